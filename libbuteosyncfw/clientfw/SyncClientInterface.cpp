@@ -24,6 +24,8 @@
 #include "SyncClientInterface.h"
 #include "SyncClientInterfacePrivate.h"
 
+#include <QMetaMethod>
+
 using namespace Buteo;
 
 SyncClientInterface::SyncClientInterface():
@@ -78,6 +80,20 @@ bool SyncClientInterface::getBackUpRestoreState()
 	return d_ptr->getBackUpRestoreState();
 }
 
+void SyncClientInterface::setProfileChangesAsXml(bool aEnabled)
+{
+	d_ptr->setProfileChangesAsXml(aEnabled);
+}
+
+void SyncClientInterface::connectNotify(const QMetaMethod &aSignal)
+{
+	if (aSignal == QMetaMethod::fromSignal(&SyncClientInterface::profileChanged) &&
+	    d_ptr != NULL) {
+		d_ptr->setProfileChangesAsXml(true);
+	}
+	QObject::connectNotify(aSignal);
+}
+
 bool SyncClientInterface::isValid()
 {
 	return d_ptr->isValid();
@@ -88,6 +104,13 @@ Buteo::SyncResults SyncClientInterface::getLastSyncResult(const QString &aProfil
     return d_ptr->getLastSyncResult(aProfileId);
 }
 
+QVariantMap SyncClientInterface::syncStatistics(const QString &aProfileId,
+                                                const QDateTime &aFrom,
+                                                const QDateTime &aTo)
+{
+    return d_ptr->syncStatistics(aProfileId, aFrom, aTo);
+}
+
 
 QList<QString /*profileAsXml*/> SyncClientInterface::allVisibleSyncProfiles()
 {
@@ -26,6 +26,7 @@
 
 #include <QObject>
 #include <QString>
+#include <QVariant>
 #include <Profile.h>
 #include <SyncProfile.h>
 #include <SyncResults.h>
@@ -147,12 +148,35 @@ public:
      */
     bool isValid();
 
+    /*!
+     * \brief Selects whether msyncd sends the full profile XML on changes.
+     *
+     * The XML is requested automatically when profileChanged() is first
+     * connected, and not sent otherwise, so that msyncd does not serialize
+     * every changed profile for clients only using profilesChanged().
+     * \param aEnabled true to receive profileChanged(), false to stop it.
+     */
+    void setProfileChangesAsXml(bool aEnabled);
+
     /*! \brief To get lastSyncResult.
      *  \param aProfileId
      *  \return SyncResults of syncLastResult.
      */
     Buteo::SyncResults getLastSyncResult(const QString &aProfileId);
 
+    /*! \brief Gets aggregated sync results of a time window.
+     *
+     * The aggregates are computed by msyncd from its long-term results
+     * history. The keys of the map are the Sync::STATS_* constants.
+     * \param aProfileId Name of the profile, empty for all profiles.
+     * \param aFrom Start of the window, invalid for no lower bound.
+     * \param aTo End of the window, invalid for no upper bound.
+     * \return Aggregates, empty if msyncd could not be reached.
+     */
+    QVariantMap syncStatistics(const QString &aProfileId,
+                               const QDateTime &aFrom = QDateTime(),
+                               const QDateTime &aTo = QDateTime());
+
     /*! \brief Gets all visible sync profiles.
      *
      * Returns all sync profiles that should be visible in sync ui. A profile
@@ -221,7 +245,8 @@ signals:
 	/*! \brief Notifies about a change in profile.
 	 *
 	 * This signal is sent when the profile data is modified or when a profile
-	 * is added or deleted in msyncd.
+	 * is added or deleted in msyncd. msyncd sends the profile XML only after
+	 * this signal has been connected.
 	 * \param aProfileId Id of the changed profile.
 	 * \param aChangeType
 	 *      0 (ADDITION): Profile was added.
@@ -232,6 +257,15 @@ signals:
 	 */
     void profileChanged(QString aProfileId,int aChangeType, QString aChangedProfile);
 
+	/*! \brief Notifies about coalesced profile changes.
+	 *
+	 * This signal is sent shortly after profiles have been added, modified or
+	 * deleted in msyncd. Each entry is a map with the profile "name", the
+	 * "changeType" (see profileChanged()) and only the changed fields.
+	 * \param aChanges List of changes in the order they happened.
+	 */
+	void profilesChanged(QVariantList aChanges);
+
 	/*! \brief Notifies about the results of a recent sync for a profile
 	 *
 	 * This signal is sent after the sync has completed for a profile.
@@ -284,6 +318,11 @@ signals:
     void transferProgress(QString aProfileId, int aTransferDatabase,
                           int aTransferType , QString aMimeType, int aCommittedItems );
 
+protected:
+
+    //! Requests the profile XML from msyncd when profileChanged() is connected.
+    virtual void connectNotify(const QMetaMethod &aSignal);
+
 private:
 
     SyncClientInterfacePrivate *d_ptr;
@@ -52,6 +52,9 @@ SyncClientInterfacePrivate::SyncClientInterfacePrivate(SyncClientInterface *aPar
         connect(this,SIGNAL(profileChanged(QString, int, QString)),
                 iParent,SIGNAL(profileChanged(QString, int, QString)));
 
+        connect(iSyncDaemon, SIGNAL(profilesChanged(QVariantList)),
+                iParent, SIGNAL(profilesChanged(QVariantList)));
+
 		connect(this,SIGNAL(resultsAvailable(QString,Buteo::SyncResults)),
 				iParent,SIGNAL(resultsAvailable(QString,Buteo::SyncResults)));
 
@@ -194,6 +197,14 @@ bool  SyncClientInterfacePrivate::getBackUpRestoreState()
 	return status;
 }
 
+void SyncClientInterfacePrivate::setProfileChangesAsXml(bool aEnabled)
+{
+    FUNCTION_CALL_TRACE;
+    if (iSyncDaemon) {
+        iSyncDaemon->setProfileChangesAsXml(aEnabled);
+    } // no else
+}
+
 bool SyncClientInterfacePrivate::isValid()
 {
 	return(iSyncDaemon && iSyncDaemon->isValid());
@@ -222,6 +233,20 @@ Buteo::SyncResults SyncClientInterfacePrivate::getLastSyncResult(const QString &
     return syncResult;
 }
 
+QVariantMap SyncClientInterfacePrivate::syncStatistics(const QString &aProfileId,
+                                                       const QDateTime &aFrom,
+                                                       const QDateTime &aTo)
+{
+    FUNCTION_CALL_TRACE;
+    QVariantMap statistics;
+    if (iSyncDaemon) {
+        statistics = iSyncDaemon->syncStatistics(aProfileId,
+                aFrom.isValid() ? aFrom.toMSecsSinceEpoch() : 0,
+                aTo.isValid() ? aTo.toMSecsSinceEpoch() : 0);
+    }
+    return statistics;
+}
+
 QList<QString /*profilesAsXml*/> SyncClientInterfacePrivate::allVisibleSyncProfiles()
 {
     FUNCTION_CALL_TRACE;
@@ -86,6 +86,12 @@ public:
 	 */
 	bool getBackUpRestoreState();
 
+	/*! \brief Selects whether msyncd sends profileChanged with the profile XML
+	 *
+	 * @param aEnabled true to receive profileChanged, false for profilesChanged only
+	 */
+	void setProfileChangesAsXml(bool aEnabled);
+
 	/*! \brief function to check if the interface is valid
 	 *
 	 * @return  status of the validity of the interface
@@ -119,6 +125,10 @@ public:
      */
     Buteo::SyncResults getLastSyncResult(const QString &aProfileId);
 
+    //! \see SyncClientInterface::syncStatistics
+    QVariantMap syncStatistics(const QString &aProfileId, const QDateTime &aFrom,
+                               const QDateTime &aTo);
+
     /*! \brief Gets all visible sync profiles.
      *
      * Returns all sync profiles that should be visible in sync ui. A profile
@@ -100,6 +100,21 @@ public Q_SLOTS: // METHODS
         return asyncCallWithArgumentList(QLatin1String("getLastSyncResult"), argumentList);
     }
 
+    //! \see SyncDBusInterface::syncStatistics()
+    inline QDBusPendingReply<QVariantMap> syncStatistics(const QString &aProfileId, qlonglong aFromTime, qlonglong aToTime)
+    {
+        QList<QVariant> argumentList;
+        argumentList << qVariantFromValue(aProfileId) << qVariantFromValue(aFromTime) << qVariantFromValue(aToTime);
+        return asyncCallWithArgumentList(QLatin1String("syncStatistics"), argumentList);
+    }
+
+    //! \see SyncDBusInterface::syncConcurrency()
+    inline QDBusPendingReply<QVariantMap> syncConcurrency()
+    {
+        QList<QVariant> argumentList;
+        return asyncCallWithArgumentList(QLatin1String("syncConcurrency"), argumentList);
+    }
+
     //! \see SyncDBusInterface::isLastSyncScheduled()
     inline QDBusPendingReply<bool> isLastSyncScheduled(const QString &aProfileId)
     {
@@ -178,6 +193,14 @@ public Q_SLOTS: // METHODS
         return asyncCallWithArgumentList(QLatin1String("setSyncSchedule"), argumentList);
     }
 
+    //! \see SyncDBusInterface::setProfileChangesAsXml()
+    inline QDBusPendingReply<> setProfileChangesAsXml(bool aEnabled)
+    {
+        QList<QVariant> argumentList;
+        argumentList << qVariantFromValue(aEnabled);
+        return asyncCallWithArgumentList(QLatin1String("setProfileChangesAsXml"), argumentList);
+    }
+
     //! \see SyncDBusInterface::startSync()
     inline QDBusPendingReply<bool> startSync(const QString &aProfileId)
     {
@@ -238,6 +261,9 @@ Q_SIGNALS: // SIGNALS
     //! \see SyncDBusInterface::signalProfileChanged()
     void signalProfileChanged(const QString &aProfileName, int aChangeType, const QString &aProfileAsXml);
 
+    //! \see SyncDBusInterface::profilesChanged()
+    void profilesChanged(const QVariantList &aChanges);
+
     //! \see SyncDBusInterface::syncStatus()
     void syncStatus(const QString &aProfileName, int aStatus, const QString &aMessage, int aErrorCode);
 
@@ -39,6 +39,27 @@ static const QString syncCacheDir()
     return HOME_PATH + QDir::separator() + "msyncd";
 }
 
+// Keys of the map returned by SyncClientInterface::syncStatistics()
+const char STATS_COUNT[] = "count";
+const char STATS_SUCCESS_COUNT[] = "successCount";
+const char STATS_SUCCESS_RATE[] = "successRate";
+const char STATS_DURATION_P50[] = "durationP50";
+const char STATS_DURATION_P95[] = "durationP95";
+const char STATS_ITEMS[] = "items";
+const char STATS_ITEMS_PER_SECOND[] = "itemsPerSecond";
+const char STATS_ERROR_CODES[] = "errorCodes";
+const char STATS_TARGET_ITEMS[] = "targetItems";
+const char STATS_TRIGGERS[] = "triggers";
+
+// Keys of the map returned by the syncConcurrency() D-Bus method
+const char CONCURRENCY_ACTIVE[] = "active";
+const char CONCURRENCY_PEAK[] = "peak";
+const char CONCURRENCY_LIMIT[] = "limit";
+const char CONCURRENCY_ONLINE[] = "online";
+const char CONCURRENCY_DEVICE[] = "device";
+const char CONCURRENCY_CLIENTS[] = "clients";
+const char CONCURRENCY_HOSTS[] = "hosts";
+
 enum SyncStatus {
     SYNC_QUEUED = 0,
     SYNC_STARTED,
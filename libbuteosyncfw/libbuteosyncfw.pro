@@ -8,7 +8,7 @@ VER_MAJ = 0
 VER_MIN = 1
 VER_PAT = 0
 
-QT += sql xml dbus network
+QT += sql xml dbus network concurrent
 QT -= gui
 
 CONFIG += dll \
@@ -38,17 +38,29 @@ HEADERS += common/Logger.h \
            profile/BtHelper.h \
            profile/Profile.h \
            profile/Profile_p.h \
+           profile/ProfileCache.h \
            profile/ProfileEngineDefs.h \
+           profile/ProfileIndex.h \
+           profile/ProfileKeys.h \
+           profile/ProfileQuery.h \
+           profile/ProfileSnapshot.h \
+           profile/ProfileStore.h \
+           profile/ProfileXmlWriter.h \
+           profile/ProfileWriteQueue.h \
            profile/ProfileFactory.h \
            profile/ProfileField.h \
            profile/ProfileManager.h \
            profile/StorageProfile.h \
            profile/SyncLog.h \
+           profile/SyncLogJournal.h \
+           profile/SqliteProfileStore.h \
            profile/SyncProfile.h \
+           profile/SyncProfile_p.h \
            profile/SyncResults.h \
            profile/SyncSchedule.h \
            profile/SyncSchedule_p.h \
            profile/TargetResults.h \
+           profile/XmlProfileStore.h \
            pluginmgr/OOPClientPlugin.h \
            pluginmgr/OOPServerPlugin.h \
            pluginmgr/ButeoPluginIface.h
@@ -67,15 +79,25 @@ SOURCES += common/Logger.cpp \
            pluginmgr/SyncPluginBase.cpp \
            profile/BtHelper.cpp \
            profile/Profile.cpp \
+           profile/ProfileCache.cpp \
            profile/ProfileFactory.cpp \
+           profile/ProfileIndex.cpp \
+           profile/ProfileKeys.cpp \
+           profile/ProfileQuery.cpp \
+           profile/ProfileSnapshot.cpp \
+           profile/ProfileStore.cpp \
+           profile/ProfileWriteQueue.cpp \
            profile/ProfileField.cpp \
            profile/ProfileManager.cpp \
            profile/StorageProfile.cpp \
            profile/SyncLog.cpp \
+           profile/SyncLogJournal.cpp \
+           profile/SqliteProfileStore.cpp \
            profile/SyncProfile.cpp \
            profile/SyncResults.cpp \
            profile/SyncSchedule.cpp \
            profile/TargetResults.cpp \
+           profile/XmlProfileStore.cpp \
            pluginmgr/OOPClientPlugin.cpp \
            pluginmgr/OOPServerPlugin.cpp \
            pluginmgr/ButeoPluginIface.cpp
@@ -136,6 +158,7 @@ headers.files = common/Logger.h \
            profile/Profile.h \
            profile/Profile_p.h \
            profile/ProfileEngineDefs.h \
+           profile/ProfileKeys.h \
            profile/ProfileFactory.h \
            profile/ProfileField.h \
            profile/ProfileManager.h \
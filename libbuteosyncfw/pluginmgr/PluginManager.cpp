@@ -293,7 +293,7 @@ ClientPlugin* PluginManager::createClient( const QString& aPluginName,
         } else {
             LOG_CRITICAL( "Could not create plugin instance" );
             // Stop the process plugin
-            stopOOPPlugin( exePath );
+            stopOOPPlugin( exePath, aProfile.name() );
             return NULL;
         }
     }
@@ -342,7 +342,7 @@ void PluginManager::destroyClient( ClientPlugin *aPlugin )
         // Stop the OOP process        
         LOG_DEBUG( "Stopping the OOP process for " << pluginName);
         QString path = iOopClientMaps.value( pluginName );
-        stopOOPPlugin( path );
+        stopOOPPlugin( path, aPlugin->getProfileName() );
         delete aPlugin;
     }
 }
@@ -408,7 +408,7 @@ ServerPlugin* PluginManager::createServer( const QString& aPluginName,
             return plugin;
         } else {
             LOG_CRITICAL( "Could not start server plugin" );
-            stopOOPPlugin( exePath );
+            stopOOPPlugin( exePath, aProfile.name() );
             return NULL;
         }
     }
@@ -457,7 +457,7 @@ void PluginManager::destroyServer( ServerPlugin *aPlugin )
     } else if ( iOoPServerMaps.contains(pluginName) ) {
         // Stop the OOP server process
         QString path = iOoPServerMaps.value( pluginName );
-        stopOOPPlugin( path );
+        stopOOPPlugin( path, aPlugin->getProfileName() );
         delete aPlugin;
     }
 }
@@ -611,7 +611,7 @@ KLUDGE: Due to NB #169065, crashes are seen in QMetaType if we unload DLLs. Henc
 
 }
 
-bool PluginManager::killProcess( const QString& aPath )
+bool PluginManager::killProcess( const QString& aPath, const QString& aProfileName )
 {
     const QFileInfo pluginFile(aPath);
     const QDir proc("/proc");
@@ -620,7 +620,8 @@ bool PluginManager::killProcess( const QString& aPath )
         int pid = entry.toInt();
         if (pid) {
             QString exe = QFile::symLinkTarget(proc.filePath(entry).append("/exe"));
-            if (!exe.isEmpty() && QFileInfo(exe) == pluginFile) {
+            if (!exe.isEmpty() && QFileInfo(exe) == pluginFile &&
+                processProfileName(proc.filePath(entry)) == aProfileName) {
                 if (kill(pid, SIGTERM) == 0) {
                     LOG_DEBUG( "Process" << pid << "has been killed");
                     return true;
@@ -635,13 +636,25 @@ bool PluginManager::killProcess( const QString& aPath )
     return false;
 }
 
+QString PluginManager::processProfileName( const QString& aProcDir )
+{
+    // The command line of a plugin process is "<exe> <plugin> <profile>",
+    // with the arguments separated by null characters.
+    QFile cmdline(aProcDir + "/cmdline");
+    if (!cmdline.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    const QList<QByteArray> args = cmdline.readAll().split('\0');
+    return args.size() > 2 ? QString::fromLocal8Bit(args.at(2)) : QString();
+}
+
 QProcess* PluginManager::startOOPPlugin( const QString &aPath,
                                     const QString& aPluginName,
                                     const QString& aProfileName)
 {
     FUNCTION_CALL_TRACE;
 
-    if (killProcess(aPath)) {
+    if (killProcess(aPath, aProfileName)) {
         LOG_INFO( "Killed runaway plugin" << aProfileName);
     }
 
@@ -708,7 +721,7 @@ QProcess* PluginManager::startOOPPlugin( const QString &aPath,
     }
 }
 
-void PluginManager::stopOOPPlugin( const QString &aPath )
+void PluginManager::stopOOPPlugin( const QString &aPath, const QString &aProfileName )
 {
     FUNCTION_CALL_TRACE;
 
@@ -716,8 +729,10 @@ void PluginManager::stopOOPPlugin( const QString &aPath )
 
     iDllLock.lockForWrite();
 
+    // Several processes of the same plugin can run for different profiles.
     for( int i = 0; i < iLoadedDlls.size(); ++i ) {
-        if( iLoadedDlls[i].iPath == aPath ) {
+        if( iLoadedDlls[i].iPath == aPath &&
+            ((QProcess*)iLoadedDlls[i].iHandle)->arguments().value(1) == aProfileName ) {
             process = (QProcess*)iLoadedDlls[i].iHandle;
             break;
         }
@@ -190,13 +190,15 @@ private:
 
     void unloadDll( const QString& aPath );
 
-    static bool killProcess( const QString& aPath );
+    static bool killProcess( const QString& aPath, const QString& aProfileName );
+
+    static QString processProfileName( const QString& aProcDir );
 
     QProcess* startOOPPlugin( const QString& aPath,
                               const QString& aPluginName,
                               const QString& aProfileName );
 
-    void stopOOPPlugin( const QString& aPath );
+    void stopOOPPlugin( const QString& aPath, const QString& aProfileName );
 
     QString                 iPluginPath;
 
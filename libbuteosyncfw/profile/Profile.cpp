@@ -27,9 +27,12 @@
 #include "Profile_p.h"
 
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include "ProfileFactory.h"
 #include "ProfileEngineDefs.h"
+#include "ProfileXmlWriter.h"
 
 #include "LogMacros.h"
 
@@ -68,7 +71,7 @@ Profile::Profile(const QDomElement &aRoot)
         QString value = key.attribute(ATTR_VALUE);
         if (!name.isEmpty() && !value.isNull())
         {
-            d_ptr->iLocalKeys.insertMulti(name, value);
+            d_ptr->iLocalKeys.insertMulti(ProfileKeys::intern(name), value);
         }
         else
         {
@@ -96,6 +99,60 @@ Profile::Profile(const QDomElement &aRoot)
     }
 }
 
+Profile::Profile(QXmlStreamReader &aReader)
+:   d_ptr(new ProfilePrivate())
+{
+    QXmlStreamAttributes attributes = aReader.attributes();
+    d_ptr->iName = attributes.value(ATTR_NAME).toString();
+    d_ptr->iType = attributes.value(ATTR_TYPE).toString();
+
+    while (aReader.readNextStartElement())
+    {
+        if (!readChildElement(aReader))
+        {
+            aReader.skipCurrentElement();
+        } // no else
+    }
+}
+
+bool Profile::readChildElement(QXmlStreamReader &aReader)
+{
+    if (aReader.name() == TAG_KEY)
+    {
+        QXmlStreamAttributes attributes = aReader.attributes();
+        QString name = attributes.value(ATTR_NAME).toString();
+        if (!name.isEmpty() && attributes.hasAttribute(ATTR_VALUE))
+        {
+            d_ptr->iLocalKeys.insertMulti(ProfileKeys::intern(name),
+                    attributes.value(ATTR_VALUE).toString());
+        }
+        else
+        {
+            // Invalid key
+        }
+        aReader.skipCurrentElement();
+    }
+    else if (aReader.name() == TAG_FIELD)
+    {
+        d_ptr->iLocalFields.append(new ProfileField(aReader));
+    }
+    else if (aReader.name() == TAG_PROFILE)
+    {
+        ProfileFactory pf;
+        Profile *subProfile = pf.createProfile(aReader);
+        if (subProfile != 0)
+        {
+            d_ptr->iSubProfiles.append(subProfile);
+        } // no else
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
 Profile::Profile(const Profile &aSource)
 :   d_ptr(new ProfilePrivate(*aSource.d_ptr))
 {
@@ -119,13 +176,17 @@ QString Profile::name() const
 
 void Profile::setName(const QString &aName)
 {
-    d_ptr->iName = aName;
+    if (d_ptr->iName != aName)
+    {
+        d_ptr->iName = aName;
+        d_ptr->iModified = true;
+    } // no else
 }
 
 void Profile::setName(const QStringList &aKeys)
 {
     	
-    d_ptr->iName = generateProfileId(aKeys);
+    Profile::setName(generateProfileId(aKeys));
 }
 
 QString Profile::type() const
@@ -135,30 +196,54 @@ QString Profile::type() const
 
 QString Profile::key(const QString &aName, const QString &aDefault) const
 {
-    QString value;
-    if (d_ptr->iLocalKeys.contains(aName))
+    // A name that was never interned is not a key of any profile.
+    const qint32 id = ProfileKeys::find(aName);
+    if (id < 0)
     {
-        value = d_ptr->iLocalKeys[aName];
-    }
-    else if (d_ptr->iMergedKeys.contains(aName))
+        return aDefault;
+    } // no else
+
+    const QString *value = keyValue(id);
+    return (value != 0) ? *value : aDefault;
+}
+
+const QString *Profile::keyValue(quint32 aId) const
+{
+    const QString *value = d_ptr->iLocalKeys.value(aId);
+    if (value == 0)
     {
-        value = d_ptr->iMergedKeys[aName];
+        value = d_ptr->iMergedKeys.value(aId);
+    } // no else
+
+    return value;
+}
+
+bool Profile::boolKey(quint32 aId, bool aDefault) const
+{
+    const QString *value = keyValue(aId);
+    if (value != 0)
+    {
+        return (value->compare(BOOLEAN_TRUE, Qt::CaseInsensitive) == 0);
     }
     else
     {
-        value = aDefault;
+        return aDefault;
     }
-    return value;
 }
 
 QMap<QString, QString> Profile::allKeys() const
 {
-    QMap<QString, QString> keys(d_ptr->iMergedKeys);
-    keys.unite(d_ptr->iLocalKeys);
+    QMap<QString, QString> keys(d_ptr->iMergedKeys.toMap());
+    keys.unite(d_ptr->iLocalKeys.toMap());
 
     return keys;
 }
 
+QMap<QString, QString> Profile::localKeys() const
+{
+    return d_ptr->iLocalKeys.toMap();
+}
+
 QMap<QString, QString> Profile::allNonStorageKeys() const
 {
     QMap<QString, QString> keys;
@@ -178,26 +263,25 @@ QMap<QString, QString> Profile::allNonStorageKeys() const
 
 bool Profile::boolKey(const QString &aName, bool aDefault) const
 {
-    QString value = key(aName);
-    if (!value.isNull())
-    {
-        return (key(aName).compare(BOOLEAN_TRUE, Qt::CaseInsensitive) == 0);
-    }
-    else
-    {
-        return aDefault;
-    }
+    const qint32 id = ProfileKeys::find(aName);
+    return (id < 0) ? aDefault : boolKey(static_cast<quint32>(id), aDefault);
 }
 
 QStringList Profile::keyValues(const QString &aName) const
 {
-    return (d_ptr->iLocalKeys.values(aName) +
-            d_ptr->iMergedKeys.values(aName));
+    const qint32 id = ProfileKeys::find(aName);
+    if (id < 0)
+    {
+        return QStringList();
+    } // no else
+
+    return (d_ptr->iLocalKeys.values(id) +
+            d_ptr->iMergedKeys.values(id));
 }
 
 QStringList Profile::keyNames() const
 {
-    return d_ptr->iLocalKeys.uniqueKeys() + d_ptr->iMergedKeys.uniqueKeys();
+    return d_ptr->iLocalKeys.uniqueNames() + d_ptr->iMergedKeys.uniqueNames();
 }
 
 void Profile::setKey(const QString &aName, const QString &aValue)
@@ -211,19 +295,30 @@ void Profile::setKey(const QString &aName, const QString &aValue)
     if (aValue.isNull())
     {
         // Setting a key value to null removes the key.
-        d_ptr->iLocalKeys.remove(aName);
-        d_ptr->iMergedKeys.remove(aName);
+        removeKey(aName);
     }
     else
     {
-        d_ptr->iLocalKeys.insert(aName, aValue);
+        const quint32 id = ProfileKeys::intern(aName);
+        const QString *value = d_ptr->iLocalKeys.value(id);
+        if (value == 0 || *value != aValue)
+        {
+            d_ptr->iLocalKeys.insert(id, aValue);
+            d_ptr->iModified = true;
+        } // no else
     }
 }
 
 void Profile::setKeyValues(const QString &aName, const QStringList &aValues)
 {
-    d_ptr->iLocalKeys.remove(aName);
-    d_ptr->iMergedKeys.remove(aName);
+    const quint32 id = ProfileKeys::intern(aName);
+    if (d_ptr->iLocalKeys.values(id) != aValues)
+    {
+        d_ptr->iModified = true;
+    } // no else
+
+    d_ptr->iLocalKeys.remove(id);
+    d_ptr->iMergedKeys.remove(id);
 
     if (aValues.size() == 0)
         return;
@@ -232,19 +327,28 @@ void Profile::setKeyValues(const QString &aName, const QStringList &aValues)
     do
     {
         i--;
-        d_ptr->iLocalKeys.insertMulti(aName, aValues[i]);
+        d_ptr->iLocalKeys.insertMulti(id, aValues[i]);
     } while (i > 0);
 }
 
 void Profile::setBoolKey(const QString &aName, bool aValue)
 {
-    d_ptr->iLocalKeys.insert(aName, aValue ? BOOLEAN_TRUE : BOOLEAN_FALSE);
+    setKey(aName, aValue ? BOOLEAN_TRUE : BOOLEAN_FALSE);
 }
 
 void Profile::removeKey(const QString &aName)
 {
-    d_ptr->iLocalKeys.remove(aName);
-    d_ptr->iMergedKeys.remove(aName);
+    const qint32 id = ProfileKeys::find(aName);
+    if (id < 0)
+    {
+        return;
+    } // no else
+
+    if (d_ptr->iLocalKeys.remove(id) > 0)
+    {
+        d_ptr->iModified = true;
+    } // no else
+    d_ptr->iMergedKeys.remove(id);
 }
 
 const ProfileField *Profile::field(const QString &aName) const
@@ -280,7 +384,8 @@ QList<const ProfileField*> Profile::visibleFields() const
         // it should be possible for the user to modify it.
         if (f->visible() == ProfileField::VISIBLE_ALWAYS ||
             (f->visible() == ProfileField::VISIBLE_USER &&
-            !d_ptr->iMergedKeys.contains(f->name())))
+            (ProfileKeys::find(f->name()) < 0 ||
+             !d_ptr->iMergedKeys.contains(ProfileKeys::find(f->name())))))
         {
             visibleFields.append(f);
         } // no else
@@ -297,12 +402,12 @@ QDomElement Profile::toXml(QDomDocument &aDoc, bool aLocalOnly) const
     root.setAttribute(ATTR_TYPE, d_ptr->iType);
 
     // Set local keys.
-    QMap<QString, QString>::const_iterator i;
-    for (i = d_ptr->iLocalKeys.begin(); i != d_ptr->iLocalKeys.end(); i++)
+    typedef QPair<QString, QString> KeyEntry;
+    foreach (const KeyEntry &entry, d_ptr->iLocalKeys.namedEntries())
     {
         QDomElement key = aDoc.createElement(TAG_KEY);
-        key.setAttribute(ATTR_NAME, i.key());
-        key.setAttribute(ATTR_VALUE, i.value());
+        key.setAttribute(ATTR_NAME, entry.first);
+        key.setAttribute(ATTR_VALUE, entry.second);
         root.appendChild(key);
     }
 
@@ -316,11 +421,11 @@ QDomElement Profile::toXml(QDomDocument &aDoc, bool aLocalOnly) const
     if (!aLocalOnly)
     {
         // Set merged keys.
-        for (i = d_ptr->iMergedKeys.begin(); i != d_ptr->iMergedKeys.end(); i++)
+        foreach (const KeyEntry &entry, d_ptr->iMergedKeys.namedEntries())
         {
             QDomElement key = aDoc.createElement(TAG_KEY);
-            key.setAttribute(ATTR_NAME, i.key());
-            key.setAttribute(ATTR_VALUE, i.value());
+            key.setAttribute(ATTR_NAME, entry.first);
+            key.setAttribute(ATTR_VALUE, entry.second);
             root.appendChild(key);
         }
 
@@ -344,17 +449,74 @@ QDomElement Profile::toXml(QDomDocument &aDoc, bool aLocalOnly) const
     return root;
 }
 
+void Profile::toXml(QXmlStreamWriter &aWriter, bool aLocalOnly) const
+{
+    aWriter.writeStartElement(TAG_PROFILE);
+    writeXmlContent(aWriter, aLocalOnly);
+    aWriter.writeEndElement();
+}
+
+void Profile::writeXmlContent(QXmlStreamWriter &aWriter, bool aLocalOnly) const
+{
+    // Set profile name and type attributes.
+    aWriter.writeAttribute(ATTR_NAME, d_ptr->iName);
+    aWriter.writeAttribute(ATTR_TYPE, d_ptr->iType);
+
+    // Set local keys.
+    typedef QPair<QString, QString> KeyEntry;
+    foreach (const KeyEntry &entry, d_ptr->iLocalKeys.namedEntries())
+    {
+        aWriter.writeStartElement(TAG_KEY);
+        aWriter.writeAttribute(ATTR_NAME, entry.first);
+        aWriter.writeAttribute(ATTR_VALUE, entry.second);
+        aWriter.writeEndElement();
+    }
+
+    // Set local fields.
+    const ProfileField *field = 0;
+    foreach (field, d_ptr->iLocalFields)
+    {
+        field->toXml(aWriter);
+    }
+
+    if (!aLocalOnly)
+    {
+        // Set merged keys.
+        foreach (const KeyEntry &entry, d_ptr->iMergedKeys.namedEntries())
+        {
+            aWriter.writeStartElement(TAG_KEY);
+            aWriter.writeAttribute(ATTR_NAME, entry.first);
+            aWriter.writeAttribute(ATTR_VALUE, entry.second);
+            aWriter.writeEndElement();
+        }
+
+        // Set merged fields.
+        foreach (field, d_ptr->iMergedFields)
+        {
+            field->toXml(aWriter);
+        }
+    } // no else
+
+    // Set sub-profiles.
+    foreach (Profile *p, d_ptr->iSubProfiles)
+    {
+        if (!p->d_ptr->iMerged || !p->d_ptr->iLocalKeys.isEmpty() ||
+            !p->d_ptr->iLocalFields.isEmpty())
+        {
+            p->toXml(aWriter, aLocalOnly);
+        } // no else
+    }
+}
+
 QString Profile::toString() const
 {
-    QDomDocument doc;
-    QDomProcessingInstruction xmlHeading =
-        doc.createProcessingInstruction("xml",
-        "version=\"1.0\" encoding=\"UTF-8\"");
-    doc.appendChild(xmlHeading);
-    QDomElement root = toXml(doc, false);
-    doc.appendChild(root);
+    QString xml;
+    QXmlStreamWriter writer(&xml);
+    beginXmlDocument(writer);
+    toXml(writer, false);
+    endXmlDocument(writer);
 
-    return doc.toString(PROFILE_INDENT);
+    return xml;
 }
 
 bool Profile::isValid() const
@@ -492,16 +654,30 @@ void Profile::merge(const Profile &aSource)
         target = pf.createProfile(aSource.name(), aSource.type());
         if (target != 0)
         {
+            // Merged sub-profiles are not written out, unless they get
+            // local data of their own.
             target->d_ptr->iMerged = true;
+            target->d_ptr->iModified = false;
             d_ptr->iSubProfiles.append(target);
         } // no else
     } // no else
 
     if (target != 0)
     {
-        // Merge keys. Allow multiple keys with the same name.
-        target->d_ptr->iMergedKeys.unite(aSource.d_ptr->iLocalKeys);
-        target->d_ptr->iMergedKeys.unite(aSource.d_ptr->iMergedKeys);
+        // Merge keys. Allow multiple keys with the same name. A target
+        // without keys shares the source key map until either one changes.
+        if (target->d_ptr->iMergedKeys.isEmpty())
+        {
+            target->d_ptr->iMergedKeys = aSource.d_ptr->iLocalKeys;
+        }
+        else
+        {
+            target->d_ptr->iMergedKeys.unite(aSource.d_ptr->iLocalKeys);
+        }
+        if (!aSource.d_ptr->iMergedKeys.isEmpty())
+        {
+            target->d_ptr->iMergedKeys.unite(aSource.d_ptr->iMergedKeys);
+        } // no else
 
         // Merge fields.
         QList<const ProfileField*> sourceFields =
@@ -532,9 +708,39 @@ void Profile::setLoaded(bool aLoaded)
     d_ptr->iLoaded = aLoaded;
 }
 
+bool Profile::isModified() const
+{
+    if (d_ptr->iModified)
+    {
+        return true;
+    } // no else
+
+    foreach (const Profile *p, d_ptr->iSubProfiles)
+    {
+        if (p->isModified())
+        {
+            return true;
+        } // no else
+    }
+
+    return false;
+}
+
+void Profile::setModified(bool aModified)
+{
+    d_ptr->iModified = aModified;
+    if (!aModified)
+    {
+        foreach (Profile *p, d_ptr->iSubProfiles)
+        {
+            p->setModified(false);
+        }
+    } // no else
+}
+
 bool Profile::isEnabled() const
 {
-    return boolKey(KEY_ENABLED, true);
+    return boolKey(ProfileKeys::ENABLED, true);
 }
 
 void Profile::setEnabled(bool aEnabled)
@@ -544,17 +750,18 @@ void Profile::setEnabled(bool aEnabled)
 
 bool Profile::isHidden() const
 {
-    return boolKey(KEY_HIDDEN);
+    return boolKey(ProfileKeys::HIDDEN, false);
 }
 
 bool Profile::isProtected() const
 {
-    return boolKey(KEY_PROTECTED);
+    return boolKey(ProfileKeys::PROTECTED, false);
 }
 
 QString Profile::displayname() const
 {
-    return key(KEY_DISPLAY_NAME);
+    const QString *value = keyValue(ProfileKeys::DISPLAY_NAME);
+    return (value != 0) ? *value : QString();
 }
 
 QString Profile::generateProfileId(const QStringList &aKeys)
@@ -32,6 +32,8 @@
 
 class QDomDocument;
 class QDomElement;
+class QXmlStreamReader;
+class QXmlStreamWriter;
 
 namespace Buteo {
     
@@ -84,6 +86,13 @@ public:
      */
     explicit Profile(const QDomElement &aRoot);
 
+    /*! \brief Constructs a Profile from an XML stream.
+     *
+     * \param aReader Reader positioned at the start element of the profile.
+     *  On return the reader is positioned at the matching end element.
+     */
+    explicit Profile(QXmlStreamReader &aReader);
+
     /*! \brief Copy constructor.
      *
      * \param aSource Copy source.
@@ -141,6 +150,17 @@ public:
      */
     virtual QDomElement toXml(QDomDocument &aDoc, bool aLocalOnly = true) const;
 
+    /*! \brief Writes a XML representation of the profile to a stream.
+     *
+     * The output is the same as for the QDomDocument version. The writer
+     * can write to a QIODevice or a QByteArray directly.
+     * \param aWriter Writer to write the profile element with.
+     * \param aLocalOnly Should only local profile elements be present in the
+     *  generated XML. If this is true, elements merged from sub-profiles are
+     *  not included.
+     */
+    virtual void toXml(QXmlStreamWriter &aWriter, bool aLocalOnly = true) const;
+
     /*! \brief Outputs a XML representation of the profile to a string.
      *
      * Merged sub-profile data is also included in the output string.
@@ -164,6 +184,14 @@ public:
      */
     QMap<QString, QString> allKeys() const;
 
+    /*! \brief Gets the keys set in this profile itself.
+     *
+     * Keys merged from sub-profiles are not included. These are the keys
+     * written to the profile file.
+     * \return Map of key names/values.
+     */
+    QMap<QString, QString> localKeys() const;
+
     /*! \brief Gets all keys that are not related to storages.
      *
      * \return Map of key names/values.
@@ -345,6 +373,25 @@ public:
      */
     void setLoaded(bool aLoaded);
 
+    /*! \brief Checks if the profile has been modified.
+     *
+     * A profile is modified if its name, local keys or local fields, or
+     * those of any of its sub-profiles, have changed since it was loaded
+     * from profile storage. Merging sub-profiles does not modify a profile.
+     * Profiles not loaded from profile storage are always modified.
+     * \return Is the profile modified.
+     */
+    bool isModified() const;
+
+    /*! \brief Sets if the profile has been modified.
+     *
+     * This function is used by the ProfileManager, which clears the flag when
+     * a profile is loaded. Clearing the flag clears it from all sub-profiles
+     * also.
+     * \param aModified Is the profile modified.
+     */
+    void setModified(bool aModified);
+
     /*! \brief Returns if the profile is enabled.
      *
      * \return Is the profile enabled.
@@ -371,10 +418,42 @@ public:
      */
     bool isProtected() const;
 
+protected:
+
+    /*! \brief Reads a child element of the profile from an XML stream.
+     *
+     * Keys, fields and sub-profiles are read. Stream constructors of derived
+     * classes use this for the elements they do not handle themselves.
+     * \param aReader Reader positioned at the start element of the child.
+     * \return True if the element was read. False if the element is not
+     *  known, the reader is not moved then.
+     */
+    bool readChildElement(QXmlStreamReader &aReader);
+
+    /*! \brief Writes the attributes and child elements of the profile.
+     *
+     * Stream serializers of derived classes use this between writing the
+     * start and end of the profile element.
+     * \param aWriter Writer positioned inside the profile start element.
+     * \param aLocalOnly See toXml().
+     */
+    void writeXmlContent(QXmlStreamWriter &aWriter, bool aLocalOnly) const;
+
 private:
 
     Profile& operator=(const Profile &aRhs);
 
+    /*! \brief Gets the value of a key by its interned id.
+     *
+     * Local keys take precedence over merged keys.
+     * \param aId Interned key id, see ProfileKeys.
+     * \return Pointer to the value or null if the key does not exist.
+     */
+    const QString *keyValue(quint32 aId) const;
+
+    //! \see boolKey(const QString &, bool)
+    bool boolKey(quint32 aId, bool aDefault) const;
+
     ProfilePrivate *d_ptr;
 
     /*! \brief Generates a profile id based on keys
@@ -385,6 +464,9 @@ private:
      */ 
     QString generateProfileId(const QStringList &aKeys);
 
+    friend class ProfileSnapshot;
+    friend class ProfileQuery;
+
 #ifdef SYNCFW_UNIT_TESTS
     friend class ProfileTest;
 #endif
@@ -0,0 +1,770 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileCache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWeakPointer>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <sys/stat.h>
+
+#include "Profile.h"
+#include "SyncProfile.h"
+#include "SyncLog.h"
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+static const QString LOG_DIRECTORY_NAME = "logs";
+static const QString LOG_SUFFIX = ".log";
+static const QString PROFILE_SUFFIX = ".xml";
+
+// Registry of live caches, keyed by the profile paths they serve.
+static QMutex cacheRegistryMutex;
+static QHash<QString, QWeakPointer<ProfileCache> > cacheRegistry;
+
+QSharedPointer<ProfileCache> ProfileCache::instance(const QString &aPrimaryPath,
+                                                    const QString &aSecondaryPath,
+                                                    bool *aCreated)
+{
+    QMutexLocker locker(&cacheRegistryMutex);
+
+    const QString registryKey = aPrimaryPath + QLatin1Char('\n') + aSecondaryPath;
+    QSharedPointer<ProfileCache> cache = cacheRegistry.value(registryKey).toStrongRef();
+    if (aCreated != 0)
+    {
+        *aCreated = cache.isNull();
+    } // no else
+
+    if (cache.isNull())
+    {
+        cache = QSharedPointer<ProfileCache>(new ProfileCache(aPrimaryPath,
+                                                              aSecondaryPath));
+        cacheRegistry.insert(registryKey, cache.toWeakRef());
+    } // no else
+
+    return cache;
+}
+
+ProfileCache::ProfileCache(const QString &aPrimaryPath,
+                           const QString &aSecondaryPath)
+:   iSnapshot(aPrimaryPath, aSecondaryPath),
+    iSnapshotChecked(false),
+    iSnapshotOutdated(false),
+    iWatcher(new QFileSystemWatcher(this)),
+    iWriteQueue(new ProfileWriteQueue(this)),
+    iPrimaryPath(aPrimaryPath),
+    iSecondaryPath(aSecondaryPath)
+{
+    FUNCTION_CALL_TRACE;
+
+    connect(iWatcher, SIGNAL(directoryChanged(QString)),
+            this, SLOT(onDirectoryChanged(QString)));
+    connect(iWatcher, SIGNAL(fileChanged(QString)),
+            this, SLOT(onFileChanged(QString)));
+    // Recorded in the writing thread, before the watcher can report it.
+    connect(iWriteQueue, SIGNAL(fileWritten(QString)),
+            this, SLOT(fileWritten(QString)), Qt::DirectConnection);
+
+    // Profile type directories may be created later.
+    watch(QStringList() << iPrimaryPath << iSecondaryPath);
+}
+
+ProfileCache::~ProfileCache()
+{
+    FUNCTION_CALL_TRACE;
+
+    iSnapshotWrite.waitForFinished();
+
+    iProfiles.clear();
+    qDeleteAll(iSyncProfiles);
+    iSyncProfiles.clear();
+}
+
+Profile *ProfileCache::profile(const QString &aName, const QString &aType)
+{
+    QMutexLocker locker(&iMutex);
+
+    QSharedPointer<const Profile> cached = iProfiles.value(cacheKey(aName, aType));
+    return (!cached.isNull()) ? cached->clone() : 0;
+}
+
+QSharedPointer<const Profile> ProfileCache::sharedProfile(const QString &aName,
+                                                          const QString &aType)
+{
+    QMutexLocker locker(&iMutex);
+
+    return iProfiles.value(cacheKey(aName, aType));
+}
+
+QSharedPointer<const Profile> ProfileCache::insertProfile(Profile *aProfile,
+                                                          const QString &aPath)
+{
+    QSharedPointer<const Profile> shared(aProfile);
+    const QString type = aProfile->type();
+    {
+        QMutexLocker locker(&iMutex);
+
+        iProfiles.insert(cacheKey(aProfile->name(), type), shared);
+    }
+
+    watch(QStringList() << aPath
+          << iPrimaryPath + QDir::separator() + type
+          << iSecondaryPath + QDir::separator() + type);
+
+    return shared;
+}
+
+SyncProfile *ProfileCache::syncProfile(const QString &aName)
+{
+    QMutexLocker locker(&iMutex);
+
+    const SyncProfile *cached = iSyncProfiles.value(aName);
+    return (cached != 0) ? cached->clone() : 0;
+}
+
+bool ProfileCache::visitSyncProfile(const QString &aName,
+                                    SyncProfileVisitor &aVisitor)
+{
+    QMutexLocker locker(&iMutex);
+
+    const SyncProfile *cached = iSyncProfiles.value(aName);
+    if (cached == 0)
+    {
+        return false;
+    } // no else
+
+    aVisitor.visit(*cached);
+    return true;
+}
+
+void ProfileCache::insertSyncProfile(const SyncProfile &aProfile)
+{
+    {
+        QMutexLocker locker(&iMutex);
+
+        delete iSyncProfiles.take(aProfile.name());
+        iSyncProfiles.insert(aProfile.name(), aProfile.clone());
+    }
+
+    const QString logDir = iPrimaryPath + QDir::separator() + Profile::TYPE_SYNC +
+            QDir::separator() + LOG_DIRECTORY_NAME;
+    watch(QStringList() << logDir
+          << logDir + QDir::separator() + aProfile.name() + LOG_SUFFIX + ".xml"
+          << logDir + QDir::separator() + aProfile.name() + LOG_SUFFIX + ".journal");
+}
+
+void ProfileCache::addSyncResults(const QString &aName,
+                                  const SyncResults &aResults)
+{
+    QMutexLocker locker(&iMutex);
+
+    markSnapshotStale(aName);
+    SyncProfile *cached = iSyncProfiles.value(aName);
+    if (cached != 0)
+    {
+        if (cached->log() != 0)
+        {
+            cached->log()->addResults(aResults);
+        }
+        else
+        {
+            delete iSyncProfiles.take(aName);
+        }
+    } // no else
+}
+
+void ProfileCache::invalidate(const QString &aName, const QString &aType)
+{
+    {
+        QMutexLocker locker(&iMutex);
+
+        iProfiles.remove(cacheKey(aName, aType));
+        if (aType == Profile::TYPE_SYNC)
+        {
+            markSnapshotStale(aName);
+            delete iSyncProfiles.take(aName);
+            iIndex.markStale(aName);
+        }
+        else
+        {
+            // Any sync profile may have merged this one.
+            discardSnapshot();
+            qDeleteAll(iSyncProfiles);
+            iSyncProfiles.clear();
+            iIndex.markSubProfileStale(aName, aType);
+        }
+    }
+
+    emit invalidated(aName, aType);
+}
+
+void ProfileCache::invalidateSyncProfile(const QString &aName)
+{
+    {
+        QMutexLocker locker(&iMutex);
+        markSnapshotStale(aName);
+        delete iSyncProfiles.take(aName);
+    }
+
+    emit invalidated(aName, Profile::TYPE_SYNC);
+}
+
+void ProfileCache::invalidateAll()
+{
+    {
+        QMutexLocker locker(&iMutex);
+
+        discardSnapshot();
+        iProfiles.clear();
+        qDeleteAll(iSyncProfiles);
+        iSyncProfiles.clear();
+        iIndex.reset();
+        iListings.clear();
+    }
+
+    emit invalidated(QString(), QString());
+}
+
+ProfileIndex &ProfileCache::index()
+{
+    return iIndex;
+}
+
+QStringList ProfileCache::profileNames(const QString &aType)
+{
+    QMutexLocker locker(&iMutex);
+
+    return listing(aType).iNames;
+}
+
+QString ProfileCache::profilePath(const QString &aName, const QString &aType)
+{
+    QMutexLocker locker(&iMutex);
+
+    const DirectoryListing &dirListing = listing(aType);
+    if (dirListing.iPrimary.contains(aName))
+    {
+        return iPrimaryPath + QDir::separator() + aType + QDir::separator() +
+               aName + PROFILE_SUFFIX;
+    }
+    else if (dirListing.iSecondary.contains(aName))
+    {
+        return iSecondaryPath + QDir::separator() + aType + QDir::separator() +
+               aName + PROFILE_SUFFIX;
+    }
+    else
+    {
+        return QString();
+    }
+}
+
+bool ProfileCache::isPrimaryProfile(const QString &aName, const QString &aType)
+{
+    QMutexLocker locker(&iMutex);
+
+    return listing(aType).iPrimary.contains(aName);
+}
+
+// Inserts a name into a range of a name list, in the order the profile
+// directories are listed in.
+static void insertSorted(QStringList &aNames, int aFrom, int aTo,
+                         const QString &aName)
+{
+    const QString fileName = (aName + PROFILE_SUFFIX).toLower();
+    int pos = aFrom;
+    while (pos < aTo && (aNames.at(pos) + PROFILE_SUFFIX).toLower() < fileName)
+    {
+        pos++;
+    }
+    aNames.insert(pos, aName);
+}
+
+void ProfileCache::addToListing(const QString &aName, const QString &aType)
+{
+    QMutexLocker locker(&iMutex);
+
+    QHash<QString, DirectoryListing>::iterator i = iListings.find(aType);
+    if (i == iListings.end() || i.value().iPrimary.contains(aName))
+    {
+        return;
+    } // no else
+
+    // A name only found in the secondary directory moves to the primary
+    // names.
+    DirectoryListing &dirListing = i.value();
+    dirListing.iNames.removeOne(aName);
+    insertSorted(dirListing.iNames, 0, dirListing.iPrimary.size(), aName);
+    dirListing.iPrimary.insert(aName);
+}
+
+void ProfileCache::removeFromListing(const QString &aName, const QString &aType)
+{
+    QMutexLocker locker(&iMutex);
+
+    QHash<QString, DirectoryListing>::iterator i = iListings.find(aType);
+    if (i == iListings.end() || !i.value().iPrimary.contains(aName))
+    {
+        return;
+    } // no else
+
+    // A file in the secondary directory is no longer overridden.
+    DirectoryListing &dirListing = i.value();
+    dirListing.iNames.removeOne(aName);
+    dirListing.iPrimary.remove(aName);
+    if (dirListing.iSecondary.contains(aName))
+    {
+        insertSorted(dirListing.iNames, dirListing.iPrimary.size(),
+                     dirListing.iNames.size(), aName);
+    } // no else
+}
+
+const ProfileCache::DirectoryListing &ProfileCache::listing(const QString &aType)
+{
+    QHash<QString, DirectoryListing>::const_iterator i = iListings.constFind(aType);
+    if (i != iListings.constEnd())
+    {
+        return i.value();
+    } // no else
+
+    const DirectoryListing dirListing = scanListing(aType);
+
+    // Changes in the directories update the listing.
+    watch(QStringList() << iPrimaryPath + QDir::separator() + aType
+          << iSecondaryPath + QDir::separator() + aType);
+
+    return iListings.insert(aType, dirListing).value();
+}
+
+ProfileCache::DirectoryListing ProfileCache::scanListing(const QString &aType) const
+{
+    DirectoryListing dirListing;
+    const QString paths[2] = { iPrimaryPath + QDir::separator() + aType,
+                               iSecondaryPath + QDir::separator() + aType };
+    QSet<QString> *names[2] = { &dirListing.iPrimary, &dirListing.iSecondary };
+    for (int p = 0; p < 2; p++)
+    {
+        QDir dir(paths[p]);
+        QFileInfoList fileInfoList = dir.entryInfoList(
+                QStringList(QString("*") + PROFILE_SUFFIX),
+                QDir::Files | QDir::NoSymLinks);
+        foreach (const QFileInfo &fileInfo, fileInfoList)
+        {
+            const QString name = fileInfo.completeBaseName();
+            names[p]->insert(name);
+            // Add only if the list does not yet contain the name.
+            if (p == 0 || !dirListing.iPrimary.contains(name))
+            {
+                dirListing.iNames.append(name);
+            } // no else
+        }
+    }
+
+    return dirListing;
+}
+
+QStringList ProfileCache::rescanListing(const QString &aType)
+{
+    const DirectoryListing fresh = scanListing(aType);
+
+    QStringList changed;
+    QHash<QString, DirectoryListing>::const_iterator i = iListings.constFind(aType);
+    if (i != iListings.constEnd())
+    {
+        // Temporary files of atomic writes are not listed, so a rewrite of
+        // an existing file changes nothing here.
+        QSet<QString> names = i.value().iPrimary + i.value().iSecondary +
+                              fresh.iPrimary + fresh.iSecondary;
+        foreach (const QString &name, names)
+        {
+            if (i.value().iPrimary.contains(name) != fresh.iPrimary.contains(name) ||
+                i.value().iSecondary.contains(name) != fresh.iSecondary.contains(name))
+            {
+                changed.append(name);
+            } // no else
+        }
+    }
+    else
+    {
+        // Without a previous listing only the cached profiles can be
+        // checked: those whose file is gone, or whose file may now be
+        // overridden by one in the primary directory.
+        QSet<QString> cached;
+        const QString prefix = cacheKey(QString(), aType);
+        foreach (const QString &key, iProfiles.keys())
+        {
+            if (key.startsWith(prefix))
+            {
+                cached.insert(key.mid(prefix.length()));
+            } // no else
+        }
+        if (aType == Profile::TYPE_SYNC)
+        {
+            cached += QSet<QString>::fromList(iSyncProfiles.keys());
+        } // no else
+
+        foreach (const QString &name, cached)
+        {
+            if (fresh.iPrimary.contains(name) == fresh.iSecondary.contains(name))
+            {
+                changed.append(name);
+            } // no else
+        }
+    }
+
+    iListings.insert(aType, fresh);
+
+    return changed;
+}
+
+ProfileWriteQueue *ProfileCache::writeQueue()
+{
+    return iWriteQueue;
+}
+
+SyncProfile *ProfileCache::snapshotProfile(const QString &aName)
+{
+    QMutexLocker locker(&iMutex);
+
+    checkSnapshot();
+
+    if (iSnapshotStale.contains(aName))
+    {
+        return 0;
+    } // no else
+
+    return iSnapshot.syncProfile(aName);
+}
+
+bool ProfileCache::snapshotNeedsRebuild()
+{
+    QMutexLocker locker(&iMutex);
+
+    checkSnapshot();
+
+    // The rebuild is claimed here, so that changes made while the profiles
+    // are loaded request another one.
+    if (!iSnapshotOutdated || !iSnapshotWrite.isFinished())
+    {
+        return false;
+    } // no else
+
+    iSnapshotOutdated = false;
+    return true;
+}
+
+QByteArray ProfileCache::snapshotSourceListing() const
+{
+    return iSnapshot.sourceListing();
+}
+
+// Writes a snapshot and releases the profile copies given to it.
+static void writeSnapshot(const QString aPrimaryPath, const QString aSecondaryPath,
+                          const QByteArray aSourceListing,
+                          const QList<const SyncProfile*> aProfiles)
+{
+    ProfileSnapshot snapshot(aPrimaryPath, aSecondaryPath);
+    snapshot.write(aSourceListing, aProfiles);
+    qDeleteAll(aProfiles);
+}
+
+void ProfileCache::rebuildSnapshot(const QByteArray &aSourceListing,
+                                   const QList<SyncProfile*> &aProfiles)
+{
+    FUNCTION_CALL_TRACE;
+
+    QList<const SyncProfile*> copies;
+    foreach (const SyncProfile *profile, aProfiles)
+    {
+        copies.append(profile->clone());
+    }
+
+    QMutexLocker locker(&iMutex);
+    if (!iSnapshotWrite.isFinished())
+    {
+        qDeleteAll(copies);
+        return;
+    } // no else
+
+    iSnapshotWrite = QtConcurrent::run(writeSnapshot, iPrimaryPath,
+                                       iSecondaryPath, aSourceListing, copies);
+}
+
+void ProfileCache::checkSnapshot()
+{
+    if (!iSnapshotChecked)
+    {
+        iSnapshotOutdated = !iSnapshot.open();
+        iSnapshotChecked = true;
+    } // no else
+}
+
+void ProfileCache::markSnapshotStale(const QString &aName)
+{
+    // The other entries stay valid. The snapshot file is rewritten on the
+    // next full load, in the background, for the benefit of other processes.
+    iSnapshotStale.insert(aName);
+    iSnapshotOutdated = true;
+}
+
+void ProfileCache::discardSnapshot()
+{
+    // The snapshot no longer reflects the profiles on disk. It is not opened
+    // again in this process, a new one is written on the next full load.
+    iSnapshot.close();
+    iSnapshotChecked = true;
+    iSnapshotStale.clear();
+    iSnapshotOutdated = true;
+}
+
+void ProfileCache::fileWritten(const QString &aPath)
+{
+    const FileState state = fileState(aPath);
+
+    QMutexLocker locker(&iMutex);
+    iOwnWrites.insert(aPath, state);
+}
+
+void ProfileCache::onDirectoryChanged(const QString &aPath)
+{
+    FUNCTION_CALL_TRACE;
+
+    // A profile file was added, removed or renamed. The directory name is the
+    // profile type, except for the sync log directory.
+    QFileInfo dirInfo(aPath);
+    if (aPath == iPrimaryPath || aPath == iSecondaryPath)
+    {
+        // A profile type directory may have been created or removed. Other
+        // entries, like the profile snapshot, do not affect the listings.
+        QHash<QString, QStringList> changed;
+        QStringList directories;
+        {
+            QMutexLocker locker(&iMutex);
+            foreach (const QString &type, iListings.keys())
+            {
+                const QString paths[2] = { iPrimaryPath + QDir::separator() + type,
+                                           iSecondaryPath + QDir::separator() + type };
+                if (QFileInfo(paths[0]).isDir() != iWatchedPaths.contains(paths[0]) ||
+                    QFileInfo(paths[1]).isDir() != iWatchedPaths.contains(paths[1]))
+                {
+                    changed.insert(type, rescanListing(type));
+                    directories << paths[0] << paths[1];
+                } // no else
+            }
+        }
+
+        QHash<QString, QStringList>::const_iterator i;
+        for (i = changed.constBegin(); i != changed.constEnd(); ++i)
+        {
+            foreach (const QString &name, i.value())
+            {
+                invalidate(name, i.key());
+            }
+        }
+        watchPaths(directories);
+    }
+    else if (dirInfo.fileName() == LOG_DIRECTORY_NAME)
+    {
+        // Log files that appeared or disappeared for cached sync profiles.
+        // Changes of existing files are seen by their own watches.
+        QStringList changed;
+        QStringList created;
+        {
+            QMutexLocker locker(&iMutex);
+            foreach (const QString &name, iSyncProfiles.keys())
+            {
+                const QString logPath = aPath + QDir::separator() + name + LOG_SUFFIX;
+                foreach (const QString &path, QStringList() << logPath + ".xml"
+                                                            << logPath + ".journal")
+                {
+                    const bool exists = QFile::exists(path);
+                    if (exists == iWatchedPaths.contains(path))
+                    {
+                        continue;
+                    } // no else
+
+                    if (!isOwnChange(path))
+                    {
+                        changed.append(name);
+                    }
+                    else if (exists)
+                    {
+                        created.append(path);
+                    } // no else
+                }
+            }
+        }
+
+        changed.removeDuplicates();
+        foreach (const QString &name, changed)
+        {
+            invalidateSyncProfile(name);
+        }
+        watchPaths(created);
+    }
+    else
+    {
+        const QString type = dirInfo.fileName();
+        QStringList changed;
+        {
+            QMutexLocker locker(&iMutex);
+            changed = rescanListing(type);
+        }
+
+        foreach (const QString &name, changed)
+        {
+            invalidate(name, type);
+        }
+    }
+
+    if (!dirInfo.exists())
+    {
+        iWatchedPaths.remove(aPath);
+    } // no else
+}
+
+void ProfileCache::onFileChanged(const QString &aPath)
+{
+    FUNCTION_CALL_TRACE;
+
+    QFileInfo fileInfo(aPath);
+    QString name = fileInfo.completeBaseName();
+    const QString dirName = QFileInfo(fileInfo.path()).fileName();
+
+    bool ownChange = false;
+    {
+        QMutexLocker locker(&iMutex);
+        ownChange = isOwnChange(aPath);
+    }
+
+    // A replaced or removed file is no longer watched. The path is
+    // registered again when the profile is cached next time, or right away
+    // if the cached data is still valid.
+    iWatcher->removePath(aPath);
+    iWatchedPaths.remove(aPath);
+
+    if (ownChange)
+    {
+        LOG_DEBUG("Ignoring own change of" << aPath);
+        watchPaths(QStringList() << aPath);
+    }
+    else if (dirName == LOG_DIRECTORY_NAME)
+    {
+        if (name.endsWith(LOG_SUFFIX))
+        {
+            name.chop(LOG_SUFFIX.length());
+        } // no else
+        invalidateSyncProfile(name);
+    }
+    else
+    {
+        invalidate(name, dirName);
+    }
+}
+
+bool ProfileCache::isOwnChange(const QString &aPath)
+{
+    QHash<QString, FileState>::iterator i = iOwnWrites.find(aPath);
+    if (i == iOwnWrites.end())
+    {
+        return false;
+    } // no else
+
+    // Several events may be reported for one change, so the entry is kept
+    // until the file changes again.
+    if (i.value() == fileState(aPath))
+    {
+        return true;
+    } // no else
+
+    iOwnWrites.erase(i);
+    return false;
+}
+
+ProfileCache::FileState ProfileCache::fileState(const QString &aPath)
+{
+    FileState state = { false, 0, 0, 0 };
+
+    struct stat info;
+    if (::stat(QFile::encodeName(aPath).constData(), &info) == 0)
+    {
+        // Atomic writes replace the file, so its inode identifies a version.
+        state.iExists = true;
+        state.iInode = info.st_ino;
+        state.iSize = info.st_size;
+        state.iModified = qint64(info.st_mtim.tv_sec) * 1000000000 +
+                          info.st_mtim.tv_nsec;
+    } // no else
+
+    return state;
+}
+
+bool ProfileCache::FileState::operator==(const FileState &aOther) const
+{
+    return iExists == aOther.iExists && iInode == aOther.iInode &&
+           iSize == aOther.iSize && iModified == aOther.iModified;
+}
+
+void ProfileCache::watch(const QStringList &aPaths)
+{
+    // The watcher may only be used from the thread owning the cache.
+    if (QThread::currentThread() == thread())
+    {
+        watchPaths(aPaths);
+    }
+    else
+    {
+        QMetaObject::invokeMethod(this, "watchPaths", Qt::QueuedConnection,
+                                  Q_ARG(QStringList, aPaths));
+    }
+}
+
+void ProfileCache::watchPaths(const QStringList &aPaths)
+{
+    foreach (const QString &path, aPaths)
+    {
+        if (!path.isEmpty() && !iWatchedPaths.contains(path) &&
+            QFile::exists(path))
+        {
+            if (iWatcher->addPath(path))
+            {
+                iWatchedPaths.insert(path);
+            }
+            else
+            {
+                LOG_DEBUG("Could not watch profile path" << path);
+            }
+        } // no else
+    }
+}
+
+QString ProfileCache::cacheKey(const QString &aName, const QString &aType)
+{
+    return aType + QDir::separator() + aName;
+}
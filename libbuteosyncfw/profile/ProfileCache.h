@@ -0,0 +1,406 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILECACHE_H
+#define PROFILECACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QFuture>
+
+#include "ProfileIndex.h"
+#include "ProfileSnapshot.h"
+#include "ProfileWriteQueue.h"
+
+class QFileSystemWatcher;
+
+namespace Buteo {
+
+class Profile;
+class SyncProfile;
+class SyncResults;
+
+/*! \brief Process-wide cache of parsed profiles.
+ *
+ * All ProfileManager instances using the same primary and secondary profile
+ * paths share one cache. Two kinds of entries are kept: profiles as loaded
+ * from their own file (keyed by name and type), and fully expanded sync
+ * profiles with their sync log attached. Entries are invalidated when the
+ * profile directories or cached files change on disk, and explicitly by
+ * ProfileManager whenever it writes. Only the profiles whose files changed
+ * are dropped, and changes ProfileManager made itself are not seen as
+ * changes on disk. Callers always get a copy of the cached
+ * object, never the cached object itself.
+ */
+class ProfileCache : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //! \brief Read-only access to a cached sync profile in place.
+    class SyncProfileVisitor
+    {
+    public:
+        //! \brief Destructor.
+        virtual ~SyncProfileVisitor() {}
+
+        /*! \brief Reads a cached sync profile.
+         *
+         * Called with the cache locked: must not call back into the cache.
+         * \param aProfile The cached, expanded sync profile with its log.
+         */
+        virtual void visit(const SyncProfile &aProfile) = 0;
+    };
+
+    /*! \brief Gets the cache shared by all users of the given profile paths.
+     *
+     * The cache is created on first use and destroyed when the last
+     * reference to it is released.
+     * \param aPrimaryPath Primary profile path, without trailing separator.
+     * \param aSecondaryPath Secondary profile path, without trailing separator.
+     * \param aCreated If not NULL, set to true if the cache was created by
+     *  this call, false if it was in use already.
+     * \return Shared cache instance.
+     */
+    static QSharedPointer<ProfileCache> instance(const QString &aPrimaryPath,
+                                                 const QString &aSecondaryPath,
+                                                 bool *aCreated = 0);
+
+    //! \brief Destructor.
+    virtual ~ProfileCache();
+
+    /*! \brief Gets a copy of a cached profile.
+     *
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     * \return Copy of the profile, owned by the caller. NULL if not cached.
+     */
+    Profile *profile(const QString &aName, const QString &aType);
+
+    /*! \brief Gets a cached profile without copying it.
+     *
+     * The returned profile is shared with the cache and all other users of
+     * it, and must not be modified. It stays valid after the cache entry is
+     * invalidated.
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     * \return The shared profile. Null if not cached.
+     */
+    QSharedPointer<const Profile> sharedProfile(const QString &aName,
+                                                const QString &aType);
+
+    /*! \brief Stores a profile loaded from its own file.
+     *
+     * \param aProfile Profile to store. The cache takes ownership.
+     * \param aPath Path of the file the profile was loaded from.
+     * \return The stored profile, shared with the cache.
+     */
+    QSharedPointer<const Profile> insertProfile(Profile *aProfile,
+                                                const QString &aPath);
+
+    /*! \brief Gets a copy of a cached, expanded sync profile.
+     *
+     * \param aName Name of the sync profile.
+     * \return Copy of the profile including its log, owned by the caller.
+     *  NULL if not cached.
+     */
+    SyncProfile *syncProfile(const QString &aName);
+
+    /*! \brief Reads a cached, expanded sync profile without copying it.
+     *
+     * \param aName Name of the sync profile.
+     * \param aVisitor Visitor called with the profile if it is cached.
+     * \return True if the profile was cached and visited.
+     */
+    bool visitSyncProfile(const QString &aName, SyncProfileVisitor &aVisitor);
+
+    /*! \brief Stores an expanded sync profile.
+     *
+     * \param aProfile Expanded sync profile. A copy of the profile is taken.
+     */
+    void insertSyncProfile(const SyncProfile &aProfile);
+
+    /*! \brief Adds sync results to the log of a cached sync profile.
+     *
+     * Does nothing if the sync profile is not cached.
+     * \param aName Name of the sync profile.
+     * \param aResults Results that were recorded for the profile.
+     */
+    void addSyncResults(const QString &aName, const SyncResults &aResults);
+
+    /*! \brief Drops cached data of a profile.
+     *
+     * If the profile is not a sync profile, all expanded sync profiles are
+     * dropped also, because any of them may have merged the profile.
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     */
+    void invalidate(const QString &aName, const QString &aType);
+
+    /*! \brief Drops the cached expanded sync profile of the given name.
+     *
+     * Used when only the sync log of the profile changes.
+     * \param aName Name of the sync profile.
+     */
+    void invalidateSyncProfile(const QString &aName);
+
+    /*! \brief Drops all cached data.
+     */
+    void invalidateAll();
+
+    /*! \brief Gets the key index of the cached sync profiles.
+     *
+     * Invalidations mark the affected index entries stale.
+     * \return The index.
+     */
+    ProfileIndex &index();
+
+    /*! \brief Gets the names of all profiles of a type.
+     *
+     * Names of profiles in the primary directory come first, followed by
+     * those only found in the secondary directory. The directories are
+     * scanned once; after that the listing is updated from the changes made
+     * by ProfileManager and from the directory watches.
+     * \param aType Type of the profiles.
+     * \return Profile names.
+     */
+    QStringList profileNames(const QString &aType);
+
+    /*! \brief Resolves the file of a profile.
+     *
+     * A file in the primary directory overrides one in the secondary
+     * directory.
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     * \return Path of the profile file. Empty if there is no such file.
+     */
+    QString profilePath(const QString &aName, const QString &aType);
+
+    /*! \brief Checks if a profile file exists in the primary directory.
+     *
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     * \return True if the file exists.
+     */
+    bool isPrimaryProfile(const QString &aName, const QString &aType);
+
+    /*! \brief Adds a profile file created in the primary directory to the
+     * directory listing of its type.
+     *
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     */
+    void addToListing(const QString &aName, const QString &aType);
+
+    /*! \brief Removes a profile file deleted from the primary directory from
+     * the directory listing of its type.
+     *
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     */
+    void removeFromListing(const QString &aName, const QString &aType);
+
+    /*! \brief Gets the write-behind queue of the profile files.
+     *
+     * \return The queue, owned by the cache.
+     */
+    ProfileWriteQueue *writeQueue();
+
+    /*! \brief Gets an expanded sync profile from the profile snapshot.
+     *
+     * The snapshot is opened and validated on first use. Entries of sync
+     * profiles changed since then are no longer used. The whole snapshot is
+     * closed for good when a sub profile changes or all data is invalidated.
+     * \param aName Name of the sync profile.
+     * \return The profile with its log, owned by the caller. NULL if there
+     *  is no valid snapshot, or the profile is not in it or has changed.
+     */
+    SyncProfile *snapshotProfile(const QString &aName);
+
+    /*! \brief Checks if the profile snapshot should be written again.
+     *
+     * A true return claims the rebuild: it is not requested again until the
+     * profiles change once more.
+     * \return True if the snapshot is missing or outdated and none is being
+     *  written.
+     */
+    bool snapshotNeedsRebuild();
+
+    /*! \brief Gets the listing of profile source files for a new snapshot.
+     *
+     * \return Source listing, see ProfileSnapshot::sourceListing().
+     */
+    QByteArray snapshotSourceListing() const;
+
+    /*! \brief Writes a new profile snapshot in a background thread.
+     *
+     * \param aSourceListing Listing taken before the profiles were loaded.
+     * \param aProfiles All expanded sync profiles. Copies are taken.
+     */
+    void rebuildSnapshot(const QByteArray &aSourceListing,
+                         const QList<SyncProfile*> &aProfiles);
+
+public slots:
+
+    /*! \brief Records a change made to a profile file by the profile manager.
+     *
+     * Watcher events for the file are ignored for as long as the file stays
+     * as it was left by the change, so that the cache is not dropped by its
+     * own writes. Must be called after the file was written or removed.
+     * \param aPath Path of the file.
+     */
+    void fileWritten(const QString &aPath);
+
+signals:
+
+    /*! \brief Emitted when cached data of a profile is dropped.
+     *
+     * \param aName Name of the profile. Empty if all profiles were dropped.
+     * \param aType Type of the profile. Empty if all profiles were dropped.
+     */
+    void invalidated(const QString &aName, const QString &aType);
+
+private slots:
+
+    void onDirectoryChanged(const QString &aPath);
+
+    void onFileChanged(const QString &aPath);
+
+    void watchPaths(const QStringList &aPaths);
+
+private:
+
+    // Profile files found in the directories of one profile type.
+    struct DirectoryListing
+    {
+        // All names, in profileNames() order.
+        QStringList iNames;
+
+        // Names with a file in the primary directory.
+        QSet<QString> iPrimary;
+
+        // Names with a file in the secondary directory.
+        QSet<QString> iSecondary;
+    };
+
+    // Identity and size of a file, to tell own changes from others.
+    struct FileState
+    {
+        bool iExists;
+        qint64 iInode;
+        qint64 iSize;
+        qint64 iModified;
+
+        bool operator==(const FileState &aOther) const;
+    };
+
+    ProfileCache(const QString &aPrimaryPath, const QString &aSecondaryPath);
+
+    // Gets the listing of a profile type, scanning the directories if
+    // needed. Must be called with iMutex held.
+    const DirectoryListing &listing(const QString &aType);
+
+    // Reads the directories of a profile type.
+    DirectoryListing scanListing(const QString &aType) const;
+
+    // Scans the directories of a profile type again after a change and
+    // gets the names of the cached profiles whose file was added, removed or
+    // overridden. Must be called with iMutex held.
+    QStringList rescanListing(const QString &aType);
+
+    // Checks if the last change of a file was made by the profile manager.
+    // Must be called with iMutex held.
+    bool isOwnChange(const QString &aPath);
+
+    static FileState fileState(const QString &aPath);
+
+    static QString cacheKey(const QString &aName, const QString &aType);
+
+    void watch(const QStringList &aPaths);
+
+    // Opens the snapshot on first use. Must be called with iMutex held.
+    void checkSnapshot();
+
+    // Stops using the snapshot entry of a changed sync profile. Must be
+    // called with iMutex held.
+    void markSnapshotStale(const QString &aName);
+
+    // Closes the snapshot after a change. Must be called with iMutex held.
+    void discardSnapshot();
+
+    // Serializes access to the cached entries.
+    QMutex iMutex;
+
+    // Profiles as loaded from their own files, keyed by type/name. The
+    // profiles are immutable and shared with the sync profiles merging them.
+    QHash<QString, QSharedPointer<const Profile> > iProfiles;
+
+    // Expanded sync profiles with logs, keyed by name.
+    QHash<QString, SyncProfile*> iSyncProfiles;
+
+    // Key index of the sync profiles.
+    ProfileIndex iIndex;
+
+    // Directory listings, keyed by profile type. Names missing from a
+    // listing are known not to exist.
+    QHash<QString, DirectoryListing> iListings;
+
+    // Compiled snapshot of the expanded sync profiles.
+    ProfileSnapshot iSnapshot;
+
+    // Has the snapshot been opened (or found invalid) already.
+    bool iSnapshotChecked;
+
+    // Sync profiles changed since the snapshot was opened.
+    QSet<QString> iSnapshotStale;
+
+    // Have the profiles changed since the snapshot was last written.
+    bool iSnapshotOutdated;
+
+    // Background write of a new snapshot.
+    QFuture<void> iSnapshotWrite;
+
+    // Files changed by the profile manager itself, with their state after
+    // the change.
+    QHash<QString, FileState> iOwnWrites;
+
+    // Paths currently registered to the watcher.
+    QSet<QString> iWatchedPaths;
+
+    QFileSystemWatcher *iWatcher;
+
+    ProfileWriteQueue *iWriteQueue;
+
+    QString iPrimaryPath;
+
+    QString iSecondaryPath;
+};
+
+}
+
+#endif // PROFILECACHE_H
@@ -103,6 +103,7 @@ const QString KEY_STORAGE_UPDATED("storage_updated");
 const QString KEY_HTTP_PROXY_HOST("http_proxy_host");
 const QString KEY_HTTP_PROXY_PORT("http_proxy_port");
 const QString KEY_PROFILE_ID("profile_id");
+const QString KEY_MAX_PARALLEL_SESSIONS("max_parallel_sessions");
 
 const QString BOOLEAN_TRUE("true");
 const QString BOOLEAN_FALSE("false");
@@ -115,6 +116,15 @@ const QString VALUE_TO_REMOTE("to-remote");
 const QString VALUE_PREFER_REMOTE("prefer remote");
 const QString VALUE_PREFER_LOCAL("prefer local");
 
+// Entries of the change deltas of ProfileManager::signalProfileDelta().
+const QString DELTA_KEYS("keys");
+const QString DELTA_REMOVED_KEYS("removedKeys");
+const QString DELTA_RESULTS("results");
+const QString DELTA_SYNC_TIME("syncTime");
+const QString DELTA_MAJOR_CODE("majorCode");
+const QString DELTA_MINOR_CODE("minorCode");
+const QString DELTA_SCHEDULED("scheduled");
+
 // Indent size for profile XML output.
 const int PROFILE_INDENT = 4;
 
@@ -23,6 +23,7 @@
 #include "ProfileFactory.h"
 
 #include <QDomDocument>
+#include <QXmlStreamReader>
 
 #include "SyncProfile.h"
 #include "StorageProfile.h"
@@ -80,3 +81,25 @@ Profile *ProfileFactory::createProfile(const QDomElement &aRoot)
 
     return p;
 }
+
+Profile *ProfileFactory::createProfile(QXmlStreamReader &aReader)
+{
+    Profile *p = NULL;
+
+    QString type = aReader.attributes().value(ATTR_TYPE).toString();
+    if (type == Profile::TYPE_SYNC)
+    {
+        p = new SyncProfile(aReader);
+    }
+    else if (type == Profile::TYPE_STORAGE)
+    {
+        p = new StorageProfile(aReader);
+    }
+    // Entries for each class derived from Profile can be added here.
+    else
+    {
+        p = new Profile(aReader);
+    }
+
+    return p;
+}
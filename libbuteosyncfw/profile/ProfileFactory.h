@@ -63,6 +63,16 @@ public:
      */
     Profile *createProfile(const QDomElement &aRoot);
 
+    /*! \brief Creates a profile from an XML stream.
+     *
+     * Same as the QDomElement version, but the profile is built directly
+     * from the stream without an intermediate document.
+     * \param aReader Reader positioned at the start element of the profile.
+     *  On return the reader is positioned at the matching end element.
+     * \return Created profile.
+     */
+    Profile *createProfile(QXmlStreamReader &aReader);
+
 };
 
 }
@@ -24,6 +24,9 @@
 #include "ProfileField.h"
 #include "ProfileEngineDefs.h"
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QSharedData>
 
 namespace Buteo {
 
@@ -40,7 +43,7 @@ const QString ProfileField::VISIBLE_USER = "user";
 const QString ProfileField::TYPE_BOOLEAN = "boolean";
 
 // Private implementation class for ProfileField.
-class ProfileFieldPrivate
+class ProfileFieldPrivate : public QSharedData
 {
 public:
 	//! \brief Constructor
@@ -81,7 +84,8 @@ ProfileFieldPrivate::ProfileFieldPrivate()
 }
 
 ProfileFieldPrivate::ProfileFieldPrivate(const ProfileFieldPrivate &aSource)
-:   iName(aSource.iName),
+:   QSharedData(aSource),
+    iName(aSource.iName),
     iType(aSource.iType),
     iDefaultValue(aSource.iDefaultValue),
     iOptions(aSource.iOptions),
@@ -128,15 +132,58 @@ ProfileField::ProfileField(const QDomElement &aRoot)
     } // no else
 }
 
+ProfileField::ProfileField(QXmlStreamReader &aReader)
+:   d_ptr(new ProfileFieldPrivate())
+{
+    QXmlStreamAttributes attributes = aReader.attributes();
+    d_ptr->iName = attributes.value(ATTR_NAME).toString();
+    d_ptr->iType = attributes.value(ATTR_TYPE).toString();
+    d_ptr->iDefaultValue = attributes.value(ATTR_DEFAULT).toString();
+    d_ptr->iLabel = attributes.value(ATTR_LABEL).toString();
+    d_ptr->iVisible = attributes.value(ATTR_VISIBLE).toString();
+    d_ptr->iReadOnly = (attributes.value(ATTR_READONLY).compare(
+        BOOLEAN_TRUE, Qt::CaseInsensitive) == 0);
+
+    // Parse options.
+    while (aReader.readNextStartElement())
+    {
+        if (aReader.name() == TAG_OPTION)
+        {
+            QString optionStr = aReader.readElementText(
+                    QXmlStreamReader::IncludeChildElements);
+            if (!optionStr.isEmpty())
+            {
+                d_ptr->iOptions.append(optionStr);
+            }
+            else
+            {
+                // Empty value.
+            }
+        }
+        else
+        {
+            aReader.skipCurrentElement();
+        }
+    }
+
+    // Options for boolean type are inserted automatically.
+    if (d_ptr->iOptions.empty())
+    {
+        if (d_ptr->iType == TYPE_BOOLEAN)
+        {
+            d_ptr->iOptions.append(BOOLEAN_TRUE);
+            d_ptr->iOptions.append(BOOLEAN_FALSE);
+        } // no else
+    } // no else
+}
+
 ProfileField::ProfileField(const ProfileField &aSource)
-:   d_ptr(new ProfileFieldPrivate(*aSource.d_ptr))
+:   d_ptr(aSource.d_ptr)
 {
 }
 
 ProfileField::~ProfileField()
 {
-    delete d_ptr;
-    d_ptr = 0;
 }
 
 QString ProfileField::name() const
@@ -210,6 +257,34 @@ QDomElement ProfileField::toXml(QDomDocument &aDoc) const
     return root;
 }
 
+void ProfileField::toXml(QXmlStreamWriter &aWriter) const
+{
+    aWriter.writeStartElement(TAG_FIELD);
+    aWriter.writeAttribute(ATTR_NAME, d_ptr->iName);
+    aWriter.writeAttribute(ATTR_TYPE, d_ptr->iType);
+    aWriter.writeAttribute(ATTR_DEFAULT, d_ptr->iDefaultValue);
+    aWriter.writeAttribute(ATTR_LABEL, d_ptr->iLabel);
+    if (!d_ptr->iVisible.isEmpty())
+        aWriter.writeAttribute(ATTR_VISIBLE, d_ptr->iVisible);
+    if (d_ptr->iReadOnly)
+        aWriter.writeAttribute(ATTR_READONLY, BOOLEAN_TRUE);
+
+    if (d_ptr->iType == TYPE_BOOLEAN)
+    {
+        // No need to specify true/false options, field parser will add
+        // them automatically.
+    }
+    else if (!d_ptr->iOptions.isEmpty())
+    {
+        foreach (QString optionStr, d_ptr->iOptions)
+        {
+            aWriter.writeTextElement(TAG_OPTION, optionStr);
+        }
+    } // no else
+
+    aWriter.writeEndElement();
+}
+
 QString ProfileField::visible() const
 {
     if (d_ptr->iVisible.isEmpty())
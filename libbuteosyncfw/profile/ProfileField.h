@@ -26,9 +26,12 @@
 
 #include <QString>
 #include <QStringList>
+#include <QExplicitlySharedDataPointer>
 
 class QDomDocument;
 class QDomElement;
+class QXmlStreamReader;
+class QXmlStreamWriter;
 
 namespace Buteo {
 
@@ -68,6 +71,13 @@ public:
      */
     explicit ProfileField(const QDomElement &aRoot);
 
+    /*! \brief Constructs a ProfileField from an XML stream.
+     *
+     * \param aReader Reader positioned at the start element of the field.
+     *  On return the reader is positioned at the matching end element.
+     */
+    explicit ProfileField(QXmlStreamReader &aReader);
+
     /*! \brief Copy constructor.
      *
      * \param aSource Copy source.
@@ -127,6 +137,13 @@ public:
      */
     QDomElement toXml(QDomDocument &aDoc) const;
 
+    /*! \brief Writes the field as XML to a stream.
+     *
+     * The output is the same as for the QDomDocument version.
+     * \param aWriter Writer to write the XML element with.
+     */
+    void toXml(QXmlStreamWriter &aWriter) const;
+
     /*! \brief Gets the visibility of the field.
      *
      * \return String defining the visibility. See VISIBLE_ constants for
@@ -145,8 +162,9 @@ private:
 
     ProfileField& operator=(const ProfileField &aRhs);
 
-    ProfileFieldPrivate *d_ptr;
-
+    // A field can not be modified after construction, so copies share the
+    // same data. Profiles merging the same sub-profile do not duplicate it.
+    QExplicitlySharedDataPointer<ProfileFieldPrivate> d_ptr;
 
 };
 
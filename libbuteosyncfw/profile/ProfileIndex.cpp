@@ -0,0 +1,281 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileIndex.h"
+
+#include <QMutexLocker>
+
+#include "SyncProfile.h"
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+// Sub-profile name or type that matches any name or type.
+static const QString ANY = QString(QChar(0x1e));
+
+// Separates the parts of an index entry.
+static const QChar SEPARATOR(0x1f);
+
+ProfileIndex::ProfileIndex()
+:   iBuilt(false),
+    iGeneration(0)
+{
+}
+
+void ProfileIndex::reset()
+{
+    QMutexLocker locker(&iMutex);
+
+    iBuilt = false;
+    iGeneration++;
+    iStale.clear();
+}
+
+void ProfileIndex::markStale(const QString &aName)
+{
+    QMutexLocker locker(&iMutex);
+
+    iStale.insert(aName);
+}
+
+void ProfileIndex::markSubProfileStale(const QString &aName,
+                                       const QString &aType)
+{
+    QMutexLocker locker(&iMutex);
+
+    // A full rebuild is pending anyway.
+    if (!iBuilt)
+        return;
+
+    iStale += iEntries.value(existsEntry(aType, aName, QString()));
+}
+
+bool ProfileIndex::needsRebuild(int &aGeneration)
+{
+    QMutexLocker locker(&iMutex);
+
+    aGeneration = iGeneration;
+    return !iBuilt;
+}
+
+void ProfileIndex::setBuilt(int aGeneration)
+{
+    QMutexLocker locker(&iMutex);
+
+    if (aGeneration == iGeneration)
+    {
+        iBuilt = true;
+    } // no else
+}
+
+QStringList ProfileIndex::takeStale()
+{
+    QMutexLocker locker(&iMutex);
+
+    QStringList stale = iStale.toList();
+    iStale.clear();
+    return stale;
+}
+
+void ProfileIndex::clear()
+{
+    QMutexLocker locker(&iMutex);
+
+    iEntries.clear();
+    iProfileEntries.clear();
+}
+
+void ProfileIndex::update(const QString &aName, const SyncProfile *aProfile)
+{
+    QMutexLocker locker(&iMutex);
+
+    foreach (const QString &entry, iProfileEntries.take(aName))
+    {
+        QHash<QString, QSet<QString> >::iterator i = iEntries.find(entry);
+        if (i != iEntries.end())
+        {
+            i->remove(aName);
+            if (i->isEmpty())
+            {
+                iEntries.erase(i);
+            } // no else
+        } // no else
+    }
+
+    if (aProfile == 0)
+        return;
+
+    QStringList entries;
+    addKeys(*aProfile, QString(), QString(), aName, entries);
+
+    foreach (const Profile *sub, aProfile->allSubProfiles())
+    {
+        const QString type = sub->type();
+        const QString name = sub->name();
+
+        addEntry(existsEntry(type, name, QString()), aName, entries);
+        addEntry(existsEntry(ANY, name, QString()), aName, entries);
+        addEntry(existsEntry(type, ANY, QString()), aName, entries);
+
+        addKeys(*sub, type, name, aName, entries);
+        addKeys(*sub, ANY, name, aName, entries);
+        addKeys(*sub, type, ANY, aName, entries);
+    }
+
+    iProfileEntries.insert(aName, entries);
+}
+
+bool ProfileIndex::candidates(const ProfileManager::SearchCriteria &aCriteria,
+                              QSet<QString> &aNames)
+{
+    QString type;
+    QString name;
+    if (!aCriteria.iSubProfileName.isEmpty())
+    {
+        type = aCriteria.iSubProfileType.isEmpty() ? ANY : aCriteria.iSubProfileType;
+        name = aCriteria.iSubProfileName;
+    }
+    else if (!aCriteria.iSubProfileType.isEmpty())
+    {
+        type = aCriteria.iSubProfileType;
+        name = ANY;
+    } // no else, keys of the main profile
+
+    QString entry;
+    switch (aCriteria.iType)
+    {
+    case ProfileManager::SearchCriteria::EQUAL:
+    case ProfileManager::SearchCriteria::EXISTS:
+        if (aCriteria.iKey.isEmpty())
+        {
+            if (type.isEmpty())
+                return false; // Matches every profile.
+
+            entry = existsEntry(type, name, QString());
+        }
+        else if (aCriteria.iType == ProfileManager::SearchCriteria::EQUAL)
+        {
+            entry = valueEntry(type, name, aCriteria.iKey, aCriteria.iValue);
+        }
+        else
+        {
+            entry = existsEntry(type, name, aCriteria.iKey);
+        }
+        break;
+
+    default:
+        // Negative criteria can not narrow down the search.
+        return false;
+    }
+
+    QMutexLocker locker(&iMutex);
+    aNames = iEntries.value(entry);
+    return true;
+}
+
+bool ProfileIndex::candidates(
+        const QList<ProfileManager::SearchCriteria> &aCriteria,
+        QSet<QString> &aNames)
+{
+    bool resolved = false;
+    foreach (const ProfileManager::SearchCriteria &criteria, aCriteria)
+    {
+        QSet<QString> names;
+        if (candidates(criteria, names))
+        {
+            if (resolved)
+            {
+                aNames.intersect(names);
+            }
+            else
+            {
+                aNames = names;
+                resolved = true;
+            }
+
+            if (aNames.isEmpty())
+                break;
+        } // no else
+    }
+
+    return resolved;
+}
+
+bool ProfileIndex::candidates(const QString &aSubProfileName,
+                              const QString &aSubProfileType,
+                              const QString &aKey, const QString &aValue,
+                              QSet<QString> &aNames)
+{
+    ProfileManager::SearchCriteria criteria;
+    criteria.iSubProfileName = aSubProfileName;
+    criteria.iSubProfileType = aSubProfileType;
+    criteria.iKey = aKey;
+    criteria.iValue = aValue;
+    criteria.iType = aValue.isEmpty() ? ProfileManager::SearchCriteria::EXISTS :
+                                        ProfileManager::SearchCriteria::EQUAL;
+
+    return candidates(criteria, aNames);
+}
+
+QString ProfileIndex::valueEntry(const QString &aSubProfileType,
+                                 const QString &aSubProfileName,
+                                 const QString &aKey, const QString &aValue)
+{
+    return QStringLiteral("v") + aSubProfileType + SEPARATOR + aSubProfileName +
+            SEPARATOR + aKey + SEPARATOR + aValue;
+}
+
+QString ProfileIndex::existsEntry(const QString &aSubProfileType,
+                                  const QString &aSubProfileName,
+                                  const QString &aKey)
+{
+    return QStringLiteral("e") + aSubProfileType + SEPARATOR + aSubProfileName +
+            SEPARATOR + aKey;
+}
+
+void ProfileIndex::addEntry(const QString &aEntry, const QString &aName,
+                            QStringList &aEntries)
+{
+    QSet<QString> &names = iEntries[aEntry];
+    if (!names.contains(aName))
+    {
+        names.insert(aName);
+        aEntries.append(aEntry);
+    } // no else
+}
+
+void ProfileIndex::addKeys(const Profile &aProfile,
+                           const QString &aSubProfileType,
+                           const QString &aSubProfileName,
+                           const QString &aName, QStringList &aEntries)
+{
+    foreach (const QString &key, aProfile.keyNames())
+    {
+        // Index the value returned by key(), it is the one compared by
+        // the search functions.
+        addEntry(valueEntry(aSubProfileType, aSubProfileName, key,
+                            aProfile.key(key)), aName, aEntries);
+        addEntry(existsEntry(aSubProfileType, aSubProfileName, key),
+                 aName, aEntries);
+    }
+}
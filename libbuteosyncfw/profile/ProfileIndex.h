@@ -0,0 +1,183 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILEINDEX_H
+#define PROFILEINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+
+#include "ProfileManager.h"
+
+namespace Buteo {
+
+class Profile;
+class SyncProfile;
+
+/*! \brief Inverted index from profile keys to sync profile names.
+ *
+ * For every expanded sync profile the index stores the value of each key of
+ * the profile itself and of each of its sub-profiles, together with the
+ * existence of keys and sub-profiles. A search criterion can then be resolved
+ * to a set of candidate profile names without loading any profile. The
+ * candidate set is always a superset of the actual matches, so candidates
+ * still need to be verified against the loaded profiles.
+ *
+ * The index is kept up to date by marking profiles stale when they change;
+ * ProfileManager re-indexes stale profiles before the next query. A change of
+ * a sub-profile only marks the sync profiles that merged it.
+ */
+class ProfileIndex
+{
+public:
+
+    //! \brief Constructor.
+    ProfileIndex();
+
+    /*! \brief Marks the whole index as out of date.
+     *
+     * Used when a change may affect any number of profiles, for example when
+     * a shared sub-profile changes.
+     */
+    void reset();
+
+    /*! \brief Marks a single sync profile as out of date.
+     *
+     * \param aName Name of the changed sync profile.
+     */
+    void markStale(const QString &aName);
+
+    /*! \brief Marks the sync profiles merging a sub-profile as out of date.
+     *
+     * \param aName Name of the changed sub-profile.
+     * \param aType Type of the changed sub-profile.
+     */
+    void markSubProfileStale(const QString &aName, const QString &aType);
+
+    /*! \brief Checks if the index needs to be built from scratch.
+     *
+     * \param aGeneration Set to the current index generation, which must be
+     *  passed to setBuilt() after the rebuild.
+     * \return True if a full rebuild is needed.
+     */
+    bool needsRebuild(int &aGeneration);
+
+    /*! \brief Marks the index built.
+     *
+     * Has no effect if the index was reset after the given generation was
+     * read.
+     * \param aGeneration Generation returned by needsRebuild().
+     */
+    void setBuilt(int aGeneration);
+
+    /*! \brief Takes the names of profiles marked stale.
+     *
+     * \return Names of the profiles that need to be re-indexed.
+     */
+    QStringList takeStale();
+
+    /*! \brief Removes all entries of the index.
+     */
+    void clear();
+
+    /*! \brief Replaces the index entries of a sync profile.
+     *
+     * \param aName Name of the profile.
+     * \param aProfile Expanded sync profile to index. If NULL, the entries of
+     *  the profile are only removed.
+     */
+    void update(const QString &aName, const SyncProfile *aProfile);
+
+    /*! \brief Resolves a search criterion to candidate profile names.
+     *
+     * \param aCriteria Search criterion.
+     * \param aNames Set of candidate profile names.
+     * \return True if the criterion could be resolved. Criteria that can not
+     *  narrow down the search (NOT_EXISTS, NOT_EQUAL) return false.
+     */
+    bool candidates(const ProfileManager::SearchCriteria &aCriteria,
+                    QSet<QString> &aNames);
+
+    /*! \brief Resolves a list of criteria to candidate profile names.
+     *
+     * The candidate sets of all resolvable criteria are intersected.
+     * \param aCriteria Search criteria.
+     * \param aNames Set of candidate profile names.
+     * \return True if at least one of the criteria could be resolved.
+     */
+    bool candidates(const QList<ProfileManager::SearchCriteria> &aCriteria,
+                    QSet<QString> &aNames);
+
+    /*! \brief Resolves the given values to candidate profile names.
+     *
+     * Semantics follow ProfileManager::getSyncProfilesByData().
+     * \param aSubProfileName Name of the sub-profile, can be empty.
+     * \param aSubProfileType Type of the sub-profile, can be empty.
+     * \param aKey Name of the key, can be empty.
+     * \param aValue Value of the key, can be empty.
+     * \param aNames Set of candidate profile names.
+     * \return True if the values could be resolved.
+     */
+    bool candidates(const QString &aSubProfileName,
+                    const QString &aSubProfileType,
+                    const QString &aKey, const QString &aValue,
+                    QSet<QString> &aNames);
+
+private:
+
+    static QString valueEntry(const QString &aSubProfileType,
+                              const QString &aSubProfileName,
+                              const QString &aKey, const QString &aValue);
+
+    static QString existsEntry(const QString &aSubProfileType,
+                               const QString &aSubProfileName,
+                               const QString &aKey);
+
+    void addEntry(const QString &aEntry, const QString &aName,
+                  QStringList &aEntries);
+
+    void addKeys(const Profile &aProfile, const QString &aSubProfileType,
+                 const QString &aSubProfileName, const QString &aName,
+                 QStringList &aEntries);
+
+    QMutex iMutex;
+
+    // Index entry -> names of the sync profiles having it.
+    QHash<QString, QSet<QString> > iEntries;
+
+    // Sync profile name -> its index entries, for removal.
+    QHash<QString, QStringList> iProfileEntries;
+
+    // Profiles that need to be re-indexed.
+    QSet<QString> iStale;
+
+    bool iBuilt;
+
+    int iGeneration;
+};
+
+}
+
+#endif // PROFILEINDEX_H
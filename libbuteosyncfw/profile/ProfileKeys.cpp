@@ -0,0 +1,372 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileKeys.h"
+
+#include <QDataStream>
+#include <QHash>
+#include <QReadWriteLock>
+
+#include <algorithm>
+
+#include "ProfileEngineDefs.h"
+
+using namespace Buteo;
+
+namespace {
+
+// Process-wide table of interned key names.
+struct KeyTable
+{
+    KeyTable();
+
+    void add(const QString &aName);
+
+    QReadWriteLock iLock;
+
+    QHash<QString, quint32> iIds;
+
+    QVector<QString> iNames;
+};
+
+KeyTable::KeyTable()
+{
+    // Same order as ProfileKeys::Id.
+    add(KEY_ENABLED);
+    add(KEY_DISPLAY_NAME);
+    add(KEY_ACTIVE);
+    add(KEY_USE_ACCOUNTS);
+    add(KEY_SYNC_SCHEDULED);
+    add(KEY_PLUGIN);
+    add(KEY_BACKEND);
+    add(KEY_ACCOUNT_ID);
+    add(KEY_USERNAME);
+    add(KEY_PASSWORD);
+    add(KEY_HIDDEN);
+    add(KEY_PROTECTED);
+    add(KEY_DESTINATION_TYPE);
+    add(KEY_SYNC_DIRECTION);
+    add(KEY_FORCE_SLOW_SYNC);
+    add(KEY_CONFLICT_RESOLUTION_POLICY);
+    add(KEY_BT_ADDRESS);
+    add(KEY_REMOTE_ID);
+    add(KEY_REMOTE_DATABASE);
+    add(KEY_BT_NAME);
+    add(KEY_BT_TRANSPORT);
+    add(KEY_USB_TRANSPORT);
+    add(KEY_INTERNET_TRANSPORT);
+    add(KEY_LOAD_WITHOUT_TRANSPORT);
+    add(KEY_CAPS_MODIFIED);
+    add(KEY_SYNC_SINCE_DAYS_PAST);
+    add(KEY_SYNC_ALWAYS_UP_TO_DATE);
+    add(KEY_SYNC_EXTERNALLY);
+    add(KEY_SOC);
+    add(KEY_SOC_AFTER);
+    add(KEY_LOCAL_URI);
+    add(KEY_ALWAYS_ON_ENABLED);
+    add(KEY_REMOTE_NAME);
+    add(KEY_UUID);
+    add(KEY_NOTES_UUID);
+    add(KEY_STORAGE_UPDATED);
+    add(KEY_HTTP_PROXY_HOST);
+    add(KEY_HTTP_PROXY_PORT);
+    add(KEY_PROFILE_ID);
+    add(KEY_MAX_PARALLEL_SESSIONS);
+
+    Q_ASSERT(iNames.size() == ProfileKeys::WELL_KNOWN_COUNT);
+}
+
+void KeyTable::add(const QString &aName)
+{
+    iIds.insert(aName, iNames.size());
+    iNames.append(aName);
+}
+
+bool entryIdLess(const ProfileKeyStore::Entry &aLeft,
+                 const ProfileKeyStore::Entry &aRight)
+{
+    return aLeft.iId < aRight.iId;
+}
+
+bool namedEntryLess(const QPair<QString, QString> &aLeft,
+                    const QPair<QString, QString> &aRight)
+{
+    return aLeft.first < aRight.first;
+}
+
+}
+
+Q_GLOBAL_STATIC(KeyTable, keyTable)
+
+quint32 ProfileKeys::intern(const QString &aName)
+{
+    KeyTable *table = keyTable();
+    {
+        QReadLocker locker(&table->iLock);
+        QHash<QString, quint32>::const_iterator i = table->iIds.constFind(aName);
+        if (i != table->iIds.constEnd())
+        {
+            return i.value();
+        } // no else
+    }
+
+    QWriteLocker locker(&table->iLock);
+    QHash<QString, quint32>::const_iterator i = table->iIds.constFind(aName);
+    if (i != table->iIds.constEnd())
+    {
+        return i.value();
+    } // no else
+
+    const quint32 id = table->iNames.size();
+    table->add(aName);
+
+    return id;
+}
+
+qint32 ProfileKeys::find(const QString &aName)
+{
+    KeyTable *table = keyTable();
+    QReadLocker locker(&table->iLock);
+
+    QHash<QString, quint32>::const_iterator i = table->iIds.constFind(aName);
+    return (i != table->iIds.constEnd()) ? static_cast<qint32>(i.value()) : -1;
+}
+
+QString ProfileKeys::name(quint32 aId)
+{
+    KeyTable *table = keyTable();
+    QReadLocker locker(&table->iLock);
+
+    return table->iNames.value(aId);
+}
+
+bool ProfileKeyStore::isEmpty() const
+{
+    return iEntries.isEmpty();
+}
+
+int ProfileKeyStore::size() const
+{
+    return iEntries.size();
+}
+
+bool ProfileKeyStore::contains(quint32 aId) const
+{
+    return value(aId) != 0;
+}
+
+const QString *ProfileKeyStore::value(quint32 aId) const
+{
+    int begin = 0;
+    int end = 0;
+    range(aId, begin, end);
+
+    return (begin < end) ? &iEntries.at(begin).iValue : 0;
+}
+
+QStringList ProfileKeyStore::values(quint32 aId) const
+{
+    int begin = 0;
+    int end = 0;
+    range(aId, begin, end);
+
+    QStringList values;
+    for (int i = begin; i < end; i++)
+    {
+        values.append(iEntries.at(i).iValue);
+    }
+
+    return values;
+}
+
+void ProfileKeyStore::insert(quint32 aId, const QString &aValue)
+{
+    int begin = 0;
+    int end = 0;
+    range(aId, begin, end);
+
+    if (begin < end)
+    {
+        iEntries[begin].iValue = aValue;
+    }
+    else
+    {
+        Entry entry = { aId, aValue };
+        iEntries.insert(begin, entry);
+    }
+}
+
+void ProfileKeyStore::insertMulti(quint32 aId, const QString &aValue)
+{
+    int begin = 0;
+    int end = 0;
+    range(aId, begin, end);
+
+    Entry entry = { aId, aValue };
+    iEntries.insert(begin, entry);
+}
+
+int ProfileKeyStore::remove(quint32 aId)
+{
+    int begin = 0;
+    int end = 0;
+    range(aId, begin, end);
+
+    if (begin < end)
+    {
+        iEntries.remove(begin, end - begin);
+    } // no else
+
+    return end - begin;
+}
+
+void ProfileKeyStore::unite(const ProfileKeyStore &aOther)
+{
+    if (iEntries.isEmpty())
+    {
+        iEntries = aOther.iEntries;
+        return;
+    } // no else
+
+    if (aOther.iEntries.isEmpty())
+    {
+        return;
+    } // no else
+
+    // Merge the sorted vectors. For a key in both stores the other store's
+    // values come first, so they are the newest.
+    QVector<Entry> merged;
+    merged.reserve(iEntries.size() + aOther.iEntries.size());
+    int i = 0;
+    int j = 0;
+    while (i < iEntries.size() || j < aOther.iEntries.size())
+    {
+        if (j < aOther.iEntries.size() &&
+            (i == iEntries.size() || aOther.iEntries.at(j).iId <= iEntries.at(i).iId))
+        {
+            merged.append(aOther.iEntries.at(j++));
+        }
+        else
+        {
+            merged.append(iEntries.at(i++));
+        }
+    }
+
+    iEntries = merged;
+}
+
+QStringList ProfileKeyStore::uniqueNames() const
+{
+    QStringList names;
+    for (int i = 0; i < iEntries.size(); i++)
+    {
+        if (i == 0 || iEntries.at(i).iId != iEntries.at(i - 1).iId)
+        {
+            names.append(ProfileKeys::name(iEntries.at(i).iId));
+        } // no else
+    }
+    names.sort();
+
+    return names;
+}
+
+QMap<QString, QString> ProfileKeyStore::toMap() const
+{
+    // The last value inserted for a key is the newest one.
+    QMap<QString, QString> map;
+    for (int i = iEntries.size() - 1; i >= 0; i--)
+    {
+        map.insertMulti(ProfileKeys::name(iEntries.at(i).iId), iEntries.at(i).iValue);
+    }
+
+    return map;
+}
+
+QList<QPair<QString, QString> > ProfileKeyStore::namedEntries() const
+{
+    QList<QPair<QString, QString> > entries;
+    foreach (const Entry &entry, iEntries)
+    {
+        entries.append(qMakePair(ProfileKeys::name(entry.iId), entry.iValue));
+    }
+
+    // Stable sort keeps the values of a key newest first.
+    std::stable_sort(entries.begin(), entries.end(), namedEntryLess);
+
+    return entries;
+}
+
+const QVector<ProfileKeyStore::Entry> &ProfileKeyStore::entries() const
+{
+    return iEntries;
+}
+
+void ProfileKeyStore::range(quint32 aId, int &aBegin, int &aEnd) const
+{
+    Entry key = { aId, QString() };
+    QVector<Entry>::const_iterator begin = std::lower_bound(
+            iEntries.constBegin(), iEntries.constEnd(), key, entryIdLess);
+    QVector<Entry>::const_iterator end = std::upper_bound(
+            begin, iEntries.constEnd(), key, entryIdLess);
+
+    aBegin = begin - iEntries.constBegin();
+    aEnd = end - iEntries.constBegin();
+}
+
+QDataStream &Buteo::operator<<(QDataStream &aStream, const ProfileKeyStore &aStore)
+{
+    const QVector<ProfileKeyStore::Entry> &entries = aStore.entries();
+    aStream << static_cast<quint32>(entries.size());
+    foreach (const ProfileKeyStore::Entry &entry, entries)
+    {
+        aStream << ProfileKeys::name(entry.iId) << entry.iValue;
+    }
+
+    return aStream;
+}
+
+QDataStream &Buteo::operator>>(QDataStream &aStream, ProfileKeyStore &aStore)
+{
+    quint32 count = 0;
+    aStream >> count;
+
+    // Entries were written in storage order, so inserting each one after
+    // the values already read for its key restores the order.
+    QList<QPair<QString, QString> > pairs;
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; i++)
+    {
+        QString name;
+        QString value;
+        aStream >> name >> value;
+        pairs.append(qMakePair(name, value));
+    }
+
+    ProfileKeyStore store;
+    for (int i = pairs.size() - 1; i >= 0; i--)
+    {
+        store.insertMulti(ProfileKeys::intern(pairs.at(i).first), pairs.at(i).second);
+    }
+    aStore = store;
+
+    return aStream;
+}
@@ -0,0 +1,226 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILEKEYS_H
+#define PROFILEKEYS_H
+
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QDataStream;
+
+namespace Buteo {
+
+//! Identifiers of the well-known profile keys of ProfileEngineDefs.h.
+namespace ProfileKeys {
+
+enum Id
+{
+    ENABLED = 0,
+    DISPLAY_NAME,
+    ACTIVE,
+    USE_ACCOUNTS,
+    SYNC_SCHEDULED,
+    PLUGIN,
+    BACKEND,
+    ACCOUNT_ID,
+    USERNAME,
+    PASSWORD,
+    HIDDEN,
+    PROTECTED,
+    DESTINATION_TYPE,
+    SYNC_DIRECTION,
+    FORCE_SLOW_SYNC,
+    CONFLICT_RESOLUTION_POLICY,
+    BT_ADDRESS,
+    REMOTE_ID,
+    REMOTE_DATABASE,
+    BT_NAME,
+    BT_TRANSPORT,
+    USB_TRANSPORT,
+    INTERNET_TRANSPORT,
+    LOAD_WITHOUT_TRANSPORT,
+    CAPS_MODIFIED,
+    SYNC_SINCE_DAYS_PAST,
+    SYNC_ALWAYS_UP_TO_DATE,
+    SYNC_EXTERNALLY,
+    SOC,
+    SOC_AFTER,
+    LOCAL_URI,
+    ALWAYS_ON_ENABLED,
+    REMOTE_NAME,
+    UUID,
+    NOTES_UUID,
+    STORAGE_UPDATED,
+    HTTP_PROXY_HOST,
+    HTTP_PROXY_PORT,
+    PROFILE_ID,
+    MAX_PARALLEL_SESSIONS,
+
+    //! Number of well-known keys. Other keys get identifiers from here on.
+    WELL_KNOWN_COUNT
+};
+
+/*! \brief Gets the identifier of a key name, interning the name if needed.
+ *
+ * Identifiers are process-wide and stay valid for the lifetime of the
+ * process. Well-known keys always have their compile-time identifiers.
+ * \param aName Key name.
+ * \return Key identifier.
+ */
+quint32 intern(const QString &aName);
+
+/*! \brief Gets the identifier of a key name without interning it.
+ *
+ * \param aName Key name.
+ * \return Key identifier. -1 if no profile has used the name.
+ */
+qint32 find(const QString &aName);
+
+/*! \brief Gets the name of a key.
+ *
+ * The returned string shares its data with all other uses of the name.
+ * \param aId Key identifier.
+ * \return Key name.
+ */
+QString name(quint32 aId);
+
+}
+
+/*! \brief Compact key-value store of a profile.
+ *
+ * Keys are stored as interned identifiers in a vector sorted by identifier.
+ * A key may have multiple values. Values of a key are kept newest first,
+ * matching QMap::insertMulti() and QMap::values(). The store is implicitly
+ * shared, so copying it is cheap until either copy is modified.
+ */
+class ProfileKeyStore
+{
+public:
+
+    //! Key-value entry.
+    struct Entry
+    {
+        //! Key identifier.
+        quint32 iId;
+
+        //! Value of the key.
+        QString iValue;
+    };
+
+    //! \brief Checks if the store has no keys.
+    bool isEmpty() const;
+
+    //! \brief Gets the number of key-value entries.
+    int size() const;
+
+    //! \brief Checks if the store has a value for a key.
+    bool contains(quint32 aId) const;
+
+    /*! \brief Gets the newest value of a key.
+     *
+     * \param aId Key identifier.
+     * \return Pointer to the value, valid until the store is modified. NULL
+     *  if the key has no value.
+     */
+    const QString *value(quint32 aId) const;
+
+    /*! \brief Gets all values of a key, newest first.
+     *
+     * \param aId Key identifier.
+     * \return Values of the key.
+     */
+    QStringList values(quint32 aId) const;
+
+    /*! \brief Sets the value of a key.
+     *
+     * Replaces the newest value of the key, like QMap::insert().
+     * \param aId Key identifier.
+     * \param aValue New value.
+     */
+    void insert(quint32 aId, const QString &aValue);
+
+    /*! \brief Adds a value to a key.
+     *
+     * The value becomes the newest value of the key, like
+     * QMap::insertMulti().
+     * \param aId Key identifier.
+     * \param aValue Value to add.
+     */
+    void insertMulti(quint32 aId, const QString &aValue);
+
+    /*! \brief Removes all values of a key.
+     *
+     * \param aId Key identifier.
+     * \return Number of removed values.
+     */
+    int remove(quint32 aId);
+
+    /*! \brief Adds all entries of another store.
+     *
+     * Entries of the other store become newer than the existing ones, like
+     * QMap::unite().
+     * \param aOther Store to add.
+     */
+    void unite(const ProfileKeyStore &aOther);
+
+    //! \brief Gets the names of the keys, sorted and without duplicates.
+    QStringList uniqueNames() const;
+
+    //! \brief Gets the keys as a map, as QMap::insertMulti() would build it.
+    QMap<QString, QString> toMap() const;
+
+    /*! \brief Gets all entries as name-value pairs.
+     *
+     * The pairs are in the order of a QMap holding the same keys: sorted by
+     * name, and newest first within a key.
+     * \return Name-value pairs.
+     */
+    QList<QPair<QString, QString> > namedEntries() const;
+
+    //! \brief Gets the entries in storage order.
+    const QVector<Entry> &entries() const;
+
+private:
+
+    // Gets the range of entries of a key.
+    void range(quint32 aId, int &aBegin, int &aEnd) const;
+
+    QVector<Entry> iEntries;
+};
+
+/*! \brief Writes a key store to a data stream.
+ *
+ * Keys are written by name, identifiers are not stable between processes.
+ */
+QDataStream &operator<<(QDataStream &aStream, const ProfileKeyStore &aStore);
+
+//! \brief Reads a key store from a data stream.
+QDataStream &operator>>(QDataStream &aStream, ProfileKeyStore &aStore);
+
+}
+
+#endif // PROFILEKEYS_H
@@ -23,13 +23,25 @@
 
 #include "ProfileManager.h"
 
+#include <QAtomicInt>
 #include <QDir>
 #include <QFile>
-#include <QTextStream>
-#include <QDomDocument>
-
+#include <QFileInfo>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentFilter>
+
+#include "ProfileCache.h"
+#include "ProfileQuery.h"
+#include "XmlProfileStore.h"
+#include "SqliteProfileStore.h"
 #include "ProfileFactory.h"
 #include "ProfileEngineDefs.h"
+#include "ProfileXmlWriter.h"
 #include "SyncCommonDefs.h"
 
 #include "LogMacros.h"
@@ -37,10 +49,6 @@
 
 namespace Buteo {
 
-static const QString FORMAT_EXT = ".xml";
-static const QString BACKUP_EXT = ".bak";
-static const QString LOG_EXT = ".log";
-static const QString LOG_DIRECTORY = "logs";
 static const QString BT_PROFILE_TEMPLATE("bt_template");
 
 const QString ProfileManager::DEFAULT_PRIMARY_PROFILE_PATH =
@@ -63,37 +71,135 @@ public:
      */
     Profile *load(const QString &aName, const QString &aType);
 
-    /*! \brief Loads the synchronization log associated with the given profile.
+    /*! \brief Gets a profile shared with the profile cache.
      *
-     * \param aProfileName Name of the sync profile whose log shall be loaded.
-     * \return The loaded log. 0 if the log was not found.
+     * The profile is parsed only if it is not cached yet.
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     * \return Immutable shared profile. Null if the profile was not found.
      */
-    SyncLog *loadLog(const QString &aProfileName);
+    QSharedPointer<const Profile> sharedProfile(const QString &aName,
+                                                const QString &aType);
 
-    bool parseFile(const QString &aPath, QDomDocument &aDoc);
+    /*! \brief Writes a profile to the store.
+     *
+     * \param aProfile Profile to write.
+     * \param aDeferred If true and the profile exists already, the store
+     *  may delay the write until flushed.
+     * \return Success indicator.
+     */
+    bool save(const Profile &aProfile, bool aDeferred = false);
 
-    void restoreBackupIfFound(const QString &aProfilePath,
-            const QString &aBackupPath);
+    bool remove(const QString &aName, const QString &aType);
 
-    QDomDocument constructProfileDocument(const Profile &aProfile);
+    /*! \brief Drops the cached profiles if another process changed the
+     * store.
+     *
+     * Does nothing while a batch is running, see ChangeCheckBatch.
+     */
+    void checkExternalChanges();
 
-    bool writeProfileFile(const QString &aProfilePath, const QDomDocument &aDoc);
+    bool profileExists(const QString &aProfileId ,const QString &aType);
 
-    QString findProfileFile(const QString &aName, const QString &aType);
+    /*! \brief Brings the key index of the sync profiles up to date.
+     *
+     * \param aManager Manager used to load the profiles to index.
+     */
+    void updateIndex(ProfileManager &aManager);
 
-    bool createBackup(const QString &aProfilePath, const QString &aBackupPath);
+    /*! \brief Gets the names of sync profiles that may match the criteria.
+     *
+     * \param aManager Manager used to list and load the profiles.
+     * \param aCriteria Search criteria.
+     * \return Candidate profile names, in profileNames() order.
+     */
+    QStringList candidateNames(ProfileManager &aManager,
+            const QList<ProfileManager::SearchCriteria> &aCriteria);
 
-    bool matchProfile(const Profile &aProfile,
-            const ProfileManager::SearchCriteria &aCriteria);
+    /*! \brief Gets the names of sync profiles that may match the data.
+     *
+     * \see ProfileManager::getSyncProfilesByData
+     */
+    QStringList candidateNames(ProfileManager &aManager,
+            const QString &aSubProfileName, const QString &aSubProfileType,
+            const QString &aKey, const QString &aValue);
 
-    bool matchKey(const Profile &aProfile,
-            const ProfileManager::SearchCriteria &aCriteria);
+    QStringList restrictNames(const QStringList &aNames,
+            const QSet<QString> &aCandidates);
 
-    bool save(const Profile &aProfile);
+    /*! \brief Checks if a sync profile matches a query.
+     *
+     * A cached profile is checked in place. Otherwise the profile is
+     * expanded without reading its sync log.
+     * \param aManager Manager used to expand the profile.
+     * \param aName Name of the sync profile.
+     * \param aQuery Compiled search criteria.
+     * \return True if the profile exists and matches.
+     */
+    bool matches(ProfileManager &aManager, const QString &aName,
+            const ProfileQuery &aQuery);
 
-    bool remove(const QString &aName, const QString &aType);
+    /*! \brief Filters sync profile names by a query.
+     *
+     * Profiles are checked concurrently on the global thread pool, like
+     * in loadSyncProfiles().
+     * \param aManager Manager used to expand the profiles.
+     * \param aNames Names of the sync profiles.
+     * \param aQuery Compiled search criteria.
+     * \return Names of the matching profiles, in the order of aNames.
+     */
+    QStringList matchingNames(ProfileManager &aManager,
+            const QStringList &aNames, const ProfileQuery &aQuery);
 
-    bool profileExists(const QString &aProfileId ,const QString &aType);
+    /*! \brief Loads expanded sync profiles with their logs.
+     *
+     * Profiles are parsed, expanded and given their logs concurrently on
+     * the global thread pool. The profile cache is shared and thread safe,
+     * so profiles loaded by one worker are reused by the others.
+     * \param aManager Manager used to load the profiles.
+     * \param aNames Names of the sync profiles.
+     * \return The loaded profiles in the order of the names, owned by the
+     *  caller. Profiles that could not be loaded are left out.
+     */
+    QList<SyncProfile*> loadSyncProfiles(ProfileManager &aManager,
+            const QStringList &aNames);
+
+    /*! \brief Loads and expands a sync profile without its sync log.
+     *
+     * Sub-profiles are merged from the profile cache, so only files that
+     * are not cached yet are parsed. The result is not cached itself.
+     * \param aManager Manager used to expand the profile.
+     * \param aName Name of the sync profile.
+     * \return The expanded profile, owned by the caller. 0 if not found.
+     */
+    SyncProfile *loadExpanded(ProfileManager &aManager, const QString &aName);
+
+    /*! \brief Matches a sync profile and projects it into a row.
+     *
+     * \param aManager Manager used to load the profile if it is not cached.
+     * \param aName Name of the sync profile.
+     * \param aQuery Compiled criteria the profile must match.
+     * \param aProjection Parts of the profile to project.
+     * \param aRow Row to fill.
+     * \return True if the profile exists and matches the criteria.
+     */
+    bool queryRow(ProfileManager &aManager, const QString &aName,
+            const ProfileQuery &aQuery,
+            const ProfileManager::Projection &aProjection,
+            ProfileManager::ProfileRow &aRow);
+
+    /*! \brief Switches to the profile database of the primary path.
+     *
+     * The database is created from the profile files if it does not exist.
+     * \return Success indicator.
+     */
+    bool useDatabase();
+
+    // Gets the path of the profile database in the primary path.
+    QString databasePath() const;
+
+    // Opens the profile database of the primary path. 0 on failure.
+    SqliteProfileStore *openDatabase();
 
     // Primary path for profiles.
     QString iPrimaryPath;
@@ -101,17 +207,132 @@ public:
     // Secondary path for profiles.
     QString iSecondaryPath;
 
+    // Parsed profiles shared with other managers using the same paths.
+    QSharedPointer<ProfileCache> iCache;
+
+    // Storage of the profiles.
+    QScopedPointer<ProfileStore> iStore;
+
+    // Is the compiled snapshot of the cache used. It is built from the
+    // profile files.
+    bool iUseSnapshot;
+
+    // Number of running ChangeCheckBatch scopes.
+    QAtomicInt iChangeCheckBatches;
+};
+
+/*! \brief Checks the store for external changes once for a whole operation.
+ *
+ * The check is made when the outermost batch starts. The profiles loaded by
+ * the operation, also on worker threads, skip their own checks. Calls made
+ * from other threads while the batch runs skip them as well.
+ */
+class ChangeCheckBatch
+{
+public:
+    explicit ChangeCheckBatch(ProfileManagerPrivate &aPrivate)
+    :   iPrivate(aPrivate)
+    {
+        iPrivate.checkExternalChanges();
+        iPrivate.iChangeCheckBatches.ref();
+    }
+
+    ~ChangeCheckBatch()
+    {
+        iPrivate.iChangeCheckBatches.deref();
+    }
 
+private:
+    ProfileManagerPrivate &iPrivate;
+};
+
+/*! \brief Matches sync profiles against criteria and projects them into
+ * rows. Used both on cached profiles in place and on loaded ones.
+ */
+class RowProjector : public ProfileCache::SyncProfileVisitor
+{
+public:
+    RowProjector(const ProfileQuery &aQuery,
+                 const ProfileManager::Projection &aProjection,
+                 ProfileManager::ProfileRow &aRow);
+
+    virtual void visit(const SyncProfile &aProfile);
+
+    //! \brief Checks if the visited profile matched the criteria.
+    bool matched() const;
+
+private:
+    void projectKeys(const Profile &aProfile, const QStringList &aKeys,
+                     QMap<QString, QString> &aValues);
+
+    const ProfileQuery &iQuery;
+
+    const ProfileManager::Projection &iProjection;
+
+    ProfileManager::ProfileRow &iRow;
+
+    bool iMatched;
 };
 
 }
 
 using namespace Buteo;
 
+// Builds the delta of a profile update from its local keys before and after.
+static QVariantMap keyDelta(const QMap<QString, QString> &aOld,
+                            const QMap<QString, QString> &aNew)
+{
+    QVariantMap changed;
+    foreach (const QString &key, aNew.uniqueKeys())
+    {
+        const QString value = aNew.value(key);
+        if (!aOld.contains(key) || aOld.value(key) != value)
+        {
+            changed.insert(key, value);
+        } // no else
+    }
+
+    QStringList removed;
+    foreach (const QString &key, aOld.uniqueKeys())
+    {
+        if (!aNew.contains(key))
+        {
+            removed.append(key);
+        } // no else
+    }
+
+    QVariantMap delta;
+    if (!changed.isEmpty())
+    {
+        delta.insert(DELTA_KEYS, changed);
+    } // no else
+    if (!removed.isEmpty())
+    {
+        delta.insert(DELTA_REMOVED_KEYS, removed);
+    } // no else
+
+    return delta;
+}
+
+// Builds the delta of new sync results.
+static QVariantMap resultsDelta(const SyncResults &aResults)
+{
+    QVariantMap results;
+    results.insert(DELTA_SYNC_TIME, aResults.syncTime().toMSecsSinceEpoch());
+    results.insert(DELTA_MAJOR_CODE, aResults.majorCode());
+    results.insert(DELTA_MINOR_CODE, aResults.minorCode());
+    results.insert(DELTA_SCHEDULED, aResults.isScheduled());
+
+    QVariantMap delta;
+    delta.insert(DELTA_RESULTS, results);
+    return delta;
+}
+
 ProfileManagerPrivate::ProfileManagerPrivate(const QString &aPrimaryPath,
         const QString &aSecondaryPath)
 :   iPrimaryPath(aPrimaryPath),
-    iSecondaryPath(aSecondaryPath)
+    iSecondaryPath(aSecondaryPath),
+    iUseSnapshot(false)
 {
 
     if (iPrimaryPath.endsWith(QDir::separator()))
@@ -125,199 +346,456 @@ ProfileManagerPrivate::ProfileManagerPrivate(const QString &aPrimaryPath,
 
     LOG_DEBUG("Primary profile path set to" << iPrimaryPath);
     LOG_DEBUG("Secondary profile path set to" << iSecondaryPath);
+
+    bool cacheCreated = false;
+    iCache = ProfileCache::instance(iPrimaryPath, iSecondaryPath, &cacheCreated);
+
+    // Profiles are kept in a database instead of files once one has been
+    // created in the primary path, see useDatabase().
+    if (QFile::exists(databasePath()))
+    {
+        iStore.reset(openDatabase());
+        if (iStore.isNull())
+        {
+            LOG_WARNING("Failed to open profile database, using profile files");
+        } // no else
+    } // no else
+
+    if (iStore.isNull())
+    {
+        XmlProfileStore *store = new XmlProfileStore(iPrimaryPath,
+                                                     iSecondaryPath, iCache);
+        if (cacheCreated)
+        {
+            // First user of these paths in this process.
+            store->migrateBackups();
+        } // no else
+        iStore.reset(store);
+        iUseSnapshot = true;
+    } // no else
 }
 
-Profile *ProfileManagerPrivate::load(const QString &aName, const QString &aType)
+QString ProfileManagerPrivate::databasePath() const
 {
-    QString profilePath = findProfileFile(aName, aType);
-    QString backupProfilePath = profilePath + BACKUP_EXT;
-
-    QDomDocument doc;
-    Profile* profile = 0;
+    return iPrimaryPath + QDir::separator() + SqliteProfileStore::DATABASE_FILE;
+}
 
-    restoreBackupIfFound(profilePath, backupProfilePath);
+SqliteProfileStore *ProfileManagerPrivate::openDatabase()
+{
+    FUNCTION_CALL_TRACE;
 
-    if (parseFile(profilePath, doc))
+    SqliteProfileStore *store = new SqliteProfileStore(databasePath(),
+                                                       iSecondaryPath);
+    if (!store->init())
     {
-        ProfileFactory pf;
-        profile = pf.createProfile(doc.documentElement());
+        delete store;
+        return 0;
+    } // no else
+
+    LOG_DEBUG("Using profile database" << databasePath());
+    return store;
+}
+
+bool ProfileManagerPrivate::useDatabase()
+{
+    FUNCTION_CALL_TRACE;
+
+    if (dynamic_cast<SqliteProfileStore*>(iStore.data()) != 0)
+        return true;
 
-        if (QFile::exists(backupProfilePath))
+    if (!QFile::exists(databasePath()))
+    {
+        // Pending updates go to the files that are imported.
+        if (!iStore->flush())
+            return false;
+
+        // The profiles are imported into a temporary database, which is
+        // renamed into place once it is complete. Other processes start
+        // using the database when they find it.
+        const QString tempPath = databasePath() + ProfileWriteQueue::TEMP_EXT;
+        QFile::remove(tempPath);
+        int imported = -1;
         {
-            QFile::remove(backupProfilePath);
+            SqliteProfileStore store(tempPath, iSecondaryPath);
+            if (store.init())
+            {
+                imported = store.importXml(iPrimaryPath);
+            } // no else
         }
+        if (imported < 0 || !QFile::rename(tempPath, databasePath()))
+        {
+            LOG_WARNING("Failed to create profile database" << databasePath());
+            QFile::remove(tempPath);
+            return false;
+        } // no else
+        LOG_DEBUG("Imported" << imported << "profiles into" << databasePath());
+    } // no else
+
+    SqliteProfileStore *store = openDatabase();
+    if (store == 0)
+    {
+        LOG_WARNING("Failed to open profile database" << databasePath());
+        return false;
+    } // no else
+
+    // The profile files are left in place, but are not read any more.
+    iStore.reset(store);
+    iUseSnapshot = false;
+    iCache->invalidateAll();
+
+    return true;
+}
+
+Profile *ProfileManagerPrivate::load(const QString &aName, const QString &aType)
+{
+    QSharedPointer<const Profile> shared = sharedProfile(aName, aType);
+    return (!shared.isNull()) ? shared->clone() : 0;
+}
+
+QSharedPointer<const Profile> ProfileManagerPrivate::sharedProfile(
+        const QString &aName, const QString &aType)
+{
+    QSharedPointer<const Profile> shared = iCache->sharedProfile(aName, aType);
+    if (!shared.isNull())
+    {
+        return shared;
+    } // no else
+
+    Profile *profile = iStore->load(aName, aType);
+    if (profile != 0)
+    {
+        shared = iCache->insertProfile(profile, iCache->profilePath(aName, aType));
     }
     else {
         LOG_WARNING("Failed to load profile:" << aName);
     }
 
-    return profile;
+    return shared;
 }
 
-SyncLog *ProfileManagerPrivate::loadLog(const QString &aProfileName)
+void ProfileManagerPrivate::updateIndex(ProfileManager &aManager)
 {
+    ProfileIndex &index = iCache->index();
 
+    int generation = 0;
+    if (index.needsRebuild(generation))
+    {
+        // Only the keys are indexed, so the profiles are expanded from the
+        // shared profile files without loading their sync logs.
+        LOG_DEBUG("Building sync profile index");
+        index.clear();
+        foreach (const QString &name, aManager.profileNames(Profile::TYPE_SYNC))
+        {
+            QScopedPointer<SyncProfile> p(loadExpanded(aManager, name));
+            index.update(name, p.data());
+        }
+        index.setBuilt(generation);
+    }
+    else
+    {
+        QStringList staleNames = index.takeStale();
+        foreach (const QString &name, staleNames)
+        {
+            QScopedPointer<SyncProfile> p(loadExpanded(aManager, name));
+            index.update(name, p.data());
+        }
+    }
+}
 
-    QString fileName = iPrimaryPath + QDir::separator() + Profile::TYPE_SYNC + QDir::separator() +
-            LOG_DIRECTORY + QDir::separator() + aProfileName + LOG_EXT + FORMAT_EXT;
+QStringList ProfileManagerPrivate::candidateNames(ProfileManager &aManager,
+        const QList<ProfileManager::SearchCriteria> &aCriteria)
+{
+    QStringList names = aManager.profileNames(Profile::TYPE_SYNC);
 
-    if (!QFile::exists(fileName))
+    // Stores that can search their profiles need no index built from the
+    // loaded profiles.
+    QSet<QString> candidates;
+    if (iStore->candidates(aCriteria, candidates))
     {
-        LOG_DEBUG("No sync log found for profile:" << aProfileName);
-        return 0;
+        return restrictNames(names, candidates);
     } // no else
 
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly))
+    updateIndex(aManager);
+    if (iCache->index().candidates(aCriteria, candidates))
+    {
+        names = restrictNames(names, candidates);
+    } // no else, every profile is a candidate
+
+    return names;
+}
+
+QStringList ProfileManagerPrivate::candidateNames(ProfileManager &aManager,
+        const QString &aSubProfileName, const QString &aSubProfileType,
+        const QString &aKey, const QString &aValue)
+{
+    ProfileManager::SearchCriteria criteria;
+    criteria.iSubProfileName = aSubProfileName;
+    criteria.iSubProfileType = aSubProfileType;
+    criteria.iKey = aKey;
+    criteria.iValue = aValue;
+    criteria.iType = aValue.isEmpty() ? ProfileManager::SearchCriteria::EXISTS :
+                                        ProfileManager::SearchCriteria::EQUAL;
+
+    return candidateNames(aManager,
+            QList<ProfileManager::SearchCriteria>() << criteria);
+}
+
+QStringList ProfileManagerPrivate::restrictNames(const QStringList &aNames,
+        const QSet<QString> &aCandidates)
+{
+    QStringList names;
+    foreach (const QString &name, aNames)
+    {
+        if (aCandidates.contains(name))
+        {
+            names.append(name);
+        } // no else
+    }
+
+    return names;
+}
+
+SyncProfile *ProfileManagerPrivate::loadExpanded(ProfileManager &aManager,
+        const QString &aName)
+{
+    Profile *p = load(aName, Profile::TYPE_SYNC);
+    if (p == 0 || p->type() != Profile::TYPE_SYNC)
     {
-        LOG_WARNING("Failed to open sync log file for reading:"
-                << file.fileName());
+        delete p;
         return 0;
     } // no else
 
-    QDomDocument doc;
-    if (!doc.setContent(&file)) {
-        file.close();
-        LOG_WARNING("Failed to parse XML from sync log file:"
-                << file.fileName());
-        return 0;
+    // Type is verified, see ProfileManager::syncProfile().
+    SyncProfile *syncProfile = static_cast<SyncProfile*>(p);
+    aManager.expand(*syncProfile);
+
+    return syncProfile;
+}
+
+bool ProfileManagerPrivate::queryRow(ProfileManager &aManager,
+        const QString &aName,
+        const ProfileQuery &aQuery,
+        const ProfileManager::Projection &aProjection,
+        ProfileManager::ProfileRow &aRow)
+{
+    RowProjector projector(aQuery, aProjection, aRow);
+    if (!iCache->visitSyncProfile(aName, projector))
+    {
+        // Only the last results need the sync log. Going through
+        // syncProfile() then also caches the profile for the next query.
+        QScopedPointer<SyncProfile> profile(aProjection.iLastResults ?
+                aManager.syncProfile(aName) : loadExpanded(aManager, aName));
+        if (profile.isNull())
+        {
+            return false;
+        } // no else
+        projector.visit(*profile);
     } // no else
-    file.close();
 
-    return new SyncLog(doc.documentElement());
+    return projector.matched();
 }
 
-bool ProfileManagerPrivate::matchProfile(const Profile &aProfile,
-        const ProfileManager::SearchCriteria &aCriteria)
+RowProjector::RowProjector(const ProfileQuery &aQuery,
+        const ProfileManager::Projection &aProjection,
+        ProfileManager::ProfileRow &aRow)
+:   iQuery(aQuery),
+    iProjection(aProjection),
+    iRow(aRow),
+    iMatched(false)
 {
-    //FUNCTION_CALL_TRACE;
-    bool matched = false;
+}
 
-    const Profile *testProfile = &aProfile;
-    if (!aCriteria.iSubProfileName.isEmpty())
+void RowProjector::visit(const SyncProfile &aProfile)
+{
+    iMatched = iQuery.matches(aProfile);
+    if (!iMatched)
     {
-        // Sub-profile name was given, request a sub-profile with a
-        // matching name and type.
-        testProfile = aProfile.subProfile(aCriteria.iSubProfileName,
-                aCriteria.iSubProfileType);
+        return;
+    } // no else
 
-        if (testProfile != 0)
-        {
-            matched = matchKey(*testProfile, aCriteria);
-        }
-        else
-        {
-            if (aCriteria.iType == ProfileManager::SearchCriteria::NOT_EXISTS)
-            {
-                matched = true;
-            }
-            else
-            {
-                matched = false;
-            }
-        }
-    }
-    else if (!aCriteria.iSubProfileType.isEmpty())
+    iRow.iName = aProfile.name();
+    projectKeys(aProfile, iProjection.iKeys, iRow.iKeys);
+
+    if (!iProjection.iSubProfileKeys.isEmpty())
     {
-        // Sub-profile name was empty, but type was given. Get all
-        // sub-profiles with the matching type.
-        QStringList subProfileNames =
-                aProfile.subProfileNames(aCriteria.iSubProfileType);
-        if (!subProfileNames.isEmpty())
+        foreach (const QString &subName,
+                 aProfile.subProfileNames(iProjection.iSubProfileType))
         {
-            matched = false;
-            foreach (const QString &subProfileName, subProfileNames)
+            const Profile *sub = aProfile.subProfile(subName,
+                    iProjection.iSubProfileType);
+            if (sub != 0)
             {
-                testProfile = aProfile.subProfile(subProfileName,
-                        aCriteria.iSubProfileType);
-                if (testProfile != 0 && matchKey(*testProfile, aCriteria))
+                QMap<QString, QString> values;
+                projectKeys(*sub, iProjection.iSubProfileKeys, values);
+                if (!values.isEmpty())
                 {
-                    matched = true;
-                    break;
-                }
-            }
+                    iRow.iSubProfileKeys.insert(subName, values);
+                } // no else
+            } // no else
         }
-        else
+    } // no else
+
+    if (iProjection.iLastResults && aProfile.lastResults() != 0)
+    {
+        iRow.iLastResults = QSharedPointer<const SyncResults>(
+                new SyncResults(*aProfile.lastResults()));
+    } // no else
+
+    if (iProjection.iSchedule)
+    {
+        iRow.iSchedule = aProfile.syncSchedule();
+        iRow.iSyncType = aProfile.syncType();
+    } // no else
+}
+
+bool RowProjector::matched() const
+{
+    return iMatched;
+}
+
+void RowProjector::projectKeys(const Profile &aProfile,
+        const QStringList &aKeys, QMap<QString, QString> &aValues)
+{
+    foreach (const QString &key, aKeys)
+    {
+        QString value = aProfile.key(key);
+        if (!value.isNull())
         {
-            if (aCriteria.iType == ProfileManager::SearchCriteria::NOT_EXISTS)
-            {
-                matched = true;
-            }
-            else
-            {
-                matched = false;
-            }
-        }
+            aValues.insert(key, value);
+        } // no else
     }
-    else
+}
+
+namespace {
+
+// Loads one sync profile, run by the workers of loadSyncProfiles().
+class SyncProfileLoader
+{
+public:
+    typedef SyncProfile *result_type;
+
+    explicit SyncProfileLoader(ProfileManager &aManager)
+    :   iManager(&aManager)
     {
-        matched = matchKey(aProfile, aCriteria);
     }
 
-    return matched;
-}
+    SyncProfile *operator()(const QString &aName) const
+    {
+        return iManager->syncProfile(aName);
+    }
+
+private:
+    ProfileManager *iManager;
+};
 
-bool ProfileManagerPrivate::matchKey(const Profile &aProfile,
-        const ProfileManager::SearchCriteria &aCriteria)
+// Checks one sync profile against a query, run by the workers of
+// matchingNames().
+class SyncProfileMatcher
 {
-    bool matched = false;
+public:
+    typedef bool result_type;
 
-    if (!aCriteria.iKey.isEmpty())
+    SyncProfileMatcher(ProfileManagerPrivate &aPrivate, ProfileManager &aManager,
+                       const ProfileQuery &aQuery)
+    :   iPrivate(&aPrivate),
+        iManager(&aManager),
+        iQuery(&aQuery)
     {
-        // Key name was given, get a key with matching name.
-        QString value = aProfile.key(aCriteria.iKey);
+    }
 
-        if (value.isNull())
-        {
-            if (aCriteria.iType == ProfileManager::SearchCriteria::NOT_EXISTS ||
-                    aCriteria.iType == ProfileManager::SearchCriteria::NOT_EQUAL)
-            {
-                matched = true;
-            }
-            else
-            {
-                matched = false;
-            }
-        }
-        else
-        {
-            switch (aCriteria.iType)
-            {
-            case ProfileManager::SearchCriteria::EXISTS:
-                matched = true;
-                break;
+    bool operator()(const QString &aName) const
+    {
+        return iPrivate->matches(*iManager, aName, *iQuery);
+    }
 
-            case ProfileManager::SearchCriteria::NOT_EXISTS:
-                matched = false;
-                break;
+private:
+    ProfileManagerPrivate *iPrivate;
+    ProfileManager *iManager;
+    const ProfileQuery *iQuery;
+};
 
-            case ProfileManager::SearchCriteria::EQUAL:
-                matched = (value == aCriteria.iValue);
-                break;
+// Checks a cached sync profile against a query in place.
+class QueryVisitor : public ProfileCache::SyncProfileVisitor
+{
+public:
+    explicit QueryVisitor(const ProfileQuery &aQuery)
+    :   iQuery(aQuery),
+        iMatched(false)
+    {
+    }
 
-            case ProfileManager::SearchCriteria::NOT_EQUAL:
-                matched = (value != aCriteria.iValue);
-                break;
+    virtual void visit(const SyncProfile &aProfile)
+    {
+        iMatched = iQuery.matches(aProfile);
+    }
 
-            default:
-                matched = false;
-                break;
-            }
-        }
+    const ProfileQuery &iQuery;
+    bool iMatched;
+};
+
+}
+
+QList<SyncProfile*> ProfileManagerPrivate::loadSyncProfiles(
+        ProfileManager &aManager, const QStringList &aNames)
+{
+    QList<SyncProfile*> loaded;
+    if (aNames.size() > 1 && QThread::idealThreadCount() > 1)
+    {
+        // Mapped results keep the order of the names.
+        loaded = QtConcurrent::blockingMapped<QList<SyncProfile*> >(aNames,
+                SyncProfileLoader(aManager));
     }
     else
     {
-        if (aCriteria.iType == ProfileManager::SearchCriteria::NOT_EXISTS)
+        SyncProfileLoader loader(aManager);
+        foreach (const QString &name, aNames)
         {
-            matched = false;
+            loaded.append(loader(name));
         }
-        else
+    }
+
+    loaded.removeAll(0);
+    return loaded;
+}
+
+bool ProfileManagerPrivate::matches(ProfileManager &aManager,
+        const QString &aName, const ProfileQuery &aQuery)
+{
+    QueryVisitor visitor(aQuery);
+    if (iCache->visitSyncProfile(aName, visitor))
+    {
+        return visitor.iMatched;
+    } // no else
+
+    QScopedPointer<SyncProfile> profile(loadExpanded(aManager, aName));
+    return !profile.isNull() && aQuery.matches(*profile);
+}
+
+QStringList ProfileManagerPrivate::matchingNames(ProfileManager &aManager,
+        const QStringList &aNames, const ProfileQuery &aQuery)
+{
+    if (aQuery.isEmpty())
+    {
+        return aNames;
+    } // no else
+
+    SyncProfileMatcher matcher(*this, aManager, aQuery);
+    if (aNames.size() > 1 && QThread::idealThreadCount() > 1)
+    {
+        // Filtered results keep the order of the names.
+        return QtConcurrent::blockingFiltered(aNames, matcher);
+    } // no else
+
+    QStringList names;
+    foreach (const QString &name, aNames)
+    {
+        if (matcher(name))
         {
-            matched = true;
-        }
+            names.append(name);
+        } // no else
     }
 
-    return matched;
+    return names;
 }
 
 ProfileManager::SearchCriteria::SearchCriteria()
@@ -334,6 +812,17 @@ ProfileManager::SearchCriteria::SearchCriteria(const SearchCriteria &aSource)
 {
 }
 
+ProfileManager::Projection::Projection()
+:   iLastResults(false),
+    iSchedule(false)
+{
+}
+
+ProfileManager::ProfileRow::ProfileRow()
+:   iSyncType(SyncProfile::SYNC_MANUAL)
+{
+}
+
 ProfileManager::ProfileManager(const QString &aPrimaryPath,
         const QString &aSecondaryPath)
 :   d_ptr(new ProfileManagerPrivate(aPrimaryPath, aSecondaryPath))
@@ -350,14 +839,32 @@ ProfileManager::~ProfileManager()
 
 Profile *ProfileManager::profile(const QString &aName, const QString &aType)
 {
-
+    d_ptr->checkExternalChanges();
     return d_ptr->load(aName, aType);
 }
 
 SyncProfile *ProfileManager::syncProfile(const QString &aName)
 {
     LOG_DEBUG("ProfileManager::syncProfile(" << aName << ")");
-    Profile *p = profile(aName, Profile::TYPE_SYNC);
+    d_ptr->checkExternalChanges();
+    SyncProfile *cached = d_ptr->iCache->syncProfile(aName);
+    if (cached != 0)
+    {
+        return cached;
+    } // no else
+
+    // Fast path, decode the expanded profile from the compiled snapshot.
+    if (d_ptr->iUseSnapshot)
+    {
+        cached = d_ptr->iCache->snapshotProfile(aName);
+        if (cached != 0)
+        {
+            d_ptr->iCache->insertSyncProfile(*cached);
+            return cached;
+        } // no else
+    } // no else
+
+    Profile *p = d_ptr->load(aName, Profile::TYPE_SYNC);
     SyncProfile *syncProfile = 0;
     if (p != 0 && p->type() == Profile::TYPE_SYNC)
     {
@@ -373,13 +880,15 @@ SyncProfile *ProfileManager::syncProfile(const QString &aName)
         // Load sync log. If not found, create an empty log.
         if (syncProfile->log() == 0)
         {
-            SyncLog *log = d_ptr->loadLog(aName);
+            SyncLog *log = d_ptr->iStore->loadLog(aName);
             if (0 == log)
             {
                 log = new SyncLog(aName);
             } // no else
             syncProfile->setLog(log);
         } // no else
+
+        d_ptr->iCache->insertSyncProfile(*syncProfile);
     } else {
         LOG_DEBUG("did not find a valid sync profile with the given name:" << aName);
         if (p != 0) {
@@ -393,54 +902,34 @@ SyncProfile *ProfileManager::syncProfile(const QString &aName)
 
 QStringList ProfileManager::profileNames(const QString &aType)
 {
-
-    // Search for all profile files from the primary directory
-    QStringList names;
-    QString nameFilter = QString("*") + FORMAT_EXT;
-    {
-        QDir dir(d_ptr->iPrimaryPath + QDir::separator() + aType);
-        QFileInfoList fileInfoList = dir.entryInfoList(QStringList(nameFilter),
-                QDir::Files | QDir::NoSymLinks);
-        foreach (const QFileInfo &fileInfo, fileInfoList)
-        {
-            names.append(fileInfo.completeBaseName());
-        }
-    }
-
-    // Search for all profile files from the secondary directory
-    {
-        QDir dir(d_ptr->iSecondaryPath + QDir::separator() + aType);
-        QFileInfoList fileInfoList = dir.entryInfoList(QStringList(nameFilter),
-                QDir::Files | QDir::NoSymLinks);
-        foreach (const QFileInfo &fileInfo, fileInfoList)
-        {
-            // Add only if the list does not yet contain the name.
-            QString profileName = fileInfo.completeBaseName();
-            if (!names.contains(profileName))
-            {
-                names.append(profileName);
-            }
-        }
-    }
-
-    return names;
+    d_ptr->checkExternalChanges();
+    return d_ptr->iStore->profileNames(aType);
 }
 
 QList<SyncProfile*> ProfileManager::allSyncProfiles()
 {
     FUNCTION_CALL_TRACE;
 
+    ChangeCheckBatch batch(*d_ptr);
+
     QList<SyncProfile*> profiles;
 
-    QStringList names = profileNames(Profile::TYPE_SYNC);
-    foreach (const QString &name, names)
+    // Source files are listed before loading, so that changes made while
+    // loading invalidate the new snapshot.
+    const bool rebuildSnapshot = d_ptr->iUseSnapshot &&
+            d_ptr->iCache->snapshotNeedsRebuild();
+    QByteArray sourceListing;
+    if (rebuildSnapshot)
     {
-        SyncProfile *p = syncProfile(name);
-        if (p != 0)
-        {
-            profiles.append(p);
-        } // no else
-    }
+        sourceListing = d_ptr->iCache->snapshotSourceListing();
+    } // no else
+
+    profiles = d_ptr->loadSyncProfiles(*this, profileNames(Profile::TYPE_SYNC));
+
+    if (rebuildSnapshot)
+    {
+        d_ptr->iCache->rebuildSnapshot(sourceListing, profiles);
+    } // no else
 
     return profiles;
 }
@@ -473,10 +962,16 @@ QList<SyncProfile*> ProfileManager::getSyncProfilesByData(
 {
     FUNCTION_CALL_TRACE;
 
-    QList<SyncProfile*> allProfiles = allSyncProfiles();
+    ChangeCheckBatch batch(*d_ptr);
+
+    // Load only the profiles the key index cannot rule out.
+    QStringList names = d_ptr->candidateNames(*this, aSubProfileName,
+            aSubProfileType, aKey, aValue);
+    QList<SyncProfile*> candidateProfiles = d_ptr->loadSyncProfiles(*this, names);
+
     QList<SyncProfile*> matchingProfiles;
 
-    foreach (SyncProfile *profile, allProfiles)
+    foreach (SyncProfile *profile, candidateProfiles)
     {
         Profile *testProfile = profile;
         if (!aSubProfileName.isEmpty())
@@ -534,25 +1029,21 @@ QList<SyncProfile*> ProfileManager::getSyncProfilesByData(
 {
     FUNCTION_CALL_TRACE;
 
-    QList<SyncProfile*> allProfiles = allSyncProfiles();
+    ChangeCheckBatch batch(*d_ptr);
+
     QList<SyncProfile*> matchingProfiles;
 
-    foreach (SyncProfile *profile, allProfiles)
+    // Of the profiles the key index cannot rule out, the query is checked
+    // on the cached ones in place and on the others before their logs are
+    // read. Only the matching profiles are then loaded completely.
+    const ProfileQuery query(aCriteria);
+    QStringList names = d_ptr->matchingNames(*this,
+            d_ptr->candidateNames(*this, aCriteria), query);
+    QList<SyncProfile*> candidateProfiles = d_ptr->loadSyncProfiles(*this, names);
+    foreach (SyncProfile *profile, candidateProfiles)
     {
-        bool matched = true;
-        if (profile == 0)
-            continue;
-
-        foreach (const SearchCriteria &criteria, aCriteria)
-        {
-            if (!d_ptr->matchProfile(*profile, criteria))
-            {
-                matched = false;
-                break;
-            }
-        }
-
-        if (matched)
+        // The profile may have changed after it was matched.
+        if (query.matches(*profile))
         {
             matchingProfiles.append(profile);
         }
@@ -566,6 +1057,56 @@ QList<SyncProfile*> ProfileManager::getSyncProfilesByData(
     return matchingProfiles;
 }
 
+namespace {
+
+// Collects the rows of a query into a list.
+class RowCollector : public ProfileManager::RowHandler
+{
+public:
+    virtual bool handleRow(const ProfileManager::ProfileRow &aRow)
+    {
+        iRows.append(aRow);
+        return true;
+    }
+
+    QList<ProfileManager::ProfileRow> iRows;
+};
+
+}
+
+QList<ProfileManager::ProfileRow> ProfileManager::queryProfiles(
+        const QList<SearchCriteria> &aCriteria,
+        const Projection &aProjection)
+{
+    RowCollector collector;
+    queryProfiles(aCriteria, aProjection, collector);
+
+    return collector.iRows;
+}
+
+void ProfileManager::queryProfiles(const QList<SearchCriteria> &aCriteria,
+        const Projection &aProjection, RowHandler &aHandler)
+{
+    FUNCTION_CALL_TRACE;
+
+    ChangeCheckBatch batch(*d_ptr);
+
+    // The key index narrows the candidates like in getSyncProfilesByData().
+    QStringList names = aCriteria.isEmpty() ?
+            profileNames(Profile::TYPE_SYNC) :
+            d_ptr->candidateNames(*this, aCriteria);
+    const ProfileQuery query(aCriteria);
+    foreach (const QString &name, names)
+    {
+        ProfileRow row;
+        if (d_ptr->queryRow(*this, name, query, aProjection, row) &&
+            !aHandler.handleRow(row))
+        {
+            break;
+        } // no else
+    }
+}
+
 QList<SyncProfile*> ProfileManager::getSOCProfilesForStorage(
         const QString &aStorageName)
 {
@@ -676,46 +1217,44 @@ QList<SyncProfile*> ProfileManager::getSyncProfilesByStorage(
 }
 
 
-bool ProfileManagerPrivate::save(const Profile &aProfile)
+bool ProfileManagerPrivate::save(const Profile &aProfile, bool aDeferred)
 {
     FUNCTION_CALL_TRACE;
 
-    QDomDocument doc = constructProfileDocument(aProfile);
-    if (doc.isNull())
+    const bool profileWritten = iStore->save(aProfile, aDeferred);
+    if (!profileWritten)
     {
-        LOG_WARNING("No profile data to write");
-        return false;
-    }
+        LOG_WARNING("Failed to save profile:" << aProfile.name());
+    } // no else
+    iCache->invalidate(aProfile.name(), aProfile.type());
 
-    // Create path for the new profile file.
-    QDir dir;
-    dir.mkpath(iPrimaryPath + QDir::separator() + aProfile.type());
-    QString profilePath(iPrimaryPath + QDir::separator() +
-            aProfile.type() + QDir::separator() + aProfile.name() + FORMAT_EXT);
+    return profileWritten;
+}
 
-    // Create a backup of the existing profile file.
-    QString oldProfilePath = findProfileFile(aProfile.type(), aProfile.name());
-    QString backupPath = profilePath + BACKUP_EXT;
+void ProfileManagerPrivate::checkExternalChanges()
+{
+    if (iChangeCheckBatches.load() > 0)
+        return;
 
-    if (QFile::exists(oldProfilePath) &&
-            !createBackup(oldProfilePath, backupPath))
+    if (iStore->hasExternalChanges())
     {
-        LOG_WARNING("Failed to create profile backup");
-    }
+        LOG_DEBUG("Profile store changed, dropping cached profiles");
+        iCache->invalidateAll();
+    } // no else
+}
 
-    bool profileWritten = false;
-    if (writeProfileFile(profilePath, doc))
-    {
-        QFile::remove(backupPath);
-        profileWritten = true;
-    }
-    else
-    {
-        LOG_WARNING("Failed to save profile:" << aProfile.name());
-        profileWritten = false;
-    }
+bool ProfileManager::flush()
+{
+    FUNCTION_CALL_TRACE;
 
-    return profileWritten;
+    return d_ptr->iStore->flush();
+}
+
+bool ProfileManager::useDatabase()
+{
+    FUNCTION_CALL_TRACE;
+
+    return d_ptr->useDatabase();
 }
 
 Profile* ProfileManager::profileFromXml(const QString &aProfileAsXml)
@@ -724,10 +1263,14 @@ Profile* ProfileManager::profileFromXml(const QString &aProfileAsXml)
 
     Profile *profile = NULL;
     if(!aProfileAsXml.isEmpty()) {
-        QDomDocument doc;
-        if(doc.setContent(aProfileAsXml,true)) {
+        QXmlStreamReader reader(aProfileAsXml);
+        if (reader.readNextStartElement()) {
             ProfileFactory pf;
-            profile = pf.createProfile(doc.documentElement());
+            profile = pf.createProfile(reader);
+        }
+        if (!readToEnd(reader)) {
+            delete profile;
+            profile = NULL;
         }
     }
     return profile;
@@ -743,19 +1286,43 @@ QString ProfileManager::updateProfile(const Profile &aProfile)
 
     QString profileId("");
 
+    // Nothing to write if the profile has not changed since it was loaded.
+    if (exists && !aProfile.isModified()) {
+        LOG_DEBUG("Profile not modified, skipping write:" << aProfile.name());
+        return aProfile.name();
+    }
+
+    // Keys as they were before the update, for the change delta.
+    QMap<QString, QString> oldKeys;
+    if (exists)
+    {
+        QSharedPointer<const Profile> old =
+            d_ptr->sharedProfile(aProfile.name(), aProfile.type());
+        if (!old.isNull())
+        {
+            oldKeys = old->localKeys();
+        } // no else
+    } // no else
+
     // We need to save before emit the signalProfileChanged, if this is the first
     // update the profile will only exists on disk after the save and any operation
-    // using this profile triggered by the signal will fail.
-    if(d_ptr->save(aProfile)) {
+    // using this profile triggered by the signal will fail. Updates of existing
+    // profiles are written behind, but are visible to all readers in this
+    // process right away.
+    if(d_ptr->save(aProfile, true)) {
         profileId = aProfile.name();
     }
 
     // Profile did not exist, it was a new one. Add it and emit signal with "added" value:
-    if (!exists) {
-        emit signalProfileChanged(aProfile.name(),ProfileManager::PROFILE_ADDED,aProfile.toString());
-    } else {
-        emit signalProfileChanged(aProfile.name(),ProfileManager::PROFILE_MODIFIED,aProfile.toString());
-    }
+    const ProfileChangeType changeType = exists ? PROFILE_MODIFIED : PROFILE_ADDED;
+    emit signalProfileDelta(aProfile.name(), changeType,
+                            keyDelta(oldKeys, aProfile.localKeys()));
+
+    // The whole profile is serialized only if someone wants it.
+    if (receivers(SIGNAL(signalProfileChanged(QString,int,QString))) > 0)
+    {
+        emit signalProfileChanged(aProfile.name(), changeType, aProfile.toString());
+    } // no else
 
     return profileId;
 }
@@ -866,6 +1433,7 @@ bool ProfileManager::removeProfile(const QString &aProfileId)
     if(profile){
        success = d_ptr->remove(aProfileId,profile->type());
        if(success) {
+           emit signalProfileDelta(aProfileId, ProfileManager::PROFILE_REMOVED, QVariantMap());
            emit signalProfileChanged(aProfileId,ProfileManager::PROFILE_REMOVED, QString(""));
        }
        delete profile;
@@ -879,7 +1447,6 @@ bool ProfileManagerPrivate::remove(const QString &aName, const QString &aType)
     FUNCTION_CALL_TRACE;
 
     bool success = false;
-    QString filePath = iPrimaryPath + QDir::separator() + aType + QDir::separator() + aName + FORMAT_EXT;
 
     // Try to load profile without expanding it. We need to check from the
     // profile data if the profile is protected before removing it.
@@ -888,12 +1455,9 @@ bool ProfileManagerPrivate::remove(const QString &aName, const QString &aType)
     {
         if (!p->isProtected())
         {
-            success = QFile::remove(filePath);
+            success = iStore->remove(aName, aType);
             if (success){
-               QString logFilePath = iPrimaryPath + QDir::separator() + aType + QDir::separator() +
-                        LOG_DIRECTORY + QDir::separator() + aName + LOG_EXT + FORMAT_EXT;
-               //Initial the will be no log this will fail.
-               QFile::remove(logFilePath);
+               iCache->invalidate(aName, aType);
             }
         }
         else
@@ -927,12 +1491,13 @@ void ProfileManager::expand(Profile &aProfile)
                         {
             if (!sub->isLoaded())
             {
-                Profile *loadedProfile = profile(sub->name(), sub->type());
-                if (loadedProfile != 0)
+                // Sub-profiles are parsed once and shared by all profiles
+                // referencing them, merge from the shared instance.
+                QSharedPointer<const Profile> loadedProfile =
+                    d_ptr->sharedProfile(sub->name(), sub->type());
+                if (!loadedProfile.isNull())
                 {
                     aProfile.merge(*loadedProfile);
-                    delete loadedProfile;
-                    loadedProfile = 0;
                 }
                 else
                 {
@@ -960,39 +1525,10 @@ bool ProfileManager::saveLog(const SyncLog &aLog)
 {
     FUNCTION_CALL_TRACE;
 
-    QDir dir;
-    QString fullPath = d_ptr->iPrimaryPath + QDir::separator() + Profile::TYPE_SYNC + QDir::separator() +
-            LOG_DIRECTORY;
-    dir.mkpath(fullPath);
-    QFile file(fullPath + QDir::separator() + aLog.profileName() + LOG_EXT + FORMAT_EXT);
-
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
-    {
-        LOG_WARNING("Failed to open sync log file for writing:"
-                << file.fileName());
-        return false;
-    } // no else
-
-    QDomDocument doc;
-    QDomProcessingInstruction xmlHeading =
-            doc.createProcessingInstruction("xml",
-                    "version=\"1.0\" encoding=\"UTF-8\"");
-    doc.appendChild(xmlHeading);
-
-    QDomElement root = aLog.toXml(doc);
-    if (root.isNull())
-    {
-        LOG_WARNING("Failed to convert sync log to XML");
+    if (!d_ptr->iStore->saveLog(aLog))
         return false;
-    } // no else
-
-    doc.appendChild(root);
 
-    QTextStream outputStream(&file);
-
-    outputStream << doc.toString(PROFILE_INDENT);
-
-    file.close();
+    d_ptr->iCache->invalidateSyncProfile(aLog.profileName());
 
     return true;
 }
@@ -1012,31 +1548,16 @@ bool ProfileManager::rename(const QString &aName, const QString &aNewName)
 {
     FUNCTION_CALL_TRACE;
 
-    bool ret = false;
-    // Rename the sync profile
-    QString source = d_ptr->iPrimaryPath + QDir::separator() +  Profile::TYPE_SYNC + QDir::separator() +
-            aName + FORMAT_EXT;
-    QString destination = d_ptr->iPrimaryPath + QDir::separator() + Profile::TYPE_SYNC + QDir::separator() +
-            aNewName + FORMAT_EXT;
-    ret = QFile::rename(source, destination);
-    if(true == ret)
-    {
-        // Rename the sync log
-        QString sourceLog = d_ptr->iPrimaryPath + QDir::separator() +  Profile::TYPE_SYNC + QDir::separator() +
-                LOG_DIRECTORY + QDir::separator() + aName + LOG_EXT  + FORMAT_EXT;
-        QString destinationLog = d_ptr->iPrimaryPath + QDir::separator() +  Profile::TYPE_SYNC + QDir::separator() +
-                LOG_DIRECTORY + QDir::separator() + aNewName + LOG_EXT  + FORMAT_EXT;
-        ret = QFile::rename(sourceLog, destinationLog);
-        if(false == ret)
-        {
-            // Roll back the earlier rename
-            QFile::rename(destination, source);
-        }
-    }
+    bool ret = d_ptr->iStore->rename(aName, aNewName);
     if(false == ret)
     {
         LOG_WARNING("Failed to rename profile" << aName);
     }
+    else
+    {
+        d_ptr->iCache->invalidate(aName, Profile::TYPE_SYNC);
+        d_ptr->iCache->invalidate(aNewName, Profile::TYPE_SYNC);
+    }
     return ret;
 }
 
@@ -1045,24 +1566,34 @@ bool ProfileManager::saveSyncResults(QString aProfileName,
 {
 
     FUNCTION_CALL_TRACE;
-    bool success = false;
 
-    SyncProfile *profile = syncProfile(aProfileName);
-    if (profile) {
-        SyncLog *log = profile->log();
-        if (log)
+    if (!d_ptr->iStore->contains(aProfileName, Profile::TYPE_SYNC))
+    {
+        LOG_DEBUG("No sync profile to save results for:" << aProfileName);
+        return false;
+    } // no else
+
+    // Record the results without loading the profile or its log.
+    if (!d_ptr->iStore->appendResults(aProfileName, aResults))
+        return false;
+
+    d_ptr->iCache->addSyncResults(aProfileName, aResults);
+
+    //Emitting signal
+    emit signalProfileDelta(aProfileName, ProfileManager::PROFILE_LOGS_MODIFIED,
+                            resultsDelta(aResults));
+    if (receivers(SIGNAL(signalProfileChanged(QString,int,QString))) > 0)
+    {
+        SyncProfile *profile = syncProfile(aProfileName);
+        if (profile != 0)
         {
-            log->addResults(aResults);
-            success = saveLog(*log);
-            //Emitting signal
             emit signalProfileChanged(aProfileName,ProfileManager::PROFILE_LOGS_MODIFIED,profile->toString());
-        }
-
-        delete profile;
-        profile = 0;
-    }
+            delete profile;
+            profile = 0;
+        } // no else
+    } // no else
 
-    return success;
+    return true;
 }
 
 bool ProfileManager::setSyncSchedule(QString aProfileId , QString aScheduleAsXml)
@@ -1073,12 +1604,14 @@ bool ProfileManager::setSyncSchedule(QString aProfileId , QString aScheduleAsXml
     if (profile)
     {
         profile->setSyncType(SyncProfile::SYNC_SCHEDULED);
-        QDomDocument doc;
-        if(doc.setContent(aScheduleAsXml,true)) {
-            SyncSchedule schedule(doc.documentElement());
-            profile->setSyncSchedule(schedule);
-            updateProfile(*profile);
-            status = true;
+        QXmlStreamReader reader(aScheduleAsXml);
+        if (reader.readNextStartElement()) {
+            SyncSchedule schedule(reader);
+            if (readToEnd(reader)) {
+                profile->setSyncSchedule(schedule);
+                updateProfile(*profile);
+                status = true;
+            }
         }
         delete profile;
         profile = NULL;
@@ -1088,148 +1621,11 @@ bool ProfileManager::setSyncSchedule(QString aProfileId , QString aScheduleAsXml
     return status;
 }
 
-bool ProfileManagerPrivate::parseFile(const QString &aPath, QDomDocument &aDoc)
-{
-    //FUNCTION_CALL_TRACE;
-
-    bool parsingOk = false;
-
-    if (QFile::exists(aPath))
-    {
-        QFile file(aPath);
-
-        if (file.open(QIODevice::ReadOnly))
-        {
-            parsingOk = aDoc.setContent(&file);
-            file.close();
-
-            if (!parsingOk)
-            {
-                LOG_WARNING("Failed to parse profile XML: " << aPath);
-            }
-        }
-        else {
-            LOG_WARNING("Failed to open profile file for reading:" << aPath);
-        }
-    }
-    else
-    {
-        LOG_WARNING("Profile file not found:" << aPath);
-    }
-
-
-
-    return parsingOk;
-}
-
-QDomDocument ProfileManagerPrivate::constructProfileDocument(const Profile &aProfile)
-{
-    //FUNCTION_CALL_TRACE;
-
-    QDomDocument doc;
-    QDomElement root = aProfile.toXml(doc);
-
-    if (root.isNull())
-    {
-        LOG_WARNING("Failed to convert profile to XML");
-    }
-    else
-    {
-        QDomProcessingInstruction xmlHeading =
-                doc.createProcessingInstruction("xml",
-                        "version=\"1.0\" encoding=\"UTF-8\"");
-
-        doc.appendChild(xmlHeading);
-        doc.appendChild(root);
-    }
-
-    return doc;
-}
-
-bool ProfileManagerPrivate::writeProfileFile(const QString &aProfilePath,
-        const QDomDocument &aDoc)
-{
-    FUNCTION_CALL_TRACE;
-    LOG_WARNING("writeProfileFile() called, forcing disk write:" << aProfilePath);
-
-    QFile file(aProfilePath);
-    bool profileWritten = false;
-
-    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
-    {
-        QTextStream outputStream(&file);
-        outputStream << aDoc.toString(PROFILE_INDENT);
-        file.close();
-        profileWritten = true;
-    }
-    else
-    {
-        LOG_WARNING("Failed to open profile file for writing:" << aProfilePath);
-        profileWritten = false;
-    }
-
-    return profileWritten;
-}
-
-void ProfileManagerPrivate::restoreBackupIfFound(const QString &aProfilePath,
-        const QString &aBackupPath)
-{
-    //FUNCTION_CALL_TRACE;
-
-    if (QFile::exists(aBackupPath))
-    {
-        LOG_WARNING("Profile backup file found. The actual profile may be corrupted.");
-
-        QDomDocument doc;
-        if (parseFile(aBackupPath, doc))
-        {
-            LOG_DEBUG("Restoring profile from backup");
-            QFile::remove(aProfilePath);
-            QFile::copy(aBackupPath, aProfilePath);
-        }
-        else
-        {
-            LOG_WARNING("Failed to parse backup file");
-            LOG_DEBUG("Removing backup file");
-            QFile::remove(aBackupPath);
-        }
-    }
-}
-
-bool ProfileManagerPrivate::createBackup(const QString &aProfilePath,
-        const QString &aBackupPath)
-{
-    FUNCTION_CALL_TRACE;
-    return QFile::copy(aProfilePath, aBackupPath);
-}
-
-QString ProfileManagerPrivate::findProfileFile(const QString &aName, const QString &aType)
-{
-    QString fileName = aType + QDir::separator() + aName + FORMAT_EXT;
-    QString primaryPath = iPrimaryPath + QDir::separator() + fileName;
-    QString secondaryPath = iSecondaryPath + QDir::separator() + fileName;
-
-    if (QFile::exists(primaryPath))
-    {
-        return primaryPath;
-    }
-    else if (!QFile::exists(secondaryPath))
-    {
-        return primaryPath;
-    }
-    else
-    {
-        return secondaryPath;
-    }
-}
-
 // this function checks to see if its a new profile or an
 // existing profile being modified under $Sync::syncCacheDir/profiles directory.
 bool ProfileManagerPrivate::profileExists(const QString &aProfileId ,const QString &aType)
 {
-    QString profileFile = iPrimaryPath + QDir::separator() + aType + QDir::separator() + aProfileId + FORMAT_EXT;
-    LOG_DEBUG("profileFile:" << profileFile);
-    return QFile::exists(profileFile);
+    return iStore->isWritable(aProfileId, aType);
 }
 
 void ProfileManager::addRetriesInfo(const SyncProfile* profile)
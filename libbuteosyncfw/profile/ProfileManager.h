@@ -25,10 +25,14 @@
 #define PROFILEMANAGER_H
 
 #include "SyncProfile.h"
+#include "SyncResults.h"
 #include "Profile.h"
 #include <QObject>
 #include <QList>
 #include <QHash>
+#include <QMap>
+#include <QSharedPointer>
+#include <QVariantMap>
 
 namespace Buteo {
 
@@ -41,6 +45,11 @@ class ProfileManagerPrivate;
  * sub-profiles. The ProfileManager hides the actual storage from the user, so
  * that it makes no difference if the profiles are stored to simple XML-files
  * or to a database. Profiles can be queried by name and type.
+ *
+ * Parsed profiles are cached and shared by all ProfileManager instances
+ * of the process that use the same profile paths. The cache follows changes
+ * made through any ProfileManager and changes made to the profile files on
+ * disk, so callers always get up to date copies.
  */
 class ProfileManager: public QObject
 {
@@ -99,6 +108,73 @@ public:
         QString iValue;
     };
 
+    //! Parts of a sync profile returned by queryProfiles().
+    struct Projection
+    {
+        //! \brief Constructor. Nothing is projected by default.
+        Projection();
+
+        //! Keys of the expanded sync profile to return.
+        QStringList iKeys;
+
+        //! Type of the sub-profiles whose keys are returned. If this is
+        //! empty, sub-profiles of all types are used.
+        QString iSubProfileType;
+
+        //! Keys of the sub-profiles to return. If this is empty, no
+        //! sub-profile keys are returned.
+        QStringList iSubProfileKeys;
+
+        //! Return the results of the last sync. The sync log is loaded only
+        //! if this is set.
+        bool iLastResults;
+
+        //! Return the sync schedule and sync type.
+        bool iSchedule;
+    };
+
+    //! Projected data of one sync profile, see queryProfiles().
+    struct ProfileRow
+    {
+        //! \brief Constructor.
+        ProfileRow();
+
+        //! Name of the sync profile.
+        QString iName;
+
+        //! Requested keys that exist in the profile.
+        QMap<QString, QString> iKeys;
+
+        //! Requested sub-profile keys, by sub-profile name. Only sub-profiles
+        //! having at least one of the keys are included.
+        QMap<QString, QMap<QString, QString> > iSubProfileKeys;
+
+        //! Results of the last sync. Null if not requested or if the profile
+        //! has no results.
+        QSharedPointer<const SyncResults> iLastResults;
+
+        //! Sync schedule, if requested.
+        SyncSchedule iSchedule;
+
+        //! Sync type, if the schedule was requested.
+        SyncProfile::SyncType iSyncType;
+    };
+
+    //! \brief Receiver of the rows of a streaming queryProfiles().
+    class RowHandler
+    {
+    public:
+        //! \brief Destructor.
+        virtual ~RowHandler() {}
+
+        /*! \brief Handles a matching profile.
+         *
+         * \param aRow Projected profile data.
+         * \return False to stop the query, true to continue.
+         */
+        virtual bool handleRow(const ProfileRow &aRow) = 0;
+    };
+
     //! \brief  Enum to indicate the change type of the Profile Operation
     enum ProfileChangeType
     {
@@ -192,6 +268,32 @@ public:
     QList<SyncProfile*> getSyncProfilesByData(
         const QList<SearchCriteria> &aCriteria);
 
+    /*! \brief Gets selected parts of the sync profiles matching criteria.
+     *
+     * Unlike getSyncProfilesByData(), no SyncProfile objects are returned.
+     * Cached profiles are read in place without copying them, and for
+     * uncached profiles only the parts needed by the projection are loaded:
+     * the sync log is read only if the last results are requested.
+     * \param aCriteria Search criteria, see getSyncProfilesByData(). An empty
+     *  list matches all sync profiles.
+     * \param aProjection Parts of the profiles to return.
+     * \return Rows of the matching profiles, in profileNames() order.
+     */
+    QList<ProfileRow> queryProfiles(const QList<SearchCriteria> &aCriteria,
+                                    const Projection &aProjection);
+
+    /*! \brief Streams selected parts of matching sync profiles to a handler.
+     *
+     * Same as queryProfiles() above, but the rows are passed to the handler
+     * one by one as they are produced.
+     * \param aCriteria Search criteria.
+     * \param aProjection Parts of the profiles to return.
+     * \param aHandler Handler of the rows. It is not called while any lock
+     *  of the profile cache is held.
+     */
+    void queryProfiles(const QList<SearchCriteria> &aCriteria,
+                       const Projection &aProjection, RowHandler &aHandler);
+
     /*! \brief Gets profiles based on supported storages.
      *
      * Returns all enabled and visible sync profiles of online destinations
@@ -234,9 +336,10 @@ public:
 
     /*! \brief Saves the results of a sync session to the log.
      *
-     * This is a convenience function that loads the log associated with the
-     * given profile, appends the given results to the log and then saves the
-     * log.
+     * The results are appended to a journal kept next to the log file of the
+     * profile. Neither the profile nor its log needs to be loaded for this.
+     * The journal is merged into the log file when it grows large, and
+     * whenever the complete log is saved with saveLog().
      * \param aProfileName Name of the profile used in the sync session.
      * \param aResults Results.
      * \return True if saving was successful.
@@ -280,11 +383,38 @@ public:
      * 
      * NOTE: only Sync Profiles can be updated using ProfileManger
      *
+     * Nothing is written and no signal is emitted if the profile exists and
+     * has not been modified since it was loaded. Changes to an existing
+     * profile are written behind: repeated updates within a short time are
+     * written to disk once, together with other pending updates. All
+     * ProfileManager instances of this process see the update right away.
+     * Call flush() to write pending updates before other processes need
+     * them.
+     *
      * \param aProfile  - Profile Object
      * \return profileId - this will be empty if the update Failed.
      */
     QString updateProfile(const Profile &aProfile);
 
+    /*! \brief Writes all pending profile updates to disk.
+     *
+     * Used before shutdown, backups and whenever another process must see
+     * the latest profile data.
+     * \return True if all pending updates were written.
+     */
+    bool flush();
+
+    /*! \brief Moves the profiles of the primary path into a database.
+     *
+     * The profile database is created from the profile files of the primary
+     * path, unless it exists already, and this manager switches to it.
+     * ProfileManager instances created later, also in other processes, use
+     * the database as soon as it exists. The profile files are kept, but are
+     * not read or written any more.
+     * \return True if the profiles are now stored in the database.
+     */
+    bool useDatabase();
+
     /*! \brief Deletes a profile from the persistent storage.
      *
      * This will emit a signalProfileChanged with ChangeType
@@ -376,6 +506,23 @@ signals:
     */
     void signalProfileChanged(QString aProfileName, int aChangeType , QString aProfileAsXml);
 
+    /*! \brief Notifies about a change in profile with only the changed data.
+    *
+    * Sent together with signalProfileChanged(), but carries a small delta
+    * instead of the whole profile. The entries of the delta are:
+    * - DELTA_KEYS: map of the keys of the profile itself that were added or
+    *   changed, with their new values. All keys for an added profile.
+    * - DELTA_REMOVED_KEYS: list of the names of removed keys.
+    * - DELTA_RESULTS: summary of new sync results, a map with DELTA_SYNC_TIME
+    *   (msecs since epoch), DELTA_MAJOR_CODE, DELTA_MINOR_CODE and
+    *   DELTA_SCHEDULED.
+    * Entries that did not change are left out.
+    * \param aProfileName Name of the changed profile.
+    * \param aChangeType \see ProfileManager::ProfileChangeType
+    * \param aDelta Changed data of the profile.
+    */
+    void signalProfileDelta(QString aProfileName, int aChangeType, QVariantMap aDelta);
+
 private:
     
     ProfileManager& operator=(const ProfileManager &aRhs);
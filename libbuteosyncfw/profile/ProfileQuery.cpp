@@ -0,0 +1,226 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileQuery.h"
+
+#include <algorithm>
+
+#include "Profile.h"
+#include "ProfileKeys.h"
+
+using namespace Buteo;
+
+// Keys whose value identifies a single account or device, so equality with
+// them rejects nearly every profile.
+static bool isIdentifyingKey(quint32 aId)
+{
+    switch (aId)
+    {
+    case ProfileKeys::ACCOUNT_ID:
+    case ProfileKeys::BT_ADDRESS:
+    case ProfileKeys::REMOTE_ID:
+    case ProfileKeys::PROFILE_ID:
+    case ProfileKeys::UUID:
+    case ProfileKeys::LOCAL_URI:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+ProfileQuery::ProfileQuery(const QList<ProfileManager::SearchCriteria> &aCriteria)
+{
+    iSteps.reserve(aCriteria.size());
+    foreach (const ProfileManager::SearchCriteria &criteria, aCriteria)
+    {
+        Step step;
+        step.iCriteria = criteria;
+        if (!criteria.iSubProfileName.isEmpty())
+        {
+            step.iScope = NAMED_SUB_PROFILE;
+        }
+        else if (!criteria.iSubProfileType.isEmpty())
+        {
+            step.iScope = TYPED_SUB_PROFILES;
+        }
+        else
+        {
+            step.iScope = MAIN_PROFILE;
+        }
+
+        // Interning a key that no profile has yet keeps the id valid for
+        // profiles loaded after the query was compiled.
+        step.iHasKey = !criteria.iKey.isEmpty();
+        step.iKeyId = step.iHasKey ? ProfileKeys::intern(criteria.iKey) : 0;
+        step.iCost = cost(step);
+        iSteps.append(step);
+    }
+
+    // All criteria must match, so their order does not change the result.
+    std::stable_sort(iSteps.begin(), iSteps.end(), costLess);
+}
+
+bool ProfileQuery::isEmpty() const
+{
+    return iSteps.isEmpty();
+}
+
+QList<ProfileManager::SearchCriteria> ProfileQuery::plan() const
+{
+    QList<ProfileManager::SearchCriteria> criteria;
+    foreach (const Step &step, iSteps)
+    {
+        criteria.append(step.iCriteria);
+    }
+
+    return criteria;
+}
+
+bool ProfileQuery::matches(const Profile &aProfile) const
+{
+    // Sub-profiles are listed once, on the first step that needs them.
+    QList<const Profile*> subProfiles;
+    bool subProfilesRead = false;
+
+    foreach (const Step &step, iSteps)
+    {
+        if (!matchStep(step, aProfile, subProfiles, subProfilesRead))
+        {
+            return false;
+        } // no else
+    }
+
+    return true;
+}
+
+int ProfileQuery::cost(const Step &aStep)
+{
+    int typeCost = 0;
+    switch (aStep.iCriteria.iType)
+    {
+    case ProfileManager::SearchCriteria::EQUAL:
+        typeCost = (aStep.iHasKey && isIdentifyingKey(aStep.iKeyId)) ? 0 : 1;
+        break;
+
+    case ProfileManager::SearchCriteria::EXISTS:
+        typeCost = 2;
+        break;
+
+    case ProfileManager::SearchCriteria::NOT_EXISTS:
+        typeCost = 3;
+        break;
+
+    case ProfileManager::SearchCriteria::NOT_EQUAL:
+    default:
+        typeCost = 4;
+        break;
+    }
+
+    // The scope breaks ties: searching sub-profiles costs more than reading
+    // a key of the main profile.
+    return typeCost * 3 + aStep.iScope;
+}
+
+bool ProfileQuery::costLess(const Step &aLeft, const Step &aRight)
+{
+    return aLeft.iCost < aRight.iCost;
+}
+
+bool ProfileQuery::matchKey(const Step &aStep, const Profile &aProfile)
+{
+    const ProfileManager::SearchCriteria::Type type = aStep.iCriteria.iType;
+    if (!aStep.iHasKey)
+    {
+        return type != ProfileManager::SearchCriteria::NOT_EXISTS;
+    } // no else
+
+    const QString *value = aProfile.keyValue(aStep.iKeyId);
+    if (value == 0)
+    {
+        return type == ProfileManager::SearchCriteria::NOT_EXISTS ||
+               type == ProfileManager::SearchCriteria::NOT_EQUAL;
+    } // no else
+
+    switch (type)
+    {
+    case ProfileManager::SearchCriteria::EXISTS:
+        return true;
+
+    case ProfileManager::SearchCriteria::EQUAL:
+        return *value == aStep.iCriteria.iValue;
+
+    case ProfileManager::SearchCriteria::NOT_EQUAL:
+        return *value != aStep.iCriteria.iValue;
+
+    case ProfileManager::SearchCriteria::NOT_EXISTS:
+    default:
+        return false;
+    }
+}
+
+bool ProfileQuery::matchStep(const Step &aStep, const Profile &aProfile,
+                             QList<const Profile*> &aSubProfiles,
+                             bool &aSubProfilesRead) const
+{
+    const bool notExists =
+        (aStep.iCriteria.iType == ProfileManager::SearchCriteria::NOT_EXISTS);
+
+    switch (aStep.iScope)
+    {
+    case NAMED_SUB_PROFILE:
+    {
+        const Profile *subProfile = aProfile.subProfile(
+                aStep.iCriteria.iSubProfileName, aStep.iCriteria.iSubProfileType);
+        return (subProfile != 0) ? matchKey(aStep, *subProfile) : notExists;
+    }
+
+    case TYPED_SUB_PROFILES:
+    {
+        if (!aSubProfilesRead)
+        {
+            aSubProfiles = aProfile.allSubProfiles();
+            aSubProfilesRead = true;
+        } // no else
+
+        // Matches if any sub-profile of the type matches.
+        bool found = false;
+        foreach (const Profile *subProfile, aSubProfiles)
+        {
+            if (subProfile->type() == aStep.iCriteria.iSubProfileType)
+            {
+                if (matchKey(aStep, *subProfile))
+                {
+                    return true;
+                } // no else
+                found = true;
+            } // no else
+        }
+        return found ? false : notExists;
+    }
+
+    case MAIN_PROFILE:
+    default:
+        return matchKey(aStep, aProfile);
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILEQUERY_H
+#define PROFILEQUERY_H
+
+#include <QList>
+#include <QVector>
+
+#include "ProfileManager.h"
+
+namespace Buteo {
+
+class Profile;
+
+/*! \brief Search criteria compiled for matching many profiles.
+ *
+ * The criteria are compiled once into steps ordered by how likely they are
+ * to reject a profile: equality of identifying keys such as the account id
+ * or Bluetooth address first, then other equality checks, existence checks
+ * and finally inequality checks, which nearly every profile passes. Checks
+ * of the main profile go before checks that search the sub-profiles. Key
+ * names are resolved to interned ids, so matching does not look up names or
+ * build sub-profile name lists, and it stops at the first failing step.
+ *
+ * Matching has the semantics of ProfileManager::getSyncProfilesByData().
+ */
+class ProfileQuery
+{
+public:
+    /*! \brief Compiles search criteria.
+     *
+     * \param aCriteria Criteria that all must match.
+     */
+    explicit ProfileQuery(const QList<ProfileManager::SearchCriteria> &aCriteria);
+
+    /*! \brief Checks if the query has no criteria, so it matches every
+     *  profile.
+     */
+    bool isEmpty() const;
+
+    /*! \brief Gets the criteria in the order they are evaluated.
+     *
+     * \return The compiled criteria.
+     */
+    QList<ProfileManager::SearchCriteria> plan() const;
+
+    /*! \brief Checks if a profile matches all criteria.
+     *
+     * \param aProfile Expanded profile to check.
+     * \return True if the profile matches.
+     */
+    bool matches(const Profile &aProfile) const;
+
+private:
+
+    // What part of the profile a step checks.
+    enum Scope
+    {
+        MAIN_PROFILE,
+        NAMED_SUB_PROFILE,
+        TYPED_SUB_PROFILES
+    };
+
+    struct Step
+    {
+        ProfileManager::SearchCriteria iCriteria;
+        Scope iScope;
+        bool iHasKey;
+        quint32 iKeyId;
+        int iCost;
+    };
+
+    static int cost(const Step &aStep);
+
+    static bool costLess(const Step &aLeft, const Step &aRight);
+
+    static bool matchKey(const Step &aStep, const Profile &aProfile);
+
+    bool matchStep(const Step &aStep, const Profile &aProfile,
+                   QList<const Profile*> &aSubProfiles,
+                   bool &aSubProfilesRead) const;
+
+    QVector<Step> iSteps;
+};
+
+}
+
+#endif // PROFILEQUERY_H
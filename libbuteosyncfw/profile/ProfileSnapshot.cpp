@@ -0,0 +1,507 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileSnapshot.h"
+
+#include <QBuffer>
+#include <QDateTime>
+#include <QDir>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QFileInfo>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "Profile.h"
+#include "Profile_p.h"
+#include "ProfileFactory.h"
+#include "SyncProfile.h"
+#include "SyncProfile_p.h"
+#include "SyncLog.h"
+#include "SyncResults.h"
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+const quint32 ProfileSnapshot::FORMAT_VERSION = 2;
+
+static const quint32 SNAPSHOT_MAGIC = 0x42535053; // "BSPS"
+static const QString SNAPSHOT_FILE_NAME = "profiles.snapshot";
+static const QString SNAPSHOT_TEMP_EXT = ".tmp";
+static const QString LOG_DIRECTORY_NAME = "logs";
+static const QDataStream::Version STREAM_VERSION = QDataStream::Qt_5_0;
+
+ProfileSnapshot::ProfileSnapshot(const QString &aPrimaryPath,
+                                 const QString &aSecondaryPath)
+:   iPrimaryPath(aPrimaryPath),
+    iSecondaryPath(aSecondaryPath),
+    iData(0),
+    iSize(0)
+{
+}
+
+ProfileSnapshot::~ProfileSnapshot()
+{
+    close();
+}
+
+QString ProfileSnapshot::filePath() const
+{
+    return iPrimaryPath + QDir::separator() + SNAPSHOT_FILE_NAME;
+}
+
+bool ProfileSnapshot::open()
+{
+    FUNCTION_CALL_TRACE;
+
+    close();
+
+    iFile.setFileName(filePath());
+    if (!iFile.exists() || !iFile.open(QIODevice::ReadOnly))
+    {
+        LOG_DEBUG("No profile snapshot:" << iFile.fileName());
+        return false;
+    } // no else
+
+    iSize = iFile.size();
+    iData = iFile.map(0, iSize);
+    if (iData == 0)
+    {
+        LOG_WARNING("Failed to map profile snapshot:" << iFile.fileName());
+        close();
+        return false;
+    } // no else
+
+    QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char*>(iData),
+                                             iSize);
+    QBuffer buffer(&raw);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    stream.setVersion(STREAM_VERSION);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray listing;
+    stream >> magic >> version;
+    if (magic != SNAPSHOT_MAGIC || version != FORMAT_VERSION)
+    {
+        LOG_DEBUG("Profile snapshot has unknown format, ignoring it");
+        close();
+        return false;
+    } // no else
+
+    stream >> listing;
+    if (stream.status() != QDataStream::Ok || listing != sourceListing())
+    {
+        LOG_DEBUG("Profile snapshot is out of date");
+        close();
+        return false;
+    } // no else
+
+    quint32 count = 0;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+    {
+        QString name;
+        quint32 length = 0;
+        stream >> name >> length;
+        const qint64 offset = buffer.pos();
+        if (stream.skipRawData(length) != static_cast<int>(length))
+        {
+            stream.setStatus(QDataStream::ReadPastEnd);
+            break;
+        } // no else
+        iRecords.insert(name, qMakePair(offset, static_cast<qint64>(length)));
+        iNames.append(name);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        LOG_WARNING("Profile snapshot is corrupted:" << iFile.fileName());
+        close();
+        return false;
+    } // no else
+
+    LOG_DEBUG("Using profile snapshot with" << iNames.size() << "profiles");
+    return true;
+}
+
+void ProfileSnapshot::close()
+{
+    if (iData != 0)
+    {
+        iFile.unmap(const_cast<uchar*>(iData));
+        iData = 0;
+    } // no else
+    iFile.close();
+    iSize = 0;
+    iRecords.clear();
+    iNames.clear();
+}
+
+bool ProfileSnapshot::isOpen() const
+{
+    return (iData != 0);
+}
+
+QStringList ProfileSnapshot::profileNames() const
+{
+    return iNames;
+}
+
+SyncProfile *ProfileSnapshot::syncProfile(const QString &aName) const
+{
+    if (!isOpen() || !iRecords.contains(aName))
+        return 0;
+
+    const QPair<qint64, qint64> record = iRecords.value(aName);
+    QByteArray raw = QByteArray::fromRawData(
+            reinterpret_cast<const char*>(iData) + record.first, record.second);
+    QDataStream stream(raw);
+    stream.setVersion(STREAM_VERSION);
+
+    SyncProfile *profile = readSyncProfile(stream);
+    if (stream.status() != QDataStream::Ok)
+    {
+        LOG_WARNING("Failed to decode profile from snapshot:" << aName);
+        delete profile;
+        profile = 0;
+    } // no else
+
+    return profile;
+}
+
+QByteArray ProfileSnapshot::sourceListing() const
+{
+    static const QStringList TYPES = QStringList() << Profile::TYPE_SYNC
+        << Profile::TYPE_CLIENT << Profile::TYPE_STORAGE << Profile::TYPE_SERVER;
+
+    QStringList dirs;
+    foreach (const QString &type, TYPES)
+    {
+        dirs << iPrimaryPath + QDir::separator() + type
+             << iSecondaryPath + QDir::separator() + type;
+    }
+    dirs << iPrimaryPath + QDir::separator() + Profile::TYPE_SYNC +
+            QDir::separator() + LOG_DIRECTORY_NAME;
+
+    // Leftover backup files change the outcome of loading, list them too.
+    // Sync results journals are replayed on top of the log files.
+    const QStringList nameFilters = QStringList() << "*.xml" << "*.bak"
+                                                  << "*.journal";
+
+    QByteArray listing;
+    QDataStream stream(&listing, QIODevice::WriteOnly);
+    stream.setVersion(STREAM_VERSION);
+    foreach (const QString &dirPath, dirs)
+    {
+        QDir dir(dirPath);
+        QFileInfoList entries = dir.entryInfoList(nameFilters,
+                QDir::Files | QDir::NoSymLinks, QDir::Name);
+        stream << dirPath << static_cast<quint32>(entries.size());
+        foreach (const QFileInfo &entry, entries)
+        {
+            stream << entry.fileName() << entry.size()
+                   << entry.lastModified().toMSecsSinceEpoch();
+        }
+    }
+
+    return listing;
+}
+
+bool ProfileSnapshot::write(const QByteArray &aSourceListing,
+                            const QList<const SyncProfile*> &aProfiles) const
+{
+    FUNCTION_CALL_TRACE;
+
+    QDir().mkpath(iPrimaryPath);
+    const QString tempPath = filePath() + SNAPSHOT_TEMP_EXT;
+    QFile file(tempPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LOG_WARNING("Failed to open profile snapshot for writing:" << tempPath);
+        return false;
+    } // no else
+
+    QDataStream stream(&file);
+    stream.setVersion(STREAM_VERSION);
+    stream << SNAPSHOT_MAGIC << FORMAT_VERSION << aSourceListing
+           << static_cast<quint32>(aProfiles.size());
+
+    QByteArray record;
+    foreach (const SyncProfile *profile, aProfiles)
+    {
+        record.clear();
+        QDataStream recordStream(&record, QIODevice::WriteOnly);
+        recordStream.setVersion(STREAM_VERSION);
+        writeSyncProfile(recordStream, *profile);
+
+        // Same layout as QByteArray serialization, but read back without
+        // copying the record.
+        stream << profile->name() << static_cast<quint32>(record.size());
+        stream.writeRawData(record.constData(), record.size());
+    }
+
+    bool written = (stream.status() == QDataStream::Ok) && file.flush() &&
+                   (::fsync(file.handle()) == 0);
+    file.close();
+
+    if (written)
+    {
+        written = (::rename(QFile::encodeName(tempPath).constData(),
+                            QFile::encodeName(filePath()).constData()) == 0);
+    } // no else
+
+    if (!written)
+    {
+        LOG_WARNING("Failed to write profile snapshot:" << filePath());
+        QFile::remove(tempPath);
+    }
+    else
+    {
+        LOG_DEBUG("Wrote profile snapshot with" << aProfiles.size() << "profiles");
+    }
+
+    return written;
+}
+
+void ProfileSnapshot::writeProfile(QDataStream &aStream, const Profile &aProfile)
+{
+    const ProfilePrivate *d = aProfile.d_ptr;
+
+    aStream << d->iName << d->iType << d->iLoaded << d->iMerged
+            << d->iLocalKeys << d->iMergedKeys;
+
+    // Fields are rare and small, they are stored in their XML form.
+    QList<const ProfileField*> fieldLists[2] = { d->iLocalFields, d->iMergedFields };
+    for (int i = 0; i < 2; i++)
+    {
+        aStream << static_cast<quint32>(fieldLists[i].size());
+        foreach (const ProfileField *field, fieldLists[i])
+        {
+            QString xml;
+            QXmlStreamWriter writer(&xml);
+            field->toXml(writer);
+            aStream << xml;
+        }
+    }
+
+    aStream << static_cast<quint32>(d->iSubProfiles.size());
+    foreach (const Profile *sub, d->iSubProfiles)
+    {
+        writeProfile(aStream, *sub);
+    }
+}
+
+Profile *ProfileSnapshot::readProfile(QDataStream &aStream)
+{
+    QString name;
+    QString type;
+    aStream >> name >> type;
+
+    ProfileFactory pf;
+    Profile *profile = pf.createProfile(name, type);
+    if (profile == 0)
+    {
+        aStream.setStatus(QDataStream::ReadCorruptData);
+        return 0;
+    } // no else
+
+    // Snapshot profiles match the profile files they were built from.
+    ProfilePrivate *d = profile->d_ptr;
+    d->iModified = false;
+    aStream >> d->iLoaded >> d->iMerged >> d->iLocalKeys >> d->iMergedKeys;
+
+    QList<const ProfileField*> *fieldLists[2] = { &d->iLocalFields, &d->iMergedFields };
+    for (int i = 0; i < 2; i++)
+    {
+        quint32 count = 0;
+        aStream >> count;
+        for (quint32 j = 0; j < count && aStream.status() == QDataStream::Ok; j++)
+        {
+            QString xml;
+            aStream >> xml;
+            QXmlStreamReader reader(xml);
+            if (reader.readNextStartElement())
+            {
+                fieldLists[i]->append(new ProfileField(reader));
+            } // no else
+            if (reader.hasError())
+            {
+                aStream.setStatus(QDataStream::ReadCorruptData);
+            } // no else
+        }
+    }
+
+    quint32 subCount = 0;
+    aStream >> subCount;
+    for (quint32 i = 0; i < subCount && aStream.status() == QDataStream::Ok; i++)
+    {
+        Profile *sub = readProfile(aStream);
+        if (sub != 0)
+        {
+            d->iSubProfiles.append(sub);
+        } // no else
+    }
+
+    return profile;
+}
+
+void ProfileSnapshot::writeSyncProfile(QDataStream &aStream,
+                                       const SyncProfile &aProfile)
+{
+    writeProfile(aStream, aProfile);
+
+    SyncSchedule schedule = aProfile.syncSchedule();
+    aStream << schedule.days() << schedule.time()
+            << schedule.scheduleConfiguredTime() << schedule.interval()
+            << schedule.scheduleEnabled() << schedule.rushEnabled()
+            << schedule.syncExternallyDuringRush() << schedule.rushDays()
+            << schedule.rushBegin() << schedule.rushEnd()
+            << schedule.rushInterval();
+
+    const SyncProfilePrivate *d = aProfile.d_ptr;
+    aStream << d->iSyncRetriesInfo.iRetryIntervals
+            << d->iSyncRetriesInfo.iIntervalIndex;
+
+    writeLog(aStream, d->iLog);
+}
+
+SyncProfile *ProfileSnapshot::readSyncProfile(QDataStream &aStream)
+{
+    Profile *profile = readProfile(aStream);
+    if (profile == 0 || profile->type() != Profile::TYPE_SYNC)
+    {
+        delete profile;
+        aStream.setStatus(QDataStream::ReadCorruptData);
+        return 0;
+    } // no else
+
+    // Type is verified, ProfileFactory creates a SyncProfile for it.
+    SyncProfile *syncProfile = static_cast<SyncProfile*>(profile);
+
+    DaySet days;
+    QTime time;
+    QDateTime configuredTime;
+    unsigned interval = 0;
+    bool enabled = false;
+    bool rushEnabled = false;
+    bool externalRush = false;
+    DaySet rushDays;
+    QTime rushBegin;
+    QTime rushEnd;
+    unsigned rushInterval = 0;
+    aStream >> days >> time >> configuredTime >> interval >> enabled
+            >> rushEnabled >> externalRush >> rushDays >> rushBegin
+            >> rushEnd >> rushInterval;
+
+    SyncSchedule schedule;
+    schedule.setDays(days);
+    schedule.setTime(time);
+    schedule.setScheduleConfiguredTime(configuredTime);
+    schedule.setInterval(interval);
+    schedule.setScheduleEnabled(enabled);
+    schedule.setRushEnabled(rushEnabled);
+    schedule.setSyncExternallyDuringRush(externalRush);
+    schedule.setRushDays(rushDays);
+    schedule.setRushTime(rushBegin, rushEnd);
+    schedule.setRushInterval(rushInterval);
+    syncProfile->setSyncSchedule(schedule);
+    syncProfile->setModified(false);
+
+    SyncProfilePrivate *d = syncProfile->d_ptr;
+    aStream >> d->iSyncRetriesInfo.iRetryIntervals
+            >> d->iSyncRetriesInfo.iIntervalIndex;
+
+    syncProfile->setLog(readLog(aStream));
+
+    return syncProfile;
+}
+
+void ProfileSnapshot::writeLog(QDataStream &aStream, const SyncLog *aLog)
+{
+    aStream << (aLog != 0);
+    if (aLog == 0)
+        return;
+
+    QList<const SyncResults*> results = aLog->allResults();
+    aStream << aLog->profileName() << static_cast<quint32>(results.size());
+    foreach (const SyncResults *result, results)
+    {
+        QList<TargetResults> targets = result->targetResults();
+        aStream << result->syncTime() << result->majorCode()
+                << result->minorCode() << result->getTargetId()
+                << result->isScheduled() << static_cast<quint32>(targets.size());
+        foreach (const TargetResults &target, targets)
+        {
+            ItemCounts local = target.localItems();
+            ItemCounts remote = target.remoteItems();
+            aStream << target.targetName()
+                    << local.added << local.deleted << local.modified
+                    << remote.added << remote.deleted << remote.modified;
+        }
+    }
+}
+
+SyncLog *ProfileSnapshot::readLog(QDataStream &aStream)
+{
+    bool hasLog = false;
+    aStream >> hasLog;
+    if (!hasLog)
+        return 0;
+
+    QString profileName;
+    quint32 count = 0;
+    aStream >> profileName >> count;
+
+    SyncLog *log = new SyncLog(profileName);
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; i++)
+    {
+        QDateTime time;
+        int majorCode = 0;
+        int minorCode = 0;
+        QString targetId;
+        bool scheduled = false;
+        quint32 targetCount = 0;
+        aStream >> time >> majorCode >> minorCode >> targetId >> scheduled
+                >> targetCount;
+
+        SyncResults results(time, majorCode, minorCode);
+        results.setTargetId(targetId);
+        results.setScheduled(scheduled);
+        for (quint32 j = 0; j < targetCount && aStream.status() == QDataStream::Ok; j++)
+        {
+            QString targetName;
+            ItemCounts local;
+            ItemCounts remote;
+            aStream >> targetName
+                    >> local.added >> local.deleted >> local.modified
+                    >> remote.added >> remote.deleted >> remote.modified;
+            results.addTargetResults(TargetResults(targetName, local, remote));
+        }
+        log->addResults(results);
+    }
+
+    return log;
+}
@@ -0,0 +1,157 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILESNAPSHOT_H
+#define PROFILESNAPSHOT_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QStringList>
+
+namespace Buteo {
+
+class Profile;
+class SyncProfile;
+class SyncLog;
+
+/*! \brief Compiled binary snapshot of all expanded sync profiles.
+ *
+ * The snapshot is a single file in the primary profile directory. It holds
+ * every sync profile in its expanded form together with its sync log, encoded
+ * with QDataStream, and a listing of the profile source files (name, size and
+ * modification time) it was built from. The file is memory mapped when
+ * opened, and a profile is decoded straight from the mapped data.
+ *
+ * A snapshot is only used if its format version matches and the recorded
+ * source listing equals the current contents of the profile directories.
+ */
+class ProfileSnapshot
+{
+public:
+
+    //! Version of the snapshot file format. Increase on any format change.
+    static const quint32 FORMAT_VERSION;
+
+    /*! \brief Constructor.
+     *
+     * \param aPrimaryPath Primary profile path, without trailing separator.
+     * \param aSecondaryPath Secondary profile path, without trailing separator.
+     */
+    ProfileSnapshot(const QString &aPrimaryPath, const QString &aSecondaryPath);
+
+    //! \brief Destructor.
+    ~ProfileSnapshot();
+
+    /*! \brief Maps the snapshot file and validates it.
+     *
+     * \return True if the snapshot is up to date and can be used.
+     */
+    bool open();
+
+    /*! \brief Unmaps the snapshot file.
+     */
+    void close();
+
+    /*! \brief Checks if the snapshot is open and valid.
+     *
+     * \return True if profiles can be read from the snapshot.
+     */
+    bool isOpen() const;
+
+    /*! \brief Gets the names of the profiles in the snapshot.
+     *
+     * \return Profile names, in the order they were written.
+     */
+    QStringList profileNames() const;
+
+    /*! \brief Decodes a sync profile from the snapshot.
+     *
+     * \param aName Name of the profile.
+     * \return The expanded profile with its log, owned by the caller. NULL if
+     *  the profile is not in the snapshot or the snapshot is not open.
+     */
+    SyncProfile *syncProfile(const QString &aName) const;
+
+    /*! \brief Lists the profile source files.
+     *
+     * The listing must be taken before the profiles passed to write() are
+     * loaded, so that any change made during loading invalidates the written
+     * snapshot.
+     * \return Opaque listing of the source files.
+     */
+    QByteArray sourceListing() const;
+
+    /*! \brief Writes a new snapshot file.
+     *
+     * The file is written to a temporary name and renamed over the old
+     * snapshot. Any open mapping of the old file stays valid.
+     * \param aSourceListing Listing from sourceListing().
+     * \param aProfiles Expanded sync profiles with logs.
+     * \return Success indicator.
+     */
+    bool write(const QByteArray &aSourceListing,
+               const QList<const SyncProfile*> &aProfiles) const;
+
+    /*! \brief Gets the path of the snapshot file.
+     *
+     * \return Snapshot file path.
+     */
+    QString filePath() const;
+
+private:
+
+    static void writeProfile(QDataStream &aStream, const Profile &aProfile);
+
+    static Profile *readProfile(QDataStream &aStream);
+
+    static void writeSyncProfile(QDataStream &aStream, const SyncProfile &aProfile);
+
+    static SyncProfile *readSyncProfile(QDataStream &aStream);
+
+    static void writeLog(QDataStream &aStream, const SyncLog *aLog);
+
+    static SyncLog *readLog(QDataStream &aStream);
+
+    QString iPrimaryPath;
+
+    QString iSecondaryPath;
+
+    QFile iFile;
+
+    const uchar *iData;
+
+    qint64 iSize;
+
+    // Profile name -> offset and length of its record in the mapped file.
+    QHash<QString, QPair<qint64, qint64> > iRecords;
+
+    QStringList iNames;
+};
+
+}
+
+#endif // PROFILESNAPSHOT_H
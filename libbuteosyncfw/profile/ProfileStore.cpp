@@ -0,0 +1,118 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileStore.h"
+
+#include <QScopedPointer>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "Profile.h"
+#include "ProfileFactory.h"
+#include "ProfileXmlWriter.h"
+#include "SyncLog.h"
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+int ProfileStore::copyProfiles(ProfileStore &aSource, ProfileStore &aTarget)
+{
+    FUNCTION_CALL_TRACE;
+
+    int copied = 0;
+    const QStringList types = QStringList() << Profile::TYPE_STORAGE
+        << Profile::TYPE_CLIENT << Profile::TYPE_SYNC;
+    foreach (const QString &type, types)
+    {
+        foreach (const QString &name, aSource.profileNames(type))
+        {
+            // Read-only system profiles stay where they are.
+            if (!aSource.isWritable(name, type))
+                continue;
+
+            QScopedPointer<Profile> profile(aSource.load(name, type));
+            if (profile.isNull())
+            {
+                LOG_WARNING("Skipping unreadable profile:" << name);
+                continue;
+            } // no else
+
+            if (!aTarget.save(*profile, false))
+                return -1;
+
+            if (type == Profile::TYPE_SYNC)
+            {
+                QScopedPointer<SyncLog> log(aSource.loadLog(name));
+                if (!log.isNull() && !aTarget.saveLog(*log))
+                    return -1;
+            } // no else
+
+            ++copied;
+        }
+    }
+
+    if (!aTarget.flush())
+        return -1;
+
+    LOG_DEBUG("Copied" << copied << "profiles");
+    return copied;
+}
+
+QByteArray ProfileStore::profileData(const Profile &aProfile)
+{
+    // The profile is serialized straight into memory, no document tree is
+    // built for it.
+    QByteArray data;
+    QXmlStreamWriter writer(&data);
+    beginXmlDocument(writer);
+    aProfile.toXml(writer);
+    endXmlDocument(writer);
+
+    return data;
+}
+
+Profile *ProfileStore::parseProfile(QXmlStreamReader &aReader,
+                                    const QString &aSource)
+{
+    Profile *profile = 0;
+    if (aReader.readNextStartElement())
+    {
+        ProfileFactory pf;
+        profile = pf.createProfile(aReader);
+    } // no else
+
+    if (!readToEnd(aReader) || profile == 0)
+    {
+        LOG_WARNING("Failed to parse profile XML: " << aSource
+                << aReader.errorString());
+        delete profile;
+        profile = 0;
+    }
+    else
+    {
+        // The profile matches its source.
+        profile->setModified(false);
+    }
+
+    return profile;
+}
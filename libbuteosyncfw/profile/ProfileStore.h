@@ -0,0 +1,201 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILESTORE_H
+#define PROFILESTORE_H
+
+#include <QList>
+#include <QSet>
+#include <QStringList>
+
+#include "ProfileManager.h"
+
+class QXmlStreamReader;
+
+namespace Buteo {
+
+class Profile;
+class SyncLog;
+class SyncResults;
+
+/*! \brief Persistent storage of profiles and sync logs.
+ *
+ * ProfileManager keeps parsed profiles in the profile cache and reads and
+ * writes them through a store. Profiles are passed in and out as parsed
+ * objects, so a store is free to choose its own layout.
+ *
+ * Stores may be used from several threads at the same time.
+ */
+class ProfileStore
+{
+public:
+
+    //! \brief Destructor.
+    virtual ~ProfileStore() {}
+
+    /*! \brief Gets the names of the stored profiles of a type.
+     *
+     * \param aType Profile type.
+     * \return Profile names.
+     */
+    virtual QStringList profileNames(const QString &aType) = 0;
+
+    /*! \brief Checks if a profile exists.
+     *
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     * \return True if the profile can be loaded.
+     */
+    virtual bool contains(const QString &aName, const QString &aType) = 0;
+
+    /*! \brief Checks if a profile has been written to the store.
+     *
+     * Read-only system profiles are found by contains() but can not be
+     * updated or removed in place.
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     * \return True if the profile has a writable copy.
+     */
+    virtual bool isWritable(const QString &aName, const QString &aType) = 0;
+
+    /*! \brief Reads a profile.
+     *
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     * \return The profile, marked unmodified and owned by the caller. 0 if
+     *  the profile was not found or could not be read.
+     */
+    virtual Profile *load(const QString &aName, const QString &aType) = 0;
+
+    /*! \brief Writes the local data of a profile.
+     *
+     * \param aProfile Profile to write.
+     * \param aDeferred If true, the store may delay writing an update of an
+     *  existing profile until flush().
+     * \return Success indicator.
+     */
+    virtual bool save(const Profile &aProfile, bool aDeferred) = 0;
+
+    /*! \brief Removes a profile, and the sync log of a sync profile.
+     *
+     * \param aName Name of the profile.
+     * \param aType Type of the profile.
+     * \return Success indicator.
+     */
+    virtual bool remove(const QString &aName, const QString &aType) = 0;
+
+    /*! \brief Renames a sync profile together with its sync log.
+     *
+     * \param aName Current name of the sync profile.
+     * \param aNewName New name of the sync profile.
+     * \return Success indicator.
+     */
+    virtual bool rename(const QString &aName, const QString &aNewName) = 0;
+
+    /*! \brief Reads the sync log of a profile.
+     *
+     * \param aProfileName Name of the sync profile.
+     * \return The log, owned by the caller. 0 if the profile has no log.
+     */
+    virtual SyncLog *loadLog(const QString &aProfileName) = 0;
+
+    /*! \brief Replaces the sync log of a profile.
+     *
+     * \param aLog Log to write.
+     * \return Success indicator.
+     */
+    virtual bool saveLog(const SyncLog &aLog) = 0;
+
+    /*! \brief Adds sync results to the log of a profile.
+     *
+     * \param aProfileName Name of the sync profile.
+     * \param aResults Results to add.
+     * \return Success indicator.
+     */
+    virtual bool appendResults(const QString &aProfileName,
+                               const SyncResults &aResults) = 0;
+
+    /*! \brief Writes all delayed changes.
+     *
+     * \return Success indicator.
+     */
+    virtual bool flush() = 0;
+
+    /*! \brief Checks if another process has changed the store.
+     *
+     * Stores whose changes are tracked by the profile cache itself return
+     * false.
+     * \return True if the store changed since the last call.
+     */
+    virtual bool hasExternalChanges() { return false; }
+
+    /*! \brief Gets the sync profiles that may match criteria.
+     *
+     * Stores that can not search their profiles return false, and every
+     * profile is a candidate.
+     * \param aCriteria Search criteria.
+     * \param aNames Names of the candidate sync profiles. A superset of the
+     *  matching profiles.
+     * \return True if the candidates were resolved.
+     */
+    virtual bool candidates(const QList<ProfileManager::SearchCriteria> &aCriteria,
+                            QSet<QString> &aNames)
+    {
+        Q_UNUSED(aCriteria);
+        Q_UNUSED(aNames);
+        return false;
+    }
+
+    /*! \brief Copies all profiles and sync logs from one store to another.
+     *
+     * Used to move profiles between storage backends. Profiles already in
+     * the target are replaced.
+     * \param aSource Store to copy from.
+     * \param aTarget Store to copy to.
+     * \return Number of profiles copied. -1 if a write failed.
+     */
+    static int copyProfiles(ProfileStore &aSource, ProfileStore &aTarget);
+
+protected:
+
+    /*! \brief Serializes the local data of a profile into a document.
+     *
+     * \param aProfile Profile to serialize.
+     * \return UTF-8 encoded XML document.
+     */
+    static QByteArray profileData(const Profile &aProfile);
+
+    /*! \brief Parses a profile document.
+     *
+     * \param aReader Reader positioned at the start of the document.
+     * \param aSource Origin of the document, for logging.
+     * \return The profile, marked unmodified. 0 if the document is not a
+     *  valid profile.
+     */
+    static Profile *parseProfile(QXmlStreamReader &aReader,
+                                 const QString &aSource);
+};
+
+}
+
+#endif // PROFILESTORE_H
@@ -0,0 +1,257 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileWriteQueue.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+const int ProfileWriteQueue::WRITE_DELAY = 1000;
+
+const QString ProfileWriteQueue::TEMP_EXT = ".tmp";
+
+ProfileWriteQueue::ProfileWriteQueue(QObject *aParent)
+:   QObject(aParent),
+    iTimer(new QTimer(this))
+{
+    FUNCTION_CALL_TRACE;
+
+    iTimer->setSingleShot(true);
+    iTimer->setInterval(WRITE_DELAY);
+    connect(iTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+ProfileWriteQueue::~ProfileWriteQueue()
+{
+    FUNCTION_CALL_TRACE;
+
+    flush();
+}
+
+void ProfileWriteQueue::enqueue(const QString &aPath, const QByteArray &aData)
+{
+    {
+        QMutexLocker locker(&iMutex);
+        iPending.insert(aPath, aData);
+    }
+
+    // The timer is not restarted by further updates, so that a file that
+    // keeps changing is still written within the delay.
+    if (QThread::currentThread() == thread())
+    {
+        startTimer();
+    }
+    else
+    {
+        QMetaObject::invokeMethod(this, "startTimer", Qt::QueuedConnection);
+    }
+}
+
+bool ProfileWriteQueue::write(const QString &aPath, const QByteArray &aData)
+{
+    QMutexLocker writeLocker(&iWriteMutex);
+
+    // Readers get the new contents from the queue until the file has been
+    // replaced.
+    {
+        QMutexLocker locker(&iMutex);
+        iPending.insert(aPath, aData);
+    }
+
+    const bool success = writeFile(aPath, aData);
+    if (success)
+    {
+        emit fileWritten(aPath);
+    } // no else
+    release(aPath, aData);
+
+    return success;
+}
+
+QByteArray ProfileWriteQueue::pending(const QString &aPath)
+{
+    QMutexLocker locker(&iMutex);
+
+    return iPending.value(aPath);
+}
+
+void ProfileWriteQueue::discard(const QString &aPath)
+{
+    QMutexLocker locker(&iMutex);
+
+    iPending.remove(aPath);
+}
+
+bool ProfileWriteQueue::flush()
+{
+    FUNCTION_CALL_TRACE;
+
+    QMutexLocker writeLocker(&iWriteMutex);
+
+    // The entries stay queued until their files have been replaced, so
+    // that readers never see the old files in between.
+    QMap<QString, QByteArray> pendingWrites;
+    {
+        QMutexLocker locker(&iMutex);
+        pendingWrites = iPending;
+    }
+
+    if (pendingWrites.isEmpty())
+    {
+        return true;
+    } // no else
+
+    LOG_DEBUG("Writing" << pendingWrites.size() << "profile files");
+
+    // Get all new contents on disk first, then switch the files over and
+    // sync each directory once.
+    QStringList written;
+    QMap<QString, QByteArray>::const_iterator i;
+    for (i = pendingWrites.constBegin(); i != pendingWrites.constEnd(); ++i)
+    {
+        if (writeTempFile(i.key(), i.value()))
+        {
+            written.append(i.key());
+        } // no else
+    }
+
+    QSet<QString> directories;
+    int committed = 0;
+    foreach (const QString &path, written)
+    {
+        if (commitTempFile(path))
+        {
+            directories.insert(QFileInfo(path).absolutePath());
+            committed++;
+            emit fileWritten(path);
+            release(path, pendingWrites.value(path));
+        } // no else
+    }
+
+    foreach (const QString &directory, directories)
+    {
+        syncDirectory(directory);
+    }
+
+    // Failed writes stay queued and are tried again on the next flush.
+    if (committed != pendingWrites.size())
+    {
+        LOG_WARNING("Failed to write" << pendingWrites.size() - committed
+                    << "profile files, keeping them queued");
+        return false;
+    } // no else
+
+    return true;
+}
+
+void ProfileWriteQueue::release(const QString &aPath, const QByteArray &aData)
+{
+    QMutexLocker locker(&iMutex);
+
+    // Contents queued while the file was written are kept for the next
+    // flush.
+    QMap<QString, QByteArray>::iterator i = iPending.find(aPath);
+    if (i != iPending.end() && i.value() == aData)
+    {
+        iPending.erase(i);
+    } // no else
+}
+
+void ProfileWriteQueue::startTimer()
+{
+    if (!iTimer->isActive())
+    {
+        iTimer->start();
+    } // no else
+}
+
+bool ProfileWriteQueue::writeFile(const QString &aPath, const QByteArray &aData)
+{
+    if (!writeTempFile(aPath, aData) || !commitTempFile(aPath))
+    {
+        return false;
+    } // no else
+
+    syncDirectory(QFileInfo(aPath).absolutePath());
+
+    return true;
+}
+
+bool ProfileWriteQueue::writeTempFile(const QString &aPath, const QByteArray &aData)
+{
+    QFile file(aPath + TEMP_EXT);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LOG_WARNING("Failed to open file for writing:" << file.fileName());
+        return false;
+    } // no else
+
+    bool success = (file.write(aData) == aData.size()) && file.flush() &&
+                   (::fsync(file.handle()) == 0);
+    file.close();
+
+    if (!success)
+    {
+        LOG_WARNING("Failed to write file:" << aPath);
+        QFile::remove(file.fileName());
+    } // no else
+
+    return success;
+}
+
+bool ProfileWriteQueue::commitTempFile(const QString &aPath)
+{
+    const QString tempPath = aPath + TEMP_EXT;
+    bool success = (::rename(QFile::encodeName(tempPath).constData(),
+                             QFile::encodeName(aPath).constData()) == 0);
+    if (!success)
+    {
+        LOG_WARNING("Failed to replace file:" << aPath);
+        QFile::remove(tempPath);
+    } // no else
+
+    return success;
+}
+
+void ProfileWriteQueue::syncDirectory(const QString &aPath)
+{
+    int fd = ::open(QFile::encodeName(aPath).constData(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0)
+    {
+        ::fsync(fd);
+        ::close(fd);
+    } // no else
+}
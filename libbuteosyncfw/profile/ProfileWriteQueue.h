@@ -0,0 +1,169 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILEWRITEQUEUE_H
+#define PROFILEWRITEQUEUE_H
+
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <QByteArray>
+#include <QString>
+
+class QTimer;
+
+namespace Buteo {
+
+/*! \brief Write-behind queue for profile files.
+ *
+ * Updates to existing profile files are kept in memory for a short while
+ * before they are written. Repeated updates of the same file within that
+ * window replace each other, so only the last one is written. All queued
+ * files are then written together: each is flushed to disk in a temporary
+ * file, the temporary files are renamed over the profile files, and every
+ * affected directory is synced once at the end.
+ *
+ * Every write, queued or immediate, replaces the target file atomically.
+ * Queued contents stay visible through pending() until the file on disk has
+ * been replaced, so readers never fall back to an outdated file.
+ * The queue is shared by all ProfileManager instances using the same
+ * profile paths, and pending writes are flushed when it is destroyed.
+ */
+class ProfileWriteQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //! Time in milliseconds a queued write waits for further updates.
+    static const int WRITE_DELAY;
+
+    /*! \brief Constructor.
+     *
+     * \param aParent Parent object.
+     */
+    explicit ProfileWriteQueue(QObject *aParent = 0);
+
+    //! \brief Destructor. Writes all pending files.
+    virtual ~ProfileWriteQueue();
+
+    /*! \brief Queues the contents of a file to be written later.
+     *
+     * Replaces contents queued earlier for the same file.
+     * \param aPath Path of the file.
+     * \param aData New contents of the file.
+     */
+    void enqueue(const QString &aPath, const QByteArray &aData);
+
+    /*! \brief Writes a file right away.
+     *
+     * Contents queued earlier for the same file are dropped. Until the file
+     * has been replaced, pending() returns the new contents.
+     * \param aPath Path of the file.
+     * \param aData New contents of the file.
+     * \return Success indicator.
+     */
+    bool write(const QString &aPath, const QByteArray &aData);
+
+    /*! \brief Gets the contents queued for a file.
+     *
+     * \param aPath Path of the file.
+     * \return Queued contents. Null if nothing is queued for the file.
+     */
+    QByteArray pending(const QString &aPath);
+
+    /*! \brief Drops the contents queued for a file.
+     *
+     * \param aPath Path of the file.
+     */
+    void discard(const QString &aPath);
+
+    /*! \brief Replaces a file atomically.
+     *
+     * The data is written to a temporary file, which is flushed to disk and
+     * renamed over the target. A crash leaves either the old or the new
+     * file, never a partial one.
+     * \param aPath Path of the file.
+     * \param aData New contents of the file.
+     * \return Success indicator.
+     */
+    static bool writeFile(const QString &aPath, const QByteArray &aData);
+
+    //! Suffix of the temporary files used for atomic writes.
+    static const QString TEMP_EXT;
+
+signals:
+
+    /*! \brief Emitted after a file has been replaced.
+     *
+     * Emitted in the thread that wrote the file.
+     * \param aPath Path of the file.
+     */
+    void fileWritten(const QString &aPath);
+
+public slots:
+
+    /*! \brief Writes all pending files.
+     *
+     * Each file stays queued, and its contents are returned by pending(),
+     * until it has been replaced on disk. Files that could not be written
+     * stay queued.
+     * \return True if all files were written.
+     */
+    bool flush();
+
+private slots:
+
+    void startTimer();
+
+private:
+
+    // Writes and syncs the temporary file for a target path.
+    static bool writeTempFile(const QString &aPath, const QByteArray &aData);
+
+    // Moves the temporary file of a target path over the target.
+    static bool commitTempFile(const QString &aPath);
+
+    // Drops a queued file after it has been written, unless newer contents
+    // were queued in the meantime.
+    void release(const QString &aPath, const QByteArray &aData);
+
+    // Makes renames in a directory durable.
+    static void syncDirectory(const QString &aPath);
+
+    // Serializes access to the pending writes.
+    QMutex iMutex;
+
+    // Serializes writes of files, so that an older version of a file is
+    // never written over a newer one.
+    QMutex iWriteMutex;
+
+    // Pending file contents, keyed by path.
+    QMap<QString, QByteArray> iPending;
+
+    QTimer *iTimer;
+};
+
+}
+
+#endif // PROFILEWRITEQUEUE_H
@@ -0,0 +1,76 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILEXMLWRITER_H
+#define PROFILEXMLWRITER_H
+
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "ProfileEngineDefs.h"
+
+namespace Buteo {
+
+/*! \brief Starts an XML document written by the stream serializers.
+ *
+ * The writer is set up to produce the same layout that
+ * QDomDocument::toString(PROFILE_INDENT) gives for the DOM serializers,
+ * starting with the same XML declaration.
+ * \param aWriter Writer to start the document with.
+ */
+inline void beginXmlDocument(QXmlStreamWriter &aWriter)
+{
+    aWriter.setAutoFormatting(true);
+    aWriter.setAutoFormattingIndent(PROFILE_INDENT);
+    // writeStartDocument() leaves out the encoding when writing to a string.
+    aWriter.writeProcessingInstruction("xml",
+            "version=\"1.0\" encoding=\"UTF-8\"");
+}
+
+/*! \brief Ends an XML document started with beginXmlDocument().
+ *
+ * \param aWriter Writer to end the document with.
+ */
+inline void endXmlDocument(QXmlStreamWriter &aWriter)
+{
+    aWriter.writeEndDocument();
+}
+
+/*! \brief Reads the rest of an XML document after its root element.
+ *
+ * \param aReader Reader positioned inside the document.
+ * \return False if the document is not well-formed.
+ */
+inline bool readToEnd(QXmlStreamReader &aReader)
+{
+    while (!aReader.atEnd())
+    {
+        aReader.readNext();
+    }
+
+    return !aReader.hasError();
+}
+
+}
+
+#endif // PROFILEXMLWRITER_H
@@ -27,6 +27,7 @@
 #include <QMap>
 #include <QString>
 #include "ProfileField.h"
+#include "ProfileKeys.h"
 
 namespace Buteo {
 
@@ -55,11 +56,14 @@ public:
     //! Is the profile merged created by merging from sub-profile.
     bool iMerged;
 
+    //! Has the profile changed since it was loaded.
+    bool iModified;
+
     //! Local keys, that are not merged from sub-profiles.
-    QMap<QString, QString> iLocalKeys;
+    ProfileKeyStore iLocalKeys;
 
     //! Keys that are merged from sub-profile files.
-    QMap<QString, QString> iMergedKeys;
+    ProfileKeyStore iMergedKeys;
 
     //! Local fields, that are not merged from sub-profiles.
     QList<const ProfileField*> iLocalFields;
@@ -77,7 +81,8 @@ public:
 
 Buteo::ProfilePrivate::ProfilePrivate()
 :   iLoaded(false),
-    iMerged(false)
+    iMerged(false),
+    iModified(true)
 {
 }
 
@@ -86,6 +91,7 @@ Buteo::ProfilePrivate::ProfilePrivate(const ProfilePrivate &aSource)
     iType(aSource.iType),
     iLoaded(aSource.iLoaded),
     iMerged(aSource.iMerged),
+    iModified(aSource.iModified),
     iLocalKeys(aSource.iLocalKeys),
     iMergedKeys(aSource.iMergedKeys)
 {
@@ -0,0 +1,994 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "SqliteProfileStore.h"
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QScopedPointer>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThreadStorage>
+#include <QVariant>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "Profile.h"
+#include "ProfileCache.h"
+#include "SyncLog.h"
+#include "SyncResults.h"
+#include "XmlProfileStore.h"
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+const QString SqliteProfileStore::DATABASE_FILE("profiles.db");
+
+static const QString FORMAT_EXT = ".xml";
+
+// Results kept for each profile, the same number SyncLog keeps.
+static const int MAX_LOG_RESULTS = 5;
+
+// Numbers the database connections of all stores.
+static QAtomicInt connectionCounter;
+
+namespace {
+
+// Database connection of a store in one thread.
+struct Connection
+{
+    QString iName;
+    // Data version seen by the last external change check.
+    qint64 iDataVersion;
+};
+
+// Closes a database connection. Must be called in the thread that opened it.
+void closeConnection(const QString &aName)
+{
+    {
+        QSqlDatabase db = QSqlDatabase::database(aName, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(aName);
+}
+
+// Database connections opened by one thread, by store. Destroyed in the
+// thread when it exits, which closes the connections that are left.
+class ThreadConnections
+{
+public:
+    ~ThreadConnections()
+    {
+        foreach (const Connection &connection, iConnections)
+        {
+            closeConnection(connection.iName);
+        }
+    }
+
+    QHash<QString, Connection> iConnections;
+};
+
+QThreadStorage<ThreadConnections*> threadConnections;
+
+}
+
+namespace Buteo {
+
+// Deferred profile updates of one database.
+class PendingSaves
+{
+public:
+    // Serializes access to the documents.
+    QMutex iMutex;
+
+    // Profile documents waiting to be written, by type and name.
+    QMap<QPair<QString, QString>, QByteArray> iDocuments;
+};
+
+}
+
+// Pending updates of the databases open in this process, by path.
+static QMutex pendingSavesMutex;
+static QHash<QString, QWeakPointer<PendingSaves> > pendingSaves;
+
+// Gets the pending updates of a database, shared by all of its stores.
+static QSharedPointer<PendingSaves> sharedPendingSaves(const QString &aDatabasePath)
+{
+    const QString path = QFileInfo(aDatabasePath).absoluteFilePath();
+    QMutexLocker locker(&pendingSavesMutex);
+    QSharedPointer<PendingSaves> pending = pendingSaves.value(path).toStrongRef();
+    if (pending.isNull())
+    {
+        pending = QSharedPointer<PendingSaves>(new PendingSaves);
+        pendingSaves.insert(path, pending);
+    } // no else
+
+    return pending;
+}
+
+// Drops a pending update after it has been written, unless a newer one was
+// deferred in the meantime.
+static void releasePending(PendingSaves &aPending,
+                           const QPair<QString, QString> &aKey,
+                           const QByteArray &aData)
+{
+    QMutexLocker locker(&aPending.iMutex);
+    QMap<QPair<QString, QString>, QByteArray>::iterator i =
+            aPending.iDocuments.find(aKey);
+    if (i != aPending.iDocuments.end() && i.value() == aData)
+    {
+        aPending.iDocuments.erase(i);
+    } // no else
+}
+
+// Tables and indexes. Keys and sub-profile references are derived from the
+// profile documents and replaced together with them.
+static const QStringList SCHEMA = QStringList()
+    << "CREATE TABLE IF NOT EXISTS profiles ("
+       "id INTEGER PRIMARY KEY, name TEXT NOT NULL, type TEXT NOT NULL, "
+       "document TEXT NOT NULL, UNIQUE (type, name))"
+    << "CREATE TABLE IF NOT EXISTS subprofiles ("
+       "profile INTEGER NOT NULL REFERENCES profiles (id) ON DELETE CASCADE, "
+       "name TEXT NOT NULL, type TEXT NOT NULL)"
+    << "CREATE INDEX IF NOT EXISTS subprofiles_profile ON subprofiles (profile)"
+    << "CREATE INDEX IF NOT EXISTS subprofiles_reference ON subprofiles (type, name)"
+    << "CREATE TABLE IF NOT EXISTS keys ("
+       "profile INTEGER NOT NULL REFERENCES profiles (id) ON DELETE CASCADE, "
+       "subname TEXT NOT NULL, subtype TEXT NOT NULL, key TEXT NOT NULL, "
+       "value TEXT NOT NULL)"
+    << "CREATE INDEX IF NOT EXISTS keys_profile ON keys (profile)"
+    << "CREATE INDEX IF NOT EXISTS keys_lookup ON keys (key, value)"
+    << "CREATE TABLE IF NOT EXISTS results ("
+       "profile TEXT NOT NULL, synctime INTEGER NOT NULL, "
+       "majorcode INTEGER NOT NULL, minorcode INTEGER NOT NULL, "
+       "scheduled INTEGER NOT NULL, document TEXT NOT NULL)"
+    << "CREATE INDEX IF NOT EXISTS results_profile ON results (profile, synctime)";
+
+// Executes a prepared query, logging a failure.
+static bool exec(QSqlQuery &aQuery)
+{
+    if (!aQuery.exec())
+    {
+        LOG_WARNING("Profile database query failed:" << aQuery.lastQuery()
+                << aQuery.lastError().text());
+        return false;
+    } // no else
+
+    return true;
+}
+
+// Inserts the keys of a profile or one of its sub-profiles.
+static bool insertKeys(QSqlQuery &aQuery, qint64 aId, const Profile &aProfile,
+                       const QString &aSubName, const QString &aSubType)
+{
+    foreach (const QString &key, aProfile.keyNames())
+    {
+        foreach (const QString &value, aProfile.keyValues(key))
+        {
+            aQuery.bindValue(":profile", aId);
+            aQuery.bindValue(":subname", aSubName);
+            aQuery.bindValue(":subtype", aSubType);
+            aQuery.bindValue(":key", key);
+            aQuery.bindValue(":value", value);
+            if (!exec(aQuery))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+SqliteProfileStore::SqliteProfileStore(const QString &aDatabasePath,
+                                       const QString &aSecondaryPath)
+:   iConnectionPrefix("profilestore" +
+        QString::number(connectionCounter.fetchAndAddOrdered(1)) + "_"),
+    iPending(sharedPendingSaves(aDatabasePath)),
+    iDatabasePath(aDatabasePath),
+    iSecondaryPath(aSecondaryPath)
+{
+    FUNCTION_CALL_TRACE;
+}
+
+SqliteProfileStore::~SqliteProfileStore()
+{
+    FUNCTION_CALL_TRACE;
+
+    // Other stores of the database may still use them, but this one may be
+    // the last.
+    bool pending = false;
+    {
+        QMutexLocker locker(&iPending->iMutex);
+        pending = !iPending->iDocuments.isEmpty();
+    }
+    if (pending && !flush())
+    {
+        LOG_WARNING("Failed to write deferred profile updates");
+    } // no else
+
+    // Connections of other threads can only be closed by those threads,
+    // they are closed when the threads exit.
+    if (threadConnections.hasLocalData())
+    {
+        QHash<QString, Connection> &connections =
+                threadConnections.localData()->iConnections;
+        if (connections.contains(iConnectionPrefix))
+        {
+            closeConnection(connections.take(iConnectionPrefix).iName);
+        } // no else
+    } // no else
+}
+
+bool SqliteProfileStore::init()
+{
+    FUNCTION_CALL_TRACE;
+
+    QDir().mkpath(QFileInfo(iDatabasePath).absolutePath());
+    QSqlDatabase db = database();
+    if (!db.isOpen())
+        return false;
+
+    QMutexLocker locker(&iWriteMutex);
+    if (!db.transaction())
+    {
+        LOG_WARNING("Failed to begin profile database transaction:"
+                << db.lastError().text());
+        return false;
+    } // no else
+
+    bool success = true;
+    foreach (const QString &statement, SCHEMA)
+    {
+        QSqlQuery query(db);
+        query.prepare(statement);
+        if (!exec(query))
+        {
+            success = false;
+            break;
+        } // no else
+    }
+
+    if (success)
+    {
+        success = db.commit();
+    }
+    else
+    {
+        db.rollback();
+    }
+
+    return success;
+}
+
+int SqliteProfileStore::importXml(const QString &aPrimaryPath)
+{
+    FUNCTION_CALL_TRACE;
+
+    XmlProfileStore source(aPrimaryPath, iSecondaryPath,
+                           ProfileCache::instance(aPrimaryPath, iSecondaryPath));
+    return copyProfiles(source, *this);
+}
+
+int SqliteProfileStore::exportXml(const QString &aPrimaryPath)
+{
+    FUNCTION_CALL_TRACE;
+
+    XmlProfileStore target(aPrimaryPath, iSecondaryPath,
+                           ProfileCache::instance(aPrimaryPath, iSecondaryPath));
+    return copyProfiles(*this, target);
+}
+
+QStringList SqliteProfileStore::profileNames(const QString &aType)
+{
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    query.prepare("SELECT name FROM profiles WHERE type = :type ORDER BY name");
+    query.bindValue(":type", aType);
+
+    QStringList names;
+    if (exec(query))
+    {
+        while (query.next())
+        {
+            names.append(query.value(0).toString());
+        }
+    } // no else
+
+    // Stored profiles first, then system profiles not stored.
+    QSet<QString> stored = names.toSet();
+    foreach (const QString &name, secondaryNames(aType))
+    {
+        if (!stored.contains(name))
+        {
+            names.append(name);
+        } // no else
+    }
+
+    return names;
+}
+
+bool SqliteProfileStore::contains(const QString &aName, const QString &aType)
+{
+    return isWritable(aName, aType) || QFile::exists(secondaryFile(aName, aType));
+}
+
+bool SqliteProfileStore::isWritable(const QString &aName, const QString &aType)
+{
+    QSqlDatabase db = database();
+    return profileId(db, aName, aType) >= 0;
+}
+
+Profile *SqliteProfileStore::load(const QString &aName, const QString &aType)
+{
+    QByteArray pending;
+    {
+        QMutexLocker locker(&iPending->iMutex);
+        pending = iPending->iDocuments.value(qMakePair(aType, aName));
+    }
+    if (!pending.isNull())
+    {
+        QXmlStreamReader reader(pending);
+        return parseProfile(reader, aName);
+    } // no else
+
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    query.prepare("SELECT document FROM profiles WHERE type = :type AND name = :name");
+    query.bindValue(":type", aType);
+    query.bindValue(":name", aName);
+    if (!exec(query))
+        return 0;
+
+    if (query.next())
+    {
+        QXmlStreamReader reader(query.value(0).toString());
+        return parseProfile(reader, aName);
+    } // no else
+
+    const QString path = secondaryFile(aName, aType);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        LOG_WARNING("Profile not found:" << aName);
+        return 0;
+    } // no else
+
+    QXmlStreamReader reader(&file);
+    return parseProfile(reader, path);
+}
+
+bool SqliteProfileStore::save(const Profile &aProfile, bool aDeferred)
+{
+    FUNCTION_CALL_TRACE;
+
+    const QPair<QString, QString> key(aProfile.type(), aProfile.name());
+    const QByteArray data = profileData(aProfile);
+
+    // Only updates of stored profiles are deferred, so that the profile
+    // names and candidates come from the database.
+    if (aDeferred && isWritable(aProfile.name(), aProfile.type()))
+    {
+        QMutexLocker locker(&iPending->iMutex);
+        iPending->iDocuments.insert(key, data);
+        return true;
+    } // no else
+
+    // Replaces an update deferred earlier. It stays visible until the new
+    // one has been committed.
+    {
+        QMutexLocker locker(&iPending->iMutex);
+        if (iPending->iDocuments.contains(key))
+        {
+            iPending->iDocuments.insert(key, data);
+        } // no else
+    }
+
+    QMutexLocker locker(&iWriteMutex);
+    QSqlDatabase db = database();
+    if (!db.transaction())
+    {
+        LOG_WARNING("Failed to begin profile database transaction:"
+                << db.lastError().text());
+        return false;
+    } // no else
+
+    bool success = writeProfile(db, aProfile.name(), aProfile.type(), data);
+
+    if (success)
+    {
+        success = db.commit();
+    }
+    else
+    {
+        db.rollback();
+    }
+
+    if (success)
+    {
+        releasePending(*iPending, key, data);
+    }
+    else
+    {
+        LOG_WARNING("Failed to save profile:" << aProfile.name());
+    }
+
+    return success;
+}
+
+bool SqliteProfileStore::remove(const QString &aName, const QString &aType)
+{
+    FUNCTION_CALL_TRACE;
+
+    {
+        QMutexLocker locker(&iPending->iMutex);
+        iPending->iDocuments.remove(qMakePair(aType, aName));
+    }
+
+    QMutexLocker locker(&iWriteMutex);
+    QSqlDatabase db = database();
+    if (!db.transaction())
+    {
+        LOG_WARNING("Failed to begin profile database transaction:"
+                << db.lastError().text());
+        return false;
+    } // no else
+
+    // Keys and sub-profile references go with the profile.
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM profiles WHERE type = :type AND name = :name");
+    query.bindValue(":type", aType);
+    query.bindValue(":name", aName);
+    bool success = exec(query) && query.numRowsAffected() > 0;
+
+    if (success && aType == Profile::TYPE_SYNC)
+    {
+        QSqlQuery removeResults(db);
+        removeResults.prepare("DELETE FROM results WHERE profile = :profile");
+        removeResults.bindValue(":profile", aName);
+        success = exec(removeResults);
+    } // no else
+
+    if (success)
+    {
+        success = db.commit();
+    }
+    else
+    {
+        db.rollback();
+    }
+
+    return success;
+}
+
+bool SqliteProfileStore::rename(const QString &aName, const QString &aNewName)
+{
+    FUNCTION_CALL_TRACE;
+
+    // Only stored documents are renamed.
+    if (!flush())
+        return false;
+
+    QScopedPointer<Profile> profile(load(aName, Profile::TYPE_SYNC));
+    if (profile.isNull())
+        return false;
+
+    // The name is part of the document also.
+    profile->setName(aNewName);
+    const QByteArray data = profileData(*profile);
+
+    QMutexLocker locker(&iWriteMutex);
+    QSqlDatabase db = database();
+    if (!db.transaction())
+    {
+        LOG_WARNING("Failed to begin profile database transaction:"
+                << db.lastError().text());
+        return false;
+    } // no else
+
+    QSqlQuery query(db);
+    query.prepare("UPDATE profiles SET name = :newname, document = :document "
+                  "WHERE type = :type AND name = :name");
+    query.bindValue(":newname", aNewName);
+    query.bindValue(":document", QString::fromUtf8(data));
+    query.bindValue(":type", Profile::TYPE_SYNC);
+    query.bindValue(":name", aName);
+    bool success = exec(query) && query.numRowsAffected() > 0;
+
+    if (success)
+    {
+        QSqlQuery renameResults(db);
+        renameResults.prepare("UPDATE results SET profile = :newname "
+                              "WHERE profile = :name");
+        renameResults.bindValue(":newname", aNewName);
+        renameResults.bindValue(":name", aName);
+        success = exec(renameResults);
+    } // no else
+
+    if (success)
+    {
+        success = db.commit();
+    }
+    else
+    {
+        db.rollback();
+    }
+
+    return success;
+}
+
+SyncLog *SqliteProfileStore::loadLog(const QString &aProfileName)
+{
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    query.prepare("SELECT document FROM results WHERE profile = :profile "
+                  "ORDER BY synctime, rowid");
+    query.bindValue(":profile", aProfileName);
+    if (!exec(query))
+        return 0;
+
+    SyncLog *log = 0;
+    while (query.next())
+    {
+        if (log == 0)
+        {
+            log = new SyncLog(aProfileName);
+        } // no else
+
+        QXmlStreamReader reader(query.value(0).toString());
+        if (!reader.readNextStartElement())
+        {
+            LOG_WARNING("Ignoring invalid sync results of profile:" << aProfileName);
+            continue;
+        } // no else
+
+        SyncResults results(reader);
+        if (reader.hasError())
+        {
+            LOG_WARNING("Ignoring invalid sync results of profile:" << aProfileName);
+            continue;
+        } // no else
+        log->addResults(results);
+    }
+
+    if (log == 0)
+    {
+        LOG_DEBUG("No sync log found for profile:" << aProfileName);
+    } // no else
+
+    return log;
+}
+
+bool SqliteProfileStore::saveLog(const SyncLog &aLog)
+{
+    FUNCTION_CALL_TRACE;
+
+    QMutexLocker locker(&iWriteMutex);
+    QSqlDatabase db = database();
+    if (!db.transaction())
+    {
+        LOG_WARNING("Failed to begin profile database transaction:"
+                << db.lastError().text());
+        return false;
+    } // no else
+
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM results WHERE profile = :profile");
+    query.bindValue(":profile", aLog.profileName());
+    bool success = exec(query);
+
+    foreach (const SyncResults *results, aLog.allResults())
+    {
+        if (!success)
+            break;
+
+        success = writeResults(db, aLog.profileName(), *results);
+    }
+
+    if (success)
+    {
+        success = db.commit();
+    }
+    else
+    {
+        db.rollback();
+    }
+
+    return success;
+}
+
+bool SqliteProfileStore::appendResults(const QString &aProfileName,
+                                       const SyncResults &aResults)
+{
+    FUNCTION_CALL_TRACE;
+
+    QMutexLocker locker(&iWriteMutex);
+    QSqlDatabase db = database();
+    if (!db.transaction())
+    {
+        LOG_WARNING("Failed to begin profile database transaction:"
+                << db.lastError().text());
+        return false;
+    } // no else
+
+    bool success = writeResults(db, aProfileName, aResults);
+
+    // Older results would be dropped from the log when it is loaded.
+    if (success)
+    {
+        QSqlQuery query(db);
+        query.prepare("DELETE FROM results WHERE profile = :profile AND rowid NOT IN "
+                      "(SELECT rowid FROM results WHERE profile = :kept "
+                      "ORDER BY synctime DESC, rowid DESC LIMIT :limit)");
+        query.bindValue(":profile", aProfileName);
+        query.bindValue(":kept", aProfileName);
+        query.bindValue(":limit", MAX_LOG_RESULTS);
+        success = exec(query);
+    } // no else
+
+    if (success)
+    {
+        success = db.commit();
+    }
+    else
+    {
+        db.rollback();
+    }
+
+    return success;
+}
+
+bool SqliteProfileStore::flush()
+{
+    FUNCTION_CALL_TRACE;
+
+    QMap<QPair<QString, QString>, QByteArray> documents;
+    {
+        QMutexLocker locker(&iPending->iMutex);
+        documents = iPending->iDocuments;
+    }
+    if (documents.isEmpty())
+        return true;
+
+    QMutexLocker locker(&iWriteMutex);
+    QSqlDatabase db = database();
+    if (!db.transaction())
+    {
+        LOG_WARNING("Failed to begin profile database transaction:"
+                << db.lastError().text());
+        return false;
+    } // no else
+
+    bool success = true;
+    QMap<QPair<QString, QString>, QByteArray>::const_iterator i;
+    for (i = documents.constBegin(); success && i != documents.constEnd(); ++i)
+    {
+        success = writeProfile(db, i.key().second, i.key().first, i.value());
+    }
+
+    if (success)
+    {
+        success = db.commit();
+    }
+    else
+    {
+        db.rollback();
+    }
+
+    if (!success)
+    {
+        LOG_WARNING("Failed to write deferred profile updates");
+        return false;
+    } // no else
+
+    for (i = documents.constBegin(); i != documents.constEnd(); ++i)
+    {
+        releasePending(*iPending, i.key(), i.value());
+    }
+
+    return true;
+}
+
+bool SqliteProfileStore::hasExternalChanges()
+{
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    query.prepare("PRAGMA data_version");
+    if (!exec(query) || !query.next())
+        return false;
+
+    // The version changes when other connections commit, also the ones of
+    // other threads in this process.
+    const qint64 version = query.value(0).toLongLong();
+    Connection &connection =
+            threadConnections.localData()->iConnections[iConnectionPrefix];
+    const bool changed = (connection.iDataVersion != version);
+    connection.iDataVersion = version;
+
+    return changed;
+}
+
+bool SqliteProfileStore::candidates(
+        const QList<ProfileManager::SearchCriteria> &aCriteria,
+        QSet<QString> &aNames)
+{
+    QSqlDatabase db = database();
+
+    bool resolved = false;
+    foreach (const ProfileManager::SearchCriteria &criteria, aCriteria)
+    {
+        if (!criteria.iSubProfileName.isEmpty() ||
+            !criteria.iSubProfileType.isEmpty() || criteria.iKey.isEmpty() ||
+            (criteria.iType != ProfileManager::SearchCriteria::EQUAL &&
+             criteria.iType != ProfileManager::SearchCriteria::EXISTS))
+        {
+            // Negative criteria and criteria on sub-profiles can not
+            // narrow down the search.
+            continue;
+        } // no else
+
+        QString statement("SELECT DISTINCT profiles.name FROM keys "
+                          "JOIN profiles ON profiles.id = keys.profile "
+                          "WHERE keys.key = :key AND keys.subname = '' "
+                          "AND keys.subtype = '' AND profiles.type = :type");
+        if (criteria.iType == ProfileManager::SearchCriteria::EQUAL)
+        {
+            statement += " AND keys.value = :value";
+        } // no else
+
+        QSqlQuery query(db);
+        query.prepare(statement);
+        query.bindValue(":key", criteria.iKey);
+        query.bindValue(":type", Profile::TYPE_SYNC);
+        if (criteria.iType == ProfileManager::SearchCriteria::EQUAL)
+        {
+            query.bindValue(":value", criteria.iValue);
+        } // no else
+        if (!exec(query))
+            return false;
+
+        QSet<QString> names;
+        while (query.next())
+        {
+            names.insert(query.value(0).toString());
+        }
+
+        if (resolved)
+        {
+            aNames.intersect(names);
+        }
+        else
+        {
+            aNames = names;
+            resolved = true;
+        }
+    }
+
+    if (resolved)
+    {
+        // Deferred updates are not indexed yet.
+        {
+            QMutexLocker locker(&iPending->iMutex);
+            QMap<QPair<QString, QString>, QByteArray>::const_iterator i;
+            for (i = iPending->iDocuments.constBegin();
+                 i != iPending->iDocuments.constEnd(); ++i)
+            {
+                if (i.key().first == Profile::TYPE_SYNC)
+                {
+                    aNames.insert(i.key().second);
+                } // no else
+            }
+        }
+
+        // System profiles are not indexed, they are always candidates.
+        foreach (const QString &name, secondaryNames(Profile::TYPE_SYNC))
+        {
+            if (profileId(db, name, Profile::TYPE_SYNC) < 0)
+            {
+                aNames.insert(name);
+            } // no else
+        }
+    } // no else
+
+    return resolved;
+}
+
+QSqlDatabase SqliteProfileStore::database()
+{
+    if (!threadConnections.hasLocalData())
+    {
+        threadConnections.setLocalData(new ThreadConnections);
+    } // no else
+    QHash<QString, Connection> &connections =
+            threadConnections.localData()->iConnections;
+
+    QHash<QString, Connection>::iterator i = connections.find(iConnectionPrefix);
+    if (i != connections.end())
+    {
+        {
+            QSqlDatabase db = QSqlDatabase::database(i->iName, false);
+            if (db.isOpen())
+                return db;
+        }
+
+        // Failed to open, try again.
+        closeConnection(i->iName);
+        connections.erase(i);
+    } // no else
+
+    Connection connection;
+    connection.iName = iConnectionPrefix +
+            QString::number(connectionCounter.fetchAndAddOrdered(1));
+    connection.iDataVersion = -1;
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection.iName);
+    db.setDatabaseName(iDatabasePath);
+    // Writers of other connections are waited for instead of failing.
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (db.open())
+    {
+        QSqlQuery query(db);
+        query.exec("PRAGMA journal_mode = WAL");
+        query.exec("PRAGMA synchronous = NORMAL");
+        query.exec("PRAGMA foreign_keys = ON");
+        if (query.exec("PRAGMA data_version") && query.next())
+        {
+            connection.iDataVersion = query.value(0).toLongLong();
+        } // no else
+    }
+    else
+    {
+        LOG_WARNING("Failed to open profile database:" << iDatabasePath
+                << db.lastError().text());
+    }
+    connections.insert(iConnectionPrefix, connection);
+
+    return db;
+}
+
+qint64 SqliteProfileStore::profileId(QSqlDatabase &aDb, const QString &aName,
+                                     const QString &aType)
+{
+    QSqlQuery query(aDb);
+    query.prepare("SELECT id FROM profiles WHERE type = :type AND name = :name");
+    query.bindValue(":type", aType);
+    query.bindValue(":name", aName);
+
+    return (exec(query) && query.next()) ? query.value(0).toLongLong() : -1;
+}
+
+bool SqliteProfileStore::writeProfile(QSqlDatabase &aDb, const QString &aName,
+                                      const QString &aType,
+                                      const QByteArray &aData)
+{
+    // The keys are taken from the stored document, so that they match the
+    // profile as it is read back.
+    QXmlStreamReader reader(aData);
+    QScopedPointer<Profile> stored(parseProfile(reader, aName));
+    if (stored.isNull())
+        return false;
+
+    bool success = false;
+    qint64 id = profileId(aDb, aName, aType);
+    QSqlQuery query(aDb);
+    if (id < 0)
+    {
+        query.prepare("INSERT INTO profiles (name, type, document) "
+                      "VALUES (:name, :type, :document)");
+        query.bindValue(":name", aName);
+        query.bindValue(":type", aType);
+        query.bindValue(":document", QString::fromUtf8(aData));
+        success = exec(query);
+        id = query.lastInsertId().toLongLong();
+    }
+    else
+    {
+        query.prepare("UPDATE profiles SET document = :document WHERE id = :id");
+        query.bindValue(":document", QString::fromUtf8(aData));
+        query.bindValue(":id", id);
+        success = exec(query);
+
+        QSqlQuery removeKeys(aDb);
+        removeKeys.prepare("DELETE FROM keys WHERE profile = :id");
+        removeKeys.bindValue(":id", id);
+        QSqlQuery removeSubProfiles(aDb);
+        removeSubProfiles.prepare("DELETE FROM subprofiles WHERE profile = :id");
+        removeSubProfiles.bindValue(":id", id);
+        success = success && exec(removeKeys) && exec(removeSubProfiles);
+    }
+
+    return success && writeKeys(aDb, id, *stored);
+}
+
+bool SqliteProfileStore::writeKeys(QSqlDatabase &aDb, qint64 aId,
+                                   const Profile &aProfile)
+{
+    QSqlQuery keyQuery(aDb);
+    keyQuery.prepare("INSERT INTO keys (profile, subname, subtype, key, value) "
+                     "VALUES (:profile, :subname, :subtype, :key, :value)");
+    if (!insertKeys(keyQuery, aId, aProfile, QString(""), QString("")))
+        return false;
+
+    QSqlQuery subQuery(aDb);
+    subQuery.prepare("INSERT INTO subprofiles (profile, name, type) "
+                     "VALUES (:profile, :name, :type)");
+    foreach (const Profile *sub, aProfile.allSubProfiles())
+    {
+        subQuery.bindValue(":profile", aId);
+        subQuery.bindValue(":name", sub->name());
+        subQuery.bindValue(":type", sub->type());
+        if (!exec(subQuery) ||
+            !insertKeys(keyQuery, aId, *sub, sub->name(), sub->type()))
+        {
+            return false;
+        } // no else
+    }
+
+    return true;
+}
+
+bool SqliteProfileStore::writeResults(QSqlDatabase &aDb,
+                                      const QString &aProfileName,
+                                      const SyncResults &aResults)
+{
+    QByteArray data;
+    QXmlStreamWriter writer(&data);
+    aResults.toXml(writer);
+
+    QSqlQuery query(aDb);
+    query.prepare("INSERT INTO results "
+                  "(profile, synctime, majorcode, minorcode, scheduled, document) "
+                  "VALUES (:profile, :synctime, :majorcode, :minorcode, "
+                  ":scheduled, :document)");
+    query.bindValue(":profile", aProfileName);
+    query.bindValue(":synctime", aResults.syncTime().toMSecsSinceEpoch());
+    query.bindValue(":majorcode", aResults.majorCode());
+    query.bindValue(":minorcode", aResults.minorCode());
+    query.bindValue(":scheduled", aResults.isScheduled() ? 1 : 0);
+    query.bindValue(":document", QString::fromUtf8(data));
+
+    return exec(query);
+}
+
+QString SqliteProfileStore::secondaryFile(const QString &aName,
+                                          const QString &aType) const
+{
+    return iSecondaryPath + QDir::separator() + aType + QDir::separator() +
+            aName + FORMAT_EXT;
+}
+
+QStringList SqliteProfileStore::secondaryNames(const QString &aType) const
+{
+    QDir dir(iSecondaryPath + QDir::separator() + aType);
+    QStringList names = dir.entryList(QStringList() << "*" + FORMAT_EXT,
+                                      QDir::Files, QDir::Name);
+    for (int i = 0; i < names.size(); ++i)
+    {
+        names[i].chop(FORMAT_EXT.length());
+    }
+
+    return names;
+}
@@ -0,0 +1,197 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef SQLITEPROFILESTORE_H
+#define SQLITEPROFILESTORE_H
+
+#include <QMutex>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+
+#include "ProfileStore.h"
+
+namespace Buteo {
+
+class PendingSaves;
+
+/*! \brief Stores profiles in a single SQLite database.
+ *
+ * The database is used in WAL mode, so readers do not block each other or
+ * the writer, also across processes. Each profile is stored as its XML
+ * document, which keeps everything the profile holds. The keys and
+ * sub-profile references of the documents are stored in normalized tables
+ * next to them, with indexes used to resolve search criteria without
+ * loading the profiles. Sync results get a row each.
+ *
+ * Read-only system profiles stay in the XML files of the secondary path and
+ * are read from there.
+ *
+ * A database connection is opened for each thread using the store. It is
+ * closed by that thread when the thread exits, or when the store is
+ * destroyed in it.
+ *
+ * Deferred updates are kept in memory, shared by all stores of the same
+ * database in the process, and written together in one transaction by
+ * flush(). Until then they are returned by load().
+ */
+class SqliteProfileStore : public ProfileStore
+{
+public:
+
+    //! File name of the profile database in the primary profile path.
+    static const QString DATABASE_FILE;
+
+    /*! \brief Constructor.
+     *
+     * \param aDatabasePath Path of the database file.
+     * \param aSecondaryPath Path of the read-only system profiles.
+     */
+    SqliteProfileStore(const QString &aDatabasePath,
+                       const QString &aSecondaryPath);
+
+    //! \brief Destructor. Writes the deferred updates.
+    virtual ~SqliteProfileStore();
+
+    /*! \brief Opens the database and creates the tables if needed.
+     *
+     * \return Success indicator.
+     */
+    bool init();
+
+    /*! \brief Imports profiles and sync logs from the XML directory layout.
+     *
+     * \param aPrimaryPath Directory of the profile files to import.
+     * \return Number of profiles imported. -1 on failure.
+     */
+    int importXml(const QString &aPrimaryPath);
+
+    /*! \brief Exports profiles and sync logs to the XML directory layout.
+     *
+     * \param aPrimaryPath Directory to write the profile files to.
+     * \return Number of profiles exported. -1 on failure.
+     */
+    int exportXml(const QString &aPrimaryPath);
+
+    //! \see ProfileStore::profileNames
+    virtual QStringList profileNames(const QString &aType);
+
+    //! \see ProfileStore::contains
+    virtual bool contains(const QString &aName, const QString &aType);
+
+    //! \see ProfileStore::isWritable
+    virtual bool isWritable(const QString &aName, const QString &aType);
+
+    //! \see ProfileStore::load
+    virtual Profile *load(const QString &aName, const QString &aType);
+
+    /*! \brief Writes a profile in a single transaction.
+     *
+     * Deferred updates of stored profiles are written by flush().
+     * \see ProfileStore::save
+     */
+    virtual bool save(const Profile &aProfile, bool aDeferred);
+
+    //! \see ProfileStore::remove
+    virtual bool remove(const QString &aName, const QString &aType);
+
+    //! \see ProfileStore::rename
+    virtual bool rename(const QString &aName, const QString &aNewName);
+
+    //! \see ProfileStore::loadLog
+    virtual SyncLog *loadLog(const QString &aProfileName);
+
+    //! \see ProfileStore::saveLog
+    virtual bool saveLog(const SyncLog &aLog);
+
+    //! \see ProfileStore::appendResults
+    virtual bool appendResults(const QString &aProfileName,
+                               const SyncResults &aResults);
+
+    /*! \brief Writes all deferred updates in a single transaction.
+     *
+     * Updates stay deferred, and visible to load(), until the transaction
+     * has been committed. Nothing is written if any of them fails.
+     * \see ProfileStore::flush
+     */
+    virtual bool flush();
+
+    /*! \brief Checks the data version of the database.
+     *
+     * \see ProfileStore::hasExternalChanges
+     */
+    virtual bool hasExternalChanges();
+
+    /*! \brief Resolves criteria on the keys of the sync profiles themselves.
+     *
+     * Keys of sub-profiles may come from other profiles merged in, so
+     * criteria on them do not narrow down the candidates.
+     * \see ProfileStore::candidates
+     */
+    virtual bool candidates(const QList<ProfileManager::SearchCriteria> &aCriteria,
+                            QSet<QString> &aNames);
+
+private:
+
+    // Gets the connection of the calling thread, opening it if needed.
+    QSqlDatabase database();
+
+    // Gets the row id of a stored profile. -1 if not found.
+    qint64 profileId(QSqlDatabase &aDb, const QString &aName,
+                     const QString &aType);
+
+    // Writes a profile document with its keys and sub-profile references.
+    // Must be called in a transaction.
+    bool writeProfile(QSqlDatabase &aDb, const QString &aName,
+                      const QString &aType, const QByteArray &aData);
+
+    // Writes the keys and sub-profile references of a profile document.
+    bool writeKeys(QSqlDatabase &aDb, qint64 aId, const Profile &aProfile);
+
+    // Writes one sync results row.
+    bool writeResults(QSqlDatabase &aDb, const QString &aProfileName,
+                      const SyncResults &aResults);
+
+    // Gets the path of a system profile file.
+    QString secondaryFile(const QString &aName, const QString &aType) const;
+
+    // Names of the system profiles of a type.
+    QStringList secondaryNames(const QString &aType) const;
+
+    // Serializes the write transactions made in this process.
+    QMutex iWriteMutex;
+
+    // Deferred updates, shared by the stores of the database.
+    QSharedPointer<PendingSaves> iPending;
+
+    // Prefix of the connection names, also identifies the store in the
+    // connections of each thread.
+    QString iConnectionPrefix;
+
+    QString iDatabasePath;
+
+    QString iSecondaryPath;
+};
+
+}
+
+#endif // SQLITEPROFILESTORE_H
@@ -62,6 +62,12 @@ StorageProfile::StorageProfile(const QDomElement &aRoot)
 {
 }
 
+StorageProfile::StorageProfile(QXmlStreamReader &aReader)
+:   Profile(aReader),
+    d_ptr(new StorageProfilePrivate())
+{
+}
+
 StorageProfile::StorageProfile(const StorageProfile &aSource)
 :   Profile(aSource),
     d_ptr(new StorageProfilePrivate(*aSource.d_ptr))
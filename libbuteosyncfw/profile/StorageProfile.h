@@ -46,6 +46,13 @@ public:
      */
     explicit StorageProfile(const QDomElement &aRoot);
 
+    /*! \brief Constructs a StorageProfile from an XML stream.
+     *
+     * \param aReader Reader positioned at the start element of the profile.
+     *  On return the reader is positioned at the matching end element.
+     */
+    explicit StorageProfile(QXmlStreamReader &aReader);
+
     /*! \brief Copy constructor.
      *
      * \param aSource Copy source.
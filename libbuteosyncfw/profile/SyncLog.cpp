@@ -23,6 +23,8 @@
 #include "SyncLog.h"
 #include "LogMacros.h"
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 #include <QtAlgorithms>
 
 #include "ProfileEngineDefs.h"
@@ -100,6 +102,24 @@ SyncLog::SyncLog(const QDomElement &aRoot)
     //qSort(d_ptr->iResults.begin(), d_ptr->iResults.end(), syncResultPointerLessThan);
 }
 
+SyncLog::SyncLog(QXmlStreamReader &aReader)
+:   d_ptr(new SyncLogPrivate())
+{
+    d_ptr->iProfileName = aReader.attributes().value(ATTR_NAME).toString();
+
+    while (aReader.readNextStartElement())
+    {
+        if (aReader.name() == TAG_SYNC_RESULTS)
+        {
+            d_ptr->iResults.append(new SyncResults(aReader));
+        }
+        else
+        {
+            aReader.skipCurrentElement();
+        }
+    }
+}
+
 SyncLog::SyncLog(const SyncLog &aSource)
 :   d_ptr(new SyncLogPrivate(*aSource.d_ptr))
 {
@@ -134,6 +154,18 @@ QDomElement SyncLog::toXml(QDomDocument &aDoc) const
     return root;
 }
 
+void SyncLog::toXml(QXmlStreamWriter &aWriter) const
+{
+    aWriter.writeStartElement(TAG_SYNC_LOG);
+    aWriter.writeAttribute(ATTR_NAME, d_ptr->iProfileName);
+
+    foreach (const SyncResults *results, d_ptr->iResults) {
+        results->toXml(aWriter);
+    }
+
+    aWriter.writeEndElement();
+}
+
 const SyncResults* SyncLog::lastResults() const
 {
     FUNCTION_CALL_TRACE;
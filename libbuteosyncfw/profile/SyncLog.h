@@ -29,6 +29,8 @@
 
 class QDomDocument;
 class QDomElement;
+class QXmlStreamReader;
+class QXmlStreamWriter;
 
 namespace Buteo {
 
@@ -56,6 +58,13 @@ public:
      */
     explicit SyncLog(const QDomElement &aRoot);
 
+    /*! \brief Constructs a SyncLog from an XML stream.
+     *
+     * \param aReader Reader positioned at the start element of the log.
+     *  On return the reader is positioned at the matching end element.
+     */
+    explicit SyncLog(QXmlStreamReader &aReader);
+
     /*! \brief Copy constructor.
      *
      * \param aSource Copy source.
@@ -86,6 +95,13 @@ public:
      */
     QDomElement toXml(QDomDocument &aDoc) const;
 
+    /*! \brief Writes the log as XML to a stream.
+     *
+     * The output is the same as for the QDomDocument version.
+     * \param aWriter Writer to write the XML element with.
+     */
+    void toXml(QXmlStreamWriter &aWriter) const;
+
     /*! \brief Gets the most recent results in the sync log.
      *
      * \return The results. NULL if the log is empty.
@@ -0,0 +1,222 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "SyncLogJournal.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "SyncLog.h"
+#include "SyncResults.h"
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+const qint64 SyncLogJournal::COMPACT_SIZE = 16 * 1024;
+
+static const QString JOURNAL_EXT = ".log.journal";
+
+// Upper bound for a single record, anything larger is corruption.
+static const quint32 MAX_RECORD_SIZE = 1024 * 1024;
+
+// Marks the start of every record.
+static const quint32 RECORD_MAGIC = 0x42534c4a;
+
+// Magic number, data length and data checksum.
+static const qint64 RECORD_HEADER_SIZE = 4 + 4 + 2;
+
+// Reads the record at the current position of a journal file. Returns false
+// if there is no complete and valid record there.
+static bool readRecord(QFile &aFile, QByteArray &aData)
+{
+    if (aFile.bytesAvailable() < RECORD_HEADER_SIZE)
+        return false;
+
+    QDataStream stream(&aFile);
+    quint32 magic = 0;
+    quint32 size = 0;
+    quint16 checksum = 0;
+    stream >> magic >> size >> checksum;
+    if (stream.status() != QDataStream::Ok || magic != RECORD_MAGIC ||
+        size > MAX_RECORD_SIZE || aFile.bytesAvailable() < size)
+    {
+        return false;
+    } // no else
+
+    aData = aFile.read(size);
+    return (aData.size() == static_cast<int>(size) &&
+            qChecksum(aData.constData(), aData.size()) == checksum);
+}
+
+SyncLogJournal::SyncLogJournal(const QString &aLogDirectory)
+:   iLogDirectory(aLogDirectory)
+{
+}
+
+QString SyncLogJournal::filePath(const QString &aProfileName) const
+{
+    return iLogDirectory + QDir::separator() + aProfileName + JOURNAL_EXT;
+}
+
+bool SyncLogJournal::append(const QString &aProfileName,
+                            const SyncResults &aResults,
+                            qint64 &aJournalSize) const
+{
+    FUNCTION_CALL_TRACE;
+
+    QByteArray data;
+    QXmlStreamWriter writer(&data);
+    aResults.toXml(writer);
+
+    QDir().mkpath(iLogDirectory);
+    QFile file(filePath(aProfileName));
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Append))
+    {
+        LOG_WARNING("Failed to open sync log journal for writing:"
+                << file.fileName());
+        return false;
+    } // no else
+
+    // A record left incomplete by an interrupted write would hide the
+    // records appended after it, so it is cut off first.
+    file.seek(0);
+    qint64 validSize = 0;
+    QByteArray existing;
+    while (readRecord(file, existing))
+    {
+        validSize = file.pos();
+    }
+    if (validSize < file.size())
+    {
+        LOG_WARNING("Dropping incomplete record from sync log journal:"
+                << file.fileName());
+        if (!file.resize(validSize))
+        {
+            LOG_WARNING("Failed to truncate sync log journal:" << file.fileName());
+            return false;
+        } // no else
+    } // no else
+    file.seek(validSize);
+
+    // Write the record with a single call, so that a reader never sees the
+    // header without the data that was written with it.
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream << RECORD_MAGIC << static_cast<quint32>(data.size())
+           << qChecksum(data.constData(), data.size());
+    record.append(data);
+
+    bool success = (file.write(record) == record.size()) && file.flush();
+    if (!success)
+    {
+        LOG_WARNING("Failed to write sync log journal:" << file.fileName());
+        file.resize(validSize);
+    } // no else
+
+    aJournalSize = file.size();
+    file.close();
+
+    return success;
+}
+
+int SyncLogJournal::replay(const QString &aProfileName, SyncLog &aLog) const
+{
+    FUNCTION_CALL_TRACE;
+
+    QFile file(filePath(aProfileName));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return 0;
+    } // no else
+
+    int added = 0;
+    QByteArray data;
+    while (!file.atEnd())
+    {
+        if (!readRecord(file, data))
+        {
+            LOG_WARNING("Ignoring incomplete record in sync log journal:"
+                    << file.fileName());
+            break;
+        } // no else
+
+        QXmlStreamReader reader(data);
+        if (!reader.readNextStartElement())
+        {
+            LOG_WARNING("Ignoring invalid record in sync log journal:"
+                    << file.fileName());
+            continue;
+        } // no else
+
+        SyncResults results(reader);
+        if (reader.hasError())
+        {
+            LOG_WARNING("Ignoring invalid record in sync log journal:"
+                    << file.fileName());
+            continue;
+        } // no else
+        bool logged = false;
+        foreach (const SyncResults *existing, aLog.allResults())
+        {
+            if (existing->syncTime() == results.syncTime() &&
+                existing->majorCode() == results.majorCode() &&
+                existing->minorCode() == results.minorCode())
+            {
+                logged = true;
+                break;
+            } // no else
+        }
+
+        if (!logged)
+        {
+            aLog.addResults(results);
+            added++;
+        } // no else
+    }
+
+    file.close();
+
+    return added;
+}
+
+bool SyncLogJournal::exists(const QString &aProfileName) const
+{
+    return QFile::exists(filePath(aProfileName));
+}
+
+void SyncLogJournal::remove(const QString &aProfileName) const
+{
+    QFile::remove(filePath(aProfileName));
+}
+
+bool SyncLogJournal::rename(const QString &aProfileName,
+                            const QString &aNewName) const
+{
+    if (!exists(aProfileName))
+        return true;
+
+    return QFile::rename(filePath(aProfileName), filePath(aNewName));
+}
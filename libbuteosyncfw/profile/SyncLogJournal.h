@@ -0,0 +1,119 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef SYNCLOGJOURNAL_H
+#define SYNCLOGJOURNAL_H
+
+#include <QString>
+
+namespace Buteo {
+
+class SyncLog;
+class SyncResults;
+
+/*! \brief Append-only journal of sync results.
+ *
+ * Every sync profile can have a journal file next to its sync log file.
+ * Recording a result appends one small record to the journal. When the sync
+ * log is loaded, the journal records are replayed on top of the log file.
+ * SyncLog still keeps only its maximum number of entries. The journal is
+ * compacted into the log file when it grows over COMPACT_SIZE.
+ *
+ * A record starts with a magic number, the byte length of the data and a
+ * checksum of the data. The data is the sync results as an UTF-8 encoded XML
+ * element. Replay stops at the first record that is cut short or does not
+ * match its checksum, since the records after it can not be found reliably.
+ * Such a record is cut off the journal before the next record is appended.
+ */
+class SyncLogJournal
+{
+public:
+
+    //! Journal size in bytes after which the journal should be compacted.
+    static const qint64 COMPACT_SIZE;
+
+    /*! \brief Constructor.
+     *
+     * \param aLogDirectory Directory of the sync log files.
+     */
+    explicit SyncLogJournal(const QString &aLogDirectory);
+
+    /*! \brief Gets the path of the journal file of a profile.
+     *
+     * \param aProfileName Name of the sync profile.
+     * \return Journal file path.
+     */
+    QString filePath(const QString &aProfileName) const;
+
+    /*! \brief Appends sync results to the journal of a profile.
+     *
+     * The journal is truncated after its last valid record first. If the
+     * write fails, the journal is truncated back to that size.
+     * \param aProfileName Name of the sync profile.
+     * \param aResults Results to append.
+     * \param aJournalSize Size of the journal after the append.
+     * \return Success indicator.
+     */
+    bool append(const QString &aProfileName, const SyncResults &aResults,
+                qint64 &aJournalSize) const;
+
+    /*! \brief Adds the journaled results of a profile to a sync log.
+     *
+     * Records are read up to the first one that is incomplete or corrupt.
+     * Results already in the log are skipped. They are found in the journal
+     * if compaction was interrupted after writing the log file.
+     * \param aProfileName Name of the sync profile.
+     * \param aLog Log to add the results to.
+     * \return Number of results added.
+     */
+    int replay(const QString &aProfileName, SyncLog &aLog) const;
+
+    /*! \brief Checks if a profile has journaled results.
+     *
+     * \param aProfileName Name of the sync profile.
+     * \return True if the journal file exists.
+     */
+    bool exists(const QString &aProfileName) const;
+
+    /*! \brief Removes the journal of a profile.
+     *
+     * \param aProfileName Name of the sync profile.
+     */
+    void remove(const QString &aProfileName) const;
+
+    /*! \brief Renames the journal of a profile.
+     *
+     * \param aProfileName Current name of the sync profile.
+     * \param aNewName New name of the sync profile.
+     * \return True if the journal was renamed or did not exist.
+     */
+    bool rename(const QString &aProfileName, const QString &aNewName) const;
+
+private:
+
+    QString iLogDirectory;
+};
+
+}
+
+#endif // SYNCLOGJOURNAL_H
@@ -23,76 +23,12 @@
  */
 
 #include "SyncProfile.h"
+#include "SyncProfile_p.h"
 #include "ProfileEngineDefs.h"
 #include "LogMacros.h"
 #include <QDomDocument>
-
-namespace Buteo {
-
-
-// Private implementation class for SyncProfile.
-class SyncProfilePrivate
-{
-public:
-    SyncProfilePrivate();
-
-    SyncProfilePrivate(const SyncProfilePrivate &aSource);
-
-    ~SyncProfilePrivate();
-
-    SyncLog *iLog;
-
-    SyncSchedule iSchedule;
-
-    struct SyncRetriesInfo
-    {
-        QList<quint32> iRetryIntervals;
-        quint32 iIntervalIndex;
-
-        void init()
-        {
-            iIntervalIndex = 0;
-        }
-
-        void addInterval(quint32 interval)
-        {
-            iRetryIntervals.append(interval);
-        }
-
-        quint32 retries()
-        {
-            return iRetryIntervals.count();
-        }
-
-        qint32 nextInterval()
-        {
-            qint32 next = -1;
-            if(iIntervalIndex < retries())
-            {
-                next = iRetryIntervals.at(iIntervalIndex);
-                ++iIntervalIndex;
-            }
-            return next;
-        }
-
-        QList<quint32> intervals()
-        {
-            return iRetryIntervals;
-        }
-
-        SyncRetriesInfo& operator=(const SyncRetriesInfo& rhs)
-        {
-            if(this != &rhs)
-            {
-                iIntervalIndex = rhs.iIntervalIndex;
-                iRetryIntervals = rhs.iRetryIntervals;
-            }
-            return *this;
-        }
-    }iSyncRetriesInfo;
-};
-
-}
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 using namespace Buteo;
 
@@ -152,6 +88,45 @@ SyncProfile::SyncProfile(const QDomElement &aRoot)
     }
 }
 
+SyncProfile::SyncProfile(QXmlStreamReader &aReader)
+:   Profile(aReader.attributes().value(ATTR_NAME).toString(),
+            aReader.attributes().value(ATTR_TYPE).toString()),
+    d_ptr(new SyncProfilePrivate())
+{
+    // Only the first schedule and retry definitions are used.
+    bool scheduleRead = false;
+    bool retriesRead = false;
+    while (aReader.readNextStartElement())
+    {
+        if (aReader.name() == TAG_SCHEDULE && !scheduleRead)
+        {
+            d_ptr->iSchedule = SyncSchedule(aReader);
+            scheduleRead = true;
+        }
+        else if (aReader.name() == TAG_ERROR_ATTEMPTS && !retriesRead)
+        {
+            while (aReader.readNextStartElement())
+            {
+                if (aReader.name() == TAG_ATTEMPT_DELAY)
+                {
+                    bool ok = false;
+                    int parsedTime = aReader.attributes().value(ATTR_VALUE).toUInt(&ok);
+                    if ( ok && parsedTime > 0 )
+                    {
+                        d_ptr->iSyncRetriesInfo.addInterval(parsedTime);
+                    }
+                } // no else
+                aReader.skipCurrentElement();
+            }
+            retriesRead = true;
+        }
+        else if (!readChildElement(aReader))
+        {
+            aReader.skipCurrentElement();
+        } // no else
+    }
+}
+
 SyncProfile::SyncProfile(const SyncProfile &aSource)
 :   Profile(aSource),
     d_ptr(new SyncProfilePrivate(*aSource.d_ptr))
@@ -196,6 +171,30 @@ QDomElement SyncProfile::toXml(QDomDocument &aDoc, bool aLocalOnly) const
     return root;
 }
 
+void SyncProfile::toXml(QXmlStreamWriter &aWriter, bool aLocalOnly) const
+{
+    aWriter.writeStartElement(TAG_PROFILE);
+    writeXmlContent(aWriter, aLocalOnly);
+    d_ptr->iSchedule.toXml(aWriter);
+    if (d_ptr->iSyncRetriesInfo.retries())
+    {
+        aWriter.writeStartElement(TAG_ERROR_ATTEMPTS);
+        for (quint32 i = 0;  i < d_ptr->iSyncRetriesInfo.retries(); ++i)
+        {
+            qint32 nextInt = d_ptr->iSyncRetriesInfo.nextInterval();
+            if(-1 != nextInt)
+            {
+                aWriter.writeStartElement(TAG_ATTEMPT_DELAY);
+                aWriter.writeAttribute(ATTR_VALUE, QString::number(nextInt));
+                aWriter.writeEndElement();
+            }
+        }
+        aWriter.writeEndElement();
+        d_ptr->iSyncRetriesInfo.init();
+    }
+    aWriter.writeEndElement();
+}
+
 void SyncProfile::setName(const QString &aName)
 {
   // sets the name in the super class Profile.
@@ -349,6 +348,7 @@ SyncSchedule SyncProfile::syncSchedule() const
 void SyncProfile::setSyncSchedule(const SyncSchedule &aSchedule)
 {
     d_ptr->iSchedule = aSchedule;
+    setModified(true);
 }
 
 QStringList SyncProfile::storageBackendNames() const
@@ -128,6 +128,13 @@ public:
      */
     explicit SyncProfile(const QDomElement &aRoot);
 
+    /*! \brief Constructs a SyncProfile from an XML stream.
+     *
+     * \param aReader Reader positioned at the start element of the profile.
+     *  On return the reader is positioned at the matching end element.
+     */
+    explicit SyncProfile(QXmlStreamReader &aReader);
+
     /*! \brief Copy constructor.
      *
      * \param aSource Copy source.
@@ -156,6 +163,9 @@ public:
     //! \see Profile::toXml
     virtual QDomElement toXml(QDomDocument &aDoc, bool aLocalOnly = true) const;
 
+    //! \see Profile::toXml
+    virtual void toXml(QXmlStreamWriter &aWriter, bool aLocalOnly = true) const;
+
     /*! \brief Checks if schedule is controlled by a external process (e.g always-up-to-date).
      *
      * \return True if schedule is controlled by a external process. External process will control the sync,
@@ -385,6 +395,8 @@ private:
     SyncProfile& operator=(const SyncProfile &aRhs);
 
     SyncProfilePrivate *d_ptr;
+
+    friend class ProfileSnapshot;
 };
 
 }
@@ -0,0 +1,98 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ * Copyright (C) 2014-2015 Jolla Ltd
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef SYNCPROFILE_P_H
+#define SYNCPROFILE_P_H
+
+#include <QList>
+#include "SyncLog.h"
+#include "SyncSchedule.h"
+
+namespace Buteo {
+
+//! Private implementation class for SyncProfile.
+class SyncProfilePrivate
+{
+public:
+    SyncProfilePrivate();
+
+    SyncProfilePrivate(const SyncProfilePrivate &aSource);
+
+    ~SyncProfilePrivate();
+
+    SyncLog *iLog;
+
+    SyncSchedule iSchedule;
+
+    struct SyncRetriesInfo
+    {
+        QList<quint32> iRetryIntervals;
+        quint32 iIntervalIndex;
+
+        void init()
+        {
+            iIntervalIndex = 0;
+        }
+
+        void addInterval(quint32 interval)
+        {
+            iRetryIntervals.append(interval);
+        }
+
+        quint32 retries()
+        {
+            return iRetryIntervals.count();
+        }
+
+        qint32 nextInterval()
+        {
+            qint32 next = -1;
+            if(iIntervalIndex < retries())
+            {
+                next = iRetryIntervals.at(iIntervalIndex);
+                ++iIntervalIndex;
+            }
+            return next;
+        }
+
+        QList<quint32> intervals()
+        {
+            return iRetryIntervals;
+        }
+
+        SyncRetriesInfo& operator=(const SyncRetriesInfo& rhs)
+        {
+            if(this != &rhs)
+            {
+                iIntervalIndex = rhs.iIntervalIndex;
+                iRetryIntervals = rhs.iRetryIntervals;
+            }
+            return *this;
+        }
+    }iSyncRetriesInfo;
+};
+
+}
+
+#endif // SYNCPROFILE_P_H
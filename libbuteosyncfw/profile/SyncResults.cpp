@@ -23,8 +23,11 @@
 #include "SyncResults.h"
 #include "LogMacros.h"
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include "ProfileEngineDefs.h"
+#include "ProfileXmlWriter.h"
 
 
 namespace Buteo {
@@ -116,6 +119,28 @@ SyncResults::SyncResults(const QDomElement &aRoot)
     }
 }
 
+SyncResults::SyncResults(QXmlStreamReader &aReader)
+:   d_ptr(new SyncResultsPrivate())
+{
+    QXmlStreamAttributes attributes = aReader.attributes();
+    d_ptr->iTime = QDateTime::fromString(attributes.value(ATTR_TIME).toString(), Qt::ISODate);
+    d_ptr->iMajorCode = attributes.value(ATTR_MAJOR_CODE).toInt();
+    d_ptr->iMinorCode = attributes.value(ATTR_MINOR_CODE).toInt();
+    d_ptr->iScheduled = (attributes.value(KEY_SYNC_SCHEDULED) == BOOLEAN_TRUE);
+
+    while (aReader.readNextStartElement())
+    {
+        if (aReader.name() == TAG_TARGET_RESULTS)
+        {
+            d_ptr->iTargetResults.append(TargetResults(aReader));
+        }
+        else
+        {
+            aReader.skipCurrentElement();
+        }
+    }
+}
+
 SyncResults::~SyncResults()
 {
     delete d_ptr;
@@ -150,17 +175,32 @@ QDomElement SyncResults::toXml(QDomDocument &aDoc) const
     return root;
 }
 
+void SyncResults::toXml(QXmlStreamWriter &aWriter) const
+{
+    aWriter.writeStartElement(TAG_SYNC_RESULTS);
+    aWriter.writeAttribute(ATTR_TIME, d_ptr->iTime.toString(Qt::ISODate));
+    aWriter.writeAttribute(ATTR_MAJOR_CODE, QString::number(d_ptr->iMajorCode));
+    aWriter.writeAttribute(ATTR_MINOR_CODE, QString::number(d_ptr->iMinorCode));
+    aWriter.writeAttribute(KEY_SYNC_SCHEDULED, d_ptr->iScheduled ? BOOLEAN_TRUE :
+        BOOLEAN_FALSE);
+
+    foreach (const TargetResults &tr, d_ptr->iTargetResults)
+    {
+        tr.toXml(aWriter);
+    }
+
+    aWriter.writeEndElement();
+}
+
 QString SyncResults::toString() const
 {
-    QDomDocument doc;
-    QDomProcessingInstruction xmlHeading =
-        doc.createProcessingInstruction("xml",
-        "version=\"1.0\" encoding=\"UTF-8\"");
-    doc.appendChild(xmlHeading);
-    QDomElement root = toXml(doc);
-    doc.appendChild(root);
+    QString xml;
+    QXmlStreamWriter writer(&xml);
+    beginXmlDocument(writer);
+    toXml(writer);
+    endXmlDocument(writer);
 
-    return doc.toString(PROFILE_INDENT);
+    return xml;
 }
 
 
@@ -29,6 +29,8 @@
 
 class QDomDocument;
 class QDomElement;
+class QXmlStreamReader;
+class QXmlStreamWriter;
 
 namespace Buteo {
 
@@ -132,6 +134,13 @@ public:
      */
     explicit SyncResults(const QDomElement &aRoot);
 
+    /*! \brief Constructs a SyncResults from an XML stream.
+     *
+     * \param aReader Reader positioned at the start element of the results.
+     *  On return the reader is positioned at the matching end element.
+     */
+    explicit SyncResults(QXmlStreamReader &aReader);
+
     /*! \brief Destructor.
      */
     ~SyncResults();
@@ -151,6 +160,13 @@ public:
      */
     QDomElement toXml(QDomDocument &aDoc) const;
 
+    /*! \brief Writes the results as XML to a stream.
+     *
+     * The output is the same as for the QDomDocument version.
+     * \param aWriter Writer to write the XML element with.
+     */
+    void toXml(QXmlStreamWriter &aWriter) const;
+
     /*! \brief Exports the sync results to QString.
      *
      * \return return the Results as xml formatted string
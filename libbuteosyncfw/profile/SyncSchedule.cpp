@@ -24,8 +24,11 @@
 #include "SyncSchedule.h"
 #include "SyncSchedule_p.h"
 #include "ProfileEngineDefs.h"
+#include "ProfileXmlWriter.h"
 #include "LogMacros.h"
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 #include <QStringList>
 
 using namespace Buteo;
@@ -89,6 +92,39 @@ SyncSchedule::SyncSchedule(const QDomElement &aRoot)
     }
 }
 
+SyncSchedule::SyncSchedule(QXmlStreamReader &aReader)
+:   d_ptr(new SyncSchedulePrivate())
+{
+    QXmlStreamAttributes attributes = aReader.attributes();
+    d_ptr->iTime = QTime::fromString(attributes.value(ATTR_TIME).toString(), Qt::ISODate);
+    d_ptr->iInterval = attributes.value(ATTR_INTERVAL).toUInt();
+    d_ptr->iEnabled = (attributes.value(ATTR_ENABLED) == BOOLEAN_TRUE);
+    d_ptr->iDays = d_ptr->parseDays(attributes.value(ATTR_DAYS).toString());
+    d_ptr->iScheduleConfiguredTime = QDateTime::fromString(
+            attributes.value(ATTR_SYNC_CONFIGURE).toString(), Qt::ISODate);
+
+    d_ptr->iRushEnabled = false;
+    d_ptr->iExternalRushEnabled = false;
+    d_ptr->iRushInterval = 0;
+
+    bool rushRead = false;
+    while (aReader.readNextStartElement())
+    {
+        if (aReader.name() == TAG_RUSH && !rushRead)
+        {
+            QXmlStreamAttributes rush = aReader.attributes();
+            d_ptr->iRushEnabled = (rush.value(ATTR_ENABLED) == BOOLEAN_TRUE);
+            d_ptr->iExternalRushEnabled = (rush.value(ATTR_EXTERNAL_SYNC) == BOOLEAN_TRUE);
+            d_ptr->iRushInterval = rush.value(ATTR_INTERVAL).toUInt();
+            d_ptr->iRushBegin = QTime::fromString(rush.value(ATTR_BEGIN).toString(), Qt::ISODate);
+            d_ptr->iRushEnd = QTime::fromString(rush.value(ATTR_END).toString(), Qt::ISODate);
+            d_ptr->iRushDays = d_ptr->parseDays(rush.value(ATTR_DAYS).toString());
+            rushRead = true;
+        } // no else
+        aReader.skipCurrentElement();
+    }
+}
+
 SyncSchedule::~SyncSchedule()
 {
     delete d_ptr;
@@ -154,17 +190,39 @@ QDomElement SyncSchedule::toXml(QDomDocument &aDoc) const
     return root;
 }
 
+void SyncSchedule::toXml(QXmlStreamWriter &aWriter) const
+{
+    aWriter.writeStartElement(TAG_SCHEDULE);
+    aWriter.writeAttribute(ATTR_ENABLED, d_ptr->iEnabled ? BOOLEAN_TRUE :
+        BOOLEAN_FALSE);
+    aWriter.writeAttribute(ATTR_TIME, d_ptr->iTime.toString(Qt::ISODate));
+    aWriter.writeAttribute(ATTR_INTERVAL, QString::number(d_ptr->iInterval));
+    aWriter.writeAttribute(ATTR_DAYS, d_ptr->createDays(d_ptr->iDays));
+    aWriter.writeAttribute(ATTR_SYNC_CONFIGURE,d_ptr->iScheduleConfiguredTime.toString(Qt::ISODate));
+
+    aWriter.writeStartElement(TAG_RUSH);
+    aWriter.writeAttribute(ATTR_ENABLED, d_ptr->iRushEnabled ? BOOLEAN_TRUE :
+        BOOLEAN_FALSE);
+    aWriter.writeAttribute(ATTR_EXTERNAL_SYNC, d_ptr->iExternalRushEnabled ? BOOLEAN_TRUE :
+        BOOLEAN_FALSE);
+    aWriter.writeAttribute(ATTR_INTERVAL, QString::number(d_ptr->iRushInterval));
+    aWriter.writeAttribute(ATTR_BEGIN, d_ptr->iRushBegin.toString(Qt::ISODate));
+    aWriter.writeAttribute(ATTR_END, d_ptr->iRushEnd.toString(Qt::ISODate));
+    aWriter.writeAttribute(ATTR_DAYS, d_ptr->createDays(d_ptr->iRushDays));
+    aWriter.writeEndElement();
+
+    aWriter.writeEndElement();
+}
+
 QString SyncSchedule::toString() const
 {
-    QDomDocument doc;
-    QDomProcessingInstruction xmlHeading =
-        doc.createProcessingInstruction("xml",
-        "version=\"1.0\" encoding=\"UTF-8\"");
-    doc.appendChild(xmlHeading);
-    QDomElement root = toXml(doc);
-    doc.appendChild(root);
+    QString xml;
+    QXmlStreamWriter writer(&xml);
+    beginXmlDocument(writer);
+    toXml(writer);
+    endXmlDocument(writer);
 
-    return doc.toString(PROFILE_INDENT);
+    return xml;
 }
 
 DaySet SyncSchedule::days() const
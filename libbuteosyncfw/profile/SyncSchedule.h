@@ -29,6 +29,8 @@
 
 class QDomDocument;
 class QDomElement;
+class QXmlStreamReader;
+class QXmlStreamWriter;
 
 namespace Buteo {
 
@@ -69,6 +71,13 @@ public:
      */
     explicit SyncSchedule(const QDomElement &aRoot);
 
+    /*! \brief Constructs a SyncSchedule from an XML stream.
+     *
+     * \param aReader Reader positioned at the start element of the schedule.
+     *  On return the reader is positioned at the matching end element.
+     */
+    explicit SyncSchedule(QXmlStreamReader &aReader);
+
     /*! \brief Destructor.
      */
     ~SyncSchedule();
@@ -92,6 +101,13 @@ public:
      */
     QDomElement toXml(QDomDocument &aDoc) const;
 
+    /*! \brief Writes the schedule as XML to a stream.
+     *
+     * The output is the same as for the QDomDocument version.
+     * \param aWriter Writer to write the XML element with.
+     */
+    void toXml(QXmlStreamWriter &aWriter) const;
+
 	/*! \brief Exports the sync schedule to QString.
      *
      * \return return the Schedule as xml formatted string
@@ -23,6 +23,8 @@
 #include "TargetResults.h"
 #include "ProfileEngineDefs.h"
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 namespace Buteo {
     
@@ -93,6 +95,34 @@ TargetResults::TargetResults(const QDomElement &aRoot)
     } // no else
 }
 
+TargetResults::TargetResults(QXmlStreamReader &aReader)
+:   d_ptr(new TargetResultsPrivate())
+{
+    d_ptr->iTargetName = aReader.attributes().value(ATTR_NAME).toString();
+
+    bool localRead = false;
+    bool remoteRead = false;
+    while (aReader.readNextStartElement())
+    {
+        QXmlStreamAttributes attributes = aReader.attributes();
+        if (aReader.name() == TAG_LOCAL && !localRead)
+        {
+            d_ptr->iLocalItems.added = attributes.value(ATTR_ADDED).toUInt();
+            d_ptr->iLocalItems.deleted = attributes.value(ATTR_DELETED).toUInt();
+            d_ptr->iLocalItems.modified = attributes.value(ATTR_MODIFIED).toUInt();
+            localRead = true;
+        }
+        else if (aReader.name() == TAG_REMOTE && !remoteRead)
+        {
+            d_ptr->iRemoteItems.added = attributes.value(ATTR_ADDED).toUInt();
+            d_ptr->iRemoteItems.deleted = attributes.value(ATTR_DELETED).toUInt();
+            d_ptr->iRemoteItems.modified = attributes.value(ATTR_MODIFIED).toUInt();
+            remoteRead = true;
+        } // no else
+        aReader.skipCurrentElement();
+    }
+}
+
 TargetResults::~TargetResults()
 {
     delete d_ptr;
@@ -130,6 +160,26 @@ QDomElement TargetResults::toXml(QDomDocument &aDoc) const
     return root;
 }
 
+void TargetResults::toXml(QXmlStreamWriter &aWriter) const
+{
+    aWriter.writeStartElement(TAG_TARGET_RESULTS);
+    aWriter.writeAttribute(ATTR_NAME, d_ptr->iTargetName);
+
+    aWriter.writeStartElement(TAG_LOCAL);
+    aWriter.writeAttribute(ATTR_ADDED, QString::number(d_ptr->iLocalItems.added));
+    aWriter.writeAttribute(ATTR_DELETED, QString::number(d_ptr->iLocalItems.deleted));
+    aWriter.writeAttribute(ATTR_MODIFIED, QString::number(d_ptr->iLocalItems.modified));
+    aWriter.writeEndElement();
+
+    aWriter.writeStartElement(TAG_REMOTE);
+    aWriter.writeAttribute(ATTR_ADDED, QString::number(d_ptr->iRemoteItems.added));
+    aWriter.writeAttribute(ATTR_DELETED, QString::number(d_ptr->iRemoteItems.deleted));
+    aWriter.writeAttribute(ATTR_MODIFIED, QString::number(d_ptr->iRemoteItems.modified));
+    aWriter.writeEndElement();
+
+    aWriter.writeEndElement();
+}
+
 QString TargetResults::targetName() const
 {
     return d_ptr->iTargetName;
@@ -27,6 +27,8 @@
 
 class QDomDocument;
 class QDomElement;
+class QXmlStreamReader;
+class QXmlStreamWriter;
 
 namespace Buteo {
 
@@ -80,6 +82,13 @@ public:
      */
     explicit TargetResults(const QDomElement &aRoot);
 
+    /*! \brief Constructs a TargetResults from an XML stream.
+     *
+     * \param aReader Reader positioned at the start element of the results.
+     *  On return the reader is positioned at the matching end element.
+     */
+    explicit TargetResults(QXmlStreamReader &aReader);
+
     /*! \brief Destructor.
      */
     ~TargetResults();
@@ -99,6 +108,13 @@ public:
      */
     QDomElement toXml(QDomDocument &aDoc) const;
 
+    /*! \brief Writes the target results as XML to a stream.
+     *
+     * The output is the same as for the QDomDocument version.
+     * \param aWriter Writer to write the XML element with.
+     */
+    void toXml(QXmlStreamWriter &aWriter) const;
+
     /*! \brief Gets the target name.
      *
      * \return Target name.
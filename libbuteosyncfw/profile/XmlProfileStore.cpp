@@ -0,0 +1,404 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "XmlProfileStore.h"
+
+#include <QDir>
+#include <QFile>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "Profile.h"
+#include "ProfileCache.h"
+#include "ProfileXmlWriter.h"
+#include "SyncLog.h"
+#include "SyncLogJournal.h"
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+static const QString FORMAT_EXT = ".xml";
+static const QString BACKUP_EXT = ".bak";
+static const QString LOG_EXT = ".log";
+static const QString LOG_DIRECTORY = "logs";
+
+XmlProfileStore::XmlProfileStore(const QString &aPrimaryPath,
+                                 const QString &aSecondaryPath,
+                                 QSharedPointer<ProfileCache> aCache)
+:   iPrimaryPath(aPrimaryPath),
+    iSecondaryPath(aSecondaryPath),
+    iCache(aCache)
+{
+}
+
+XmlProfileStore::~XmlProfileStore()
+{
+}
+
+QStringList XmlProfileStore::profileNames(const QString &aType)
+{
+    // Primary directory first, then names only found in the secondary one.
+    return iCache->profileNames(aType);
+}
+
+bool XmlProfileStore::contains(const QString &aName, const QString &aType)
+{
+    return !iCache->profilePath(aName, aType).isEmpty();
+}
+
+bool XmlProfileStore::isWritable(const QString &aName, const QString &aType)
+{
+    return iCache->isPrimaryProfile(aName, aType);
+}
+
+Profile *XmlProfileStore::load(const QString &aName, const QString &aType)
+{
+    return parseFile(findProfileFile(aName, aType));
+}
+
+bool XmlProfileStore::save(const Profile &aProfile, bool aDeferred)
+{
+    FUNCTION_CALL_TRACE;
+
+    // Create path for the new profile file.
+    QDir dir;
+    dir.mkpath(iPrimaryPath + QDir::separator() + aProfile.type());
+    const QString profilePath = primaryFile(aProfile.name(), aProfile.type());
+
+    const QByteArray data = profileData(aProfile);
+
+    const bool exists = iCache->isPrimaryProfile(aProfile.name(), aProfile.type());
+    bool profileWritten = false;
+    if (aDeferred && exists)
+    {
+        iCache->writeQueue()->enqueue(profilePath, data);
+        profileWritten = true;
+    }
+    else
+    {
+        profileWritten = iCache->writeQueue()->write(profilePath, data);
+        if (profileWritten && !exists)
+        {
+            iCache->addToListing(aProfile.name(), aProfile.type());
+        } // no else
+    }
+
+    return profileWritten;
+}
+
+bool XmlProfileStore::remove(const QString &aName, const QString &aType)
+{
+    FUNCTION_CALL_TRACE;
+
+    const QString filePath = primaryFile(aName, aType);
+
+    iCache->writeQueue()->discard(filePath);
+    const bool success = QFile::remove(filePath);
+    iCache->fileWritten(filePath);
+    if (success)
+    {
+        iCache->removeFromListing(aName, aType);
+        //Initial the will be no log this will fail.
+        QFile::remove(logFile(aName));
+        iCache->fileWritten(logFile(aName));
+        SyncLogJournal journal(logDirectory());
+        journal.remove(aName);
+        iCache->fileWritten(journal.filePath(aName));
+    } // no else
+
+    return success;
+}
+
+bool XmlProfileStore::rename(const QString &aName, const QString &aNewName)
+{
+    FUNCTION_CALL_TRACE;
+
+    // Only complete files are renamed.
+    flush();
+
+    // Merge journaled results into the log file, so that only complete log
+    // files need to be renamed.
+    SyncLogJournal journal(logDirectory());
+    if (journal.exists(aName))
+    {
+        compactLog(aName);
+    } // no else
+
+    // Rename the sync profile
+    const QString source = primaryFile(aName, Profile::TYPE_SYNC);
+    const QString destination = primaryFile(aNewName, Profile::TYPE_SYNC);
+    bool ret = QFile::rename(source, destination);
+    if (true == ret)
+    {
+        // Rename the sync log
+        ret = QFile::rename(logFile(aName), logFile(aNewName));
+        if (false == ret)
+        {
+            // Roll back the earlier rename
+            QFile::rename(destination, source);
+        }
+    }
+
+    foreach (const QString &path, QStringList() << source << destination
+                                                << logFile(aName)
+                                                << logFile(aNewName))
+    {
+        iCache->fileWritten(path);
+    }
+
+    if (true == ret)
+    {
+        iCache->removeFromListing(aName, Profile::TYPE_SYNC);
+        iCache->addToListing(aNewName, Profile::TYPE_SYNC);
+    } // no else
+
+    return ret;
+}
+
+SyncLog *XmlProfileStore::loadLog(const QString &aProfileName)
+{
+    const QString fileName = logFile(aProfileName);
+    SyncLogJournal journal(logDirectory());
+
+    SyncLog *log = 0;
+    if (QFile::exists(fileName))
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            LOG_WARNING("Failed to open sync log file for reading:"
+                    << file.fileName());
+            return 0;
+        } // no else
+
+        QXmlStreamReader reader(&file);
+        if (reader.readNextStartElement())
+        {
+            log = new SyncLog(reader);
+        } // no else
+        if (!readToEnd(reader) || log == 0) {
+            file.close();
+            LOG_WARNING("Failed to parse XML from sync log file:"
+                    << file.fileName());
+            delete log;
+            return 0;
+        } // no else
+        file.close();
+    }
+    else if (journal.exists(aProfileName))
+    {
+        log = new SyncLog(aProfileName);
+    }
+    else
+    {
+        LOG_DEBUG("No sync log found for profile:" << aProfileName);
+        return 0;
+    }
+
+    // Results recorded after the log file was written.
+    journal.replay(aProfileName, *log);
+
+    return log;
+}
+
+bool XmlProfileStore::saveLog(const SyncLog &aLog)
+{
+    QDir dir;
+    dir.mkpath(logDirectory());
+    const QString logPath = logFile(aLog.profileName());
+
+    QByteArray data;
+    QXmlStreamWriter writer(&data);
+    beginXmlDocument(writer);
+    aLog.toXml(writer);
+    endXmlDocument(writer);
+
+    if (!ProfileWriteQueue::writeFile(logPath, data))
+    {
+        LOG_WARNING("Failed to write sync log file:" << logPath);
+        return false;
+    } // no else
+    iCache->fileWritten(logPath);
+
+    // The log file now contains everything that was journaled.
+    SyncLogJournal journal(logDirectory());
+    journal.remove(aLog.profileName());
+    iCache->fileWritten(journal.filePath(aLog.profileName()));
+
+    return true;
+}
+
+bool XmlProfileStore::appendResults(const QString &aProfileName,
+                                    const SyncResults &aResults)
+{
+    // Record the results without loading the profile or its log.
+    SyncLogJournal journal(logDirectory());
+    qint64 journalSize = 0;
+    if (!journal.append(aProfileName, aResults, journalSize))
+        return false;
+    iCache->fileWritten(journal.filePath(aProfileName));
+
+    if (journalSize > SyncLogJournal::COMPACT_SIZE)
+    {
+        compactLog(aProfileName);
+    } // no else
+
+    return true;
+}
+
+bool XmlProfileStore::flush()
+{
+    return iCache->writeQueue()->flush();
+}
+
+bool XmlProfileStore::compactLog(const QString &aProfileName)
+{
+    FUNCTION_CALL_TRACE;
+
+    SyncLog *log = loadLog(aProfileName);
+    if (log == 0)
+        return false;
+
+    bool success = saveLog(*log);
+    delete log;
+    log = 0;
+
+    return success;
+}
+
+QString XmlProfileStore::logDirectory() const
+{
+    return iPrimaryPath + QDir::separator() + Profile::TYPE_SYNC +
+            QDir::separator() + LOG_DIRECTORY;
+}
+
+QString XmlProfileStore::logFile(const QString &aProfileName) const
+{
+    return logDirectory() + QDir::separator() + aProfileName + LOG_EXT +
+            FORMAT_EXT;
+}
+
+QString XmlProfileStore::primaryFile(const QString &aName,
+                                     const QString &aType) const
+{
+    return iPrimaryPath + QDir::separator() + aType + QDir::separator() +
+            aName + FORMAT_EXT;
+}
+
+Profile *XmlProfileStore::parseFile(const QString &aPath)
+{
+    //FUNCTION_CALL_TRACE;
+
+    Profile *profile = 0;
+
+    const QByteArray pending = iCache->writeQueue()->pending(aPath);
+    if (!pending.isNull())
+    {
+        QXmlStreamReader reader(pending);
+        profile = parseProfile(reader, aPath);
+    }
+    else if (QFile::exists(aPath))
+    {
+        QFile file(aPath);
+
+        if (file.open(QIODevice::ReadOnly))
+        {
+            QXmlStreamReader reader(&file);
+            profile = parseProfile(reader, aPath);
+            file.close();
+        }
+        else {
+            LOG_WARNING("Failed to open profile file for reading:" << aPath);
+        }
+    }
+    else
+    {
+        LOG_WARNING("Profile file not found:" << aPath);
+    }
+
+    return profile;
+}
+
+void XmlProfileStore::migrateBackups()
+{
+    FUNCTION_CALL_TRACE;
+
+    QDir primaryDir(iPrimaryPath);
+    foreach (const QString &type, primaryDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QDir typeDir(primaryDir.filePath(type));
+        const QStringList leftovers = typeDir.entryList(QStringList()
+                << "*" + FORMAT_EXT + BACKUP_EXT
+                << "*" + FORMAT_EXT + ProfileWriteQueue::TEMP_EXT,
+                QDir::Files);
+        foreach (const QString &fileName, leftovers)
+        {
+            const QString path = typeDir.filePath(fileName);
+            if (fileName.endsWith(ProfileWriteQueue::TEMP_EXT))
+            {
+                LOG_DEBUG("Removing unfinished profile write:" << path);
+                QFile::remove(path);
+                continue;
+            } // no else
+
+            QString profilePath = path;
+            profilePath.chop(BACKUP_EXT.length());
+            LOG_WARNING("Profile backup file found:" << path);
+
+            // The backup holds the contents from before the interrupted
+            // save. It is only needed if the profile file did not survive.
+            Profile *profile = parseFile(profilePath);
+            if (profile == 0)
+            {
+                Profile *backup = parseFile(path);
+                if (backup != 0)
+                {
+                    LOG_DEBUG("Restoring profile from backup");
+                    QFile::remove(profilePath);
+                    QFile::rename(path, profilePath);
+                    delete backup;
+                    backup = 0;
+                }
+                else
+                {
+                    LOG_WARNING("Failed to parse backup file");
+                }
+            } // no else
+            delete profile;
+            profile = 0;
+
+            QFile::remove(path);
+        }
+    }
+}
+
+QString XmlProfileStore::findProfileFile(const QString &aName, const QString &aType)
+{
+    QString path = iCache->profilePath(aName, aType);
+    if (path.isEmpty())
+    {
+        path = primaryFile(aName, aType);
+    } // no else
+
+    return path;
+}
@@ -0,0 +1,158 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef XMLPROFILESTORE_H
+#define XMLPROFILESTORE_H
+
+#include <QSharedPointer>
+
+#include "ProfileStore.h"
+
+namespace Buteo {
+
+class ProfileCache;
+
+/*! \brief Stores profiles as one XML file per profile.
+ *
+ * Profiles are written to the primary path, in a directory per profile
+ * type. Profiles only found in the secondary path are read-only. Sync logs
+ * are XML files in the logs directory of the sync profiles, with a results
+ * journal next to each log file.
+ *
+ * Directory listings and the write-behind queue are shared with the profile
+ * cache of the same paths.
+ */
+class XmlProfileStore : public ProfileStore
+{
+public:
+
+    /*! \brief Constructor.
+     *
+     * \param aPrimaryPath Path of the writable profiles.
+     * \param aSecondaryPath Path of the read-only system profiles.
+     * \param aCache Profile cache of the same paths.
+     */
+    XmlProfileStore(const QString &aPrimaryPath, const QString &aSecondaryPath,
+                    QSharedPointer<ProfileCache> aCache);
+
+    //! \brief Destructor.
+    virtual ~XmlProfileStore();
+
+    /*! \brief Resolves profile backups left behind by older versions.
+     *
+     * Profiles used to be saved by copying the old file to a .bak file and
+     * rewriting the profile in place. A leftover backup means that a save
+     * was interrupted: the profile is restored from the backup if the
+     * profile file itself is damaged, and the backup is removed. Temporary
+     * files of interrupted atomic writes are removed also.
+     */
+    void migrateBackups();
+
+    //! \see ProfileStore::profileNames
+    virtual QStringList profileNames(const QString &aType);
+
+    //! \see ProfileStore::contains
+    virtual bool contains(const QString &aName, const QString &aType);
+
+    //! \see ProfileStore::isWritable
+    virtual bool isWritable(const QString &aName, const QString &aType);
+
+    /*! \brief Reads a profile file.
+     *
+     * Contents queued for the file in the write-behind queue are parsed
+     * instead of the file itself.
+     * \see ProfileStore::load
+     */
+    virtual Profile *load(const QString &aName, const QString &aType);
+
+    /*! \brief Writes a profile to its file in the primary path.
+     *
+     * New profiles are always written right away, so that listing the
+     * profile directories finds them. Deferred updates go through the
+     * write-behind queue.
+     * \see ProfileStore::save
+     */
+    virtual bool save(const Profile &aProfile, bool aDeferred);
+
+    //! \see ProfileStore::remove
+    virtual bool remove(const QString &aName, const QString &aType);
+
+    //! \see ProfileStore::rename
+    virtual bool rename(const QString &aName, const QString &aNewName);
+
+    /*! \brief Reads the sync log file and replays the results journal on it.
+     *
+     * \see ProfileStore::loadLog
+     */
+    virtual SyncLog *loadLog(const QString &aProfileName);
+
+    /*! \brief Writes a complete sync log file.
+     *
+     * The results journal of the profile is merged into the file, so it is
+     * removed after the write.
+     * \see ProfileStore::saveLog
+     */
+    virtual bool saveLog(const SyncLog &aLog);
+
+    /*! \brief Appends the results to the journal of the profile.
+     *
+     * The journal is compacted into the log file when it grows too large.
+     * \see ProfileStore::appendResults
+     */
+    virtual bool appendResults(const QString &aProfileName,
+                               const SyncResults &aResults);
+
+    //! \see ProfileStore::flush
+    virtual bool flush();
+
+private:
+
+    // Reads a profile file, or its contents queued for writing.
+    Profile *parseFile(const QString &aPath);
+
+    // Gets the file of a profile. Profiles not found are looked for in the
+    // primary path.
+    QString findProfileFile(const QString &aName, const QString &aType);
+
+    // Gets the path of a profile file in the primary path.
+    QString primaryFile(const QString &aName, const QString &aType) const;
+
+    // Gets the path of the sync log file of a profile.
+    QString logFile(const QString &aProfileName) const;
+
+    // Writes the journaled results of a profile into its log file.
+    bool compactLog(const QString &aProfileName);
+
+    // Gets the directory of the sync log files.
+    QString logDirectory() const;
+
+    QString iPrimaryPath;
+
+    QString iSecondaryPath;
+
+    QSharedPointer<ProfileCache> iCache;
+};
+
+}
+
+#endif // XMLPROFILESTORE_H
@@ -308,6 +308,26 @@ QList<SyncProfile*> AccountsHelper::getProfilesByAccountId(Accounts::AccountId i
     return iProfileManager.getSyncProfilesByData(filters);
 }
 
+QStringList AccountsHelper::getProfileNamesByAccountId(Accounts::AccountId id)
+{
+    FUNCTION_CALL_TRACE;
+    QList<ProfileManager::SearchCriteria> filters;
+    ProfileManager::SearchCriteria filter;
+    filter.iType = ProfileManager::SearchCriteria::EQUAL;
+    filter.iKey = KEY_ACCOUNT_ID;
+    filter.iValue = QString::number(id);
+    filters.append(filter);
+
+    QStringList names;
+    const QList<ProfileManager::ProfileRow> rows =
+        iProfileManager.queryProfiles(filters, ProfileManager::Projection());
+    foreach (const ProfileManager::ProfileRow &row, rows)
+    {
+        names.append(row.iName);
+    }
+    return names;
+}
+
 void AccountsHelper::createProfileForAccount(Accounts::Account *account,
                                              const QString profileName,
                                              const SyncProfile *baseProfile)
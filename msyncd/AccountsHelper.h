@@ -24,6 +24,7 @@
 #define ACCOUNTSHELPER_H
 
 #include <QObject>
+#include <QStringList>
 
 #include <Accounts/manager.h>
 #include <Accounts/account.h>
@@ -66,6 +67,14 @@ public:
      */
     QList<SyncProfile*> getProfilesByAccountId(Accounts::AccountId id);
 
+    /*! \brief Returns names of the sync profiles of a given account ID
+     *
+     * Cheaper than getProfilesByAccountId(), no profiles are constructed.
+     * \param id - The account ID.
+     * \return Names of the sync profiles.
+     */
+    QStringList getProfileNamesByAccountId(Accounts::AccountId id);
+
 public Q_SLOTS:
 
     /*! \brief This method is used to create a profile for a specified
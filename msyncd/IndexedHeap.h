@@ -0,0 +1,222 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef INDEXEDHEAP_H
+#define INDEXEDHEAP_H
+
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+namespace Buteo {
+
+/*! \brief Binary min-heap with an index from item keys to heap positions.
+ *
+ * Adding an item, and taking out the first item or any item by its key,
+ * takes logarithmic time. The index makes looking up an item by key
+ * constant time.
+ *
+ * The traits class gives the order and the keys of the items:
+ * \code
+ * static bool lessThan(const T &aLeft, const T &aRight);
+ * static Key key(const T &aItem);
+ * \endcode
+ * Keys must be unique within the heap.
+ */
+template <typename Key, typename T, typename Traits>
+class IndexedHeap
+{
+public:
+
+    /*! \brief Checks if the heap is empty.
+     *
+     * \return Is the heap empty.
+     */
+    bool isEmpty() const { return iHeap.isEmpty(); }
+
+    /*! \brief Number of items in the heap.
+     *
+     * \return Number of items.
+     */
+    int size() const { return iHeap.size(); }
+
+    /*! \brief Checks if an item with a key is in the heap.
+     *
+     * \param aKey Key of the item.
+     * \return Is the item in the heap.
+     */
+    bool contains(const Key &aKey) const { return iIndex.contains(aKey); }
+
+    /*! \brief Gets the keys of all items.
+     *
+     * \return Keys in no particular order.
+     */
+    QList<Key> keys() const { return iIndex.keys(); }
+
+    /*! \brief Gets the first item. The heap must not be empty.
+     *
+     * \return The least item.
+     */
+    const T &first() const { return iHeap.first(); }
+
+    /*! \brief Gets the item with a key.
+     *
+     * \param aKey Key of the item.
+     * \return The item. 0 if no item has the key.
+     */
+    const T *find(const Key &aKey) const
+    {
+        const int pos = iIndex.value(aKey, -1);
+        return (pos >= 0) ? &iHeap.at(pos) : 0;
+    }
+
+    /*! \brief Adds an item.
+     *
+     * \param aItem Item to add. No item with the same key may be queued.
+     */
+    void insert(const T &aItem)
+    {
+        iHeap.append(aItem);
+        iIndex.insert(Traits::key(aItem), iHeap.size() - 1);
+        siftUp(iHeap.size() - 1);
+    }
+
+    /*! \brief Replaces the contents of the heap.
+     *
+     * Builds the heap bottom-up, which takes linear time.
+     * \param aItems Items in any order, with unique keys.
+     */
+    void assign(const QVector<T> &aItems)
+    {
+        iHeap = aItems;
+        iIndex.clear();
+        for (int i = 0; i < iHeap.size(); ++i)
+        {
+            iIndex.insert(Traits::key(iHeap.at(i)), i);
+        }
+        for (int i = iHeap.size() / 2 - 1; i >= 0; --i)
+        {
+            siftDown(i);
+        }
+    }
+
+    /*! \brief Removes the first item and returns it. The heap must not be
+     * empty.
+     *
+     * \return The least item.
+     */
+    T takeFirst() { return removeAt(0); }
+
+    /*! \brief Removes the item with a key and returns it. The item must be
+     * in the heap.
+     *
+     * \param aKey Key of the item.
+     * \return The removed item.
+     */
+    T take(const Key &aKey) { return removeAt(iIndex.value(aKey)); }
+
+    //! \brief Removes all items.
+    void clear()
+    {
+        iHeap.clear();
+        iIndex.clear();
+    }
+
+private:
+
+    T removeAt(int aPos)
+    {
+        const T item = iHeap.at(aPos);
+        iIndex.remove(Traits::key(item));
+
+        const T last = iHeap.last();
+        iHeap.removeLast();
+        if (aPos < iHeap.size())
+        {
+            // Move the last item to the hole and restore the heap order in
+            // whichever direction it is broken.
+            place(last, aPos);
+            siftUp(aPos);
+            siftDown(iIndex.value(Traits::key(last)));
+        } // no else
+
+        return item;
+    }
+
+    void siftUp(int aPos)
+    {
+        const T item = iHeap.at(aPos);
+        while (aPos > 0)
+        {
+            const int parent = (aPos - 1) / 2;
+            if (!Traits::lessThan(item, iHeap.at(parent)))
+            {
+                break;
+            } // no else
+            place(iHeap.at(parent), aPos);
+            aPos = parent;
+        }
+        place(item, aPos);
+    }
+
+    void siftDown(int aPos)
+    {
+        const T item = iHeap.at(aPos);
+        const int count = iHeap.size();
+        while (true)
+        {
+            int child = 2 * aPos + 1;
+            if (child >= count)
+            {
+                break;
+            } // no else
+            if (child + 1 < count &&
+                Traits::lessThan(iHeap.at(child + 1), iHeap.at(child)))
+            {
+                ++child;
+            } // no else
+            if (!Traits::lessThan(iHeap.at(child), item))
+            {
+                break;
+            } // no else
+            place(iHeap.at(child), aPos);
+            aPos = child;
+        }
+        place(item, aPos);
+    }
+
+    void place(const T &aItem, int aPos)
+    {
+        iHeap[aPos] = aItem;
+        iIndex[Traits::key(aItem)] = aPos;
+    }
+
+    QVector<T> iHeap;
+
+    // Key -> position in iHeap.
+    QHash<Key, int> iIndex;
+};
+
+}
+
+#endif // INDEXEDHEAP_H
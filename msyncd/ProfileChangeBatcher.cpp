@@ -0,0 +1,175 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileChangeBatcher.h"
+
+#include "ProfileManager.h"
+#include "ProfileEngineDefs.h"
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+const int ProfileChangeBatcher::COALESCE_INTERVAL = 250;
+const QString ProfileChangeBatcher::CHANGE_PROFILE_NAME("name");
+const QString ProfileChangeBatcher::CHANGE_TYPE("changeType");
+
+// Orders change types by how much of the profile they affect. A merged
+// change keeps the most significant type.
+static int changeRank(int aChangeType)
+{
+    switch (aChangeType)
+    {
+    case ProfileManager::PROFILE_ADDED:
+        return 2;
+    case ProfileManager::PROFILE_MODIFIED:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+ProfileChangeBatcher::ProfileChangeBatcher(QObject *aParent)
+:   QObject(aParent)
+{
+    FUNCTION_CALL_TRACE;
+
+    iTimer.setSingleShot(true);
+    iTimer.setInterval(COALESCE_INTERVAL);
+    connect(&iTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+ProfileChangeBatcher::~ProfileChangeBatcher()
+{
+    FUNCTION_CALL_TRACE;
+}
+
+bool ProfileChangeBatcher::isPending() const
+{
+    return !iOrder.isEmpty();
+}
+
+void ProfileChangeBatcher::addChange(QString aProfileName, int aChangeType,
+                                     QVariantMap aDelta)
+{
+    FUNCTION_CALL_TRACE;
+
+    if (!iChanges.contains(aProfileName))
+    {
+        QVariantMap change(aDelta);
+        change.insert(CHANGE_PROFILE_NAME, aProfileName);
+        change.insert(CHANGE_TYPE, aChangeType);
+        iChanges.insert(aProfileName, change);
+        iOrder.append(aProfileName);
+    }
+    else
+    {
+        merge(iChanges[aProfileName], aChangeType, aDelta);
+    }
+
+    // The timer is not restarted by later changes, so a steady stream of
+    // changes can not hold back the notification indefinitely.
+    if (!iTimer.isActive())
+    {
+        iTimer.start();
+    } // no else
+}
+
+void ProfileChangeBatcher::flush()
+{
+    FUNCTION_CALL_TRACE;
+
+    iTimer.stop();
+    if (iOrder.isEmpty())
+    {
+        return;
+    } // no else
+
+    QVariantList changes;
+    foreach (const QString &name, iOrder)
+    {
+        changes.append(iChanges.value(name));
+    }
+    iOrder.clear();
+    iChanges.clear();
+
+    LOG_DEBUG("Sending" << changes.size() << "coalesced profile changes");
+    emit changesReady(changes);
+}
+
+void ProfileChangeBatcher::merge(QVariantMap &aPending, int aChangeType,
+                                 const QVariantMap &aDelta)
+{
+    const QVariant name = aPending.value(CHANGE_PROFILE_NAME);
+    const int pendingType = aPending.value(CHANGE_TYPE).toInt();
+
+    if (aChangeType == ProfileManager::PROFILE_REMOVED ||
+        pendingType == ProfileManager::PROFILE_REMOVED)
+    {
+        // Earlier changes of a removed profile are of no interest, and a
+        // profile created again after removal is reported as a new one.
+        aPending = aDelta;
+        aPending.insert(CHANGE_PROFILE_NAME, name);
+        aPending.insert(CHANGE_TYPE, aChangeType);
+        return;
+    } // no else
+
+    if (changeRank(aChangeType) > changeRank(pendingType))
+    {
+        aPending.insert(CHANGE_TYPE, aChangeType);
+    } // no else
+
+    QVariantMap keys = aPending.value(DELTA_KEYS).toMap();
+    QStringList removedKeys = aPending.value(DELTA_REMOVED_KEYS).toStringList();
+    const QVariantMap newKeys = aDelta.value(DELTA_KEYS).toMap();
+    for (QVariantMap::const_iterator i = newKeys.constBegin();
+         i != newKeys.constEnd(); ++i)
+    {
+        keys.insert(i.key(), i.value());
+        removedKeys.removeAll(i.key());
+    }
+    foreach (const QString &key, aDelta.value(DELTA_REMOVED_KEYS).toStringList())
+    {
+        keys.remove(key);
+        if (!removedKeys.contains(key))
+        {
+            removedKeys.append(key);
+        } // no else
+    }
+
+    aPending.remove(DELTA_KEYS);
+    aPending.remove(DELTA_REMOVED_KEYS);
+    if (!keys.isEmpty())
+    {
+        aPending.insert(DELTA_KEYS, keys);
+    } // no else
+    if (!removedKeys.isEmpty())
+    {
+        aPending.insert(DELTA_REMOVED_KEYS, removedKeys);
+    } // no else
+
+    // Only the latest results are of interest.
+    if (aDelta.contains(DELTA_RESULTS))
+    {
+        aPending.insert(DELTA_RESULTS, aDelta.value(DELTA_RESULTS));
+    } // no else
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILECHANGEBATCHER_H
+#define PROFILECHANGEBATCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantList>
+#include <QVariantMap>
+
+namespace Buteo {
+
+/*! \brief Coalesces profile change deltas into batched notifications.
+ *
+ * Changes are collected for a short period after the first one arrives and
+ * then sent out together. Several changes of the same profile within the
+ * period are merged into one entry, so bursts like account updates or a
+ * restore result in a single notification.
+ */
+class ProfileChangeBatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //! Time in milliseconds changes are collected before they are sent.
+    static const int COALESCE_INTERVAL;
+
+    //! Entry of a batched change holding the profile name.
+    static const QString CHANGE_PROFILE_NAME;
+
+    //! Entry of a batched change holding the change type.
+    static const QString CHANGE_TYPE;
+
+    /*! \brief Constructor.
+     *
+     * \param aParent Parent object.
+     */
+    explicit ProfileChangeBatcher(QObject *aParent = 0);
+
+    //! \brief Destructor.
+    virtual ~ProfileChangeBatcher();
+
+    /*! \brief Checks if there are changes waiting to be sent.
+     *
+     * \return True if changes are pending.
+     */
+    bool isPending() const;
+
+public slots:
+
+    /*! \brief Adds a change to the current batch.
+     *
+     * \param aProfileName Name of the changed profile.
+     * \param aChangeType Change type, see ProfileManager::ProfileChangeType.
+     * \param aDelta Changed data, see ProfileManager::signalProfileDelta().
+     */
+    void addChange(QString aProfileName, int aChangeType, QVariantMap aDelta);
+
+    /*! \brief Sends the pending changes right away.
+     */
+    void flush();
+
+signals:
+
+    /*! \brief Emitted with a batch of coalesced changes.
+     *
+     * \param aChanges One map per changed profile, in the order the profiles
+     *  first changed. Each map holds CHANGE_PROFILE_NAME, CHANGE_TYPE and the
+     *  merged delta entries.
+     */
+    void changesReady(QVariantList aChanges);
+
+private:
+
+    // Merges a new change of a profile into its pending change.
+    static void merge(QVariantMap &aPending, int aChangeType,
+                      const QVariantMap &aDelta);
+
+    // Names of the changed profiles in the order they first changed.
+    QStringList iOrder;
+
+    // Pending change of each profile.
+    QHash<QString, QVariantMap> iChanges;
+
+    QTimer iTimer;
+
+#ifdef SYNCFW_UNIT_TESTS
+    friend class ProfileChangeBatcherTest;
+#endif
+};
+
+}
+
+#endif // PROFILECHANGEBATCHER_H
@@ -26,23 +26,23 @@
 
 #include <QTimer>
 #include <QObject>
-#include <QSettings>
 #include <QDebug>
 #include <LogMacros.h>
 
 const QString ALARM_CONNECTION_NAME( "alarms" );
 
-const int TRIGGER_COUNT = 1;
+// Longest interval a QTimer can wait. Alarms further away are reached in
+// several steps.
+const qint64 MAX_TIMER_INTERVAL = 24 * 60 * 60 * 1000;
 
 SyncAlarmInventory::SyncAlarmInventory():
-        iTimer(0),
-        currentAlarm(0),
-        triggerCount(TRIGGER_COUNT)
+        iNextId(1),
+        iTimer(0)
 {
   // empty.explicitly call init
 }
 
-bool SyncAlarmInventory::init()
+bool SyncAlarmInventory::init(const QString &aDbFile)
 {
     FUNCTION_CALL_TRACE;
 
@@ -50,11 +50,14 @@ bool SyncAlarmInventory::init()
     iConnectionName = ALARM_CONNECTION_NAME + QString::number( connectionNumber++ );
     iDbHandle = QSqlDatabase::addDatabase( "QSQLITE", iConnectionName );
 
-    // Make sure we have the .sync directory
-    QDir configDir;
-    configDir.mkdir(Sync::syncCacheDir());
-    QString path( Sync::syncCacheDir() );
-    path.append( QDir::separator() ).append( "alarms.db.sqlite" );
+    QString path( aDbFile );
+    if (path.isEmpty()) {
+        // Make sure we have the .sync directory
+        QDir configDir;
+        configDir.mkdir(Sync::syncCacheDir());
+        path = Sync::syncCacheDir();
+        path.append( QDir::separator() ).append( "alarms.db.sqlite" );
+    }
     path = QDir::toNativeSeparators( path );
 
     iDbHandle.setDatabaseName( path );
@@ -67,33 +70,40 @@ bool SyncAlarmInventory::init()
     }
 
     // Create the alarms table
-    const QString createTableQuery( "CREATE TABLE IF NOT EXISTS alarms(alarmid INTEGER PRIMARY KEY AUTOINCREMENT, synctime DATETIME)" );
-    QSqlQuery query( createTableQuery, iDbHandle );
-    LOG_DEBUG("SQL Query::" << query.lastQuery());
-    if ( !query.exec() ) {
-    	LOG_WARNING("Failed to execute the createTableQuery");
-    	return false;
+    const QStringList statements = QStringList()
+        << "CREATE TABLE IF NOT EXISTS alarms(alarmid INTEGER PRIMARY KEY AUTOINCREMENT, synctime DATETIME)"
+        << "CREATE INDEX IF NOT EXISTS alarms_synctime ON alarms(synctime)";
+    QSqlQuery query( iDbHandle );
+    foreach (const QString &statement, statements) {
+        if ( !query.exec(statement) ) {
+            LOG_WARNING("Failed to create the alarms table:" << query.lastError().text());
+            return false;
+        }
     }
 
-    // Clear any old alarms that may have lingered
-    removeAllAlarms();
+    // Writes are collected and done once control returns to the event loop.
+    iFlushTimer.setSingleShot(true);
+    iFlushTimer.setInterval(0);
+    connect( &iFlushTimer, SIGNAL(timeout()), this, SLOT(flush()) );
 
     // Create the iTimer object
     iTimer = new QTimer(this);
-    if(iTimer) {
-    	connect( iTimer, SIGNAL(timeout()), this, SLOT(timerTriggered()) );
-    	currentAlarm = 0;
-    	return true;
-    } else {
-    	LOG_WARNING("Failed to create a QTimer");
-    	return false;
+    iTimer->setSingleShot(true);
+    connect( iTimer, SIGNAL(timeout()), this, SLOT(timerTriggered()) );
+
+    if (!loadAlarms()) {
+        return false;
     }
+    scheduleNext();
+    return true;
 }
 
 SyncAlarmInventory::~SyncAlarmInventory()
 {
     FUNCTION_CALL_TRACE;
 
+    flush();
+
     iDbHandle.close();
     iDbHandle = QSqlDatabase();
     QSqlDatabase::removeDatabase( iConnectionName );
@@ -105,10 +115,39 @@ SyncAlarmInventory::~SyncAlarmInventory()
     }
 }
 
+bool SyncAlarmInventory::loadAlarms()
+{
+    FUNCTION_CALL_TRACE;
+
+    QSqlQuery selectQuery( iDbHandle );
+    if ( !selectQuery.exec("SELECT alarmid,synctime FROM alarms") ) {
+        LOG_WARNING("Failed to load the alarms:" << selectQuery.lastError().text());
+        return false;
+    }
+
+    QVector<Alarm> alarms;
+    while ( selectQuery.next() ) {
+        Alarm alarm;
+        alarm.iId = selectQuery.value(0).toInt();
+        alarm.iTime = selectQuery.value(1).toDateTime().toMSecsSinceEpoch();
+        alarms.append(alarm);
+        iNextId = qMax(iNextId, alarm.iId + 1);
+    }
+
+    iHeap.assign(alarms);
+    LOG_DEBUG("Loaded" << iHeap.size() << "alarms");
+    return true;
+}
+
 int SyncAlarmInventory::addAlarm( QDateTime alarmDate )
 {
     FUNCTION_CALL_TRACE;
 
+    if ( !iTimer ) {
+        LOG_WARNING("Alarm inventory is not initialised");
+        return 0;
+    }
+
     // Check if alarmDate < QDateTime::currentDateTime()
     if ( QDateTime::currentDateTime().secsTo(alarmDate) < 0 ) {
     	LOG_WARNING("alarmDate < QDateTime::currentDateTime()");
@@ -116,58 +155,32 @@ int SyncAlarmInventory::addAlarm( QDateTime alarmDate )
         alarmDate = QDateTime::currentDateTime();
     }
 
-    // Store the alarm 
-    int alarmId = 0;
-    if ( (alarmId = addAlarmToDb(alarmDate)) == 0 ) {
-        // Note: Even incase of an already existing profile, false is returned by the query
-        // There is no way to detect a record insertion from an already existing alarm
-
-        // If unable to add an alarm to db, set the iTimers
-        // for already existing alarms
-    	LOG_WARNING("(alarmId = addAlarmToDb(alarmDate)) == 0");
-    }
+    Alarm alarm;
+    alarm.iId = iNextId++;
+    alarm.iTime = alarmDate.toMSecsSinceEpoch();
+    iHeap.insert(alarm);
+    logChange(alarm.iId, alarm.iTime);
 
-    // Select all the alarms from the db sorted by alarm time
-    QSqlQuery selectQuery( iDbHandle );
-    if ( selectQuery.exec("SELECT alarmid,synctime FROM alarms ORDER BY synctime ASC") ) {
-        LOG_DEBUG("SQL Query::" << selectQuery.lastQuery());
-        if ( selectQuery.first() ) {
-            int newAlarm = selectQuery.value(0).toInt();
-            QDateTime alarmTime = selectQuery.value(1).toDateTime();
-
-            // If the newAlarm != currentAlarm that is fetched from DB, stop the
-            // previous iTimer
-            if ( (currentAlarm != 0) && (newAlarm != currentAlarm) ) {
-                if ( !iTimer->isActive() )
-                    iTimer->stop();
-            }
-
-            // This is a new alarm. Set the iTimer for the alarm
-            currentAlarm = newAlarm;
-            QDateTime now = QDateTime::currentDateTime();
-            int iTimerInterval = 0;
-            if(now < alarmTime)
-            {
-                iTimerInterval = (now.secsTo( alarmTime ) / TRIGGER_COUNT) * 1000;  // time interval in millisec
-            }
-            LOG_DEBUG("currentAlarm"<<currentAlarm<<"alarmTime"<<alarmTime<<"iTimerInterval"<<iTimerInterval);
-            triggerCount = TRIGGER_COUNT;
-            iTimer->setInterval( iTimerInterval );
-            iTimer->start();
-        }
-    } else {
-    	LOG_WARNING("Select Query Execution Failed" );
+    LOG_DEBUG("Added alarm" << alarm.iId << "alarmTime" << alarmDate);
+    if ( iHeap.first().iId == alarm.iId ) {
+        scheduleNext();
     }
 
-    return alarmId;
+    return alarm.iId;
 }
 
 bool SyncAlarmInventory::removeAlarm(int alarmId)
 {
     FUNCTION_CALL_TRACE;
 
-    if( alarmId <= 0 ) return false;
-    deleteAlarmFromDb( alarmId );
+    if( alarmId <= 0 || !iHeap.contains(alarmId) ) return false;
+
+    const bool wasFirst = ( iHeap.first().iId == alarmId );
+    iHeap.take( alarmId );
+    logChange( alarmId, -1 );
+    if ( wasFirst ) {
+        scheduleNext();
+    }
     return true;
 }
 
@@ -175,84 +188,147 @@ void SyncAlarmInventory::removeAllAlarms()
 {
     FUNCTION_CALL_TRACE;
 
-    QSqlQuery deleteAllQuery(QString("DELETE FROM alarms"), iDbHandle);
-    LOG_DEBUG("SQL Query::" << deleteAllQuery.lastQuery());
-    if(!deleteAllQuery.exec())
-    {
-        LOG_WARNING("Failed query to delete all alarms");
+    iHeap.clear();
+    iLog.clear();
+    logChange( 0, -1 );
+    if ( iTimer ) {
+        iTimer->stop();
     }
 }
 
+int SyncAlarmInventory::count() const
+{
+    return iHeap.size();
+}
+
+QList<int> SyncAlarmInventory::alarmIds() const
+{
+    return iHeap.keys();
+}
+
+QDateTime SyncAlarmInventory::alarmTime(int alarmId) const
+{
+    const Alarm *alarm = iHeap.find(alarmId);
+    if ( alarm == 0 ) {
+        return QDateTime();
+    }
+    return QDateTime::fromMSecsSinceEpoch( alarm->iTime );
+}
+
 void SyncAlarmInventory::timerTriggered()
 {
     FUNCTION_CALL_TRACE;
 
-    // Decrement the alarm counter
-    triggerCount--;
+    // Trigger every expired alarm. Each one is taken out of the heap before
+    // the signal is sent, the receivers may add or remove alarms.
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while ( !iHeap.isEmpty() && iHeap.first().iTime <= now ) {
+        const Alarm alarm = iHeap.takeFirst();
+        logChange( alarm.iId, -1 );
+    	LOG_DEBUG("Triggering the alarm " << alarm.iId );
+        emit triggerAlarm( alarm.iId );
+    }
+
+    scheduleNext();
+}
 
-    // Alarm expired. Trigger the alarm and delete it from DB and set the alarm for the next one
-    if (triggerCount == 0) {
-    	LOG_DEBUG("Triggering the alarm " << currentAlarm );
-        emit triggerAlarm(currentAlarm);
+void SyncAlarmInventory::scheduleNext()
+{
+    if ( !iTimer ) {
+        return;
+    }
 
-        // Delete the alarm from DB
-        if ( !deleteAlarmFromDb(currentAlarm) ) {
-        }
+    if ( iHeap.isEmpty() ) {
         iTimer->stop();
-        currentAlarm = 0;
-
-        // Set the new alarm iTimer
-        // Select all the alarms from the db sorted by alarm time
-        QSqlQuery selectQuery( iDbHandle );
-        if ( selectQuery.exec("SELECT alarmid,synctime FROM alarms ORDER BY synctime ASC") ) {
-            LOG_DEBUG("SQL Query::" << selectQuery.lastQuery());
-            if ( selectQuery.first() ) {
-                currentAlarm = selectQuery.value(0).toInt();
-                QDateTime alarmTime = selectQuery.value(1).toDateTime();
-
-                // Set the iTimer for the alarm
-                QDateTime now = QDateTime::currentDateTime();
-                int iTimerInterval = 0;
-                if(now < alarmTime)
-                {
-                    iTimerInterval = (now.secsTo( alarmTime ) / TRIGGER_COUNT) * 1000;  // time interval in millisec
-                }
-                triggerCount = TRIGGER_COUNT;
-                LOG_DEBUG("Starting timer with interval::" << iTimerInterval);
-                iTimer->setInterval( iTimerInterval );
-                iTimer->start();
-            }
-        }
+        return;
+    }
+
+    const qint64 interval = iHeap.first().iTime - QDateTime::currentMSecsSinceEpoch();
+    const int timerInterval = static_cast<int>( qBound( qint64(0), interval, MAX_TIMER_INTERVAL ) );
+    LOG_DEBUG("currentAlarm" << iHeap.first().iId << "Starting timer with interval::" << timerInterval);
+    iTimer->start( timerInterval );
+}
+
+void SyncAlarmInventory::logChange(int aId, qint64 aTime)
+{
+    Alarm change;
+    change.iId = aId;
+    change.iTime = aTime;
+    iLog.append(change);
+    if ( !iFlushTimer.isActive() ) {
+        iFlushTimer.start();
     }
 }
 
-bool SyncAlarmInventory::deleteAlarmFromDb( int alarmId )
+bool SyncAlarmInventory::flush()
 {
     FUNCTION_CALL_TRACE;
 
-    QSqlQuery removeQuery ( iDbHandle );
-    removeQuery.prepare( "DELETE FROM alarms WHERE alarmid=:alarmid" );
-    removeQuery.bindValue( ":alarmid", alarmId );
+    iFlushTimer.stop();
+    if ( iLog.isEmpty() || !iDbHandle.isOpen() ) {
+        return true;
+    }
 
-    LOG_DEBUG("SQL Query::" << removeQuery.lastQuery());
-    if ( !removeQuery.exec() )
+    if ( !iDbHandle.transaction() ) {
+        LOG_WARNING("Failed to begin alarm transaction:" << iDbHandle.lastError().text());
         return false;
-    else
-        return true;
+    }
+
+    QSqlQuery insertQuery( iDbHandle );
+    insertQuery.prepare( "INSERT INTO alarms(alarmid, synctime) VALUES(:alarmid, :synctime)" );
+    QSqlQuery removeQuery( iDbHandle );
+    removeQuery.prepare( "DELETE FROM alarms WHERE alarmid=:alarmid" );
+    QSqlQuery removeAllQuery( iDbHandle );
+    removeAllQuery.prepare( "DELETE FROM alarms" );
+
+    bool success = true;
+    foreach (const Alarm &change, iLog) {
+        QSqlQuery *query = 0;
+        if ( change.iId == 0 ) {
+            query = &removeAllQuery;
+        } else if ( change.iTime < 0 ) {
+            query = &removeQuery;
+            query->bindValue( ":alarmid", change.iId );
+        } else {
+            query = &insertQuery;
+            query->bindValue( ":alarmid", change.iId );
+            query->bindValue( ":synctime", QDateTime::fromMSecsSinceEpoch(change.iTime) );
+        }
+        if ( !query->exec() ) {
+            LOG_WARNING("Failed to store alarm" << change.iId << ":" << query->lastError().text());
+            success = false;
+            break;
+        }
+    }
+
+    if ( success ) {
+        success = iDbHandle.commit();
+    } else {
+        iDbHandle.rollback();
+    }
+
+    // The changes are kept and written again with the next ones if the
+    // transaction failed.
+    if ( success ) {
+        iLog.clear();
+    } else {
+        LOG_WARNING("Failed to write the alarm changes");
+    }
+    return success;
 }
 
-int SyncAlarmInventory::addAlarmToDb( QDateTime timeStamp )
+bool SyncAlarmInventory::AlarmTraits::lessThan(const Alarm &aLeft, const Alarm &aRight)
 {
-    FUNCTION_CALL_TRACE;
-
-    QSqlQuery insertQuery( iDbHandle );
-    insertQuery.prepare( "INSERT INTO alarms(synctime) VALUES(:synctime)" );
-    insertQuery.bindValue( ":synctime", timeStamp );
+    if (aLeft.iTime != aRight.iTime)
+    {
+        return aLeft.iTime < aRight.iTime;
+    } // no else
 
-    LOG_DEBUG("SQL Query::" << insertQuery.lastQuery());
-    if ( insertQuery.exec() )
-        return insertQuery.lastInsertId().toInt();
-    else
-        return 0;
+    // Alarms of the same time trigger in the order they were added.
+    return aLeft.iId < aRight.iId;
 }
 
+int SyncAlarmInventory::AlarmTraits::key(const Alarm &aAlarm)
+{
+    return aAlarm.iId;
+}
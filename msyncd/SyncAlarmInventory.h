@@ -27,12 +27,18 @@
 
 #include <QObject>
 #include <QDateTime>
+#include <QTimer>
 #include <QtSql>
 
+#include "IndexedHeap.h"
+
 /*! \brief Class for storing alarms
  *
  * This class stores alarms for scheduled synchronizations. The main elements
- * are the sync time and the alarm id
+ * are the sync time and the alarm id. The alarms are kept in memory in a heap
+ * ordered by sync time, so adding, removing and triggering an alarm takes
+ * logarithmic time. The database only logs the changes, it is read once in
+ * init() and written in one transaction per event loop iteration.
  */
 class SyncAlarmInventory : public QObject
 {
@@ -48,9 +54,13 @@ class SyncAlarmInventory : public QObject
 
         /*! \brief Creates and Initialize the alarms database. also Creates the timers
          * Please call this function to make sure the database is initialised properly
+         * Alarms stored by an earlier instance are loaded, and expired ones
+         * trigger right away.
+         * @param aDbFile - path of the database file. By default the file is
+         *  placed in the sync cache directory.
          * @return - status of the initialisation
          */
-        bool init();
+        bool init(const QString &aDbFile = QString());
 
         /*! \brief Method to add an alarm
          *
@@ -71,6 +81,33 @@ class SyncAlarmInventory : public QObject
          */
         void removeAllAlarms();
 
+        /*! \brief Gets the number of pending alarms
+         *
+         * @return number of alarms
+         */
+        int count() const;
+
+        /*! \brief Gets the ids of the pending alarms
+         *
+         * @return ids of the alarms in no particular order
+         */
+        QList<int> alarmIds() const;
+
+        /*! \brief Gets the time of an alarm
+         *
+         * @param alarmId - id of the alarm
+         * @return time of the alarm, invalid if there is no such alarm
+         */
+        QDateTime alarmTime(int alarmId) const;
+
+    public slots:
+        /*! \brief Writes pending changes to the database right away
+         *
+         * Changes that could not be written are kept and written later.
+         * @return status of the write
+         */
+        bool flush();
+
     signals:
         /*! \brief Signal triggered when an alarm expired
          * @param alarmId  - id of the alarm that got triggered.
@@ -78,23 +115,45 @@ class SyncAlarmInventory : public QObject
         void triggerAlarm(int alarmId);
 
     private:
-        /* Deletes the alarm from DB */
-        bool deleteAlarmFromDb( int alarmName );
 
-        /* Method to add an alarm to the database */
-        int addAlarmToDb( QDateTime timeStamp );
+        struct Alarm
+        {
+            int iId;
+            // Alarm time in milliseconds since the epoch.
+            qint64 iTime;
+        };
+
+        /* Loads the stored alarms into the heap */
+        bool loadAlarms();
+
+        /* Adds a change to the database log */
+        void logChange(int aId, qint64 aTime);
 
-        /* Method to fetch the database handle */
-        QSqlDatabase*  getDbHandle();
+        /* Orders the alarms by time and keys them by id */
+        struct AlarmTraits
+        {
+            static bool lessThan(const Alarm &aLeft, const Alarm &aRight);
+            static int key(const Alarm &aAlarm);
+        };
+
+        /* Starts the timer for the earliest alarm */
+        void scheduleNext();
+
+        /* Pending alarms as a binary min-heap ordered by time */
+        Buteo::IndexedHeap<int, Alarm, AlarmTraits> iHeap;
+
+        /* Changes not yet written to the database. A negative time marks a
+         * removed alarm, id 0 the removal of all alarms. */
+        QList<Alarm> iLog;
+
+        /* Id of the next alarm */
+        int iNextId;
 
         /* Timer object to keep tracke of alarm timers */
         QTimer*        iTimer;
 
-        /* Current alarm that is under work */
-        int            currentAlarm;
-
-        /* Number of times that the alarm triggers */
-        int            triggerCount;
+        /* Timer that writes the changes to the database */
+        QTimer         iFlushTimer;
 
         /* Database handle */
         QSqlDatabase   iDbHandle;
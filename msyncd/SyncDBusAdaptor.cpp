@@ -134,6 +134,12 @@ bool SyncDBusAdaptor::setSyncSchedule(const QString &aProfileId, const QString &
     return out0;
 }
 
+void SyncDBusAdaptor::setProfileChangesAsXml(bool aEnabled)
+{
+    // handle method call com.meego.msyncd.setProfileChangesAsXml
+    QMetaObject::invokeMethod(parent(), "setProfileChangesAsXml", Q_ARG(bool, aEnabled));
+}
+
 void SyncDBusAdaptor::start(uint aAccountId)
 {
     // handle method call com.meego.msyncd.start
@@ -184,6 +190,22 @@ QStringList SyncDBusAdaptor::syncProfilesByType(const QString &aType)
     return out0;
 }
 
+QVariantMap SyncDBusAdaptor::syncStatistics(const QString &aProfileId, qlonglong aFromTime, qlonglong aToTime)
+{
+    // handle method call com.meego.msyncd.syncStatistics
+    QVariantMap out0;
+    QMetaObject::invokeMethod(parent(), "syncStatistics", Q_RETURN_ARG(QVariantMap, out0), Q_ARG(QString, aProfileId), Q_ARG(qlonglong, aFromTime), Q_ARG(qlonglong, aToTime));
+    return out0;
+}
+
+QVariantMap SyncDBusAdaptor::syncConcurrency()
+{
+    // handle method call com.meego.msyncd.syncConcurrency
+    QVariantMap out0;
+    QMetaObject::invokeMethod(parent(), "syncConcurrency", Q_RETURN_ARG(QVariantMap, out0));
+    return out0;
+}
+
 QList<uint> SyncDBusAdaptor::syncingAccounts()
 {
     // handle method call com.meego.msyncd.syncingAccounts
@@ -61,6 +61,9 @@ class SyncDBusAdaptor: public QDBusAbstractAdaptor
 "      <arg direction=\"out\" type=\"i\" name=\"aChangeType\"/>\n"
 "      <arg direction=\"out\" type=\"s\" name=\"aProfileAsXml\"/>\n"
 "    </signal>\n"
+"    <signal name=\"profilesChanged\">\n"
+"      <arg direction=\"out\" type=\"av\" name=\"aChanges\"/>\n"
+"    </signal>\n"
 "    <signal name=\"backupInProgress\"/>\n"
 "    <signal name=\"backupDone\"/>\n"
 "    <signal name=\"restoreInProgress\"/>\n"
@@ -93,6 +96,10 @@ class SyncDBusAdaptor: public QDBusAbstractAdaptor
 "      <arg direction=\"out\" type=\"b\"/>\n"
 "      <arg direction=\"in\" type=\"s\" name=\"aProfileId\"/>\n"
 "    </method>\n"
+"    <method name=\"setProfileChangesAsXml\">\n"
+"      <arg direction=\"in\" type=\"b\" name=\"aEnabled\"/>\n"
+"      <annotation value=\"true\" name=\"org.freedesktop.DBus.Method.NoReply\"/>\n"
+"    </method>\n"
 "    <method name=\"updateProfile\">\n"
 "      <arg direction=\"out\" type=\"b\"/>\n"
 "      <arg direction=\"in\" type=\"s\" name=\"aProfileAsXml\"/>\n"
@@ -173,6 +180,17 @@ class SyncDBusAdaptor: public QDBusAbstractAdaptor
 "      <arg direction=\"in\" type=\"s\" name=\"aClientProfileName\"/>\n"
 "      <annotation value=\"true\" name=\"org.freedesktop.DBus.Method.NoReply\"/>\n"
 "    </method>\n"
+"    <method name=\"syncStatistics\">\n"
+"      <arg direction=\"out\" type=\"a{sv}\"/>\n"
+"      <annotation value=\"QVariantMap\" name=\"com.trolltech.QtDBus.QtTypeName.Out0\"/>\n"
+"      <arg direction=\"in\" type=\"s\" name=\"aProfileId\"/>\n"
+"      <arg direction=\"in\" type=\"x\" name=\"aFromTime\"/>\n"
+"      <arg direction=\"in\" type=\"x\" name=\"aToTime\"/>\n"
+"    </method>\n"
+"    <method name=\"syncConcurrency\">\n"
+"      <arg direction=\"out\" type=\"a{sv}\"/>\n"
+"      <annotation value=\"QVariantMap\" name=\"com.trolltech.QtDBus.QtTypeName.Out0\"/>\n"
+"    </method>\n"
 "  </interface>\n"
         "")
 public:
@@ -192,6 +210,7 @@ public Q_SLOTS: // METHODS
     QStringList runningSyncs();
     bool saveSyncResults(const QString &aProfileId, const QString &aSyncResults);
     bool setSyncSchedule(const QString &aProfileId, const QString &aScheduleAsXml);
+    Q_NOREPLY void setProfileChangesAsXml(bool aEnabled);
     Q_NOREPLY void start(uint aAccountId);
     bool startSync(const QString &aProfileId);
     int status(uint aAccountId, int &aFailedReason, qlonglong &aPrevSyncTime, qlonglong &aNextSyncTime);
@@ -199,6 +218,8 @@ public Q_SLOTS: // METHODS
     QString syncProfile(const QString &aProfileId);
     QStringList syncProfilesByKey(const QString &aKey, const QString &aValue);
     QStringList syncProfilesByType(const QString &aType);
+    QVariantMap syncStatistics(const QString &aProfileId, qlonglong aFromTime, qlonglong aToTime);
+    QVariantMap syncConcurrency();
     QList<uint> syncingAccounts();
     bool updateProfile(const QString &aProfileAsXml);
     Q_NOREPLY void isSyncedExternally(uint aAccountId, const QString aClientProfileName);
@@ -210,6 +231,7 @@ Q_SIGNALS: // SIGNALS
     void restoreInProgress();
     void resultsAvailable(const QString &aProfileName, const QString &aResultsAsXml);
     void signalProfileChanged(const QString &aProfileName, int aChangeType, const QString &aProfileAsXml);
+    void profilesChanged(const QVariantList &aChanges);
     void statusChanged(uint aAccountId, int aNewStatus, int aFailedReason, qlonglong aPrevSyncTime, qlonglong aNextSyncTime);
     void syncStatus(const QString &aProfileName, int aStatus, const QString &aMessage, int aMoreDetails);
     void transferProgress(const QString &aProfileName, int aTransferDatabase, int aTransferType, const QString &aMimeType, int aCommittedItems);
@@ -104,6 +104,19 @@ signals:
      */
     void signalProfileChanged(QString aProfileName, int aChangeType , QString aProfileAsXml);
 
+    /*! \brief Notifies about changed profiles with only the changed data.
+     *
+     * Changes made within a short period are coalesced into one signal, and
+     * several changes of the same profile into one entry. Unlike
+     * signalProfileChanged(), this signal is always sent.
+     * \param aChanges One map per changed profile, holding the profile name
+     *  ("name"), the change type ("changeType", see signalProfileChanged())
+     *  and the changed data: "keys" (map of added or changed keys),
+     *  "removedKeys" (list of key names) and "results" (map with "syncTime",
+     *  "majorCode", "minorCode" and "scheduled" of the latest sync results).
+     */
+    void profilesChanged(QVariantList aChanges);
+
 
     /*! \brief Notifies about Backup start.
      *
@@ -380,6 +393,46 @@ public slots:
      * \return The profile name if the profile was created successful or empty if it fails
      */
     virtual QString createSyncProfileForAccount(uint aAccountId) = 0;
+
+    /*! \brief Selects if the calling client gets signalProfileChanged().
+     *
+     * The full profile XML of signalProfileChanged() is only sent while at
+     * least one client has asked for it. Clients that only need to know
+     * what changed should listen to profilesChanged() instead. The request
+     * is dropped when the client disconnects from the bus.
+     *
+     * \param aEnabled True to receive signalProfileChanged(), false to stop.
+     */
+    virtual Q_NOREPLY void setProfileChangesAsXml(bool aEnabled) = 0;
+
+    /*! \brief Gets aggregated sync results of a time window.
+     *
+     * The aggregates are computed from the long-term results history, which
+     * keeps results for longer than the sync log of the profile. The keys
+     * of the returned map are the Sync::STATS_* constants of SyncCommonDefs.h.
+     *
+     * \param aProfileId Name of the profile, empty for all profiles.
+     * \param aFromTime Start of the window in milliseconds since epoch,
+     *  0 for no lower bound.
+     * \param aToTime End of the window in milliseconds since epoch, 0 for
+     *  no upper bound.
+     * \return Sync count, success rate, median and 95th percentile duration
+     *  in milliseconds, items per second and error code histogram.
+     */
+    virtual QVariantMap syncStatistics(const QString &aProfileId,
+                                       qlonglong aFromTime, qlonglong aToTime) = 0;
+
+    /*! \brief Gets the occupancy of the sync session slots.
+     *
+     * The number of sync sessions running at the same time is limited
+     * globally and per destination type, client plug-in and destination
+     * host. The keys of the returned map are the Sync::CONCURRENCY_*
+     * constants of SyncCommonDefs.h.
+     *
+     * \return Current and peak number of running sessions, the global limit
+     *  and the current number of sessions per class.
+     */
+    virtual QVariantMap syncConcurrency() = 0;
 };
 
 }
@@ -0,0 +1,256 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "SyncGovernor.h"
+#include "SyncProfile.h"
+#include "ProfileEngineDefs.h"
+#include "SyncCommonDefs.h"
+#include "LogMacros.h"
+
+#include <QUrl>
+
+using namespace Buteo;
+
+SyncGovernor::SyncGovernor()
+:   iLimit(0),
+    iOnline(0),
+    iDevice(0),
+    iPeak(0)
+{
+    FUNCTION_CALL_TRACE;
+
+    for (int i = 0; i < LIMIT_CLASS_COUNT; ++i)
+    {
+        iClassLimits[i] = 0;
+    }
+}
+
+void SyncGovernor::setLimit(int aLimit)
+{
+    iLimit = qMax(aLimit, 0);
+}
+
+int SyncGovernor::limit() const
+{
+    return iLimit;
+}
+
+void SyncGovernor::setClassLimit(LimitClass aClass, int aLimit)
+{
+    if (aClass >= 0 && aClass < LIMIT_CLASS_COUNT)
+    {
+        iClassLimits[aClass] = qMax(aLimit, 0);
+    } // no else
+}
+
+int SyncGovernor::classLimit(LimitClass aClass) const
+{
+    if (aClass >= 0 && aClass < LIMIT_CLASS_COUNT)
+    {
+        return iClassLimits[aClass];
+    } // no else
+
+    return 0;
+}
+
+bool SyncGovernor::canAdmit(const SyncProfile *aProfile) const
+{
+    FUNCTION_CALL_TRACE;
+
+    if (isFull(iSlots.size(), iLimit))
+    {
+        LOG_DEBUG("Concurrent session limit reached:" << iLimit);
+        return false;
+    } // no else
+
+    const Slot slot = slotOf(aProfile);
+    if ((slot.iDestination == SyncProfile::DESTINATION_TYPE_ONLINE &&
+         isFull(iOnline, iClassLimits[LIMIT_ONLINE])) ||
+        (slot.iDestination == SyncProfile::DESTINATION_TYPE_DEVICE &&
+         isFull(iDevice, iClassLimits[LIMIT_DEVICE])))
+    {
+        LOG_DEBUG("Concurrent session limit of the destination type reached");
+        return false;
+    } // no else
+
+    if (!slot.iClient.isEmpty() &&
+        isFull(iClients.value(slot.iClient), iClassLimits[LIMIT_CLIENT_PLUGIN]))
+    {
+        LOG_DEBUG("Concurrent session limit of client plug-in reached:" << slot.iClient);
+        return false;
+    } // no else
+
+    if (!slot.iHost.isEmpty() &&
+        isFull(iHosts.value(slot.iHost), iClassLimits[LIMIT_HOST]))
+    {
+        LOG_DEBUG("Concurrent session limit of host reached:" << slot.iHost);
+        return false;
+    } // no else
+
+    return true;
+}
+
+void SyncGovernor::admit(const QString &aProfileName, const SyncProfile *aProfile)
+{
+    FUNCTION_CALL_TRACE;
+
+    release(aProfileName);
+
+    const Slot slot = slotOf(aProfile);
+    iSlots.insert(aProfileName, slot);
+    if (slot.iDestination == SyncProfile::DESTINATION_TYPE_ONLINE)
+    {
+        ++iOnline;
+    }
+    else if (slot.iDestination == SyncProfile::DESTINATION_TYPE_DEVICE)
+    {
+        ++iDevice;
+    } // no else
+    if (!slot.iClient.isEmpty())
+    {
+        ++iClients[slot.iClient];
+    } // no else
+    if (!slot.iHost.isEmpty())
+    {
+        ++iHosts[slot.iHost];
+    } // no else
+
+    iPeak = qMax(iPeak, iSlots.size());
+}
+
+bool SyncGovernor::release(const QString &aProfileName)
+{
+    FUNCTION_CALL_TRACE;
+
+    QHash<QString, Slot>::iterator i = iSlots.find(aProfileName);
+    if (i == iSlots.end())
+    {
+        return false;
+    } // no else
+
+    const Slot slot = i.value();
+    iSlots.erase(i);
+    if (slot.iDestination == SyncProfile::DESTINATION_TYPE_ONLINE)
+    {
+        --iOnline;
+    }
+    else if (slot.iDestination == SyncProfile::DESTINATION_TYPE_DEVICE)
+    {
+        --iDevice;
+    } // no else
+    if (!slot.iClient.isEmpty() && --iClients[slot.iClient] <= 0)
+    {
+        iClients.remove(slot.iClient);
+    } // no else
+    if (!slot.iHost.isEmpty() && --iHosts[slot.iHost] <= 0)
+    {
+        iHosts.remove(slot.iHost);
+    } // no else
+
+    return true;
+}
+
+int SyncGovernor::occupancy() const
+{
+    return iSlots.size();
+}
+
+int SyncGovernor::peakOccupancy() const
+{
+    return iPeak;
+}
+
+QVariantMap SyncGovernor::status() const
+{
+    FUNCTION_CALL_TRACE;
+
+    QVariantMap clients;
+    for (QHash<QString, int>::const_iterator i = iClients.constBegin();
+         i != iClients.constEnd(); ++i)
+    {
+        clients.insert(i.key(), i.value());
+    }
+    QVariantMap hosts;
+    for (QHash<QString, int>::const_iterator i = iHosts.constBegin();
+         i != iHosts.constEnd(); ++i)
+    {
+        hosts.insert(i.key(), i.value());
+    }
+
+    QVariantMap status;
+    status.insert(Sync::CONCURRENCY_ACTIVE, occupancy());
+    status.insert(Sync::CONCURRENCY_PEAK, iPeak);
+    status.insert(Sync::CONCURRENCY_LIMIT, iLimit);
+    status.insert(Sync::CONCURRENCY_ONLINE, iOnline);
+    status.insert(Sync::CONCURRENCY_DEVICE, iDevice);
+    status.insert(Sync::CONCURRENCY_CLIENTS, clients);
+    status.insert(Sync::CONCURRENCY_HOSTS, hosts);
+    return status;
+}
+
+QString SyncGovernor::host(const SyncProfile *aProfile)
+{
+    if (aProfile == 0)
+    {
+        return QString();
+    } // no else
+
+    QString address = aProfile->key(KEY_REMOTE_DATABASE);
+    if (address.isEmpty() && aProfile->clientProfile() != 0)
+    {
+        address = aProfile->clientProfile()->key(KEY_REMOTE_DATABASE);
+    } // no else
+
+    if (!address.isEmpty())
+    {
+        const QString urlHost = QUrl(address).host();
+        if (!urlHost.isEmpty())
+        {
+            return urlHost.toLower();
+        } // no else
+    } // no else
+
+    return aProfile->key(KEY_BT_ADDRESS).toLower();
+}
+
+SyncGovernor::Slot SyncGovernor::slotOf(const SyncProfile *aProfile)
+{
+    Slot slot;
+    slot.iDestination = SyncProfile::DESTINATION_TYPE_UNDEFINED;
+    if (aProfile != 0)
+    {
+        slot.iDestination = aProfile->destinationType();
+        if (aProfile->clientProfile() != 0)
+        {
+            slot.iClient = aProfile->clientProfile()->name();
+        } // no else
+        slot.iHost = host(aProfile);
+    } // no else
+
+    return slot;
+}
+
+bool SyncGovernor::isFull(int aCount, int aLimit)
+{
+    return aLimit > 0 && aCount >= aLimit;
+}
@@ -0,0 +1,163 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef SYNCGOVERNOR_H
+#define SYNCGOVERNOR_H
+
+#include <QString>
+#include <QHash>
+#include <QVariantMap>
+
+namespace Buteo {
+
+class SyncProfile;
+
+/*! \brief Limits the number of sync sessions running at the same time.
+ *
+ * A session is admitted only if it fits the global limit and the limits of
+ * every class it belongs to: online or device destination, client plug-in
+ * and destination host. A limit of 0 means unlimited. Sessions that are not
+ * admitted stay in the sync queue until a running session releases its slot.
+ */
+class SyncGovernor
+{
+public:
+
+    //! \brief Session classes with a separate limit
+    enum LimitClass
+    {
+        //! Sessions with an online destination
+        LIMIT_ONLINE,
+        //! Sessions with a device destination
+        LIMIT_DEVICE,
+        //! Sessions of one client plug-in
+        LIMIT_CLIENT_PLUGIN,
+        //! Sessions with one destination host
+        LIMIT_HOST,
+        LIMIT_CLASS_COUNT
+    };
+
+    //! \brief Constructor. All limits are initially unlimited.
+    SyncGovernor();
+
+    /*! \brief Sets the global limit.
+     *
+     * \param aLimit Maximum number of sessions, 0 for unlimited.
+     */
+    void setLimit(int aLimit);
+
+    //! \brief Gets the global limit.
+    int limit() const;
+
+    /*! \brief Sets the limit of a session class.
+     *
+     * \param aClass Session class.
+     * \param aLimit Maximum number of sessions in each instance of the
+     *  class, 0 for unlimited.
+     */
+    void setClassLimit(LimitClass aClass, int aLimit);
+
+    //! \brief Gets the limit of a session class.
+    int classLimit(LimitClass aClass) const;
+
+    /*! \brief Checks if a session with the profile would be admitted now.
+     *
+     * \param aProfile Profile of the session.
+     * \return True if there is a free slot for the session.
+     */
+    bool canAdmit(const SyncProfile *aProfile) const;
+
+    /*! \brief Takes a slot for a started session.
+     *
+     * The slot is taken even if the limits are exceeded, so that sessions
+     * started by remote devices are also counted.
+     * \param aProfileName Name of the session profile.
+     * \param aProfile Profile of the session, may be null.
+     */
+    void admit(const QString &aProfileName, const SyncProfile *aProfile);
+
+    /*! \brief Releases the slot of a finished session.
+     *
+     * \param aProfileName Name of the session profile.
+     * \return True if the session had a slot.
+     */
+    bool release(const QString &aProfileName);
+
+    //! \brief Gets the number of sessions holding a slot.
+    int occupancy() const;
+
+    //! \brief Gets the highest number of sessions that held a slot at once.
+    int peakOccupancy() const;
+
+    /*! \brief Gets the current occupancy per class.
+     *
+     * \return Map with the Sync::CONCURRENCY_* keys of SyncCommonDefs.h.
+     */
+    QVariantMap status() const;
+
+    /*! \brief Gets the destination host of a profile.
+     *
+     * \param aProfile Profile.
+     * \return Host of the remote database URL or Bluetooth address of the
+     *  profile, empty if neither is set.
+     */
+    static QString host(const SyncProfile *aProfile);
+
+private:
+
+    struct Slot
+    {
+        int iDestination;
+        QString iClient;
+        QString iHost;
+    };
+
+    static Slot slotOf(const SyncProfile *aProfile);
+
+    static bool isFull(int aCount, int aLimit);
+
+    int iLimit;
+
+    int iClassLimits[LIMIT_CLASS_COUNT];
+
+    // Profile name -> slot of the running session.
+    QHash<QString, Slot> iSlots;
+
+    int iOnline;
+
+    int iDevice;
+
+    QHash<QString, int> iClients;
+
+    QHash<QString, int> iHosts;
+
+    int iPeak;
+
+#ifdef SYNCFW_UNIT_TESTS
+    friend class SyncGovernorTest;
+#endif
+};
+
+}
+
+#endif // SYNCGOVERNOR_H
@@ -27,12 +27,75 @@
 
 using namespace Buteo;
 
+const qint64 SyncQueue::DEFAULT_AGING_INTERVAL;
+
+SyncQueue::SyncQueue()
+:   iAgingInterval(DEFAULT_AGING_INTERVAL),
+    iSequence(0)
+{
+    FUNCTION_CALL_TRACE;
+
+    iClock.start();
+}
+
+SyncQueue::Priority SyncQueue::priority(const SyncSession *aSession)
+{
+    FUNCTION_CALL_TRACE;
+
+    if (aSession == 0 || aSession->trigger() == SyncSession::TRIGGER_MANUAL)
+    {
+        return PRIORITY_MANUAL;
+    } // no else
+
+    // Device sync has higher priority than online sync.
+    const SyncProfile *profile = aSession->profile();
+    if (profile != 0 &&
+        profile->destinationType() == SyncProfile::DESTINATION_TYPE_DEVICE)
+    {
+        return PRIORITY_DEVICE;
+    } // no else
+
+    switch (aSession->trigger())
+    {
+    case SyncSession::TRIGGER_SYNC_ON_CHANGE:
+        return PRIORITY_SYNC_ON_CHANGE;
+    case SyncSession::TRIGGER_RETRY:
+        return PRIORITY_RETRY;
+    default:
+        return PRIORITY_SCHEDULED;
+    }
+}
+
 void SyncQueue::enqueue(SyncSession *aSession)
 {
     FUNCTION_CALL_TRACE;
 
-    iItems.enqueue(aSession);
-    sort();
+    enqueue(aSession, iClock.elapsed());
+}
+
+void SyncQueue::enqueue(SyncSession *aSession, qint64 aTime)
+{
+    if (aSession == 0)
+    {
+        return;
+    } // no else
+
+    const QString name = aSession->profileName();
+    if (iHeap.contains(name))
+    {
+        LOG_WARNING("Profile already queued:" << name);
+        return;
+    } // no else
+
+    // Aging: an entry of class N ranks like a manual sync enqueued N aging
+    // intervals later. The rank never changes while the entry is queued,
+    // so the heap stays valid as time passes.
+    Entry entry;
+    entry.iSession = aSession;
+    entry.iRank = aTime + priority(aSession) * iAgingInterval;
+    entry.iSequence = iSequence++;
+
+    iHeap.insert(entry);
 }
 
 SyncSession *SyncQueue::dequeue()
@@ -41,9 +104,9 @@ SyncSession *SyncQueue::dequeue()
 
     SyncSession *p = NULL;
 
-    if (!iItems.isEmpty())
+    if (!iHeap.isEmpty())
     {
-        p = iItems.dequeue();
+        p = iHeap.takeFirst().iSession;
     } // no else
 
     return p;
@@ -52,17 +115,13 @@ SyncSession *SyncQueue::dequeue()
 SyncSession* SyncQueue::dequeue(const QString &aProfileName)
 {
     FUNCTION_CALL_TRACE;
+
     SyncSession *ret = 0;
-    QQueue<SyncSession*>::iterator i;
-    for (i = iItems.begin(); i != iItems.end(); ++i)
+    if (iHeap.contains(aProfileName))
     {
-        if ((*i)->profileName() == aProfileName)
-        {
-            ret = *i;
-            iItems.erase(i);
-            break;
-        }
-    }
+        ret = iHeap.take(aProfileName).iSession;
+    } // no else
+
     return ret;
 }
 
@@ -71,9 +130,9 @@ SyncSession *SyncQueue::head()
     FUNCTION_CALL_TRACE;
 
     SyncSession *p = NULL;
-    if (!iItems.isEmpty())
+    if (!iHeap.isEmpty())
     {
-        p = iItems.head();
+        p = iHeap.first().iSession;
     } // no else
 
     return p;
@@ -83,62 +142,70 @@ bool SyncQueue::isEmpty() const
 {
     FUNCTION_CALL_TRACE;
 
-    return iItems.isEmpty();
+    return iHeap.isEmpty();
 }
 
 int SyncQueue::size() const
 {
     FUNCTION_CALL_TRACE;
 
-    return iItems.size();
+    return iHeap.size();
 }
 
 bool SyncQueue::contains(const QString &aProfileName) const
 {
     FUNCTION_CALL_TRACE;
 
-    QQueue<SyncSession*>::const_iterator i;
-    for (i = iItems.begin(); i != iItems.end(); ++i)
-    {
-        if ((*i)->profileName() == aProfileName)
-            return true;
-    }
-
-    return false;
+    return iHeap.contains(aProfileName);
 }
 
-bool syncSessionPointerLessThan(SyncSession *&aLhs, SyncSession *&aRhs)
+SyncSession *SyncQueue::session(const QString &aProfileName) const
 {
-    if (aLhs && aRhs) {
-        // Manual sync has higher priority than scheduled sync.
-        if (aLhs->isScheduled() != aRhs->isScheduled())
-            return !aLhs->isScheduled();
+    FUNCTION_CALL_TRACE;
 
-        SyncProfile *lhsProfile = aLhs->profile();
-        SyncProfile *rhsProfile = aRhs->profile();
-        if (lhsProfile == 0 || rhsProfile == 0)
-            return false;
+    const Entry *entry = iHeap.find(aProfileName);
+    return entry != 0 ? entry->iSession : NULL;
+}
 
-        // Device sync has higher priority than online sync.
-        SyncProfile::DestinationType lhsDestType = lhsProfile->destinationType();
-        SyncProfile::DestinationType rhsDestType = rhsProfile->destinationType();
-        if (lhsDestType != rhsDestType)
-            return (lhsDestType == SyncProfile::DESTINATION_TYPE_DEVICE);
+QList<SyncSession*> SyncQueue::getQueuedSyncSessions() const
+{
+    FUNCTION_CALL_TRACE;
+
+    SyncQueue copy(*this);
+    QList<SyncSession*> sessions;
+    while (!copy.isEmpty())
+    {
+        sessions.append(copy.dequeue());
     }
 
-    return false;
+    return sessions;
 }
 
-void SyncQueue::sort()
+void SyncQueue::setAgingInterval(qint64 aInterval)
 {
     FUNCTION_CALL_TRACE;
 
-    // @todo: Sort queued profiles using some criteria.
+    iAgingInterval = qMax(aInterval, qint64(0));
 }
 
-const QList<SyncSession*>& SyncQueue::getQueuedSyncSessions() const
+qint64 SyncQueue::agingInterval() const
 {
     FUNCTION_CALL_TRACE;
-    return iItems;
+
+    return iAgingInterval;
+}
+
+bool SyncQueue::EntryTraits::lessThan(const Entry &aLhs, const Entry &aRhs)
+{
+    if (aLhs.iRank != aRhs.iRank)
+    {
+        return aLhs.iRank < aRhs.iRank;
+    } // no else
+
+    return aLhs.iSequence < aRhs.iSequence;
 }
 
+QString SyncQueue::EntryTraits::key(const Entry &aEntry)
+{
+    return aEntry.iSession->profileName();
+}
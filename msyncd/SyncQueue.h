@@ -23,7 +23,11 @@
 #ifndef SYNCQUEUE_H
 #define SYNCQUEUE_H
 
-#include <QQueue>
+#include <QList>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "IndexedHeap.h"
 
 namespace Buteo {
     
@@ -31,12 +35,46 @@ class SyncSession;
 
 /*! \brief Class for queuing sync sessions.
  *
- * The queue is sorted every time when new items are added to it, so that
- * the sync sessions with highest priority will be at the front of the queue.
+ * The queue is a binary heap ordered by priority class, so that the sync
+ * sessions with highest priority will be at the front of the queue. Sessions
+ * of the same class are served in the order they were added. Queued sessions
+ * age: every aging interval spent in the queue counts as one class higher, so
+ * background syncs are not starved by a steady stream of manual syncs.
+ *
+ * Sessions are also indexed by profile name, so looking up and removing a
+ * queued profile does not need to scan the queue.
  */
 class SyncQueue
 {
 public:
+    //! \brief Priority classes, from the highest to the lowest
+    enum Priority
+    {
+        //! Sync requested by the user
+        PRIORITY_MANUAL,
+        //! Background sync with a device
+        PRIORITY_DEVICE,
+        //! Background sync caused by a storage change
+        PRIORITY_SYNC_ON_CHANGE,
+        //! Background sync started by the schedule
+        PRIORITY_SCHEDULED,
+        //! Retry of a failed sync
+        PRIORITY_RETRY
+    };
+
+    //! \brief Default time a session waits to be raised by one class
+    static const qint64 DEFAULT_AGING_INTERVAL = 2 * 60 * 1000;
+
+    //! \brief Constructor
+    SyncQueue();
+
+    /*! \brief Gets the priority class of a session.
+     *
+     * \param aSession Session
+     * \return Priority class of the session
+     */
+    static Priority priority(const SyncSession *aSession);
+
     /*! \brief Adds a new profile to the queue. Queue is sorted automatically.
      *
      * \param aSession Session to add to queue
@@ -45,7 +83,7 @@ public:
 
     /*! \brief Removes the sync session corresponding to the profile name and returns it.
      *
-     * \return The removed item. NULL if the queue was empty.
+     * \return The removed item. NULL if the profile was not queued.
      */
     SyncSession *dequeue(const QString &aProfileName);
 
@@ -79,18 +117,62 @@ public:
      */
     bool contains(const QString &aProfileName) const;
 
-    /*! \brief Returns as a const reference, the list of all SyncSessions
-     * currently queued.
+    /*! \brief Returns the queued session of a profile but does not remove it.
      *
-     * \return Is the profile in the queue.
+     * \return The session. NULL if the profile was not queued.
+     */
+    SyncSession *session(const QString &aProfileName) const;
+
+    /*! \brief Returns the list of all SyncSessions currently queued.
+     *
+     * \return Queued sessions, in the order they would be dequeued.
      */
-    const QList<SyncSession*>& getQueuedSyncSessions() const;
+    QList<SyncSession*> getQueuedSyncSessions() const;
+
+    /*! \brief Sets how long a session waits before it is raised by one class.
+     *
+     * Only affects sessions enqueued after the call.
+     * \param aInterval Aging interval in milliseconds
+     */
+    void setAgingInterval(qint64 aInterval);
+
+    /*! \brief Gets the aging interval.
+     *
+     * \return Aging interval in milliseconds
+     */
+    qint64 agingInterval() const;
 
 private:
 
-    void sort();
+    struct Entry
+    {
+        SyncSession *iSession;
+        // Time at which the entry ranks like a fresh manual sync.
+        qint64 iRank;
+        quint64 iSequence;
+    };
+
+    // Orders the entries and keys them by profile name.
+    struct EntryTraits
+    {
+        static bool lessThan(const Entry &aLhs, const Entry &aRhs);
+
+        static QString key(const Entry &aEntry);
+    };
+
+    void enqueue(SyncSession *aSession, qint64 aTime);
+
+    IndexedHeap<QString, Entry, EntryTraits> iHeap;
+
+    qint64 iAgingInterval;
+
+    quint64 iSequence;
+
+    QElapsedTimer iClock;
 
-    QQueue<SyncSession*> iItems;
+#ifdef SYNCFW_UNIT_TESTS
+    friend class SyncQueueTest;
+#endif
 };
 
 }
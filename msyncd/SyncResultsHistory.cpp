@@ -0,0 +1,396 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "SyncResultsHistory.h"
+#include "SyncResults.h"
+#include "SyncCommonDefs.h"
+#include "LogMacros.h"
+
+#include <QDir>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <limits>
+
+using namespace Buteo;
+
+static const QString HISTORY_CONNECTION_NAME("synchistory");
+static const QString HISTORY_DB_FILE("synchistory.db.sqlite");
+
+static void bindValues(QSqlQuery &aQuery, const QVariantMap &aBinds)
+{
+    for (QVariantMap::const_iterator i = aBinds.constBegin();
+         i != aBinds.constEnd(); ++i)
+    {
+        aQuery.bindValue(i.key(), i.value());
+    }
+}
+
+static unsigned itemCount(const ItemCounts &aCounts)
+{
+    return aCounts.added + aCounts.deleted + aCounts.modified;
+}
+
+SyncResultsHistory::SyncResultsHistory()
+:   iRetentionDays(DEFAULT_RETENTION_DAYS)
+{
+    // empty. explicitly call init
+}
+
+SyncResultsHistory::~SyncResultsHistory()
+{
+    FUNCTION_CALL_TRACE;
+
+    if (!iConnectionName.isEmpty())
+    {
+        iDb.close();
+        iDb = QSqlDatabase();
+        QSqlDatabase::removeDatabase(iConnectionName);
+    } // no else
+}
+
+bool SyncResultsHistory::init(const QString &aDbFile)
+{
+    FUNCTION_CALL_TRACE;
+
+    QString path = aDbFile;
+    if (path.isEmpty())
+    {
+        QDir().mkpath(Sync::syncCacheDir());
+        path = Sync::syncCacheDir() + QDir::separator() + HISTORY_DB_FILE;
+    } // no else
+
+    static unsigned connectionNumber = 0;
+    iConnectionName = HISTORY_CONNECTION_NAME + QString::number(connectionNumber++);
+    iDb = QSqlDatabase::addDatabase("QSQLITE", iConnectionName);
+    iDb.setDatabaseName(QDir::toNativeSeparators(path));
+
+    if (!iDb.open())
+    {
+        LOG_CRITICAL("Failed to open sync history database" << path);
+        return false;
+    } // no else
+
+    if (!createTables())
+    {
+        iDb.close();
+        return false;
+    } // no else
+
+    purge(QDateTime::currentDateTime().addDays(-iRetentionDays));
+
+    return true;
+}
+
+bool SyncResultsHistory::createTables()
+{
+    FUNCTION_CALL_TRACE;
+
+    const QStringList statements = QStringList()
+        << "PRAGMA foreign_keys = ON"
+        << "CREATE TABLE IF NOT EXISTS history("
+           "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+           "profile TEXT NOT NULL, "
+           "synctime INTEGER NOT NULL, "
+           "duration INTEGER NOT NULL, "
+           "majorcode INTEGER NOT NULL, "
+           "minorcode INTEGER NOT NULL, "
+           "scheduled INTEGER NOT NULL, "
+           "items INTEGER NOT NULL)"
+        << "CREATE INDEX IF NOT EXISTS history_profile ON history(profile, synctime)"
+        << "CREATE INDEX IF NOT EXISTS history_time ON history(synctime)"
+        << "CREATE TABLE IF NOT EXISTS targets("
+           "result INTEGER NOT NULL REFERENCES history(id) ON DELETE CASCADE, "
+           "target TEXT NOT NULL, "
+           "local_added INTEGER NOT NULL, "
+           "local_deleted INTEGER NOT NULL, "
+           "local_modified INTEGER NOT NULL, "
+           "remote_added INTEGER NOT NULL, "
+           "remote_deleted INTEGER NOT NULL, "
+           "remote_modified INTEGER NOT NULL)"
+        << "CREATE INDEX IF NOT EXISTS targets_result ON targets(result)"
+        << "CREATE TABLE IF NOT EXISTS triggers("
+           "result INTEGER NOT NULL REFERENCES history(id) ON DELETE CASCADE, "
+           "reason TEXT NOT NULL)"
+        << "CREATE INDEX IF NOT EXISTS triggers_result ON triggers(result)";
+
+    QSqlQuery query(iDb);
+    foreach (const QString &statement, statements)
+    {
+        if (!query.exec(statement))
+        {
+            LOG_WARNING("Failed to create sync history tables:"
+                        << query.lastError().text());
+            return false;
+        } // no else
+    }
+
+    return true;
+}
+
+void SyncResultsHistory::setRetention(int aDays)
+{
+    iRetentionDays = aDays;
+}
+
+int SyncResultsHistory::retention() const
+{
+    return iRetentionDays;
+}
+
+bool SyncResultsHistory::record(const QString &aProfileName,
+                                const SyncResults &aResults, qint64 aDuration,
+                                const QStringList &aReasons)
+{
+    FUNCTION_CALL_TRACE;
+
+    if (!iDb.isOpen())
+    {
+        return false;
+    } // no else
+
+    const QList<TargetResults> targets = aResults.targetResults();
+    qlonglong items = 0;
+    foreach (const TargetResults &target, targets)
+    {
+        items += itemCount(target.localItems()) + itemCount(target.remoteItems());
+    }
+
+    const QDateTime syncTime = aResults.syncTime().isValid() ?
+        aResults.syncTime() : QDateTime::currentDateTime();
+
+    iDb.transaction();
+
+    QSqlQuery query(iDb);
+    query.prepare("INSERT INTO history(profile, synctime, duration, majorcode, "
+                  "minorcode, scheduled, items) VALUES (:profile, :synctime, "
+                  ":duration, :majorcode, :minorcode, :scheduled, :items)");
+    query.bindValue(":profile", aProfileName);
+    query.bindValue(":synctime", syncTime.toMSecsSinceEpoch());
+    query.bindValue(":duration", qMax<qint64>(aDuration, 0));
+    query.bindValue(":majorcode", aResults.majorCode());
+    query.bindValue(":minorcode", aResults.minorCode());
+    query.bindValue(":scheduled", aResults.isScheduled() ? 1 : 0);
+    query.bindValue(":items", items);
+    if (!query.exec())
+    {
+        LOG_WARNING("Failed to record sync results of" << aProfileName << ":"
+                    << query.lastError().text());
+        iDb.rollback();
+        return false;
+    } // no else
+
+    const QVariant resultId = query.lastInsertId();
+
+    QSqlQuery targetQuery(iDb);
+    targetQuery.prepare("INSERT INTO targets(result, target, local_added, "
+                        "local_deleted, local_modified, remote_added, "
+                        "remote_deleted, remote_modified) VALUES (:result, "
+                        ":target, :la, :ld, :lm, :ra, :rd, :rm)");
+    foreach (const TargetResults &target, targets)
+    {
+        const ItemCounts local = target.localItems();
+        const ItemCounts remote = target.remoteItems();
+        targetQuery.bindValue(":result", resultId);
+        targetQuery.bindValue(":target", target.targetName());
+        targetQuery.bindValue(":la", local.added);
+        targetQuery.bindValue(":ld", local.deleted);
+        targetQuery.bindValue(":lm", local.modified);
+        targetQuery.bindValue(":ra", remote.added);
+        targetQuery.bindValue(":rd", remote.deleted);
+        targetQuery.bindValue(":rm", remote.modified);
+        if (!targetQuery.exec())
+        {
+            LOG_WARNING("Failed to record target results of" << aProfileName
+                        << ":" << targetQuery.lastError().text());
+            iDb.rollback();
+            return false;
+        } // no else
+    }
+
+    QSqlQuery triggerQuery(iDb);
+    triggerQuery.prepare("INSERT INTO triggers(result, reason) VALUES (:result, :reason)");
+    foreach (const QString &reason, aReasons)
+    {
+        triggerQuery.bindValue(":result", resultId);
+        triggerQuery.bindValue(":reason", reason);
+        if (!triggerQuery.exec())
+        {
+            LOG_WARNING("Failed to record sync triggers of" << aProfileName
+                        << ":" << triggerQuery.lastError().text());
+            iDb.rollback();
+            return false;
+        } // no else
+    }
+
+    purge(QDateTime::currentDateTime().addDays(-iRetentionDays));
+
+    return iDb.commit();
+}
+
+int SyncResultsHistory::purge(const QDateTime &aBefore)
+{
+    FUNCTION_CALL_TRACE;
+
+    if (!iDb.isOpen())
+    {
+        return -1;
+    } // no else
+
+    QSqlQuery query(iDb);
+    query.prepare("DELETE FROM history WHERE synctime < :before");
+    query.bindValue(":before", aBefore.toMSecsSinceEpoch());
+    if (!query.exec())
+    {
+        LOG_WARNING("Failed to purge sync history:" << query.lastError().text());
+        return -1;
+    } // no else
+
+    const int removed = query.numRowsAffected();
+    if (removed > 0)
+    {
+        LOG_DEBUG("Removed" << removed << "results from sync history");
+    } // no else
+    return removed;
+}
+
+qint64 SyncResultsHistory::durationAt(const QString &aWhere,
+                                      const QVariantMap &aBinds,
+                                      qint64 aOffset) const
+{
+    QSqlQuery query(iDb);
+    query.prepare("SELECT duration FROM history " + aWhere +
+                  " ORDER BY duration LIMIT 1 OFFSET :offset");
+    bindValues(query, aBinds);
+    query.bindValue(":offset", aOffset);
+    if (query.exec() && query.next())
+    {
+        return query.value(0).toLongLong();
+    } // no else
+    return 0;
+}
+
+QVariantMap SyncResultsHistory::statistics(const QString &aProfileName,
+                                           const QDateTime &aFrom,
+                                           const QDateTime &aTo) const
+{
+    FUNCTION_CALL_TRACE;
+
+    QVariantMap stats;
+    if (!iDb.isOpen())
+    {
+        return stats;
+    } // no else
+
+    QString where("WHERE synctime >= :from AND synctime <= :to");
+    QVariantMap binds;
+    binds[":from"] = aFrom.isValid() ? aFrom.toMSecsSinceEpoch() :
+        std::numeric_limits<qint64>::min();
+    binds[":to"] = aTo.isValid() ? aTo.toMSecsSinceEpoch() :
+        std::numeric_limits<qint64>::max();
+    if (!aProfileName.isEmpty())
+    {
+        where += " AND profile = :profile";
+        binds[":profile"] = aProfileName;
+    } // no else
+
+    QSqlQuery query(iDb);
+    query.prepare("SELECT COUNT(*), TOTAL(majorcode = :success), TOTAL(items), "
+                  "TOTAL(CASE WHEN duration > 0 THEN items ELSE 0 END), "
+                  "TOTAL(duration) FROM history " + where);
+    bindValues(query, binds);
+    query.bindValue(":success", static_cast<int>(SyncResults::SYNC_RESULT_SUCCESS));
+    if (!query.exec() || !query.next())
+    {
+        LOG_WARNING("Failed to query sync history:" << query.lastError().text());
+        return stats;
+    } // no else
+
+    const qint64 count = query.value(0).toLongLong();
+    const qint64 successCount = query.value(1).toLongLong();
+    const qint64 items = query.value(2).toLongLong();
+    const qint64 timedItems = query.value(3).toLongLong();
+    const qint64 totalDuration = query.value(4).toLongLong();
+
+    stats[Sync::STATS_COUNT] = count;
+    stats[Sync::STATS_SUCCESS_COUNT] = successCount;
+    stats[Sync::STATS_SUCCESS_RATE] = count > 0 ? double(successCount) / count : 0.0;
+    stats[Sync::STATS_ITEMS] = items;
+    stats[Sync::STATS_ITEMS_PER_SECOND] = totalDuration > 0 ?
+        timedItems * 1000.0 / totalDuration : 0.0;
+
+    // Nearest-rank percentiles.
+    if (count > 0)
+    {
+        stats[Sync::STATS_DURATION_P50] = durationAt(where, binds, (count * 50 + 99) / 100 - 1);
+        stats[Sync::STATS_DURATION_P95] = durationAt(where, binds, (count * 95 + 99) / 100 - 1);
+    }
+    else
+    {
+        stats[Sync::STATS_DURATION_P50] = qint64(0);
+        stats[Sync::STATS_DURATION_P95] = qint64(0);
+    }
+
+    QVariantMap errorCodes;
+    query.prepare("SELECT minorcode, COUNT(*) FROM history " + where +
+                  " AND majorcode != :success GROUP BY minorcode");
+    bindValues(query, binds);
+    query.bindValue(":success", static_cast<int>(SyncResults::SYNC_RESULT_SUCCESS));
+    if (query.exec())
+    {
+        while (query.next())
+        {
+            errorCodes[query.value(0).toString()] = query.value(1).toLongLong();
+        }
+    } // no else
+    stats[Sync::STATS_ERROR_CODES] = errorCodes;
+
+    QVariantMap targetItems;
+    query.prepare("SELECT target, TOTAL(local_added + local_deleted + "
+                  "local_modified + remote_added + remote_deleted + "
+                  "remote_modified) FROM targets JOIN history ON "
+                  "targets.result = history.id " + where + " GROUP BY target");
+    bindValues(query, binds);
+    if (query.exec())
+    {
+        while (query.next())
+        {
+            targetItems[query.value(0).toString()] = query.value(1).toLongLong();
+        }
+    } // no else
+    stats[Sync::STATS_TARGET_ITEMS] = targetItems;
+
+    QVariantMap triggers;
+    query.prepare("SELECT reason, COUNT(*) FROM triggers JOIN history ON "
+                  "triggers.result = history.id " + where + " GROUP BY reason");
+    bindValues(query, binds);
+    if (query.exec())
+    {
+        while (query.next())
+        {
+            triggers[query.value(0).toString()] = query.value(1).toLongLong();
+        }
+    } // no else
+    stats[Sync::STATS_TRIGGERS] = triggers;
+
+    return stats;
+}
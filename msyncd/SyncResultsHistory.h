@@ -0,0 +1,128 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef SYNCRESULTSHISTORY_H
+#define SYNCRESULTSHISTORY_H
+
+#include <QDateTime>
+#include <QVariantMap>
+#include <QStringList>
+#include <QSqlDatabase>
+
+namespace Buteo {
+
+class SyncResults;
+
+/*! \brief Long-term store of sync results.
+ *
+ * The sync log of a profile only keeps the last few results. This class
+ * keeps every result, including the item counts of all targets and the
+ * duration of the session, in an SQLite database for a configurable number
+ * of days and computes aggregates over a time window from it.
+ */
+class SyncResultsHistory
+{
+public:
+    //! Number of days results are kept by default.
+    static const int DEFAULT_RETENTION_DAYS = 90;
+
+    /*! \brief Constructor.
+     *
+     * Call init() before using other methods of this class.
+     */
+    SyncResultsHistory();
+
+    /*! \brief Destructor.
+     */
+    ~SyncResultsHistory();
+
+    /*! \brief Opens the history database, creating it if needed.
+     *
+     * Results older than the retention time are removed.
+     * \param aDbFile Path of the database file. By default the file is
+     *  placed in the sync cache directory.
+     * \return True on success.
+     */
+    bool init(const QString &aDbFile = QString());
+
+    /*! \brief Sets how long results are kept.
+     *
+     * \param aDays Retention time in days.
+     */
+    void setRetention(int aDays);
+
+    /*! \brief Gets how long results are kept.
+     *
+     * \return Retention time in days.
+     */
+    int retention() const;
+
+    /*! \brief Adds a result to the history.
+     *
+     * \param aProfileName Name of the sync profile the result belongs to.
+     * \param aResults Results of the sync session.
+     * \param aDuration Duration of the session in milliseconds.
+     * \param aReasons Names of the trigger sources that started the session.
+     * \return True on success.
+     */
+    bool record(const QString &aProfileName, const SyncResults &aResults,
+                qint64 aDuration, const QStringList &aReasons = QStringList());
+
+    /*! \brief Computes aggregates of the results in a time window.
+     *
+     * The keys of the returned map are the Sync::STATS_* constants.
+     * \param aProfileName Name of the profile. An empty name covers all
+     *  profiles.
+     * \param aFrom Start of the window, inclusive. An invalid time means no
+     *  lower bound.
+     * \param aTo End of the window, inclusive. An invalid time means no
+     *  upper bound.
+     * \return Aggregates, empty if the database is not open.
+     */
+    QVariantMap statistics(const QString &aProfileName, const QDateTime &aFrom,
+                           const QDateTime &aTo) const;
+
+    /*! \brief Removes results older than the given time.
+     *
+     * \param aBefore Results synced before this time are removed.
+     * \return Number of removed results, -1 on failure.
+     */
+    int purge(const QDateTime &aBefore);
+
+private:
+
+    bool createTables();
+
+    qint64 durationAt(const QString &aWhere, const QVariantMap &aBinds,
+                      qint64 aOffset) const;
+
+    QSqlDatabase iDb;
+
+    QString iConnectionName;
+
+    int iRetentionDays;
+};
+
+}
+
+#endif // SYNCRESULTSHISTORY_H
@@ -35,7 +35,8 @@
 using namespace Buteo;
 
 SyncScheduler::SyncScheduler(QObject *aParent)
-:   QObject(aParent)
+:   QObject(aParent),
+    iWakeWindow(0)
 {
     FUNCTION_CALL_TRACE;
 
@@ -57,6 +58,9 @@ SyncScheduler::SyncScheduler(QObject *aParent)
     	if(!iAlarmInventory->init()) {
     		LOG_WARNING("AlarmInventory Init Failed");
     	}
+    	// Alarms stored by an earlier instance are taken over by the profiles
+    	// scheduled at the same times, see removeUnclaimedAlarms().
+    	iUnclaimedAlarms = iAlarmInventory->alarmIds().toSet();
     }
 #endif
 }
@@ -68,7 +72,7 @@ SyncScheduler::~SyncScheduler()
 #ifdef USE_KEEPALIVE
     iBackgroundActivity->removeAll();
 #else
-    removeAllAlarms();
+    // The alarms are kept for the next instance.
     if (iAlarmInventory) {
         delete iAlarmInventory;
         iAlarmInventory = 0;
@@ -143,24 +147,42 @@ bool SyncScheduler::addProfile(const SyncProfile* aProfile)
 void SyncScheduler::removeProfile(const QString &aProfileName)
 {
     FUNCTION_CALL_TRACE;
+
+    iWakeTimes.remove(aProfileName);
 #ifdef USE_KEEPALIVE
     if(iBackgroundActivity->remove(aProfileName)) {
         LOG_DEBUG("Scheduled sync removed: profile =" << aProfileName);
     }
 #else
     if (iSyncScheduleProfiles.contains(aProfileName)) {
-        int alarmEventID = iSyncScheduleProfiles.value(aProfileName);
-        removeAlarmEvent(alarmEventID);
-        iSyncScheduleProfiles.remove(aProfileName);
+        int alarmEventID = iSyncScheduleProfiles.take(aProfileName);
+        // Other profiles may still be woken up by the same alarm.
+        if (iSyncScheduleProfiles.keys(alarmEventID).isEmpty()) {
+            removeAlarmEvent(alarmEventID);
+        }
         LOG_DEBUG("Scheduled sync removed: profile =" << aProfileName);
     }
 #endif
 }
 
+void SyncScheduler::setWakeAlignment(int aWindow)
+{
+    FUNCTION_CALL_TRACE;
+
+    iWakeWindow = qMax(aWindow, 0);
+    LOG_DEBUG("Wake-up alignment window:" << iWakeWindow << "s");
+}
+
+int SyncScheduler::wakeAlignment() const
+{
+    return iWakeWindow;
+}
+
 void SyncScheduler::doIPHeartbeatActions(QString aProfileName)
 {
     FUNCTION_CALL_TRACE;
 
+    iWakeTimes.remove(aProfileName);
     emit syncNow(aProfileName);
 }
 
@@ -195,7 +217,8 @@ int SyncScheduler::setNextAlarm(const SyncProfile* aProfile, QDateTime aNextSync
     QDateTime nextSyncTime;
     if(!aNextSyncTime.isValid())
     {
-        nextSyncTime = aProfile->nextSyncTime(aProfile->lastSyncTime());
+        nextSyncTime = alignedSyncTime(aProfile,
+                                       aProfile->nextSyncTime(aProfile->lastSyncTime()));
     }
     else
     {
@@ -223,13 +246,35 @@ int SyncScheduler::setNextAlarm(const SyncProfile* aProfile, QDateTime aNextSync
             iBackgroundActivity->removeSwitch(aProfile->name());
         }
 #else
-        iAlarmInventory->addAlarm(nextSyncTime);
+        // Profiles woken up at the same time share one alarm.
+        for (QMap<QString, int>::const_iterator i = iSyncScheduleProfiles.constBegin();
+             i != iSyncScheduleProfiles.constEnd(); ++i)
+        {
+            if (i.key() != aProfile->name() && iWakeTimes.value(i.key()) == nextSyncTime)
+            {
+                alarmEventID = i.value();
+                LOG_DEBUG("Sharing alarm" << alarmEventID << "with profile" << i.key());
+                break;
+            }
+        }
+        if (alarmEventID <= 0)
+        {
+            alarmEventID = claimAlarm(nextSyncTime);
+        }
+        if (alarmEventID <= 0)
+        {
+            alarmEventID = iAlarmInventory->addAlarm(nextSyncTime);
+        }
 #endif
-        if (alarmEventID == 0)
+        if (alarmEventID <= 0)
         {
             LOG_WARNING("Failed to add alarm for scheduled sync of profile"
                 << aProfile->name());
         }
+        else
+        {
+            iWakeTimes.insert(aProfile->name(), nextSyncTime);
+        }
     }
     else {
         LOG_WARNING("Next sync time is not valid, sync not scheduled for profile"
@@ -239,24 +284,96 @@ int SyncScheduler::setNextAlarm(const SyncProfile* aProfile, QDateTime aNextSync
     return alarmEventID;
 }
 
+QDateTime SyncScheduler::alignedSyncTime(const SyncProfile *aProfile,
+                                         const QDateTime &aSyncTime) const
+{
+    FUNCTION_CALL_TRACE;
+
+    const qint64 tolerance = wakeTolerance(aProfile);
+    if (iWakeWindow <= 0 || tolerance <= 0 || !aSyncTime.isValid())
+    {
+        return aSyncTime;
+    } // no else
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch() / 1000;
+    const qint64 syncTime = aSyncTime.toMSecsSinceEpoch() / 1000;
+
+    // Joining a wake-up already planned for another profile is preferred,
+    // the device is then woken up once for both.
+    QDateTime shared;
+    qint64 sharedDistance = 0;
+    for (QMap<QString, QDateTime>::const_iterator i = iWakeTimes.constBegin();
+         i != iWakeTimes.constEnd(); ++i)
+    {
+        const qint64 wakeTime = i.value().toMSecsSinceEpoch() / 1000;
+        const qint64 distance = qAbs(wakeTime - syncTime);
+        if (i.key() != aProfile->name() && wakeTime >= now && distance <= tolerance &&
+            (!shared.isValid() || distance < sharedDistance))
+        {
+            shared = i.value();
+            sharedDistance = distance;
+        } // no else
+    }
+    if (shared.isValid())
+    {
+        LOG_DEBUG("Sync of" << aProfile->name() << "moved from" << aSyncTime
+                  << "to shared wake-up" << shared);
+        return shared;
+    } // no else
+
+    // Otherwise the start of the nearest window is used, so that profiles
+    // scheduled later can join it.
+    qint64 windowStart = (syncTime + iWakeWindow / 2) / iWakeWindow * iWakeWindow;
+    if (windowStart < now)
+    {
+        windowStart += iWakeWindow;
+    } // no else
+    if (qAbs(windowStart - syncTime) <= tolerance)
+    {
+        const QDateTime aligned = QDateTime::fromMSecsSinceEpoch(windowStart * 1000);
+        LOG_DEBUG("Sync of" << aProfile->name() << "moved from" << aSyncTime
+                  << "to wake-up window" << aligned);
+        return aligned;
+    } // no else
+
+    return aSyncTime;
+}
+
+qint64 SyncScheduler::wakeTolerance(const SyncProfile *aProfile)
+{
+    const SyncSchedule schedule = aProfile->syncSchedule();
+    unsigned interval = schedule.interval();
+    if (schedule.rushEnabled() && schedule.rushInterval() > 0 &&
+        (interval == 0 || schedule.rushInterval() < interval))
+    {
+        interval = schedule.rushInterval();
+    } // no else
+
+    // Intervals are in minutes.
+    return qint64(interval) * 60 / WAKE_TOLERANCE_DIVISOR;
+}
+
 #ifndef USE_KEEPALIVE
 void SyncScheduler::doAlarmActions(int aAlarmEventID)
 {
     FUNCTION_CALL_TRACE;
-    
-    const QString syncProfileName
-        = iSyncScheduleProfiles.key(aAlarmEventID);
-    
-    if (!syncProfileName.isEmpty()) {
+
+    iUnclaimedAlarms.remove(aAlarmEventID);
+
+    // All profiles sharing the alarm are synced on the same wake-up.
+    const QStringList syncProfileNames = iSyncScheduleProfiles.keys(aAlarmEventID);
+
+    foreach (const QString &syncProfileName, syncProfileNames) {
         iSyncScheduleProfiles.remove(syncProfileName);
+        iWakeTimes.remove(syncProfileName);
         // Use global slots (min time == max time) for scheduling heart beats.
         if(iIPHeartBeatMan->setHeartBeat(syncProfileName, IPHB_GS_WAIT_2_5_MINS, IPHB_GS_WAIT_2_5_MINS)) {
         //Do nothing, sync will be triggered on getting heart beat
         } else {
             emit syncNow(syncProfileName);
         }
-    } // no else, in error cases simply ignore
-    
+    } // in error cases simply ignore
+
 }
 
 void SyncScheduler::removeAlarmEvent(int aAlarmEventID)
@@ -274,10 +391,28 @@ void SyncScheduler::removeAlarmEvent(int aAlarmEventID)
     }
 }
 
-void SyncScheduler::removeAllAlarms()
+int SyncScheduler::claimAlarm(const QDateTime &aTime)
+{
+    // Stored alarm times are precise to the second.
+    foreach (int alarmId, iUnclaimedAlarms) {
+        if (iAlarmInventory->alarmTime(alarmId).toTime_t() == aTime.toTime_t()) {
+            iUnclaimedAlarms.remove(alarmId);
+            LOG_DEBUG("Taking over stored alarm" << alarmId);
+            return alarmId;
+        }
+    }
+    return -1;
+}
+#endif
+
+void SyncScheduler::removeUnclaimedAlarms()
 {
     FUNCTION_CALL_TRACE;
 
-    iAlarmInventory->removeAllAlarms();
-}
+#ifndef USE_KEEPALIVE
+    foreach (int alarmId, iUnclaimedAlarms) {
+        removeAlarmEvent(alarmId);
+    }
+    iUnclaimedAlarms.clear();
 #endif
+}
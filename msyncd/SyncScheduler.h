@@ -32,6 +32,7 @@
 #endif
 #include <QObject>
 #include <QMap>
+#include <QSet>
 #include <QDateTime>
 #include <ctime>
 
@@ -55,6 +56,11 @@ class SyncScheduler : public QObject
 
 public:
 
+    /*! \brief Part of its sync interval a scheduled sync may be moved by to
+     *  share a wake-up with other profiles, as a divisor of the interval.
+     */
+    static const int WAKE_TOLERANCE_DIVISOR = 4;
+
     //! \brief Constructor.
     SyncScheduler(QObject *aParent = 0);
     
@@ -93,6 +99,34 @@ public:
      */
     void removeProfile(const QString &aProfileName);
 
+    /*! \brief Removes the stored alarms no profile has taken over.
+     *
+     * Alarms of an earlier scheduler instance are kept. A profile scheduled
+     * at the time of a stored alarm takes it over instead of adding a new
+     * one. Call this after the profiles have been added, the remaining
+     * alarms belong to profiles that are no longer scheduled.
+     */
+    void removeUnclaimedAlarms();
+
+    /*! \brief Sets the length of the shared wake-up windows.
+     *
+     * When set, the next sync of a profile scheduled by interval is moved to
+     * a wake-up already planned for another profile, or to the start of a
+     * window, if that is within the tolerance of the profile. The tolerance
+     * is the shortest sync interval of the profile divided by
+     * WAKE_TOLERANCE_DIVISOR. Profiles synced at a fixed time of day and
+     * retries of failed syncs are not moved. Only affects syncs scheduled
+     * after the call.
+     * \param aWindow Window length in seconds, 0 to disable alignment.
+     */
+    void setWakeAlignment(int aWindow);
+
+    /*! \brief Gets the length of the shared wake-up windows.
+     *
+     * \return Window length in seconds, 0 if alignment is disabled.
+     */
+    int wakeAlignment() const;
+
 private slots:
 
 #ifndef USE_KEEPALIVE
@@ -146,6 +180,23 @@ private: // functions
      * @return Unique alarm event ID or 0 in failure case.
      */
     int setNextAlarm(const SyncProfile* aProfile, QDateTime aNextSyncTime = QDateTime());
+
+    /**
+     * \brief Moves a sync time to a shared wake-up, see setWakeAlignment().
+     *
+     * @param aProfile The profile to sync
+     * @param aSyncTime Next sync time computed from the schedule
+     * @return The aligned sync time, aSyncTime if it can not be moved
+     */
+    QDateTime alignedSyncTime(const SyncProfile *aProfile, const QDateTime &aSyncTime) const;
+
+    /**
+     * \brief Gets how far the sync of a profile may be moved.
+     *
+     * @param aProfile The profile to sync
+     * @return Tolerance in seconds, 0 if the sync must not be moved
+     */
+    static qint64 wakeTolerance(const SyncProfile *aProfile);
     
     /**
      * \brief Creates a DBUS adaptor for the scheduler
@@ -160,21 +211,33 @@ private: // functions
     void removeAlarmEvent(int aAlarmEvent);
     
     /**
-     * \brief A convenience method that removes all alarms from alarmd queue
+     * \brief Takes over a stored alarm of an earlier instance
+     * @param aTime Time of the alarm
+     * @return ID of the alarm, -1 if no unclaimed alarm has the time
      */
-    void removeAllAlarms();
+    int claimAlarm(const QDateTime &aTime);
 #endif
     
 private: // data
 
+    /// Length of the shared wake-up windows in seconds, 0 if disabled
+    int iWakeWindow;
+
+    /// Planned wake-up time of each scheduled profile
+    QMap<QString, QDateTime> iWakeTimes;
+
 #ifdef USE_KEEPALIVE
     /// BackgroundSync management object
     BackgroundSync *iBackgroundActivity;
     ProfileManager iProfileManager;
 #else
-    /// A list of sync schedule profiles
+    /// Alarm of each scheduled profile. Profiles sharing a wake-up share
+    /// the alarm.
     QMap<QString, int> iSyncScheduleProfiles;
 
+    /// Stored alarms not taken over by a profile yet
+    QSet<int> iUnclaimedAlarms;
+
     /// Alarm factory object
     SyncAlarmInventory      *iAlarmInventory;
 
@@ -38,6 +38,7 @@ SyncSession::SyncSession(SyncProfile *aProfile, QObject *aParent)
     iErrorCode(0),
     iPluginRunnerOwned(false),
     iScheduled(false),
+    iTrigger(TRIGGER_MANUAL),
     iAborted(false),
     iStarted(false),
     iFinished(false),
@@ -126,6 +127,7 @@ bool SyncSession::start()
     FUNCTION_CALL_TRACE;
 
     bool rv = false;
+    iRunTime.start();
     // If this is an online session, then we need to ensure that the network
     // session is opened before starting our plugin runner
     
@@ -270,12 +272,25 @@ SyncResults SyncSession::results() const
     return iResults;
 }
 
+qint64 SyncSession::duration() const
+{
+    return iRunTime.isValid() ? iRunTime.elapsed() : 0;
+}
+
 
 void SyncSession::setScheduled(bool aScheduled)
 {
     FUNCTION_CALL_TRACE;
 
     iScheduled = aScheduled;
+    if (!aScheduled)
+    {
+        iTrigger = TRIGGER_MANUAL;
+    }
+    else if (iTrigger == TRIGGER_MANUAL)
+    {
+        iTrigger = TRIGGER_SCHEDULE;
+    } // no else
 }
 
 bool SyncSession::isScheduled() const
@@ -285,6 +300,35 @@ bool SyncSession::isScheduled() const
     return iScheduled;
 }
 
+void SyncSession::setTrigger(Trigger aTrigger)
+{
+    FUNCTION_CALL_TRACE;
+
+    iTrigger = aTrigger;
+    iScheduled = (aTrigger != TRIGGER_MANUAL);
+}
+
+SyncSession::Trigger SyncSession::trigger() const
+{
+    FUNCTION_CALL_TRACE;
+
+    return iTrigger;
+}
+
+void SyncSession::setTriggerReasons(const QStringList &aReasons)
+{
+    FUNCTION_CALL_TRACE;
+
+    iTriggerReasons = aReasons;
+}
+
+QStringList SyncSession::triggerReasons() const
+{
+    FUNCTION_CALL_TRACE;
+
+    return iTriggerReasons;
+}
+
 void SyncSession::onSuccess(const QString &aProfileName, const QString &aMessage)
 {
     FUNCTION_CALL_TRACE;
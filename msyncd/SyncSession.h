@@ -28,6 +28,8 @@
 #include "SyncResults.h"
 #include <QObject>
 #include <QMap>
+#include <QElapsedTimer>
+#include <QStringList>
 
 namespace Buteo {
 
@@ -46,6 +48,19 @@ class SyncSession : public QObject
 
 public:
 
+    //! \brief What caused the session to be started
+    enum Trigger
+    {
+        //! Started on user request
+        TRIGGER_MANUAL,
+        //! Started by the sync schedule
+        TRIGGER_SCHEDULE,
+        //! Started by a change in a local storage
+        TRIGGER_SYNC_ON_CHANGE,
+        //! Started to retry a failed sync
+        TRIGGER_RETRY
+    };
+
     /*! \brief Constructor
      *
      * @param aProfile SyncProfile associated with the session. With server
@@ -120,6 +135,14 @@ public:
      */
     SyncResults results() const;
 
+    /*! \brief Gets how long the session has been running.
+     *
+     * The time is measured from the call to start(), so it includes waiting
+     * for the network session to open.
+     * @return Running time in milliseconds, 0 if the session was not started
+     */
+    qint64 duration() const;
+
     /*! \brief Sets if the session was started by the scheduler
      *
      * @param  aScheduled True if scheduled, false otherwise
@@ -132,6 +155,32 @@ public:
      */
     bool isScheduled() const;
 
+    /*! \brief Sets what caused the session to be started
+     *
+     * Any trigger other than TRIGGER_MANUAL also marks the session as
+     * scheduled.
+     * @param aTrigger Trigger of the session
+     */
+    void setTrigger(Trigger aTrigger);
+
+    /*! \brief Gets what caused the session to be started
+     *
+     * @return Trigger of the session
+     */
+    Trigger trigger() const;
+
+    /*! \brief Sets why the session was started
+     *
+     * @param aReasons Names of the trigger sources that asked for the sync
+     */
+    void setTriggerReasons(const QStringList &aReasons);
+
+    /*! \brief Gets why the session was started
+     *
+     * @return Names of the trigger sources that asked for the sync
+     */
+    QStringList triggerReasons() const;
+
     /*! \brief Sets the results for this session
      *
      * This function can be used in error situations to set the results to this
@@ -258,6 +307,10 @@ private slots:
 
     bool iScheduled;
 
+    Trigger iTrigger;
+
+    QStringList iTriggerReasons;
+
     bool iAborted;
 
     bool iStarted;
@@ -276,6 +329,8 @@ private slots:
 
     NetworkManager *iNetworkManager;
 
+    QElapsedTimer iRunTime;
+
     #ifdef SYNCFW_UNIT_TESTS
     friend class SyncSessionTest;
     #endif
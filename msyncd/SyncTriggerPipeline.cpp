@@ -0,0 +1,323 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "SyncTriggerPipeline.h"
+
+#include <QMultiMap>
+
+#include "LogMacros.h"
+
+using namespace Buteo;
+
+// Names of the sources, in the order of the Source enum.
+static const char *const SOURCE_NAMES[SyncTriggerPipeline::SOURCE_COUNT] =
+{
+    "manual",
+    "profileAdded",
+    "syncOnChange",
+    "profileModified",
+    "schedule",
+    "retry"
+};
+
+// Sources absorbed by the coalescing window: those only asking for a sync
+// because time has passed.
+static const int COALESCED_SOURCES =
+    SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_SCHEDULE) |
+    SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_RETRY);
+
+SyncTriggerPipeline::SyncTriggerPipeline(QObject *aParent)
+:   QObject(aParent),
+    iCoalesceWindow(0)
+{
+    FUNCTION_CALL_TRACE;
+
+    for (int i = 0; i < SOURCE_COUNT; ++i)
+    {
+        iDebounce[i] = 0;
+    }
+    iTimer.setSingleShot(true);
+    connect(&iTimer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+    iClock.start();
+}
+
+SyncTriggerPipeline::~SyncTriggerPipeline()
+{
+    FUNCTION_CALL_TRACE;
+}
+
+void SyncTriggerPipeline::setDebounce(Source aSource, int aMsecs)
+{
+    iDebounce[aSource] = qMax(aMsecs, 0);
+}
+
+int SyncTriggerPipeline::debounce(Source aSource) const
+{
+    return iDebounce[aSource];
+}
+
+void SyncTriggerPipeline::setCoalesceWindow(int aMsecs)
+{
+    iCoalesceWindow = qMax(aMsecs, 0);
+}
+
+int SyncTriggerPipeline::coalesceWindow() const
+{
+    return iCoalesceWindow;
+}
+
+bool SyncTriggerPipeline::isPending(const QString &aProfileName) const
+{
+    return iEntries.contains(aProfileName);
+}
+
+int SyncTriggerPipeline::take(const QString &aProfileName)
+{
+    FUNCTION_CALL_TRACE;
+
+    QHash<QString, Entry>::iterator i = iEntries.find(aProfileName);
+    if (i == iEntries.end())
+    {
+        return 0;
+    } // no else
+
+    const int sources = i->iSources;
+    iEntries.erase(i);
+    LOG_DEBUG("Pending triggers of" << aProfileName << "merged into a sync:" << reasons(sources));
+    schedule(iClock.elapsed());
+    return sources;
+}
+
+int SyncTriggerPipeline::source(Source aSource)
+{
+    return 1 << aSource;
+}
+
+SyncTriggerPipeline::Source SyncTriggerPipeline::strongest(int aSources)
+{
+    for (int i = 0; i < SOURCE_COUNT; ++i)
+    {
+        if (aSources & source(static_cast<Source>(i)))
+        {
+            return static_cast<Source>(i);
+        } // no else
+    }
+    return SOURCE_MANUAL;
+}
+
+SyncSession::Trigger SyncTriggerPipeline::sessionTrigger(Source aSource)
+{
+    switch (aSource)
+    {
+    case SOURCE_SYNC_ON_CHANGE:
+        return SyncSession::TRIGGER_SYNC_ON_CHANGE;
+    case SOURCE_PROFILE_MODIFIED:
+    case SOURCE_SCHEDULE:
+        return SyncSession::TRIGGER_SCHEDULE;
+    case SOURCE_RETRY:
+        return SyncSession::TRIGGER_RETRY;
+    default:
+        return SyncSession::TRIGGER_MANUAL;
+    }
+}
+
+QStringList SyncTriggerPipeline::reasons(int aSources)
+{
+    QStringList names;
+    for (int i = 0; i < SOURCE_COUNT; ++i)
+    {
+        if (aSources & source(static_cast<Source>(i)))
+        {
+            names.append(QLatin1String(SOURCE_NAMES[i]));
+        } // no else
+    }
+    return names;
+}
+
+int SyncTriggerPipeline::sources(const QStringList &aReasons)
+{
+    int sources = 0;
+    for (int i = 0; i < SOURCE_COUNT; ++i)
+    {
+        if (aReasons.contains(QLatin1String(SOURCE_NAMES[i])))
+        {
+            sources |= source(static_cast<Source>(i));
+        } // no else
+    }
+    return sources;
+}
+
+void SyncTriggerPipeline::trigger(const QString &aProfileName,
+                                  Buteo::SyncTriggerPipeline::Source aSource)
+{
+    FUNCTION_CALL_TRACE;
+
+    trigger(aProfileName, aSource, iClock.elapsed());
+}
+
+void SyncTriggerPipeline::cancel(const QString &aProfileName)
+{
+    FUNCTION_CALL_TRACE;
+
+    iCoalescing.remove(aProfileName);
+    if (iEntries.remove(aProfileName) > 0)
+    {
+        LOG_DEBUG("Pending triggers of" << aProfileName << "cancelled");
+        schedule(iClock.elapsed());
+    } // no else
+}
+
+void SyncTriggerPipeline::startCoalescing(const QString &aProfileName)
+{
+    FUNCTION_CALL_TRACE;
+
+    startCoalescing(aProfileName, iClock.elapsed());
+}
+
+void SyncTriggerPipeline::onTimeout()
+{
+    FUNCTION_CALL_TRACE;
+
+    process(iClock.elapsed());
+}
+
+void SyncTriggerPipeline::trigger(const QString &aProfileName, Source aSource,
+                                  qint64 aTime)
+{
+    if (isCoalesced(aProfileName, aSource, aTime))
+    {
+        LOG_DEBUG("Sync of" << aProfileName << "triggered by" << SOURCE_NAMES[aSource]
+                  << "absorbed by the sync that just ran");
+        return;
+    } // no else
+
+    QHash<QString, Entry>::iterator i = iEntries.find(aProfileName);
+    if (i == iEntries.end())
+    {
+        Entry entry;
+        entry.iSources = 0;
+        i = iEntries.insert(aProfileName, entry);
+    } // no else
+
+    // A repeated event of the same source restarts its window.
+    i->iSources |= source(aSource);
+    i->iDue[aSource] = aTime + iDebounce[aSource];
+    LOG_DEBUG("Sync of" << aProfileName << "triggered by" << SOURCE_NAMES[aSource]
+              << ", due in" << iDebounce[aSource] << "ms");
+    schedule(aTime);
+}
+
+void SyncTriggerPipeline::process(qint64 aTime)
+{
+    // Take the due entries out first, the receivers may trigger or take
+    // other profiles while the signals are delivered.
+    QMultiMap<qint64, QPair<QString, int> > ready;
+    QHash<QString, Entry>::iterator i = iEntries.begin();
+    while (i != iEntries.end())
+    {
+        const qint64 deadline = due(i.value());
+        if (deadline <= aTime)
+        {
+            ready.insert(deadline, qMakePair(i.key(), i->iSources));
+            i = iEntries.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    QMultiMap<qint64, QPair<QString, int> >::const_iterator d = ready.constBegin();
+    for (; d != ready.constEnd(); ++d)
+    {
+        LOG_DEBUG("Starting sync of" << d->first << ", triggered by" << reasons(d->second));
+        startCoalescing(d->first, aTime);
+        emit triggered(d->first, d->second);
+    }
+
+    schedule(aTime);
+}
+
+void SyncTriggerPipeline::startCoalescing(const QString &aProfileName,
+                                          qint64 aTime)
+{
+    if (iCoalesceWindow > 0)
+    {
+        iCoalescing.insert(aProfileName, aTime + iCoalesceWindow);
+    } // no else
+}
+
+bool SyncTriggerPipeline::isCoalesced(const QString &aProfileName,
+                                      Source aSource, qint64 aTime)
+{
+    QHash<QString, qint64>::iterator i = iCoalescing.find(aProfileName);
+    if (i == iCoalescing.end())
+    {
+        return false;
+    } // no else
+
+    if (i.value() <= aTime)
+    {
+        // The window has passed.
+        iCoalescing.erase(i);
+        return false;
+    } // no else
+
+    return (COALESCED_SOURCES & source(aSource)) != 0;
+}
+
+void SyncTriggerPipeline::schedule(qint64 aTime)
+{
+    if (iEntries.isEmpty())
+    {
+        iTimer.stop();
+        return;
+    } // no else
+
+    qint64 next = -1;
+    foreach (const Entry &entry, iEntries)
+    {
+        const qint64 deadline = due(entry);
+        if (next < 0 || deadline < next)
+        {
+            next = deadline;
+        } // no else
+    }
+    iTimer.start(static_cast<int>(qMax(next - aTime, qint64(0))));
+}
+
+qint64 SyncTriggerPipeline::due(const Entry &aEntry)
+{
+    // The profile is synced as soon as the window of any of its sources
+    // has passed, the other sources are served by the same sync.
+    qint64 deadline = -1;
+    for (int i = 0; i < SOURCE_COUNT; ++i)
+    {
+        if ((aEntry.iSources & source(static_cast<Source>(i))) &&
+            (deadline < 0 || aEntry.iDue[i] < deadline))
+        {
+            deadline = aEntry.iDue[i];
+        } // no else
+    }
+    return deadline;
+}
@@ -0,0 +1,247 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef SYNCTRIGGERPIPELINE_H
+#define SYNCTRIGGERPIPELINE_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "SyncSession.h"
+
+namespace Buteo {
+
+/*! \brief Debounces and merges the events that trigger syncs.
+ *
+ * Every source that can start a sync hands its events to the pipeline
+ * instead of starting the sync directly. Each source has its own debounce
+ * window: an event is held until no further event from the same source has
+ * arrived for the window. Events of different sources for the same profile
+ * are merged, so the profile is synced once, with the priority of the
+ * strongest source, and the session records every source that asked for it.
+ *
+ * After a sync of a profile has been dispatched, and again when it finishes,
+ * the profile enters a coalescing window. Schedule and retry events of the
+ * profile arriving within the window are absorbed, as the sync that just ran
+ * served them already. Other sources are never absorbed.
+ */
+class SyncTriggerPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //! Sources of sync triggers, strongest first.
+    enum Source
+    {
+        //! Sync requested by a user or an application.
+        SOURCE_MANUAL = 0,
+        //! A new profile was added.
+        SOURCE_PROFILE_ADDED,
+        //! Data in a storage changed.
+        SOURCE_SYNC_ON_CHANGE,
+        //! An existing profile was modified.
+        SOURCE_PROFILE_MODIFIED,
+        //! The sync schedule of the profile is due.
+        SOURCE_SCHEDULE,
+        //! A failed sync is retried.
+        SOURCE_RETRY,
+        //! Number of sources.
+        SOURCE_COUNT
+    };
+
+    /*! \brief Constructor.
+     *
+     * All sources start with a debounce window of 0, so their events are
+     * passed on from the event loop right away.
+     * \param aParent Parent object.
+     */
+    explicit SyncTriggerPipeline(QObject *aParent = 0);
+
+    //! \brief Destructor.
+    virtual ~SyncTriggerPipeline();
+
+    /*! \brief Sets the debounce window of a source.
+     *
+     * Events that are already pending keep their current deadline.
+     * \param aSource Trigger source.
+     * \param aMsecs Window in milliseconds.
+     */
+    void setDebounce(Source aSource, int aMsecs);
+
+    /*! \brief Gets the debounce window of a source.
+     *
+     * \param aSource Trigger source.
+     * \return Window in milliseconds.
+     */
+    int debounce(Source aSource) const;
+
+    /*! \brief Sets the coalescing window that follows a sync of a profile.
+     *
+     * \param aMsecs Window in milliseconds. 0 disables coalescing.
+     */
+    void setCoalesceWindow(int aMsecs);
+
+    /*! \brief Gets the coalescing window that follows a sync of a profile.
+     *
+     * \return Window in milliseconds.
+     */
+    int coalesceWindow() const;
+
+    /*! \brief Checks if a sync is pending for a profile.
+     *
+     * \param aProfileName Name of the profile.
+     * \return True if events for the profile are waiting.
+     */
+    bool isPending(const QString &aProfileName) const;
+
+    /*! \brief Takes the pending events of a profile.
+     *
+     * Used when the profile is synced for another reason, so the pending
+     * events are served by that sync.
+     * \param aProfileName Name of the profile.
+     * \return Set of sources, see source(), or 0 if nothing was pending.
+     */
+    int take(const QString &aProfileName);
+
+    /*! \brief Gets the bit of a source in a set of sources.
+     *
+     * \param aSource Trigger source.
+     * \return Source bit.
+     */
+    static int source(Source aSource);
+
+    /*! \brief Gets the strongest source in a set of sources.
+     *
+     * \param aSources Set of sources.
+     * \return Strongest source, SOURCE_MANUAL if the set is empty.
+     */
+    static Source strongest(int aSources);
+
+    /*! \brief Maps a source to the trigger of the session it starts.
+     *
+     * \param aSource Trigger source.
+     * \return Session trigger.
+     */
+    static SyncSession::Trigger sessionTrigger(Source aSource);
+
+    /*! \brief Gets the names of a set of sources.
+     *
+     * \param aSources Set of sources.
+     * \return Source names, strongest first.
+     */
+    static QStringList reasons(int aSources);
+
+    /*! \brief Gets the set of sources from their names.
+     *
+     * \param aReasons Source names, as returned by reasons().
+     * \return Set of sources. Unknown names are ignored.
+     */
+    static int sources(const QStringList &aReasons);
+
+public slots:
+
+    /*! \brief Adds a trigger event.
+     *
+     * \param aProfileName Name of the profile to sync.
+     * \param aSource Source of the event.
+     */
+    void trigger(const QString &aProfileName, Buteo::SyncTriggerPipeline::Source aSource);
+
+    /*! \brief Drops the pending events of a profile.
+     *
+     * The coalescing window of the profile is closed also.
+     * \param aProfileName Name of the profile.
+     */
+    void cancel(const QString &aProfileName);
+
+    /*! \brief Opens the coalescing window of a profile.
+     *
+     * Called when a sync of the profile finishes. The window is also opened
+     * whenever the pipeline passes on a sync of the profile.
+     * \param aProfileName Name of the profile.
+     */
+    void startCoalescing(const QString &aProfileName);
+
+signals:
+
+    /*! \brief Emitted when the debounce window of a profile has passed.
+     *
+     * \param aProfileName Name of the profile to sync.
+     * \param aSources Set of sources that asked for the sync.
+     */
+    void triggered(QString aProfileName, int aSources);
+
+private slots:
+
+    void onTimeout();
+
+private:
+
+    struct Entry
+    {
+        // Sources with pending events.
+        int iSources;
+        // Deadline of each source, valid for the sources in iSources.
+        qint64 iDue[SOURCE_COUNT];
+    };
+
+    void trigger(const QString &aProfileName, Source aSource, qint64 aTime);
+
+    void startCoalescing(const QString &aProfileName, qint64 aTime);
+
+    // Checks if an event is served by a sync that has just run.
+    bool isCoalesced(const QString &aProfileName, Source aSource, qint64 aTime);
+
+    // Passes on all entries due at the given time.
+    void process(qint64 aTime);
+
+    // Restarts the timer for the earliest pending deadline.
+    void schedule(qint64 aTime);
+
+    static qint64 due(const Entry &aEntry);
+
+    int iDebounce[SOURCE_COUNT];
+
+    int iCoalesceWindow;
+
+    QHash<QString, Entry> iEntries;
+
+    // End of the coalescing window of each profile.
+    QHash<QString, qint64> iCoalescing;
+
+    QTimer iTimer;
+
+    QElapsedTimer iClock;
+
+#ifdef SYNCFW_UNIT_TESTS
+    friend class SyncTriggerPipelineTest;
+#endif
+};
+
+}
+
+#endif // SYNCTRIGGERPIPELINE_H
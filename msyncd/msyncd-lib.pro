@@ -52,6 +52,7 @@ HEADERS += ServerActivator.h \
     ClientThread.h \
     ServerThread.h \
     StorageBooker.h \
+    IndexedHeap.h \
     SyncQueue.h \
     SyncScheduler.h \
     SyncBackup.h \
@@ -64,7 +65,11 @@ HEADERS += ServerActivator.h \
     SyncSigHandler.h \
     StorageChangeNotifier.h \
     SyncOnChange.h \
-    SyncOnChangeScheduler.h
+    SyncOnChangeScheduler.h \
+    ProfileChangeBatcher.h \
+    SyncResultsHistory.h \
+    SyncGovernor.h \
+    SyncTriggerPipeline.h
 
 SOURCES += ServerActivator.cpp \
     synchronizer.cpp \
@@ -85,7 +90,11 @@ SOURCES += ServerActivator.cpp \
     SyncSigHandler.cpp \
     StorageChangeNotifier.cpp \
     SyncOnChange.cpp \
-    SyncOnChangeScheduler.cpp
+    SyncOnChangeScheduler.cpp \
+    ProfileChangeBatcher.cpp \
+    SyncResultsHistory.cpp \
+    SyncGovernor.cpp \
+    SyncTriggerPipeline.cpp
 
 contains(DEFINES, USE_KEEPALIVE) {
     PKGCONFIG += keepalive
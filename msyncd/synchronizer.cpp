@@ -87,6 +87,7 @@ public:
 
 Synchronizer::Synchronizer( QCoreApplication* aApplication )
 :   iNetworkManager(0),
+    iWaitingForSlot(false),
     iSyncScheduler(0),
     iSyncBackup(0),
     iTransportTracker(0),
@@ -94,6 +95,7 @@ Synchronizer::Synchronizer( QCoreApplication* aApplication )
     iAccounts(0),
     iClosing(false),
     iSOCEnabled(false),
+    iXmlChangeListenerWatcher(0),
     iSyncUIInterface(NULL),
     iBatteryInfo(new BatteryInfo)
 {
@@ -101,9 +103,11 @@ Synchronizer::Synchronizer( QCoreApplication* aApplication )
     FUNCTION_CALL_TRACE;
     this->setParent(aApplication);
 
-    iProfileChangeTriggerTimer.setSingleShot(true);
-    connect(&iProfileChangeTriggerTimer, &QTimer::timeout,
-            this, &Synchronizer::profileChangeTriggerTimeout);
+    connect(&iTriggerPipeline, SIGNAL(triggered(QString,int)),
+            this, SLOT(onSyncTriggered(QString,int)));
+
+    connect(&iProfileChangeBatcher, SIGNAL(changesReady(QVariantList)),
+            this, SIGNAL(profilesChanged(QVariantList)));
 }
 
 Synchronizer::~Synchronizer()
@@ -141,13 +145,29 @@ bool Synchronizer::initialize()
         LOG_DEBUG("Registered to D-Bus");
     } // else ok
 
+    // Done before the profiles are read. Only the running msyncd instance
+    // gets here, so the profiles are imported once.
+    if (g_settings_get_boolean(iSettings, "profile-database") &&
+        !iProfileManager.useDatabase())
+    {
+        LOG_WARNING("Failed to move profiles into a database, using profile files");
+    } // no else
+
     connect(this, SIGNAL(syncStatus(QString, int, QString, int)),
             this, SLOT(slotSyncStatus(QString, int, QString, int)),
             Qt::QueuedConnection);
 
     // use queued connection because the profile will be stored after the signal
-    connect(&iProfileManager ,SIGNAL(signalProfileChanged(QString,int,QString)),
-            this, SLOT(slotProfileChanged(QString,int,QString)), Qt::QueuedConnection);
+    connect(&iProfileManager, SIGNAL(signalProfileDelta(QString,int,QVariantMap)),
+            this, SLOT(slotProfileDelta(QString,int,QVariantMap)), Qt::QueuedConnection);
+
+    // The profile XML signal is connected only on request of a client, see
+    // setProfileChangesAsXml().
+    iXmlChangeListenerWatcher = new QDBusServiceWatcher(this);
+    iXmlChangeListenerWatcher->setConnection(QDBusConnection::sessionBus());
+    iXmlChangeListenerWatcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+    connect(iXmlChangeListenerWatcher, SIGNAL(serviceUnregistered(QString)),
+            this, SLOT(onXmlChangeListenerGone(QString)));
 
     iNetworkManager = new NetworkManager(this);
     Q_ASSERT(iNetworkManager);
@@ -180,6 +200,34 @@ bool Synchronizer::initialize()
     connect(this, SIGNAL(storageReleased()),
             this, SLOT(onStorageReleased()), Qt::QueuedConnection);
 
+    if (!iResultsHistory.init())
+    {
+        LOG_WARNING("Sync results history is not available");
+    } // no else
+
+    iGovernor.setLimit(g_settings_get_int(iSettings, "max-sync-sessions"));
+    iGovernor.setClassLimit(SyncGovernor::LIMIT_ONLINE,
+                            g_settings_get_int(iSettings, "max-online-sync-sessions"));
+    iGovernor.setClassLimit(SyncGovernor::LIMIT_DEVICE,
+                            g_settings_get_int(iSettings, "max-device-sync-sessions"));
+    iGovernor.setClassLimit(SyncGovernor::LIMIT_CLIENT_PLUGIN,
+                            g_settings_get_int(iSettings, "max-sync-sessions-per-client-plugin"));
+    iGovernor.setClassLimit(SyncGovernor::LIMIT_HOST,
+                            g_settings_get_int(iSettings, "max-sync-sessions-per-host"));
+
+    // Profile changes are held back longest, to avoid thrash during
+    // backup/restore and races with clients that sync the profile themselves.
+    const int profileChangeDebounce = g_settings_get_int(iSettings, "profile-change-trigger-delay");
+    iTriggerPipeline.setDebounce(SyncTriggerPipeline::SOURCE_PROFILE_ADDED, profileChangeDebounce);
+    iTriggerPipeline.setDebounce(SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED, profileChangeDebounce);
+    iTriggerPipeline.setDebounce(SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE,
+                                 g_settings_get_int(iSettings, "sync-on-change-trigger-delay"));
+    iTriggerPipeline.setDebounce(SyncTriggerPipeline::SOURCE_SCHEDULE,
+                                 g_settings_get_int(iSettings, "schedule-trigger-delay"));
+    iTriggerPipeline.setDebounce(SyncTriggerPipeline::SOURCE_RETRY,
+                                 g_settings_get_int(iSettings, "retry-trigger-delay"));
+    iTriggerPipeline.setCoalesceWindow(g_settings_get_int(iSettings, "trigger-coalesce-window"));
+
     startServers();
 
     // Initialize scheduler
@@ -216,7 +264,7 @@ bool Synchronizer::initialize()
         else
         {
             QObject::connect(&iSyncOnChangeScheduler, SIGNAL(syncNow(QString)),
-                             this, SLOT(startScheduledSync(QString)),
+                             this, SLOT(startSyncOnChangeSync(QString)),
                              Qt::QueuedConnection);
             iSOCEnabled = true;
         }
@@ -248,7 +296,7 @@ void Synchronizer::enableSOCSlot(const QString& aProfileName)
             if (iSyncOnChange.enable(aSOCStorageMap, &iSyncOnChangeScheduler, &iPluginManager, aFailedStorages))
             {
                 QObject::connect(&iSyncOnChangeScheduler, SIGNAL(syncNow(const QString&)),
-                             this, SLOT(startScheduledSync(const QString&)),
+                             this, SLOT(startSyncOnChangeSync(QString)),
                              Qt::QueuedConnection);
                 iSOCEnabled = true;
                 LOG_DEBUG("Sync on change enabled for profile" << aProfileName);
@@ -298,6 +346,11 @@ void Synchronizer::close()
     delete iSyncBackup;
     iSyncBackup = 0;
 
+    // Write profile updates still waiting in the write-behind queue.
+    iProfileManager.flush();
+
+    // Send profile changes still waiting to be coalesced.
+    iProfileChangeBatcher.flush();
 
     // Unregister from D-Bus.
     QDBusConnection dbus = QDBusConnection::sessionBus();
@@ -349,6 +402,62 @@ bool Synchronizer::startScheduledSync(QString aProfileName)
     return true;
 }
 
+bool Synchronizer::startSyncOnChangeSync(QString aProfileName)
+{
+    FUNCTION_CALL_TRACE;
+
+    iTriggerPipeline.trigger(aProfileName, SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE);
+    return true;
+}
+
+void Synchronizer::onScheduleTriggered(QString aProfileName)
+{
+    FUNCTION_CALL_TRACE;
+
+    // The scheduler reports retries of failed syncs through the same signal.
+    const SyncTriggerPipeline::Source source = iRetryProfiles.remove(aProfileName) ?
+        SyncTriggerPipeline::SOURCE_RETRY : SyncTriggerPipeline::SOURCE_SCHEDULE;
+    iTriggerPipeline.trigger(aProfileName, source);
+}
+
+void Synchronizer::onSyncTriggered(QString aProfileName, int aSources)
+{
+    FUNCTION_CALL_TRACE;
+
+    const int profileChanges = SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_PROFILE_ADDED) |
+                               SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED);
+    if (aSources & SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_PROFILE_ADDED))
+    {
+        enableSOCSlot(aProfileName);
+    } // no else
+
+    if ((aSources & ~profileChanges) == 0)
+    {
+        // Profile changes only sync profiles that are enabled, and do not
+        // report failures for the others.
+        SyncProfile *profile = iProfileManager.syncProfile(aProfileName);
+        const bool enabled = profile && profile->isEnabled();
+        delete profile;
+        if (!enabled)
+        {
+            LOG_DEBUG("Not syncing changed profile" << aProfileName);
+            return;
+        } // no else
+    } // no else
+
+    iPendingTriggers[aProfileName] |= aSources;
+    const SyncSession::Trigger trigger = SyncTriggerPipeline::sessionTrigger(
+        SyncTriggerPipeline::strongest(aSources));
+    if (trigger == SyncSession::TRIGGER_MANUAL)
+    {
+        startSync(aProfileName, false);
+    }
+    else
+    {
+        startScheduledSync(aProfileName);
+    }
+}
+
 bool Synchronizer::setSyncSchedule(QString aProfileId , QString aScheduleAsXml)
 {
     bool status = false;
@@ -398,13 +507,17 @@ bool Synchronizer::startSync(const QString &aProfileName, bool aScheduled)
     // second sync.
     iSyncOnChangeScheduler.removeProfile(aProfileName);
 
-    // Do the same if the profile is pending sync due to a profile change.
-    for (int i = iProfileChangeTriggerQueue.size() - 1; i >= 0; --i) {
-        if (iProfileChangeTriggerQueue[i].first == aProfileName) {
-            LOG_DEBUG("Removing queued profile change sync due to sync trigger:" << aProfileName);
-            iProfileChangeTriggerQueue.removeAt(i);
-        }
+    // Triggers still waiting in the pipeline are served by this sync too.
+    int sources = iPendingTriggers.take(aProfileName) | iTriggerPipeline.take(aProfileName);
+    if (!aScheduled &&
+        !(sources & SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_PROFILE_ADDED)))
+    {
+        sources |= SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_MANUAL);
     }
+    else if (sources == 0)
+    {
+        sources = SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_SCHEDULE);
+    } // no else
 
     if (iActiveSessions.contains(aProfileName))
     {
@@ -414,6 +527,18 @@ bool Synchronizer::startSync(const QString &aProfileName, bool aScheduled)
     else if (iSyncQueue.contains(aProfileName))
     {
         LOG_DEBUG( "Sync request already in queue" );
+        SyncSession *queuedSession = iSyncQueue.session(aProfileName);
+        sources |= SyncTriggerPipeline::sources(queuedSession->triggerReasons());
+        queuedSession->setTriggerReasons(SyncTriggerPipeline::reasons(sources));
+        const SyncSession::Trigger trigger = SyncTriggerPipeline::sessionTrigger(
+            SyncTriggerPipeline::strongest(sources));
+        if (trigger != queuedSession->trigger())
+        {
+            // A stronger trigger asked for this sync, move it ahead.
+            iSyncQueue.dequeue(aProfileName);
+            queuedSession->setTrigger(trigger);
+            iSyncQueue.enqueue(queuedSession);
+        } // no else
         emit syncStatus(aProfileName, Sync::SYNC_QUEUED, "", 0);
         return true;
     }
@@ -457,11 +582,15 @@ bool Synchronizer::startSync(const QString &aProfileName, bool aScheduled)
         return false;
     }
 
-    session->setScheduled(aScheduled);
+    session->setTrigger(SyncTriggerPipeline::sessionTrigger(
+        SyncTriggerPipeline::strongest(sources)));
+    session->setTriggerReasons(SyncTriggerPipeline::reasons(sources));
+    LOG_DEBUG("Sync of" << aProfileName << "triggered by" << session->triggerReasons());
 
-    if (clientProfileActive(profile->clientProfile()->name())) {
+    if (clientProfileActive(profile)) {
         LOG_DEBUG( "Sync request of the same type in progress, adding request to the sync queue" );
         iSyncQueue.enqueue(session);
+        waitForResources(session);
         emit syncStatus(aProfileName, Sync::SYNC_QUEUED, "", 0);
         return false;
     }
@@ -481,10 +610,19 @@ bool Synchronizer::startSync(const QString &aProfileName, bool aScheduled)
         session->setFailureResult(SyncResults::SYNC_RESULT_FAILED, Buteo::SyncResults::LOW_BATTERY_POWER);
         emit syncStatus(aProfileName, Sync::SYNC_ERROR, "Low battery", Buteo::SyncResults::LOW_BATTERY_POWER);
     }
+    else if (!iGovernor.canAdmit(profile))
+    {
+        LOG_DEBUG( "Too many sync sessions running, queuing sync request" );
+        iSyncQueue.enqueue(session);
+        iWaitingForSlot = true;
+        emit syncStatus(aProfileName, Sync::SYNC_QUEUED, "", 0);
+        success = true;
+    }
     else if (!session->reserveStorages(&iStorageBooker))
     {
         LOG_DEBUG( "Needed storage(s) already in use, queuing sync request" );
         iSyncQueue.enqueue(session);
+        waitForResources(session);
         emit syncStatus(aProfileName, Sync::SYNC_QUEUED, "", 0);
         success = true;
     }
@@ -554,6 +692,13 @@ bool Synchronizer::startSyncNow(SyncSession *aSession)
 
     iProfileManager.addRetriesInfo(profile);
 
+    // Out-of-process plug-ins read the profile from disk, so updates still
+    // waiting in the write-behind queue must be written first.
+    if (!iProfileManager.flush())
+    {
+        LOG_WARNING("Failed to write pending profile updates before sync");
+    } // no else
+
     PluginRunner *pluginRunner = new ClientPluginRunner(
             clientProfile->name(), aSession->profile(), &iPluginManager, this,
             this);
@@ -615,6 +760,7 @@ bool Synchronizer::startSyncNow(SyncSession *aSession)
 
         LOG_DEBUG( "Sync session started" );
         iActiveSessions.insert(aSession->profileName(), aSession);
+        iGovernor.admit(aSession->profileName(), aSession->profile());
     }
     else
     {
@@ -632,6 +778,13 @@ void Synchronizer::onSessionFinished(const QString &aProfileName,
 
     LOG_DEBUG( "Session finished:" << aProfileName << ", status:" << aStatus);
 
+    // Timed triggers arriving right after this sync are served by it.
+    iTriggerPipeline.startCoalescing(aProfileName);
+
+    QStringList releasedStorages;
+    QString releasedClient;
+    bool releasedSlot = false;
+
     if(iActiveSessions.contains(aProfileName))
     {
         SyncSession *session = iActiveSessions[aProfileName];
@@ -680,6 +833,7 @@ void Synchronizer::onSessionFinished(const QString &aProfileName,
                 if(nextRetryInterval.isValid())
                 {
                     iSyncScheduler->addProfileForSyncRetry(session->profile(), nextRetryInterval);
+                    iRetryProfiles.insert(session->profileName());
                 }
                 else
                 {
@@ -694,6 +848,15 @@ void Synchronizer::onSessionFinished(const QString &aProfileName,
             }
 
             iActiveSessions.remove(aProfileName);
+            releasedSlot = iGovernor.release(aProfileName);
+            if (session->profile() != 0)
+            {
+                releasedStorages = session->profile()->storageBackendNames();
+                if (session->profile()->clientProfile() != 0)
+                {
+                    releasedClient = session->profile()->clientProfile()->name();
+                } // no else
+            } // no else
             if(session->isScheduled())
             {
                 // Calling this multiple times has no effect, even if the
@@ -708,6 +871,7 @@ void Synchronizer::onSessionFinished(const QString &aProfileName,
             }
             if (session->isAborted() && (iActiveSessions.size() == 0) && isBackupRestoreInProgress()) {
                 stopServers();
+                iProfileManager.flush();
                 iSyncBackup->sendReply(0);
             }
         }
@@ -729,11 +893,14 @@ void Synchronizer::onSessionFinished(const QString &aProfileName,
         iSyncOnChange.enable();
     }
 
-    // Try starting new sync sessions waiting in the queue.
-    while (startNextSync())
+    // Try starting new sync sessions waiting in the queue, if any of them
+    // waits for what this session held.
+    if (containsAny(iWaitedStorages, releasedStorages) ||
+        iWaitedClients.contains(releasedClient) ||
+        (releasedSlot && iWaitingForSlot))
     {
-        //intentionally empty
-    }
+        startNextSync();
+    } // no else
 }
 
 void Synchronizer::onSyncProgressDetail(const QString &aProfileName,int aProgressDetail)
@@ -751,65 +918,132 @@ bool Synchronizer::startNextSync()
         return false;
     }
 
-    bool tryNext = true;
+    bool dispatched = false;
 
-    SyncSession *session = iSyncQueue.head();
-    if (session == 0)
-    {
-        LOG_WARNING( "Null session found from queue" );
-        iSyncQueue.dequeue();
-        return true;
-    }
+    // Storages and client plug-in instances wanted by blocked sessions
+    // earlier in the queue. A later session may only start if it needs none
+    // of them, so that it cannot keep a blocked higher priority session
+    // waiting.
+    QSet<QString> claimedStorages;
+    QHash<QString, int> claimedClients;
+    bool waitingForSlot = false;
 
-    SyncProfile *profile = session->profile();
-    if (profile == 0)
+    const QList<SyncSession*> queuedSessions = iSyncQueue.getQueuedSyncSessions();
+    foreach (SyncSession *session, queuedSessions)
     {
-        LOG_WARNING( "Null profile found from queued session" );
-        cleanupSession(session, Sync::SYNC_ERROR);
-        iSyncQueue.dequeue();
-        return true;
-    }
+        QString profileName = session->profileName();
+        SyncProfile *profile = session->profile();
+        if (profile == 0)
+        {
+            LOG_WARNING( "Null profile found from queued session" );
+            iSyncQueue.dequeue(profileName);
+            cleanupSession(session, Sync::SYNC_ERROR);
+            dispatched = true;
+            continue;
+        }
 
-    QString profileName = session->profileName();
-    LOG_DEBUG( "Trying to start next sync in queue. Profile:" << profileName << session->isScheduled());
+        LOG_DEBUG( "Trying to start queued sync. Profile:" << profileName << session->isScheduled());
+
+        if (session->isScheduled() && iBatteryInfo->isLowPower())
+        {
+            LOG_WARNING( "Low power, scheduled sync aborted" );
+            iSyncQueue.dequeue(profileName);
+            session->setFailureResult(SyncResults::SYNC_RESULT_FAILED, Buteo::SyncResults::LOW_BATTERY_POWER);
+            cleanupSession(session, Sync::SYNC_ERROR);
+            emit syncStatus(profileName, Sync::SYNC_ERROR, "Low Battery", Buteo::SyncResults::LOW_BATTERY_POWER);
+            dispatched = true;
+            continue;
+        }
+
+        const QStringList storageNames = profile->storageBackendNames();
+        const QString clientName = profile->clientProfile() != 0 ?
+                                   profile->clientProfile()->name() : QString();
+        bool blocked = true;
+        if (clientProfileActive(profile, claimedClients.value(clientName)))
+        {
+            LOG_DEBUG( "Client profile active, wait for finish" );
+        }
+        else if (containsAny(claimedStorages, storageNames))
+        {
+            LOG_DEBUG( "Needed resources are claimed by an earlier queued sync" );
+        }
+        else if (!iGovernor.canAdmit(profile))
+        {
+            LOG_DEBUG( "Too many sync sessions running, wait for a free slot" );
+            waitingForSlot = true;
+        }
+        else if (!session->reserveStorages(&iStorageBooker))
+        {
+            LOG_DEBUG( "Needed storage(s) already in use" );
+        }
+        else
+        {
+            blocked = false;
+        }
+
+        if (blocked)
+        {
+            ++claimedClients[clientName];
+            foreach (const QString &storageName, storageNames)
+            {
+                claimedStorages.insert(storageName);
+            }
+            continue;
+        } // no else
 
-    if (session->isScheduled() && iBatteryInfo->isLowPower())
-    {
-        LOG_WARNING( "Low power, scheduled sync aborted" );
-        iSyncQueue.dequeue();
-        session->setFailureResult(SyncResults::SYNC_RESULT_FAILED, Buteo::SyncResults::LOW_BATTERY_POWER);
-        cleanupSession(session, Sync::SYNC_ERROR);
-        emit syncStatus(profileName, Sync::SYNC_ERROR, "Low Battery", Buteo::SyncResults::LOW_BATTERY_POWER);
-        tryNext = true;
-    }
-    else if (!session->reserveStorages(&iStorageBooker))
-    {
-        LOG_DEBUG( "Needed storage(s) already in use" );
-        tryNext = false;
-    }
-    else if (clientProfileActive(profile->clientProfile()->name())) {
-        LOG_DEBUG( "Client profile active, wait for finish" );
-        return false;
-    }
-    else
-    {
         // Sync can be started now.
-        iSyncQueue.dequeue();
+        iSyncQueue.dequeue(profileName);
         if (startSyncNow(session))
         {
             emit syncStatus(profileName, Sync::SYNC_STARTED, "", 0);
         }
         else
         {
-            LOG_WARNING("unable to start sync with session:" << session->profileName());
+            LOG_WARNING("unable to start sync with session:" << profileName);
             session->setFailureResult(SyncResults::SYNC_RESULT_FAILED, Buteo::SyncResults::INTERNAL_ERROR);
             cleanupSession(session, Sync::SYNC_ERROR);
             emit syncStatus(profileName, Sync::SYNC_ERROR, "Internal Error", Buteo::SyncResults::INTERNAL_ERROR);
         }
-        tryNext = true;
+        dispatched = true;
     }
 
-    return tryNext;
+    // Only releasing one of these can unblock the sessions left in the queue.
+    iWaitedStorages = claimedStorages;
+    iWaitedClients = QSet<QString>::fromList(claimedClients.keys());
+    iWaitingForSlot = waitingForSlot;
+
+    return dispatched;
+}
+
+void Synchronizer::waitForResources(const SyncSession *aSession)
+{
+    FUNCTION_CALL_TRACE;
+
+    const SyncProfile *profile = aSession->profile();
+    if (profile != 0)
+    {
+        foreach (const QString &storageName, profile->storageBackendNames())
+        {
+            iWaitedStorages.insert(storageName);
+        }
+        if (profile->clientProfile() != 0)
+        {
+            iWaitedClients.insert(profile->clientProfile()->name());
+        } // no else
+    } // no else
+}
+
+bool Synchronizer::containsAny(const QSet<QString> &aSet, const QStringList &aNames)
+{
+    foreach (const QString &name, aNames)
+    {
+        if (aSet.contains(name))
+        {
+            return true;
+        } // no else
+    }
+
+    return false;
 }
 
 void Synchronizer::cleanupSession(SyncSession *aSession, Sync::SyncStatus aStatus)
@@ -827,6 +1061,8 @@ void Synchronizer::cleanupSession(SyncSession *aSession, Sync::SyncStatus aStatu
                 iProfileManager.saveRemoteTargetId(*profile, aSession->results().getTargetId());
             }
             iProfileManager.saveSyncResults(profileName, aSession->results());
+            iResultsHistory.record(profileName, aSession->results(), aSession->duration(),
+                                   aSession->triggerReasons());
 
             // UI needs to know that Sync Log has been updated.
             emit resultsAvailable(profileName,aSession->results().toString());
@@ -834,7 +1070,9 @@ void Synchronizer::cleanupSession(SyncSession *aSession, Sync::SyncStatus aStatu
             if ( aSession->isScheduled() )
             {
                 reschedule(profileName);
-                emit signalProfileChanged(profileName, 1 ,QString());
+                if (!iXmlChangeListeners.isEmpty()) {
+                    emit signalProfileChanged(profileName, 1 ,QString());
+                }
             } // no else
         } // no else
         aSession->setProfileCreated(false);
@@ -862,6 +1100,8 @@ void Synchronizer::abortSync(QString aProfileName)
         {
             LOG_DEBUG("Removed queued sync" << aProfileName);
             delete queuedSession;
+            // Sessions held back behind it may be able to start now.
+            startNextSync();
         }
         SyncResults syncResults(QDateTime::currentDateTime(), SyncResults::SYNC_RESULT_CANCELLED, Buteo::SyncResults::ABORTED);
         iProfileManager.saveSyncResults(aProfileName, syncResults);
@@ -926,20 +1166,31 @@ bool Synchronizer::cleanupProfile(const QString &aProfileId)
     return status;
 }
 
-bool Synchronizer::clientProfileActive(const QString &clientProfileName)
+bool Synchronizer::clientProfileActive(const SyncProfile *aProfile, int aClaimed)
 {
+    const Profile *client = aProfile->clientProfile();
+    if (client == 0)
+    {
+        return false;
+    } // no else
+
+    // The client profile may allow several sessions of the plug-in to run
+    // in parallel for different sync profiles.
+    const int maxSessions = qMax(client->key(KEY_MAX_PARALLEL_SESSIONS).toInt(), 1);
+    int sessions = aClaimed;
     QList<SyncSession*> activeSessions = iActiveSessions.values();
     foreach(SyncSession *session, activeSessions)
     {
         if(session->profile())
         {
             SyncProfile *profile = session->profile();
-            if (profile->clientProfile()->name() == clientProfileName) {
-                return true;
+            if (profile->clientProfile() &&
+                profile->clientProfile()->name() == client->name()) {
+                ++sessions;
             }
         }
     }
-    return false;
+    return sessions >= maxSessions;
 }
 
 bool Synchronizer::removeProfile(QString aProfileId)
@@ -1003,6 +1254,9 @@ bool Synchronizer::updateProfile(QString aProfileAsXml)
 
             QString profileId = iProfileManager.updateProfile(*profile);
 
+            // The client reads the profile from disk.
+            iProfileManager.flush();
+
             // if the profile changes are for schedule sync we need to reschedule
             if(!profileId.isEmpty()) {
                 reschedule(profileId);
@@ -1027,6 +1281,10 @@ void Synchronizer::releaseStorages(QStringList aStorageNames)
     FUNCTION_CALL_TRACE;
 
     iStorageBooker.releaseStorages(aStorageNames);
+    foreach (const QString &storageName, aStorageNames)
+    {
+        iReleasedStorages.insert(storageName);
+    }
     emit storageReleased();
 }
 
@@ -1042,9 +1300,15 @@ void Synchronizer::onStorageReleased()
     FUNCTION_CALL_TRACE;
 
     LOG_DEBUG( "Storage released" );
-    while (startNextSync())
+    const QStringList releasedStorages = iReleasedStorages.toList();
+    iReleasedStorages.clear();
+    if (containsAny(iWaitedStorages, releasedStorages))
+    {
+        startNextSync();
+    }
+    else
     {
-        // Intentionally empty.
+        LOG_DEBUG( "No queued sync waits for the released storages" );
     }
 }
 
@@ -1111,6 +1375,7 @@ void Synchronizer::releaseStorage(const QString &aStorageName,
     FUNCTION_CALL_TRACE;
 
     iStorageBooker.releaseStorage(aStorageName);
+    iReleasedStorages.insert(aStorageName);
     emit storageReleased();
 }
 
@@ -1132,8 +1397,9 @@ void Synchronizer::initializeScheduler()
     FUNCTION_CALL_TRACE;
     if (!iSyncScheduler) {
         iSyncScheduler = new SyncScheduler(this);
+        iSyncScheduler->setWakeAlignment(g_settings_get_int(iSettings, "scheduled-sync-wake-window"));
         connect(iSyncScheduler, SIGNAL(syncNow(QString)),
-                this, SLOT(startScheduledSync(QString)), Qt::QueuedConnection);
+                this, SLOT(onScheduleTriggered(QString)), Qt::QueuedConnection);
         connect(iSyncScheduler, SIGNAL(externalSyncChanged(const SyncProfile*,bool)),
                 this, SLOT(externalSyncStatus(const SyncProfile*,bool)), Qt::QueuedConnection);
         QList<SyncProfile*> profiles = iProfileManager.allSyncProfiles();
@@ -1150,6 +1416,7 @@ void Synchronizer::initializeScheduler()
             externalSyncStatus(profile, true);
         }
         qDeleteAll(profiles);
+        iSyncScheduler->removeUnclaimedAlarms();
     }
 }
 
@@ -1482,6 +1749,7 @@ void Synchronizer::onNewSession(const QString &aDestination)
             session->setStorageMap(storageMap);
 
             iActiveSessions.insert(profile->name(), session);
+            iGovernor.admit(profile->name(), profile);
 
             // Connect signals from sync session.
             connect(session, SIGNAL(transferProgress(const QString &,
@@ -1516,74 +1784,104 @@ void Synchronizer::onNewSession(const QString &aDestination)
 
 void Synchronizer::slotProfileChanged(QString aProfileName, int aChangeType, QString aProfileAsXml)
 {
-    // queue up a sync when a new profile is added or an existing profile is modified.
-    // we coalesce changes to profiles so that we do not trigger syncs immediately
-    // on change, to avoid thrash during backup/restore and races if the client wishes
-    // to trigger manually.  Temporary until we can improve Buteo's SyncOnChange handler.
+    // Only connected while some client wants the whole profile XML.
+    emit signalProfileChanged(aProfileName, aChangeType, aProfileAsXml);
+}
+
+void Synchronizer::slotProfileDelta(QString aProfileName, int aChangeType, QVariantMap aDelta)
+{
+    // Sync when a new profile is added or an existing profile is modified.
+    // The trigger pipeline holds these syncs back for a while, see initialize().
     switch (aChangeType)
     {
         case ProfileManager::PROFILE_ADDED:
-            {
-                iProfileChangeTriggerQueue.append(qMakePair(aProfileName, ProfileManager::PROFILE_ADDED));
-                iProfileChangeTriggerTimer.start(30000); // 30 seconds.
-            }
+            iTriggerPipeline.trigger(aProfileName, SyncTriggerPipeline::SOURCE_PROFILE_ADDED);
             break;
 
         case ProfileManager::PROFILE_REMOVED:
             iSyncOnChangeScheduler.removeProfile(aProfileName);
             iWaitingOnlineSyncs.removeAll(aProfileName);
-            for (int i = iProfileChangeTriggerQueue.size() - 1; i >= 0; --i) {
-                if (iProfileChangeTriggerQueue[i].first == aProfileName) {
-                    LOG_DEBUG("Removing queued profile change sync due to profile removal:" << aProfileName);
-                    iProfileChangeTriggerQueue.removeAt(i);
-                }
-            }
+            iTriggerPipeline.cancel(aProfileName);
+            iPendingTriggers.remove(aProfileName);
+            iRetryProfiles.remove(aProfileName);
             break;
 
         case ProfileManager::PROFILE_MODIFIED:
-            {
-                bool alreadyQueued = false;
-                for (int i = 0; i < iProfileChangeTriggerQueue.size(); ++i) {
-                    if (iProfileChangeTriggerQueue.at(i).first == aProfileName) {
-                        alreadyQueued = true;
-                        break;
-                    }
-                }
-                if (!alreadyQueued) {
-                    iProfileChangeTriggerQueue.append(qMakePair(aProfileName, ProfileManager::PROFILE_MODIFIED));
-                }
-                iProfileChangeTriggerTimer.start(30000); // 30 seconds.
-            }
+            iTriggerPipeline.trigger(aProfileName, SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED);
             break;
     }
 
-    emit signalProfileChanged(aProfileName, aChangeType, aProfileAsXml);
+    iProfileChangeBatcher.addChange(aProfileName, aChangeType, aDelta);
 }
 
-void Synchronizer::profileChangeTriggerTimeout()
+void Synchronizer::setProfileChangesAsXml(bool aEnabled)
 {
-    if (iProfileChangeTriggerQueue.isEmpty()) {
+    FUNCTION_CALL_TRACE;
+
+    if (!calledFromDBus())
+    {
         return;
+    } // no else
+
+    const QString service = message().service();
+    const bool hadListeners = !iXmlChangeListeners.isEmpty();
+    if (aEnabled)
+    {
+        iXmlChangeListeners.insert(service);
+        iXmlChangeListenerWatcher->addWatchedService(service);
+    }
+    else
+    {
+        iXmlChangeListeners.remove(service);
+        iXmlChangeListenerWatcher->removeWatchedService(service);
     }
+    LOG_DEBUG("Clients receiving profile XML:" << iXmlChangeListeners.size());
 
-    QPair<QString, ProfileManager::ProfileChangeType> queuedChange = iProfileChangeTriggerQueue.takeFirst();
-    SyncProfile *profile = iProfileManager.syncProfile(queuedChange.first);
-    if (profile) {
-        if (queuedChange.second == ProfileManager::PROFILE_ADDED) {
-            enableSOCSlot(queuedChange.first);
-            if (profile->isEnabled()) {
-                LOG_DEBUG("Triggering queued profile addition sync for:" << queuedChange.first);
-                startSync(queuedChange.first);
-            }
-        } else if (profile->isEnabled()) {
-            LOG_DEBUG("Triggering queued profile modification sync for:" << queuedChange.first);
-            startScheduledSync(queuedChange.first);
-        }
-        delete profile;
+    // Without a connection ProfileManager does not serialize the profiles.
+    if (!hadListeners && !iXmlChangeListeners.isEmpty())
+    {
+        connect(&iProfileManager, SIGNAL(signalProfileChanged(QString,int,QString)),
+                this, SLOT(slotProfileChanged(QString,int,QString)), Qt::QueuedConnection);
     }
+    else if (hadListeners && iXmlChangeListeners.isEmpty())
+    {
+        disconnect(&iProfileManager, SIGNAL(signalProfileChanged(QString,int,QString)),
+                   this, SLOT(slotProfileChanged(QString,int,QString)));
+    } // no else
+}
+
+QVariantMap Synchronizer::syncStatistics(const QString &aProfileId,
+                                         qlonglong aFromTime, qlonglong aToTime)
+{
+    FUNCTION_CALL_TRACE;
 
-    // continue triggering profiles until we have emptied the queue.
-    QMetaObject::invokeMethod(this, "profileChangeTriggerTimeout", Qt::QueuedConnection);
+    const QDateTime from = aFromTime > 0 ?
+        QDateTime::fromMSecsSinceEpoch(aFromTime) : QDateTime();
+    const QDateTime to = aToTime > 0 ?
+        QDateTime::fromMSecsSinceEpoch(aToTime) : QDateTime();
+    return iResultsHistory.statistics(aProfileId, from, to);
+}
+
+QVariantMap Synchronizer::syncConcurrency()
+{
+    FUNCTION_CALL_TRACE;
+
+    return iGovernor.status();
+}
+
+void Synchronizer::onXmlChangeListenerGone(const QString &aService)
+{
+    FUNCTION_CALL_TRACE;
+
+    if (iXmlChangeListeners.remove(aService))
+    {
+        iXmlChangeListenerWatcher->removeWatchedService(aService);
+        if (iXmlChangeListeners.isEmpty())
+        {
+            disconnect(&iProfileManager, SIGNAL(signalProfileChanged(QString,int,QString)),
+                       this, SLOT(slotProfileChanged(QString,int,QString)));
+        } // no else
+    } // no else
 }
 
 void Synchronizer::reschedule(const QString &aProfileName)
@@ -1692,6 +1990,7 @@ void Synchronizer::backupRestoreStarts ()
     if (iActiveSessions.size() == 0) {
         LOG_DEBUG ("No active sync sessions ");
         stopServers( true );
+        iProfileManager.flush();
         iSyncBackup->sendReply(0);
     } else {
         // Stop running sessions
@@ -1757,11 +2056,10 @@ void Synchronizer::start(unsigned int aAccountId)
 {
    FUNCTION_CALL_TRACE;
    LOG_DEBUG("Start sync requested for account" << aAccountId);
-   QList<SyncProfile*> profileList = iAccounts->getProfilesByAccountId(aAccountId);
-   foreach(SyncProfile *profile, profileList)
+   const QStringList profileNames = iAccounts->getProfileNamesByAccountId(aAccountId);
+   foreach(const QString &profileName, profileNames)
    {
-       startSync(profile->name());
-       delete profile;
+       startSync(profileName);
    }
 }
 
@@ -1769,11 +2067,10 @@ void Synchronizer::stop(unsigned int aAccountId)
 {
    FUNCTION_CALL_TRACE;
    LOG_DEBUG("Stop sync requested for account" << aAccountId);
-   QList<SyncProfile*> profileList = iAccounts->getProfilesByAccountId(aAccountId);
-   foreach(SyncProfile *profile, profileList)
+   const QStringList profileNames = iAccounts->getProfileNamesByAccountId(aAccountId);
+   foreach(const QString &profileName, profileNames)
    {
-       abortSync(profile->name());
-       delete profile;
+       abortSync(profileName);
    }
 }
 
@@ -1783,12 +2080,25 @@ int Synchronizer::status(unsigned int aAccountId, int &aFailedReason, qlonglong
     int status = 1; // Initialize to Done
     QDateTime prevSyncTime; // Initialize to invalid
     QDateTime nextSyncTime;
-    QList<SyncProfile*> profileList = iAccounts->getProfilesByAccountId(aAccountId);
-    foreach(SyncProfile *profile, profileList)
+
+    // Only the last results and the schedule are needed, not whole profiles.
+    QList<ProfileManager::SearchCriteria> criteria;
+    ProfileManager::SearchCriteria accountCriteria;
+    accountCriteria.iType = ProfileManager::SearchCriteria::EQUAL;
+    accountCriteria.iKey = KEY_ACCOUNT_ID;
+    accountCriteria.iValue = QString::number(aAccountId);
+    criteria.append(accountCriteria);
+    ProfileManager::Projection projection;
+    projection.iLastResults = true;
+    projection.iSchedule = true;
+    QList<ProfileManager::ProfileRow> rows =
+            iProfileManager.queryProfiles(criteria, projection);
+
+    foreach(const ProfileManager::ProfileRow &row, rows)
     {
         // First check if sync is going on for any profile corresponding to this
         // account ID
-        if(iActiveSessions.contains(profile->name()) || iSyncQueue.contains(profile->name()))
+        if(iActiveSessions.contains(row.iName) || iSyncQueue.contains(row.iName))
         {
             LOG_DEBUG("Sync running for" << aAccountId);
             status = 0;
@@ -1798,7 +2108,7 @@ int Synchronizer::status(unsigned int aAccountId, int &aFailedReason, qlonglong
         {
             // Check if the last sync resulted in an error for any of the
             // profiles
-            const SyncResults *lastResults = profile->lastResults();
+            const SyncResults *lastResults = row.iLastResults.data();
             if(lastResults && SyncResults::SYNC_RESULT_FAILED == lastResults->majorCode())
             {
                 status = 2;
@@ -1812,28 +2122,32 @@ int Synchronizer::status(unsigned int aAccountId, int &aFailedReason, qlonglong
     if(status != 0)
     {
         // Need to return the next and last sync times
-        foreach(SyncProfile *profile, profileList)
+        foreach(const ProfileManager::ProfileRow &row, rows)
         {
+            const QDateTime lastSyncTime = row.iLastResults ?
+                    row.iLastResults->syncTime() : QDateTime();
             if(!prevSyncTime.isValid())
             {
-                prevSyncTime = profile->lastSyncTime();
+                prevSyncTime = lastSyncTime;
             }
             else
             {
-                (prevSyncTime > profile->lastSyncTime()) ? prevSyncTime : profile->lastSyncTime();
+                (prevSyncTime > lastSyncTime) ? prevSyncTime : lastSyncTime;
             }
         }
         if(prevSyncTime.isValid())
         {
             // Doesn't really matter which profile we do this for, as all of
             // them have the same schedule
-            SyncProfile *profile = profileList.first();
-            nextSyncTime = profile->nextSyncTime(prevSyncTime);
+            const ProfileManager::ProfileRow &row = rows.first();
+            if(row.iSyncType == SyncProfile::SYNC_SCHEDULED)
+            {
+                nextSyncTime = row.iSchedule.nextSyncTime(prevSyncTime);
+            }
         }
     }
     aPrevSyncTime = prevSyncTime.toMSecsSinceEpoch();
     aNextSyncTime = nextSyncTime.toMSecsSinceEpoch();
-    qDeleteAll(profileList);
     return status;
 }
 
@@ -26,11 +26,16 @@
 
 #include "SyncDBusInterface.h"
 #include "SyncQueue.h"
+#include "SyncSession.h"
 #include "StorageBooker.h"
 #include "SyncScheduler.h"
 #include "SyncBackup.h"
 #include "SyncOnChange.h"
 #include "SyncOnChangeScheduler.h"
+#include "ProfileChangeBatcher.h"
+#include "SyncResultsHistory.h"
+#include "SyncGovernor.h"
+#include "SyncTriggerPipeline.h"
 
 #include "SyncCommonDefs.h"
 #include "ProfileManager.h"
@@ -44,6 +49,9 @@
 #include <QMap>
 #include <QString>
 #include <QDBusInterface>
+#include <QDBusContext>
+#include <QDBusServiceWatcher>
+#include <QSet>
 #include <QScopedPointer>
 #include <QTimer>
 
@@ -64,7 +72,8 @@ class BatteryInfo;
 /// This class manages other components and connects them to provide
 /// the fully functioning synchronization framework.
 class Synchronizer : public SyncDBusInterface, // Derived from QObject
-                     public PluginCbInterface
+                     public PluginCbInterface,
+                     protected QDBusContext
 {
     Q_OBJECT
 public:
@@ -174,6 +183,19 @@ public slots:
     //! Called  starts a schedule sync.
     bool startScheduledSync(QString aProfileName);
 
+    //! Called when a storage change triggers a sync.
+    bool startSyncOnChangeSync(QString aProfileName);
+
+    //! Called when the sync schedule or a retry of a profile is due.
+    void onScheduleTriggered(QString aProfileName);
+
+    /*! \brief Starts the sync of a profile once the trigger pipeline passes it on.
+     *
+     * \param aProfileName Name of the profile.
+     * \param aSources Trigger sources, see SyncTriggerPipeline::source().
+     */
+    void onSyncTriggered(QString aProfileName, int aSources);
+
     //! Called  when backup starts
     void backupStarts();
 
@@ -228,6 +250,16 @@ public slots:
      */
     void isSyncedExternally(unsigned int aAccountId, const QString aClientProfileName);
 
+    //! \see SyncDBusInterface::setProfileChangesAsXml
+    void setProfileChangesAsXml(bool aEnabled);
+
+    //! \see SyncDBusInterface::syncStatistics
+    virtual QVariantMap syncStatistics(const QString &aProfileId,
+                                       qlonglong aFromTime, qlonglong aToTime);
+
+    //! \see SyncDBusInterface::syncConcurrency
+    virtual QVariantMap syncConcurrency();
+
 signals:
 
         //! emitted by releaseStorages call
@@ -244,8 +276,8 @@ private slots:
 
     /*! \brief Handler for storage released signal.
      *
-     * Tries to start the next sync in queue, which may have been blocked
-     * earlier by storage reservations.
+     * Tries to start queued syncs, if any of them was blocked by the
+     * released storages.
      */
     void onStorageReleased();
 
@@ -266,6 +298,14 @@ private slots:
 
     void slotProfileChanged(QString aProfileName, int aChangeType , QString aProfileAsXml);
 
+    void slotProfileDelta(QString aProfileName, int aChangeType, QVariantMap aDelta);
+
+    /*! \brief Drops the XML change request of a client that left the bus.
+     *
+     * @param aService Unique bus name of the client.
+     */
+    void onXmlChangeListenerGone(const QString &aService);
+
     /*! \brief Starts a server plug-in
      *
      * @param aProfileName Server profile name
@@ -319,9 +359,6 @@ private slots:
      */
     void externalSyncStatus(const SyncProfile *aProfile, bool aQuery=false);
 
-    /*! \brief Triggers sync for profiles which were queued for sync due to profile changes. */
-    void profileChangeTriggerTimeout();
-
 private:
 
     bool startSync(const QString &aProfileName, bool aScheduled);
@@ -333,14 +370,28 @@ private:
      */
     bool startSyncNow(SyncSession *aSession);
 
-    /*! \brief Tries to starts next sync request from the sync queue.
+    /*! \brief Starts queued sync requests whose resources are free.
+     *
+     * The queue is scanned in priority order and every session whose
+     * storages and client profile can be acquired is started. A session
+     * that needs a resource wanted by a blocked session earlier in the
+     * queue is held back, so the blocked session is not starved. The
+     * resources the remaining sessions wait for are recorded, and the
+     * queue is scanned again only when one of them is released.
      *
-     * \return Is it possible to try starting more syncs by calling this
-     *  function again. Will be true if the first sync request in the queue
-     *  is not blocked by already reserved storages.
+     * \return True if any session was removed from the queue.
      */
     bool startNextSync();
 
+    /*! \brief Records the resources a newly queued session waits for.
+     *
+     * \param aSession Queued session
+     */
+    void waitForResources(const SyncSession *aSession);
+
+    //! Checks if any of the names is in the set.
+    static bool containsAny(const QSet<QString> &aSet, const QStringList &aNames);
+
     /*! \brief To clean up session
      *  \param aSession
      *  \param aStatus of sync
@@ -384,7 +435,16 @@ private:
      */
     bool cleanupProfile(const QString &profileId);
 
-    bool clientProfileActive(const QString &clientProfileName);
+    /*! \brief Checks if no more sessions of the client plug-in can start.
+     *
+     * By default one session of a client plug-in runs at a time. The client
+     * profile can allow more with the max_parallel_sessions key.
+     * \param aProfile Sync profile of the session to start.
+     * \param aClaimed Number of instances of the plug-in held for other
+     *  sessions that have not started yet.
+     * \return True if all allowed sessions of the plug-in are running.
+     */
+    bool clientProfileActive(const SyncProfile *aProfile, int aClaimed = 0);
 
     /*! \brief Removes the external sync status for a given profile, if status changes
      * 'syncedExternallyStatus' dbus signal will be emitted to notify possible clients.
@@ -419,6 +479,27 @@ private:
 
     SyncQueue iSyncQueue;
 
+    // Trigger sources of syncs that have been passed on by the trigger
+    // pipeline but not started yet, see SyncTriggerPipeline::source().
+    QHash<QString, int> iPendingTriggers;
+
+    // Profiles with a retry alarm set after a failed sync.
+    QSet<QString> iRetryProfiles;
+
+    // Storages and client profiles queued sessions are waiting for.
+    QSet<QString> iWaitedStorages;
+
+    QSet<QString> iWaitedClients;
+
+    // Storages released since the last storageReleased() was handled.
+    QSet<QString> iReleasedStorages;
+
+    // Limits the number of sessions running at the same time.
+    SyncGovernor iGovernor;
+
+    // True if a queued session waits for a free session slot.
+    bool iWaitingForSlot;
+
     StorageBooker iStorageBooker;
 
     SyncScheduler *iSyncScheduler;
@@ -455,14 +536,19 @@ private:
 
     QString iRemoteName;
 
-    /*
-     * Temporary, until we can clean up Buteo and properly implement the SyncOnChange
-     * queue to handle all of the required changes (account + profile + connectivity)
-     * in a sane manner (also taking into account BackupRestore status).
-     * However, that change will be far more invasive, so for now this is much simpler.
-     */
-    QList<QPair<QString, ProfileManager::ProfileChangeType> > iProfileChangeTriggerQueue;
-    QTimer iProfileChangeTriggerTimer;
+    // Debounces and merges the sync triggers of all sources.
+    SyncTriggerPipeline iTriggerPipeline;
+
+    // Coalesces profile change deltas for profilesChanged().
+    ProfileChangeBatcher iProfileChangeBatcher;
+
+    // Clients that asked for signalProfileChanged(), by unique bus name.
+    QSet<QString> iXmlChangeListeners;
+
+    QDBusServiceWatcher *iXmlChangeListenerWatcher;
+
+    // Long-term results of all sessions, for syncStatistics().
+    SyncResultsHistory iResultsHistory;
 
 #ifdef SYNCFW_UNIT_TESTS
     friend class SynchronizerTest;
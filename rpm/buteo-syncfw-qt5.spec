@@ -8,6 +8,7 @@ License: LGPLv2.1
 Source0: %{name}-%{version}.tar.gz
 BuildRequires: doxygen, fdupes
 BuildRequires: pkgconfig(Qt5Core)
+BuildRequires: pkgconfig(Qt5Concurrent)
 BuildRequires: pkgconfig(Qt5DBus)
 BuildRequires: pkgconfig(Qt5Sql)
 BuildRequires: pkgconfig(Qt5Test)
@@ -0,0 +1,151 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "IndexedHeapTest.h"
+#include "IndexedHeap.h"
+
+using namespace Buteo;
+
+namespace {
+
+struct Item
+{
+    QString iName;
+    int iValue;
+};
+
+struct ItemTraits
+{
+    static bool lessThan(const Item &aLeft, const Item &aRight)
+    {
+        return aLeft.iValue < aRight.iValue;
+    }
+
+    static QString key(const Item &aItem)
+    {
+        return aItem.iName;
+    }
+};
+
+typedef IndexedHeap<QString, Item, ItemTraits> ItemHeap;
+
+Item item(const QString &aName, int aValue)
+{
+    Item item;
+    item.iName = aName;
+    item.iValue = aValue;
+    return item;
+}
+
+// Takes out all items and returns their values in order.
+QList<int> drain(ItemHeap &aHeap)
+{
+    QList<int> values;
+    while (!aHeap.isEmpty())
+    {
+        values.append(aHeap.takeFirst().iValue);
+    }
+    return values;
+}
+
+}
+
+void IndexedHeapTest::testOrder()
+{
+    ItemHeap heap;
+    QVERIFY(heap.isEmpty());
+
+    const QList<int> values = QList<int>() << 5 << 3 << 8 << 1 << 9 << 2 << 7;
+    foreach (int value, values)
+    {
+        heap.insert(item(QString::number(value), value));
+    }
+    QCOMPARE(heap.size(), values.size());
+    QCOMPARE(heap.first().iValue, 1);
+
+    QList<int> sorted = values;
+    qSort(sorted);
+    QCOMPARE(drain(heap), sorted);
+    QVERIFY(heap.isEmpty());
+}
+
+void IndexedHeapTest::testTake()
+{
+    ItemHeap heap;
+    for (int i = 0; i < 20; ++i)
+    {
+        heap.insert(item(QString::number(i), (i * 7) % 20));
+    }
+
+    // Items can be found and taken out from any position.
+    QVERIFY(heap.contains("3"));
+    QVERIFY(heap.find("3") != 0);
+    QCOMPARE(heap.find("3")->iValue, 1);
+    QCOMPARE(heap.take("3").iValue, 1);
+    QVERIFY(!heap.contains("3"));
+    QVERIFY(heap.find("3") == 0);
+    QCOMPARE(heap.take("0").iValue, 0);
+    QCOMPARE(heap.take("19").iValue, 13);
+    QCOMPARE(heap.size(), 17);
+
+    // The rest stays in order and indexed.
+    QCOMPARE(heap.first().iValue, 2);
+    for (int i = 1; i < 20; ++i)
+    {
+        if (i != 3 && i != 19)
+        {
+            QCOMPARE(heap.find(QString::number(i))->iValue, (i * 7) % 20);
+        } // no else
+    }
+    QList<int> values = drain(heap);
+    QCOMPARE(values.size(), 17);
+    for (int i = 1; i < values.size(); ++i)
+    {
+        QVERIFY(values.at(i - 1) < values.at(i));
+    }
+
+    heap.insert(item("a", 1));
+    heap.clear();
+    QVERIFY(heap.isEmpty());
+    QVERIFY(!heap.contains("a"));
+}
+
+void IndexedHeapTest::testAssign()
+{
+    QVector<Item> items;
+    for (int i = 0; i < 10; ++i)
+    {
+        items.append(item(QString::number(i), 9 - i));
+    }
+
+    ItemHeap heap;
+    heap.insert(item("old", -1));
+    heap.assign(items);
+    QCOMPARE(heap.size(), 10);
+    QVERIFY(!heap.contains("old"));
+    QCOMPARE(heap.find("2")->iValue, 7);
+    QCOMPARE(heap.take("5").iValue, 4);
+    QCOMPARE(drain(heap), QList<int>() << 0 << 1 << 2 << 3 << 5 << 6 << 7 << 8 << 9);
+}
+
+QTEST_MAIN(Buteo::IndexedHeapTest)
@@ -0,0 +1,140 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileChangeBatcherTest.h"
+#include "ProfileChangeBatcher.h"
+#include "ProfileManager.h"
+#include "ProfileEngineDefs.h"
+
+#include <QSignalSpy>
+
+using namespace Buteo;
+
+static QVariantMap keysDelta(const QString &aKey, const QString &aValue)
+{
+    QVariantMap keys;
+    keys.insert(aKey, aValue);
+    QVariantMap delta;
+    delta.insert(DELTA_KEYS, keys);
+    return delta;
+}
+
+void ProfileChangeBatcherTest::testBatch()
+{
+    ProfileChangeBatcher batcher;
+    QSignalSpy spy(&batcher, SIGNAL(changesReady(QVariantList)));
+
+    // Nothing to send.
+    QCOMPARE(batcher.isPending(), false);
+    batcher.flush();
+    QCOMPARE(spy.count(), 0);
+
+    // Changes are sent together, in the order the profiles first changed.
+    batcher.addChange("b", ProfileManager::PROFILE_MODIFIED, keysDelta("k", "1"));
+    batcher.addChange("a", ProfileManager::PROFILE_ADDED, QVariantMap());
+    batcher.addChange("b", ProfileManager::PROFILE_MODIFIED, keysDelta("k", "2"));
+    QCOMPARE(batcher.isPending(), true);
+    QCOMPARE(spy.count(), 0);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(batcher.isPending(), false);
+    const QVariantList changes = spy.at(0).at(0).toList();
+    QCOMPARE(changes.size(), 2);
+    QCOMPARE(changes.at(0).toMap().value(ProfileChangeBatcher::CHANGE_PROFILE_NAME).toString(),
+             QString("b"));
+    QCOMPARE(changes.at(0).toMap().value(DELTA_KEYS).toMap().value("k").toString(),
+             QString("2"));
+    QCOMPARE(changes.at(1).toMap().value(ProfileChangeBatcher::CHANGE_PROFILE_NAME).toString(),
+             QString("a"));
+    QCOMPARE(changes.at(1).toMap().value(ProfileChangeBatcher::CHANGE_TYPE).toInt(),
+             int(ProfileManager::PROFILE_ADDED));
+
+    // Flush sends right away and only once.
+    batcher.addChange("a", ProfileManager::PROFILE_MODIFIED, QVariantMap());
+    batcher.flush();
+    QCOMPARE(spy.count(), 2);
+    QTest::qWait(ProfileChangeBatcher::COALESCE_INTERVAL * 2);
+    QCOMPARE(spy.count(), 2);
+}
+
+void ProfileChangeBatcherTest::testMerge()
+{
+    ProfileChangeBatcher batcher;
+    QSignalSpy spy(&batcher, SIGNAL(changesReady(QVariantList)));
+
+    QVariantMap removed;
+    removed.insert(DELTA_REMOVED_KEYS, QStringList() << "gone" << "back");
+    QVariantMap results;
+    results.insert(DELTA_MAJOR_CODE, 1);
+    QVariantMap logs;
+    logs.insert(DELTA_RESULTS, results);
+
+    batcher.addChange("p", ProfileManager::PROFILE_LOGS_MODIFIED, logs);
+    batcher.addChange("p", ProfileManager::PROFILE_MODIFIED, keysDelta("k", "v"));
+    batcher.addChange("p", ProfileManager::PROFILE_MODIFIED, removed);
+    batcher.addChange("p", ProfileManager::PROFILE_MODIFIED, keysDelta("back", "1"));
+    batcher.flush();
+
+    QCOMPARE(spy.count(), 1);
+    const QVariantList changes = spy.at(0).at(0).toList();
+    QCOMPARE(changes.size(), 1);
+    const QVariantMap change = changes.first().toMap();
+
+    // The most significant change type wins, all deltas are kept.
+    QCOMPARE(change.value(ProfileChangeBatcher::CHANGE_TYPE).toInt(),
+             int(ProfileManager::PROFILE_MODIFIED));
+    const QVariantMap keys = change.value(DELTA_KEYS).toMap();
+    QCOMPARE(keys.size(), 2);
+    QCOMPARE(keys.value("k").toString(), QString("v"));
+    QCOMPARE(keys.value("back").toString(), QString("1"));
+    QCOMPARE(change.value(DELTA_REMOVED_KEYS).toStringList(), QStringList() << "gone");
+    QCOMPARE(change.value(DELTA_RESULTS).toMap().value(DELTA_MAJOR_CODE).toInt(), 1);
+}
+
+void ProfileChangeBatcherTest::testRemoved()
+{
+    ProfileChangeBatcher batcher;
+    QSignalSpy spy(&batcher, SIGNAL(changesReady(QVariantList)));
+
+    // Changes before removal are dropped.
+    batcher.addChange("p", ProfileManager::PROFILE_ADDED, keysDelta("k", "v"));
+    batcher.addChange("p", ProfileManager::PROFILE_REMOVED, QVariantMap());
+    batcher.flush();
+    QCOMPARE(spy.count(), 1);
+    QVariantMap change = spy.at(0).at(0).toList().first().toMap();
+    QCOMPARE(change.value(ProfileChangeBatcher::CHANGE_TYPE).toInt(),
+             int(ProfileManager::PROFILE_REMOVED));
+    QVERIFY(!change.contains(DELTA_KEYS));
+
+    // A profile created again is reported as added.
+    batcher.addChange("p", ProfileManager::PROFILE_REMOVED, QVariantMap());
+    batcher.addChange("p", ProfileManager::PROFILE_ADDED, keysDelta("k", "w"));
+    batcher.flush();
+    QCOMPARE(spy.count(), 2);
+    change = spy.at(1).at(0).toList().first().toMap();
+    QCOMPARE(change.value(ProfileChangeBatcher::CHANGE_TYPE).toInt(),
+             int(ProfileManager::PROFILE_ADDED));
+    QCOMPARE(change.value(DELTA_KEYS).toMap().value("k").toString(), QString("w"));
+}
+
+QTEST_MAIN(Buteo::ProfileChangeBatcherTest)
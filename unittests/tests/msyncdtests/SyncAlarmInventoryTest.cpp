@@ -0,0 +1,134 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "SyncAlarmInventoryTest.h"
+#include "SyncAlarmInventory.h"
+
+using namespace Buteo;
+
+void SyncAlarmInventoryTest::init()
+{
+    iDbFile = QDir::tempPath() + QDir::separator() + "alarminventorytest.db.sqlite";
+    QFile::remove(iDbFile);
+}
+
+void SyncAlarmInventoryTest::cleanup()
+{
+    QFile::remove(iDbFile);
+}
+
+void SyncAlarmInventoryTest::testOrder()
+{
+    SyncAlarmInventory inventory;
+    QVERIFY(inventory.init(iDbFile));
+    QSignalSpy spy(&inventory, SIGNAL(triggerAlarm(int)));
+
+    const QDateTime now = QDateTime::currentDateTime();
+    const int late = inventory.addAlarm(now.addMSecs(300));
+    const int early = inventory.addAlarm(now.addMSecs(100));
+    const int past = inventory.addAlarm(now.addSecs(-60));
+    const int middle = inventory.addAlarm(now.addMSecs(200));
+    QVERIFY(late > 0 && early > 0 && past > 0 && middle > 0);
+    QCOMPARE(inventory.count(), 4);
+
+    // An alarm in the past triggers right away.
+    QVERIFY(inventory.alarmTime(past) >= now);
+
+    QTRY_COMPARE(spy.count(), 4);
+    QCOMPARE(spy.at(0).at(0).toInt(), past);
+    QCOMPARE(spy.at(1).at(0).toInt(), early);
+    QCOMPARE(spy.at(2).at(0).toInt(), middle);
+    QCOMPARE(spy.at(3).at(0).toInt(), late);
+    QCOMPARE(inventory.count(), 0);
+}
+
+void SyncAlarmInventoryTest::testRemove()
+{
+    SyncAlarmInventory inventory;
+    QVERIFY(inventory.init(iDbFile));
+    QSignalSpy spy(&inventory, SIGNAL(triggerAlarm(int)));
+
+    const QDateTime now = QDateTime::currentDateTime();
+    QList<int> alarms;
+    for (int i = 0; i < 20; ++i)
+    {
+        alarms.append(inventory.addAlarm(now.addMSecs(100 + (i * 7) % 20 * 10)));
+    }
+    QCOMPARE(inventory.count(), 20);
+
+    // Removing the earliest alarm moves the timer to the next one.
+    QVERIFY(inventory.removeAlarm(alarms.at(0)));
+    QVERIFY(!inventory.removeAlarm(alarms.at(0)));
+    QVERIFY(!inventory.removeAlarm(0));
+    for (int i = 1; i < 20; i += 2)
+    {
+        QVERIFY(inventory.removeAlarm(alarms.at(i)));
+    }
+    QCOMPARE(inventory.count(), 9);
+    QVERIFY(!inventory.alarmTime(alarms.at(1)).isValid());
+
+    QTRY_COMPARE(spy.count(), 9);
+    for (int i = 0; i < spy.count(); ++i)
+    {
+        const int id = spy.at(i).at(0).toInt();
+        QVERIFY(id != alarms.at(0));
+        QCOMPARE(alarms.indexOf(id) % 2, 0);
+    }
+
+    inventory.addAlarm(now.addSecs(60));
+    inventory.removeAllAlarms();
+    QCOMPARE(inventory.count(), 0);
+}
+
+void SyncAlarmInventoryTest::testPersistence()
+{
+    const QDateTime alarmTime = QDateTime::currentDateTime().addSecs(3600);
+    int removed = 0;
+    int kept = 0;
+    {
+        SyncAlarmInventory inventory;
+        QVERIFY(inventory.init(iDbFile));
+        removed = inventory.addAlarm(alarmTime.addSecs(-60));
+        kept = inventory.addAlarm(alarmTime);
+        QVERIFY(inventory.removeAlarm(removed));
+        QVERIFY(inventory.flush());
+    }
+
+    SyncAlarmInventory inventory;
+    QVERIFY(inventory.init(iDbFile));
+    QCOMPARE(inventory.count(), 1);
+    QVERIFY(!inventory.alarmTime(removed).isValid());
+    QCOMPARE(inventory.alarmTime(kept).toTime_t(), alarmTime.toTime_t());
+
+    // New alarms do not reuse the loaded ids.
+    const int added = inventory.addAlarm(alarmTime);
+    QVERIFY(added > kept);
+
+    inventory.removeAllAlarms();
+    QVERIFY(inventory.flush());
+    SyncAlarmInventory empty;
+    QVERIFY(empty.init(iDbFile));
+    QCOMPARE(empty.count(), 0);
+}
+
+QTEST_MAIN(Buteo::SyncAlarmInventoryTest)
@@ -0,0 +1,148 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "SyncGovernorTest.h"
+#include "SyncGovernor.h"
+#include "SyncCommonDefs.h"
+#include <SyncProfile.h>
+#include <ProfileEngineDefs.h>
+
+using namespace Buteo;
+
+static SyncProfile *createProfile(const QString &aName, const QString &aDestinationType,
+                                  const QString &aClient, const QString &aRemoteDatabase = QString())
+{
+    SyncProfile *profile = new SyncProfile(aName);
+    profile->setKey(KEY_DESTINATION_TYPE, aDestinationType);
+    if (!aRemoteDatabase.isEmpty())
+    {
+        profile->setKey(KEY_REMOTE_DATABASE, aRemoteDatabase);
+    }
+    profile->merge(Profile(aClient, Profile::TYPE_CLIENT));
+    return profile;
+}
+
+void SyncGovernorTest::testGlobalLimit()
+{
+    QScopedPointer<SyncProfile> p1(createProfile("p1", VALUE_ONLINE, "caldav"));
+    QScopedPointer<SyncProfile> p2(createProfile("p2", VALUE_DEVICE, "syncml"));
+    QScopedPointer<SyncProfile> p3(createProfile("p3", VALUE_ONLINE, "carddav"));
+    SyncGovernor governor;
+
+    // No limits by default.
+    QCOMPARE(governor.limit(), 0);
+    QCOMPARE(governor.canAdmit(p1.data()), true);
+
+    governor.setLimit(2);
+    QCOMPARE(governor.limit(), 2);
+    governor.admit(p1->name(), p1.data());
+    QCOMPARE(governor.canAdmit(p2.data()), true);
+    governor.admit(p2->name(), p2.data());
+    QCOMPARE(governor.canAdmit(p3.data()), false);
+
+    QCOMPARE(governor.release(p1->name()), true);
+    QCOMPARE(governor.release(p1->name()), false);
+    QCOMPARE(governor.canAdmit(p3.data()), true);
+}
+
+void SyncGovernorTest::testClassLimits()
+{
+    QScopedPointer<SyncProfile> online1(createProfile("online1", VALUE_ONLINE, "caldav",
+                                                      "https://dav.example.com/calendars"));
+    QScopedPointer<SyncProfile> online2(createProfile("online2", VALUE_ONLINE, "carddav",
+                                                      "https://DAV.example.com/contacts"));
+    QScopedPointer<SyncProfile> online3(createProfile("online3", VALUE_ONLINE, "caldav",
+                                                      "https://other.example.com/"));
+    QScopedPointer<SyncProfile> device(createProfile("device", VALUE_DEVICE, "syncml"));
+    QCOMPARE(SyncGovernor::host(online1.data()), QString("dav.example.com"));
+    QCOMPARE(SyncGovernor::host(online2.data()), QString("dav.example.com"));
+    QCOMPARE(SyncGovernor::host(device.data()), QString());
+
+    SyncGovernor governor;
+    governor.setClassLimit(SyncGovernor::LIMIT_HOST, 1);
+    governor.setClassLimit(SyncGovernor::LIMIT_CLIENT_PLUGIN, 1);
+    governor.setClassLimit(SyncGovernor::LIMIT_ONLINE, 1);
+    QCOMPARE(governor.classLimit(SyncGovernor::LIMIT_HOST), 1);
+
+    // Same host, other plug-in.
+    governor.admit(online1->name(), online1.data());
+    QCOMPARE(governor.canAdmit(online2.data()), false);
+    governor.setClassLimit(SyncGovernor::LIMIT_HOST, 0);
+    QCOMPARE(governor.canAdmit(online2.data()), false);
+
+    // Online limit reached, device sessions are still admitted.
+    governor.setClassLimit(SyncGovernor::LIMIT_ONLINE, 0);
+    QCOMPARE(governor.canAdmit(online2.data()), true);
+    QCOMPARE(governor.canAdmit(device.data()), true);
+
+    // Same plug-in, other host.
+    QCOMPARE(governor.canAdmit(online3.data()), false);
+    governor.setClassLimit(SyncGovernor::LIMIT_CLIENT_PLUGIN, 2);
+    QCOMPARE(governor.canAdmit(online3.data()), true);
+
+    governor.setClassLimit(SyncGovernor::LIMIT_DEVICE, 1);
+    governor.admit(device->name(), device.data());
+    QScopedPointer<SyncProfile> device2(createProfile("device2", VALUE_DEVICE, "obex"));
+    QCOMPARE(governor.canAdmit(device2.data()), false);
+    governor.release(device->name());
+    QCOMPARE(governor.canAdmit(device2.data()), true);
+}
+
+void SyncGovernorTest::testOccupancy()
+{
+    QScopedPointer<SyncProfile> p1(createProfile("p1", VALUE_ONLINE, "caldav",
+                                                 "https://dav.example.com/"));
+    QScopedPointer<SyncProfile> p2(createProfile("p2", VALUE_ONLINE, "caldav",
+                                                 "https://dav.example.com/"));
+    QScopedPointer<SyncProfile> p3(createProfile("p3", VALUE_DEVICE, "syncml"));
+    SyncGovernor governor;
+    governor.setLimit(1);
+
+    // Slots are taken even beyond the limit.
+    governor.admit(p1->name(), p1.data());
+    governor.admit(p2->name(), p2.data());
+    governor.admit(p3->name(), p3.data());
+    // Admitting the same session again does not take another slot.
+    governor.admit(p3->name(), p3.data());
+    QCOMPARE(governor.occupancy(), 3);
+    QCOMPARE(governor.peakOccupancy(), 3);
+
+    QVariantMap status = governor.status();
+    QCOMPARE(status.value(Sync::CONCURRENCY_ACTIVE).toInt(), 3);
+    QCOMPARE(status.value(Sync::CONCURRENCY_LIMIT).toInt(), 1);
+    QCOMPARE(status.value(Sync::CONCURRENCY_ONLINE).toInt(), 2);
+    QCOMPARE(status.value(Sync::CONCURRENCY_DEVICE).toInt(), 1);
+    QCOMPARE(status.value(Sync::CONCURRENCY_CLIENTS).toMap().value("caldav").toInt(), 2);
+    QCOMPARE(status.value(Sync::CONCURRENCY_HOSTS).toMap().value("dav.example.com").toInt(), 2);
+
+    governor.release(p1->name());
+    governor.release(p2->name());
+    status = governor.status();
+    QCOMPARE(governor.occupancy(), 1);
+    QCOMPARE(status.value(Sync::CONCURRENCY_PEAK).toInt(), 3);
+    QCOMPARE(status.value(Sync::CONCURRENCY_ONLINE).toInt(), 0);
+    QVERIFY(status.value(Sync::CONCURRENCY_CLIENTS).toMap().value("caldav").isNull());
+    QVERIFY(status.value(Sync::CONCURRENCY_HOSTS).toMap().isEmpty());
+}
+
+QTEST_MAIN(Buteo::SyncGovernorTest)
@@ -24,9 +24,20 @@
 #include "SyncQueue.h"
 #include "SyncSession.h"
 #include <SyncProfile.h>
+#include <ProfileEngineDefs.h>
 
 using namespace Buteo;
 
+static SyncSession *createSession(const QString &aName, SyncSession::Trigger aTrigger,
+                                  const QString &aDestinationType = VALUE_ONLINE)
+{
+    SyncProfile *profile = new SyncProfile(aName);
+    profile->setKey(KEY_DESTINATION_TYPE, aDestinationType);
+    SyncSession *session = new SyncSession(profile);
+    session->setTrigger(aTrigger);
+    return session;
+}
+
 void SyncQueueTest::testQueue()
 {
     const QString NAME1 = "Name1";
@@ -62,4 +73,137 @@ void SyncQueueTest::testQueue()
 
 }
 
+void SyncQueueTest::testPriority()
+{
+    QList<SyncSession*> sessions;
+    sessions << createSession("retry", SyncSession::TRIGGER_RETRY)
+             << createSession("scheduled", SyncSession::TRIGGER_SCHEDULE)
+             << createSession("soc", SyncSession::TRIGGER_SYNC_ON_CHANGE)
+             << createSession("device", SyncSession::TRIGGER_SCHEDULE, VALUE_DEVICE)
+             << createSession("manual", SyncSession::TRIGGER_MANUAL, VALUE_DEVICE);
+
+    QCOMPARE(SyncQueue::priority(sessions[0]), SyncQueue::PRIORITY_RETRY);
+    QCOMPARE(SyncQueue::priority(sessions[1]), SyncQueue::PRIORITY_SCHEDULED);
+    QCOMPARE(SyncQueue::priority(sessions[2]), SyncQueue::PRIORITY_SYNC_ON_CHANGE);
+    QCOMPARE(SyncQueue::priority(sessions[3]), SyncQueue::PRIORITY_DEVICE);
+    QCOMPARE(SyncQueue::priority(sessions[4]), SyncQueue::PRIORITY_MANUAL);
+
+    // setScheduled() and setTrigger() agree.
+    QCOMPARE(sessions[0]->isScheduled(), true);
+    QCOMPARE(sessions[4]->isScheduled(), false);
+
+    SyncQueue q;
+    foreach (SyncSession *session, sessions)
+    {
+        q.enqueue(session, 0);
+    }
+    QCOMPARE(q.size(), sessions.size());
+
+    QList<SyncSession*> expected;
+    for (int i = sessions.size() - 1; i >= 0; --i)
+    {
+        expected.append(sessions[i]);
+    }
+    QCOMPARE(q.getQueuedSyncSessions(), expected);
+    QCOMPARE(q.size(), sessions.size());
+
+    foreach (SyncSession *session, expected)
+    {
+        QCOMPARE(q.head(), session);
+        QCOMPARE(q.dequeue(), session);
+    }
+    QCOMPARE(q.isEmpty(), true);
+
+    qDeleteAll(sessions);
+}
+
+void SyncQueueTest::testAging()
+{
+    const qint64 INTERVAL = 1000;
+    SyncSession *scheduled = createSession("scheduled", SyncSession::TRIGGER_SCHEDULE);
+    SyncSession *manual = createSession("manual", SyncSession::TRIGGER_MANUAL);
+    SyncQueue q;
+    q.setAgingInterval(INTERVAL);
+    QCOMPARE(q.agingInterval(), INTERVAL);
+
+    // A fresh manual sync goes ahead of a scheduled sync.
+    q.enqueue(scheduled, 0);
+    q.enqueue(manual, 2 * INTERVAL);
+    QCOMPARE(q.head(), manual);
+    QCOMPARE(q.dequeue(), manual);
+    QCOMPARE(q.dequeue(), scheduled);
+
+    // After waiting long enough the scheduled sync is served first.
+    q.enqueue(scheduled, 0);
+    q.enqueue(manual, 4 * INTERVAL);
+    QCOMPARE(q.head(), scheduled);
+    QCOMPARE(q.dequeue(), scheduled);
+    QCOMPARE(q.dequeue(), manual);
+
+    // On a tie the session queued first wins.
+    q.enqueue(scheduled, 0);
+    q.enqueue(manual, SyncQueue::PRIORITY_SCHEDULED * INTERVAL);
+    QCOMPARE(q.dequeue(), scheduled);
+    QCOMPARE(q.dequeue(), manual);
+
+    delete scheduled;
+    delete manual;
+}
+
+void SyncQueueTest::testRemoveByName()
+{
+    const int COUNT = 20;
+    QList<SyncSession*> sessions;
+    SyncQueue q;
+    for (int i = 0; i < COUNT; ++i)
+    {
+        SyncSession *session = createSession(QString("profile%1").arg(i),
+            static_cast<SyncSession::Trigger>(i % 4));
+        sessions.append(session);
+        q.enqueue(session, i);
+    }
+    QCOMPARE(q.size(), COUNT);
+
+    // Adding a queued profile again is ignored.
+    q.enqueue(sessions[3], 100);
+    QCOMPARE(q.size(), COUNT);
+
+    QList<SyncSession*> order = q.getQueuedSyncSessions();
+    QCOMPARE(order.size(), COUNT);
+
+    // Remove from the middle, the front and the back of the heap.
+    QVERIFY(q.dequeue("unknown") == NULL);
+    QStringList removed;
+    removed << "profile7" << order.first()->profileName()
+            << order.last()->profileName() << "profile12";
+    foreach (const QString &name, removed)
+    {
+        QCOMPARE(q.contains(name), true);
+        SyncSession *session = q.dequeue(name);
+        QVERIFY(session != NULL);
+        QCOMPARE(session->profileName(), name);
+        QCOMPARE(q.contains(name), false);
+        QVERIFY(q.dequeue(name) == NULL);
+    }
+    QCOMPARE(q.size(), COUNT - removed.size());
+
+    // The remaining sessions keep their relative order.
+    QList<SyncSession*> remaining;
+    while (!q.isEmpty())
+    {
+        remaining.append(q.dequeue());
+    }
+    foreach (SyncSession *session, order)
+    {
+        if (!removed.contains(session->profileName()))
+        {
+            QVERIFY(!remaining.isEmpty());
+            QCOMPARE(remaining.takeFirst(), session);
+        } // no else
+    }
+    QVERIFY(remaining.isEmpty());
+
+    qDeleteAll(sessions);
+}
+
 QTEST_MAIN(Buteo::SyncQueueTest)
@@ -0,0 +1,176 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "SyncResultsHistoryTest.h"
+#include "SyncResultsHistory.h"
+#include "SyncResults.h"
+#include "SyncCommonDefs.h"
+
+using namespace Buteo;
+
+static SyncResults makeResults(const QDateTime &aTime, int aMajorCode,
+                               int aMinorCode, unsigned aItems)
+{
+    SyncResults results(aTime, aMajorCode, aMinorCode);
+    results.addTargetResults(TargetResults("contacts", ItemCounts(aItems, 0, 0),
+                                           ItemCounts(0, 0, 0)));
+    return results;
+}
+
+void SyncResultsHistoryTest::init()
+{
+    iDbFile = QDir::tempPath() + QDir::separator() + "synchistorytest.db.sqlite";
+    QFile::remove(iDbFile);
+}
+
+void SyncResultsHistoryTest::cleanup()
+{
+    QFile::remove(iDbFile);
+}
+
+void SyncResultsHistoryTest::testStatistics()
+{
+    SyncResultsHistory history;
+    QVERIFY(history.init(iDbFile));
+
+    const QDateTime now = QDateTime::currentDateTime();
+    // Durations 1..20 seconds, every fourth sync fails.
+    for (int i = 1; i <= 20; ++i)
+    {
+        const bool failed = (i % 4 == 0);
+        QVERIFY(history.record("p1", makeResults(now.addSecs(-i),
+            failed ? SyncResults::SYNC_RESULT_FAILED : SyncResults::SYNC_RESULT_SUCCESS,
+            failed ? SyncResults::CONNECTION_ERROR : SyncResults::NO_ERROR, 10),
+            i * 1000));
+    }
+    QVERIFY(history.record("p2", makeResults(now, SyncResults::SYNC_RESULT_FAILED,
+                                             SyncResults::AUTHENTICATION_FAILURE, 0),
+                           500));
+
+    QVariantMap stats = history.statistics("p1", QDateTime(), QDateTime());
+    QCOMPARE(stats.value(Sync::STATS_COUNT).toLongLong(), qint64(20));
+    QCOMPARE(stats.value(Sync::STATS_SUCCESS_COUNT).toLongLong(), qint64(15));
+    QCOMPARE(stats.value(Sync::STATS_SUCCESS_RATE).toDouble(), 0.75);
+    QCOMPARE(stats.value(Sync::STATS_DURATION_P50).toLongLong(), qint64(10000));
+    QCOMPARE(stats.value(Sync::STATS_DURATION_P95).toLongLong(), qint64(19000));
+    QCOMPARE(stats.value(Sync::STATS_ITEMS).toLongLong(), qint64(200));
+    // 200 items in 210 seconds.
+    QVERIFY(qAbs(stats.value(Sync::STATS_ITEMS_PER_SECOND).toDouble() - 200.0 / 210) < 0.0001);
+
+    QVariantMap errorCodes = stats.value(Sync::STATS_ERROR_CODES).toMap();
+    QCOMPARE(errorCodes.size(), 1);
+    QCOMPARE(errorCodes.value(QString::number(SyncResults::CONNECTION_ERROR)).toLongLong(),
+             qint64(5));
+    QCOMPARE(stats.value(Sync::STATS_TARGET_ITEMS).toMap().value("contacts").toLongLong(),
+             qint64(200));
+
+    // An empty profile name covers all profiles.
+    stats = history.statistics(QString(), QDateTime(), QDateTime());
+    QCOMPARE(stats.value(Sync::STATS_COUNT).toLongLong(), qint64(21));
+    QCOMPARE(stats.value(Sync::STATS_ERROR_CODES).toMap().size(), 2);
+
+    stats = history.statistics("unknown", QDateTime(), QDateTime());
+    QCOMPARE(stats.value(Sync::STATS_COUNT).toLongLong(), qint64(0));
+    QCOMPARE(stats.value(Sync::STATS_SUCCESS_RATE).toDouble(), 0.0);
+}
+
+void SyncResultsHistoryTest::testWindow()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    {
+        SyncResultsHistory history;
+        QVERIFY(history.init(iDbFile));
+        QVERIFY(history.record("p1", makeResults(now.addDays(-10),
+            SyncResults::SYNC_RESULT_SUCCESS, SyncResults::NO_ERROR, 1), 1000));
+        QVERIFY(history.record("p1", makeResults(now.addDays(-5),
+            SyncResults::SYNC_RESULT_SUCCESS, SyncResults::NO_ERROR, 1), 2000));
+        QVERIFY(history.record("p1", makeResults(now.addDays(-1),
+            SyncResults::SYNC_RESULT_SUCCESS, SyncResults::NO_ERROR, 1), 3000));
+    }
+
+    // The history is kept across instances.
+    SyncResultsHistory history;
+    QVERIFY(history.init(iDbFile));
+    QVariantMap stats = history.statistics("p1", now.addDays(-6), now.addDays(-2));
+    QCOMPARE(stats.value(Sync::STATS_COUNT).toLongLong(), qint64(1));
+    QCOMPARE(stats.value(Sync::STATS_DURATION_P50).toLongLong(), qint64(2000));
+
+    stats = history.statistics("p1", now.addDays(-6), QDateTime());
+    QCOMPARE(stats.value(Sync::STATS_COUNT).toLongLong(), qint64(2));
+}
+
+void SyncResultsHistoryTest::testRetention()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    SyncResultsHistory history;
+    QCOMPARE(history.retention(), int(SyncResultsHistory::DEFAULT_RETENTION_DAYS));
+    QVERIFY(history.init(iDbFile));
+    history.setRetention(30);
+
+    QVERIFY(history.record("p1", makeResults(now.addDays(-20),
+        SyncResults::SYNC_RESULT_SUCCESS, SyncResults::NO_ERROR, 1), 1000));
+    QVERIFY(history.record("p1", makeResults(now.addDays(-40),
+        SyncResults::SYNC_RESULT_SUCCESS, SyncResults::NO_ERROR, 1), 1000));
+
+    // The old result is purged when recorded.
+    QVariantMap stats = history.statistics("p1", QDateTime(), QDateTime());
+    QCOMPARE(stats.value(Sync::STATS_COUNT).toLongLong(), qint64(1));
+    QCOMPARE(stats.value(Sync::STATS_TARGET_ITEMS).toMap().value("contacts").toLongLong(),
+             qint64(1));
+
+    QCOMPARE(history.purge(now), 1);
+    stats = history.statistics("p1", QDateTime(), QDateTime());
+    QCOMPARE(stats.value(Sync::STATS_COUNT).toLongLong(), qint64(0));
+    QVERIFY(stats.value(Sync::STATS_TARGET_ITEMS).toMap().isEmpty());
+}
+
+void SyncResultsHistoryTest::testTriggers()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    SyncResultsHistory history;
+    QVERIFY(history.init(iDbFile));
+
+    QVERIFY(history.record("p1", makeResults(now.addSecs(-2),
+        SyncResults::SYNC_RESULT_SUCCESS, SyncResults::NO_ERROR, 1), 1000,
+        QStringList() << "syncOnChange" << "schedule"));
+    QVERIFY(history.record("p1", makeResults(now.addSecs(-1),
+        SyncResults::SYNC_RESULT_SUCCESS, SyncResults::NO_ERROR, 1), 1000,
+        QStringList() << "schedule"));
+    QVERIFY(history.record("p1", makeResults(now,
+        SyncResults::SYNC_RESULT_SUCCESS, SyncResults::NO_ERROR, 1), 1000));
+
+    QVariantMap triggers = history.statistics("p1", QDateTime(), QDateTime())
+        .value(Sync::STATS_TRIGGERS).toMap();
+    QCOMPARE(triggers.size(), 2);
+    QCOMPARE(triggers.value("schedule").toLongLong(), qint64(2));
+    QCOMPARE(triggers.value("syncOnChange").toLongLong(), qint64(1));
+
+    // Triggers of purged results are removed with them.
+    QCOMPARE(history.purge(now.addSecs(-1)), 1);
+    triggers = history.statistics("p1", QDateTime(), QDateTime())
+        .value(Sync::STATS_TRIGGERS).toMap();
+    QCOMPARE(triggers.size(), 1);
+    QCOMPARE(triggers.value("schedule").toLongLong(), qint64(1));
+}
+
+QTEST_MAIN(Buteo::SyncResultsHistoryTest)
@@ -30,6 +30,8 @@ using namespace Buteo;
 void SyncSchedulerTest::init()
 {
     iSyncScheduler = new SyncScheduler();
+    // Alarms left by earlier tests are stored.
+    iSyncScheduler->removeUnclaimedAlarms();
     iSyncProfileName.clear();
 }
 
@@ -80,4 +82,102 @@ void SyncSchedulerTest::testSetNextAlarm()
     iSyncScheduler->removeAlarmEvent(alarmId);
 }
 
+static QDateTime at(qint64 aBase, qint64 aSecs)
+{
+    return QDateTime::fromMSecsSinceEpoch((aBase + aSecs) * 1000);
+}
+
+void SyncSchedulerTest::testWakeAlignment()
+{
+    const qint64 WINDOW = 300;
+    SyncProfile profile("foo");
+    SyncSchedule schedule;
+    schedule.setInterval(15);
+    profile.setSyncSchedule(schedule);
+    QCOMPARE(SyncScheduler::wakeTolerance(&profile), qint64(15 * 60 / SyncScheduler::WAKE_TOLERANCE_DIVISOR));
+
+    // Start of a window well in the future.
+    const qint64 base = (QDateTime::currentMSecsSinceEpoch() / 1000 / WINDOW + 100) * WINDOW;
+
+    // Alignment is off by default.
+    QCOMPARE(iSyncScheduler->wakeAlignment(), 0);
+    QCOMPARE(iSyncScheduler->alignedSyncTime(&profile, at(base, 60)), at(base, 60));
+
+    iSyncScheduler->setWakeAlignment(WINDOW);
+    QCOMPARE(iSyncScheduler->alignedSyncTime(&profile, at(base, 60)), at(base, 0));
+    QCOMPARE(iSyncScheduler->alignedSyncTime(&profile, at(base, 200)), at(base, WINDOW));
+
+    // A wake-up planned for another profile is preferred.
+    iSyncScheduler->iWakeTimes.insert("bar", at(base, 100));
+    QCOMPARE(iSyncScheduler->alignedSyncTime(&profile, at(base, 200)), at(base, 100));
+    // Wake-ups out of the tolerance of the profile are not joined.
+    QCOMPARE(iSyncScheduler->alignedSyncTime(&profile, at(base, 400)), at(base, WINDOW));
+
+    // Syncs at a fixed time are not moved.
+    SyncProfile fixed("baz");
+    QCOMPARE(SyncScheduler::wakeTolerance(&fixed), qint64(0));
+    QCOMPARE(iSyncScheduler->alignedSyncTime(&fixed, at(base, 60)), at(base, 60));
+}
+
+void SyncSchedulerTest::testSharedAlarm()
+{
+    SyncProfileStub p1("foo");
+    SyncProfileStub p2("bar");
+    const QDateTime syncTime = QDateTime::currentDateTime().addSecs(3600);
+
+    int alarm1 = iSyncScheduler->setNextAlarm(&p1, syncTime);
+    QVERIFY(alarm1 > 0);
+    iSyncScheduler->iSyncScheduleProfiles.insert(p1.name(), alarm1);
+
+    // A profile woken up at the same time gets the same alarm.
+    int alarm2 = iSyncScheduler->setNextAlarm(&p2, syncTime);
+    QCOMPARE(alarm2, alarm1);
+    iSyncScheduler->iSyncScheduleProfiles.insert(p2.name(), alarm2);
+
+    // Removing one profile keeps the alarm of the other.
+    iSyncScheduler->removeProfile(p1.name());
+    QVERIFY(iSyncScheduler->iSyncScheduleProfiles.contains(p2.name()));
+
+    // All profiles sharing the alarm are handled when it triggers.
+    iSyncScheduler->iSyncScheduleProfiles.insert(p1.name(), alarm1);
+    iSyncScheduler->doAlarmActions(alarm1);
+    QVERIFY(iSyncScheduler->iSyncScheduleProfiles.isEmpty());
+    QVERIFY(iSyncScheduler->iWakeTimes.isEmpty());
+}
+
+void SyncSchedulerTest::testStoredAlarms()
+{
+    SyncProfileStub p1("foo");
+    SyncProfileStub p2("bar");
+    p1.setEnabled(true);
+    p2.setEnabled(true);
+    const QDateTime syncTime = QDateTime::currentDateTime().addSecs(3600);
+
+    iSyncScheduler->addProfileForSyncRetry(&p1, syncTime);
+    iSyncScheduler->addProfileForSyncRetry(&p2, syncTime.addSecs(60));
+    const int alarm1 = iSyncScheduler->iSyncScheduleProfiles.value(p1.name());
+    const int alarm2 = iSyncScheduler->iSyncScheduleProfiles.value(p2.name());
+    QVERIFY(alarm1 > 0);
+    QVERIFY(alarm2 > 0);
+
+    // The alarms outlive the scheduler.
+    delete iSyncScheduler;
+    iSyncScheduler = new SyncScheduler();
+    QVERIFY(iSyncScheduler->iSyncScheduleProfiles.isEmpty());
+    QVERIFY(iSyncScheduler->iAlarmInventory->alarmTime(alarm1).isValid());
+    QVERIFY(iSyncScheduler->iAlarmInventory->alarmTime(alarm2).isValid());
+
+    // A profile scheduled at the same time takes its alarm over.
+    iSyncScheduler->addProfileForSyncRetry(&p1, syncTime);
+    QCOMPARE(iSyncScheduler->iSyncScheduleProfiles.value(p1.name()), alarm1);
+
+    // Alarms not taken over are removed.
+    iSyncScheduler->removeUnclaimedAlarms();
+    QVERIFY(!iSyncScheduler->iAlarmInventory->alarmTime(alarm2).isValid());
+    QVERIFY(iSyncScheduler->iAlarmInventory->alarmTime(alarm1).isValid());
+
+    iSyncScheduler->removeProfile(p1.name());
+    QVERIFY(!iSyncScheduler->iAlarmInventory->alarmTime(alarm1).isValid());
+}
+
 QTEST_MAIN(Buteo::SyncSchedulerTest)
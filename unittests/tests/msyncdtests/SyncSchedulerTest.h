@@ -43,6 +43,9 @@ class SyncSchedulerTest: public QObject
         
         void testAddRemoveProfile();
         void testSetNextAlarm();
+        void testWakeAlignment();
+        void testSharedAlarm();
+        void testStoredAlarms();
         
     private:
         
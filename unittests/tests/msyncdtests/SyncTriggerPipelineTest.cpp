@@ -0,0 +1,176 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "SyncTriggerPipelineTest.h"
+#include "SyncTriggerPipeline.h"
+
+using namespace Buteo;
+
+void SyncTriggerPipelineTest::testDebounce()
+{
+    SyncTriggerPipeline pipeline;
+    pipeline.setDebounce(SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED, 30000);
+    QCOMPARE(pipeline.debounce(SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED), 30000);
+    QCOMPARE(pipeline.debounce(SyncTriggerPipeline::SOURCE_SCHEDULE), 0);
+    QSignalSpy spy(&pipeline, SIGNAL(triggered(QString,int)));
+
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED, 0);
+    QCOMPARE(pipeline.isPending("p1"), true);
+    pipeline.process(29999);
+    QCOMPARE(spy.count(), 0);
+
+    // A repeated event restarts the window.
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED, 20000);
+    pipeline.process(30000);
+    QCOMPARE(spy.count(), 0);
+    pipeline.process(50000);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toString(), QString("p1"));
+    QCOMPARE(spy.at(0).at(1).toInt(),
+             SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED));
+    QCOMPARE(pipeline.isPending("p1"), false);
+
+    // Without a window the event is passed on from the event loop.
+    pipeline.trigger("p2", SyncTriggerPipeline::SOURCE_SCHEDULE);
+    QCOMPARE(spy.count(), 1);
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(1).at(0).toString(), QString("p2"));
+}
+
+void SyncTriggerPipelineTest::testMerge()
+{
+    SyncTriggerPipeline pipeline;
+    pipeline.setDebounce(SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED, 30000);
+    pipeline.setDebounce(SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE, 2000);
+    pipeline.setDebounce(SyncTriggerPipeline::SOURCE_SCHEDULE, 1000);
+    QSignalSpy spy(&pipeline, SIGNAL(triggered(QString,int)));
+
+    // Events of all sources for one profile result in one sync when the
+    // first window passes.
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED, 0);
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_SCHEDULE, 500);
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE, 1000);
+    pipeline.trigger("p2", SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE, 0);
+    pipeline.process(1499);
+    QCOMPARE(spy.count(), 0);
+    pipeline.process(2500);
+    QCOMPARE(spy.count(), 2);
+
+    // Profiles are passed on in the order their windows passed.
+    QCOMPARE(spy.at(0).at(0).toString(), QString("p1"));
+    QCOMPARE(spy.at(1).at(0).toString(), QString("p2"));
+    const int sources = spy.at(0).at(1).toInt();
+    QCOMPARE(sources, SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED) |
+                      SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_SCHEDULE) |
+                      SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE));
+    QCOMPARE(SyncTriggerPipeline::strongest(sources), SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE);
+    QCOMPARE(SyncTriggerPipeline::sessionTrigger(SyncTriggerPipeline::strongest(sources)),
+             SyncSession::TRIGGER_SYNC_ON_CHANGE);
+    QCOMPARE(pipeline.isPending("p1"), false);
+    QCOMPARE(pipeline.isPending("p2"), false);
+}
+
+void SyncTriggerPipelineTest::testTakeAndCancel()
+{
+    SyncTriggerPipeline pipeline;
+    pipeline.setDebounce(SyncTriggerPipeline::SOURCE_PROFILE_ADDED, 30000);
+    pipeline.setDebounce(SyncTriggerPipeline::SOURCE_RETRY, 30000);
+    QSignalSpy spy(&pipeline, SIGNAL(triggered(QString,int)));
+
+    QCOMPARE(pipeline.take("p1"), 0);
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_PROFILE_ADDED, 0);
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_RETRY, 0);
+    pipeline.trigger("p2", SyncTriggerPipeline::SOURCE_RETRY, 0);
+    QCOMPARE(pipeline.take("p1"),
+             SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_PROFILE_ADDED) |
+             SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_RETRY));
+    QCOMPARE(pipeline.isPending("p1"), false);
+
+    pipeline.cancel("p2");
+    QCOMPARE(pipeline.isPending("p2"), false);
+    pipeline.process(60000);
+    QCOMPARE(spy.count(), 0);
+}
+
+void SyncTriggerPipelineTest::testCoalesce()
+{
+    SyncTriggerPipeline pipeline;
+    QCOMPARE(pipeline.coalesceWindow(), 0);
+    pipeline.setCoalesceWindow(5000);
+    QCOMPARE(pipeline.coalesceWindow(), 5000);
+    pipeline.setDebounce(SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE, 1000);
+    pipeline.setDebounce(SyncTriggerPipeline::SOURCE_SCHEDULE, 1000);
+    QSignalSpy spy(&pipeline, SIGNAL(triggered(QString,int)));
+
+    // Passing on a sync opens the window of the profile.
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE, 0);
+    pipeline.process(1000);
+    QCOMPARE(spy.count(), 1);
+
+    // Timed events of the profile within the window are absorbed, other
+    // sources and other profiles are not.
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_SCHEDULE, 2000);
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_RETRY, 2000);
+    QCOMPARE(pipeline.isPending("p1"), false);
+    pipeline.trigger("p2", SyncTriggerPipeline::SOURCE_SCHEDULE, 2000);
+    QCOMPARE(pipeline.isPending("p2"), true);
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_SYNC_ON_CHANGE, 2000);
+    QCOMPARE(pipeline.isPending("p1"), true);
+    pipeline.process(3000);
+    QCOMPARE(spy.count(), 3);
+
+    // A finished sync opens the window again.
+    pipeline.startCoalescing("p1", 60000);
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_SCHEDULE, 64999);
+    QCOMPARE(pipeline.isPending("p1"), false);
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_SCHEDULE, 65000);
+    QCOMPARE(pipeline.isPending("p1"), true);
+
+    // Cancelling closes the window.
+    pipeline.cancel("p1");
+    pipeline.startCoalescing("p1", 70000);
+    pipeline.cancel("p1");
+    pipeline.trigger("p1", SyncTriggerPipeline::SOURCE_SCHEDULE, 70000);
+    QCOMPARE(pipeline.isPending("p1"), true);
+}
+
+void SyncTriggerPipelineTest::testReasons()
+{
+    const int sources = SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_RETRY) |
+                        SyncTriggerPipeline::source(SyncTriggerPipeline::SOURCE_MANUAL);
+    const QStringList reasons = SyncTriggerPipeline::reasons(sources);
+    QCOMPARE(reasons, QStringList() << "manual" << "retry");
+    QCOMPARE(SyncTriggerPipeline::sources(reasons), sources);
+    QCOMPARE(SyncTriggerPipeline::sources(QStringList() << "unknown"), 0);
+
+    QCOMPARE(SyncTriggerPipeline::strongest(0), SyncTriggerPipeline::SOURCE_MANUAL);
+    QCOMPARE(SyncTriggerPipeline::strongest(sources), SyncTriggerPipeline::SOURCE_MANUAL);
+    QCOMPARE(SyncTriggerPipeline::sessionTrigger(SyncTriggerPipeline::SOURCE_PROFILE_ADDED),
+             SyncSession::TRIGGER_MANUAL);
+    QCOMPARE(SyncTriggerPipeline::sessionTrigger(SyncTriggerPipeline::SOURCE_PROFILE_MODIFIED),
+             SyncSession::TRIGGER_SCHEDULE);
+    QCOMPARE(SyncTriggerPipeline::sessionTrigger(SyncTriggerPipeline::SOURCE_RETRY),
+             SyncSession::TRIGGER_RETRY);
+}
+
+QTEST_MAIN(Buteo::SyncTriggerPipelineTest)
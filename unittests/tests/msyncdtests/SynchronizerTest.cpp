@@ -24,6 +24,7 @@
 #include "TransportTracker.h"
 #include "ServerActivator.h"
 #include "ServerPluginRunner.h"
+#include "ProfileEngineDefs.h"
 
 
 using namespace Buteo;
@@ -251,4 +252,27 @@ void SynchronizerTest::testSignals()
 	iSync->onSessionFinished("Profile", Sync::SYNC_DONE, "Msg", 0);
 	QCOMPARE(sessionStatus.count(), 1);
 }
+
+void SynchronizerTest::testClientProfileActive()
+{
+	Profile client("caldav", Profile::TYPE_CLIENT);
+	SyncProfile *running = new SyncProfile("running");
+	running->merge(client);
+	SyncSession session(running, NULL);
+	SyncProfile queued("queued");
+	queued.merge(client);
+
+	QCOMPARE(iSync->clientProfileActive(&queued), false);
+	iSync->iActiveSessions.insert(running->name(), &session);
+	QCOMPARE(iSync->clientProfileActive(&queued), true);
+
+	// The client profile allows two parallel sessions.
+	client.setKey(KEY_MAX_PARALLEL_SESSIONS, "2");
+	SyncProfile parallel("parallel");
+	parallel.merge(client);
+	QCOMPARE(iSync->clientProfileActive(&parallel), false);
+	QCOMPARE(iSync->clientProfileActive(&parallel, 1), true);
+
+	iSync->iActiveSessions.remove(running->name());
+}
 QTEST_MAIN(Buteo::SynchronizerTest)
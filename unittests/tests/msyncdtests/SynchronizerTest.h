@@ -42,6 +42,7 @@ class SynchronizerTest: public QObject
 	void testInitialize();
 	void testSync();
 	void testSignals();
+	void testClientProfileActive();
 	
 	private:
 	Synchronizer *iSync;
@@ -3,15 +3,21 @@ SUBDIRS = \
         AccountsHelperTest.pro \
         ClientPluginRunnerTest.pro \
         ClientThreadTest.pro \
+        IndexedHeapTest.pro \
         PluginRunnerTest.pro \
+        ProfileChangeBatcherTest.pro \
         ServerActivatorTest.pro \
         ServerPluginRunnerTest.pro \
         ServerThreadTest.pro \
         StorageBookerTest.pro \
+        SyncAlarmInventoryTest.pro \
         SyncBackupTest.pro \
+        SyncGovernorTest.pro \
         SyncQueueTest.pro \
+        SyncResultsHistoryTest.pro \
         SyncSessionTest.pro \
         SyncSigHandlerTest.pro \
+        SyncTriggerPipelineTest.pro \
         SynchronizerTest.pro \
         TransportTrackerTest.pro \
 
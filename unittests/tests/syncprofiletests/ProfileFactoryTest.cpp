@@ -23,6 +23,9 @@
 #include "ProfileFactoryTest.h"
 
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QDir>
+#include <QFile>
 #include <QScopedPointer>
 
 #include "ProfileFactory.h"
@@ -103,4 +106,56 @@ void ProfileFactoryTest::testCreateFromXml()
 
 }
 
+void ProfileFactoryTest::testCreateFromStream()
+{
+    const QString PROFILE_DIR = "syncprofiletests/testprofiles/user";
+    ProfileFactory pf;
+
+    // Stream and DOM parsing give the same profiles.
+    QStringList files;
+    foreach (const QString &type, QStringList() << Profile::TYPE_SYNC
+             << Profile::TYPE_CLIENT << Profile::TYPE_STORAGE)
+    {
+        QDir dir(PROFILE_DIR + QDir::separator() + type);
+        foreach (const QString &name, dir.entryList(QStringList() << "*.xml"))
+        {
+            files.append(dir.filePath(name));
+        }
+    }
+    QVERIFY(!files.isEmpty());
+
+    foreach (const QString &path, files)
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        const QByteArray xml = file.readAll();
+        file.close();
+
+        QDomDocument doc;
+        QVERIFY(doc.setContent(xml));
+        QScopedPointer<Profile> domProfile(pf.createProfile(doc.documentElement()));
+
+        QXmlStreamReader reader(xml);
+        QVERIFY(reader.readNextStartElement());
+        QScopedPointer<Profile> streamProfile(pf.createProfile(reader));
+        QVERIFY(!reader.hasError());
+
+        QVERIFY(domProfile != 0);
+        QVERIFY(streamProfile != 0);
+        QCOMPARE(streamProfile->type(), domProfile->type());
+        QCOMPARE(streamProfile->toString(), domProfile->toString());
+        if (domProfile->type() == Profile::TYPE_SYNC)
+        {
+            QVERIFY(dynamic_cast<SyncProfile*>(streamProfile.data()) != 0);
+        } // no else
+
+        // The written XML parses back to the same profile.
+        QDomDocument written;
+        QVERIFY(written.setContent(domProfile->toString()));
+        QScopedPointer<Profile> reparsed(pf.createProfile(written.documentElement()));
+        QVERIFY(reparsed != 0);
+        QCOMPARE(reparsed->toString(), domProfile->toString());
+    }
+}
+
 QTEST_MAIN(Buteo::ProfileFactoryTest)
@@ -36,6 +36,8 @@ private slots:
     void testCreateDirect();
 
     void testCreateFromXml();
+
+    void testCreateFromStream();
 };
 }
 
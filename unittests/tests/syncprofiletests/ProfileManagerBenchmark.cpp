@@ -0,0 +1,297 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileManagerBenchmark.h"
+#include "ProfileTreeGenerator.h"
+#include "ProfileManager.h"
+#include "ProfileEngineDefs.h"
+#include "SyncProfile.h"
+#include "SyncResults.h"
+#include <QScopedPointer>
+#include <QDir>
+
+using namespace Buteo;
+
+static const char SIZES_VARIABLE[] = "BUTEO_BENCHMARK_SIZES";
+
+void ProfileManagerBenchmark::initTestCase()
+{
+    const QString sizes = QString::fromLocal8Bit(qgetenv(SIZES_VARIABLE));
+    foreach (const QString &size, sizes.split(',', QString::SkipEmptyParts))
+    {
+        bool ok = false;
+        const int count = size.trimmed().toInt(&ok);
+        if (ok && count > 0)
+        {
+            iSizes.append(count);
+        } // no else
+    }
+    if (iSizes.isEmpty())
+    {
+        iSizes << 100 << 1000 << 10000 << 50000;
+    } // no else
+
+    iRoot = QDir::tempPath() + QDir::separator() + "buteo-profile-benchmark";
+    QDir(iRoot).removeRecursively();
+}
+
+void ProfileManagerBenchmark::cleanupTestCase()
+{
+    QDir(iRoot).removeRecursively();
+}
+
+void ProfileManagerBenchmark::addSizes()
+{
+    QTest::addColumn<int>("profiles");
+    foreach (int size, iSizes)
+    {
+        QTest::newRow(QByteArray::number(size).constData()) << size;
+    }
+}
+
+QString ProfileManagerBenchmark::tree(int aProfiles)
+{
+    if (!iTrees.contains(aProfiles))
+    {
+        const QString path = iRoot + QDir::separator() + QString::number(aProfiles);
+        ProfileTreeGenerator generator(path);
+        if (!generator.generate(aProfiles))
+        {
+            return QString();
+        } // no else
+        iTrees.insert(aProfiles, path);
+    } // no else
+
+    return iTrees.value(aProfiles);
+}
+
+void ProfileManagerBenchmark::benchmarkSyncProfile_data()
+{
+    addSizes();
+}
+
+void ProfileManagerBenchmark::benchmarkSyncProfile()
+{
+    QFETCH(int, profiles);
+    const QString path = tree(profiles);
+    QVERIFY(!path.isEmpty());
+    ProfileManager pm(path, path);
+
+    int i = 0;
+    QBENCHMARK {
+        QScopedPointer<SyncProfile> p(pm.syncProfile(
+                ProfileTreeGenerator::syncProfileName(i++ % profiles)));
+        QVERIFY(p != 0);
+    }
+}
+
+void ProfileManagerBenchmark::benchmarkAllSyncProfiles_data()
+{
+    addSizes();
+}
+
+void ProfileManagerBenchmark::benchmarkAllSyncProfiles()
+{
+    QFETCH(int, profiles);
+    const QString path = tree(profiles);
+    QVERIFY(!path.isEmpty());
+    ProfileManager pm(path, path);
+
+    QBENCHMARK {
+        QList<SyncProfile*> all = pm.allSyncProfiles();
+        QCOMPARE(all.size(), profiles);
+        qDeleteAll(all);
+    }
+}
+
+void ProfileManagerBenchmark::benchmarkAllSyncProfilesCold_data()
+{
+    addSizes();
+}
+
+void ProfileManagerBenchmark::benchmarkAllSyncProfilesCold()
+{
+    QFETCH(int, profiles);
+    const QString path = tree(profiles);
+    QVERIFY(!path.isEmpty());
+
+    // The profile cache lives as long as a manager of the paths exists.
+    QBENCHMARK {
+        ProfileManager pm(path, path);
+        QList<SyncProfile*> all = pm.allSyncProfiles();
+        QCOMPARE(all.size(), profiles);
+        qDeleteAll(all);
+    }
+}
+
+void ProfileManagerBenchmark::benchmarkGetByStorage_data()
+{
+    addSizes();
+}
+
+void ProfileManagerBenchmark::benchmarkGetByStorage()
+{
+    QFETCH(int, profiles);
+    const QString path = tree(profiles);
+    QVERIFY(!path.isEmpty());
+    ProfileManager pm(path, path);
+
+    QBENCHMARK {
+        QList<SyncProfile*> found = pm.getSyncProfilesByStorage(
+                ProfileTreeGenerator::storageProfileName(0), true);
+        QVERIFY(!found.isEmpty());
+        qDeleteAll(found);
+    }
+}
+
+void ProfileManagerBenchmark::benchmarkGetByAccount_data()
+{
+    addSizes();
+}
+
+void ProfileManagerBenchmark::benchmarkGetByAccount()
+{
+    QFETCH(int, profiles);
+    const QString path = tree(profiles);
+    QVERIFY(!path.isEmpty());
+    ProfileManager pm(path, path);
+
+    QList<ProfileManager::SearchCriteria> criteriaList;
+    ProfileManager::SearchCriteria enabled;
+    enabled.iType = ProfileManager::SearchCriteria::NOT_EQUAL;
+    enabled.iKey = KEY_ENABLED;
+    enabled.iValue = BOOLEAN_FALSE;
+    criteriaList.append(enabled);
+
+    ProfileManager::SearchCriteria account;
+    account.iType = ProfileManager::SearchCriteria::EQUAL;
+    account.iKey = KEY_ACCOUNT_ID;
+    criteriaList.append(account);
+
+    int i = 0;
+    QBENCHMARK {
+        // Disabled profiles are not found.
+        int index = (i++ * 4) % profiles;
+        criteriaList[1].iValue = QString::number(index);
+        QList<SyncProfile*> found = pm.getSyncProfilesByData(criteriaList);
+        QCOMPARE(found.size(), 1);
+        qDeleteAll(found);
+    }
+}
+
+void ProfileManagerBenchmark::benchmarkUpdateProfile_data()
+{
+    addSizes();
+}
+
+void ProfileManagerBenchmark::benchmarkUpdateProfile()
+{
+    QFETCH(int, profiles);
+    const QString path = tree(profiles);
+    QVERIFY(!path.isEmpty());
+    ProfileManager pm(path, path);
+
+    QScopedPointer<SyncProfile> p(pm.syncProfile(
+            ProfileTreeGenerator::syncProfileName(profiles / 2)));
+    QVERIFY(p != 0);
+
+    int i = 0;
+    QBENCHMARK {
+        p->setKey(KEY_DISPLAY_NAME, "Updated " + QString::number(i++));
+        QVERIFY(!pm.updateProfile(*p).isEmpty());
+    }
+    QVERIFY(pm.flush());
+}
+
+void ProfileManagerBenchmark::benchmarkSaveSyncResults_data()
+{
+    addSizes();
+}
+
+void ProfileManagerBenchmark::benchmarkSaveSyncResults()
+{
+    QFETCH(int, profiles);
+    const QString path = tree(profiles);
+    QVERIFY(!path.isEmpty());
+    ProfileManager pm(path, path);
+
+    const QString name = ProfileTreeGenerator::syncProfileName(profiles / 2);
+    QBENCHMARK {
+        SyncResults results(QDateTime::currentDateTime(),
+                            SyncResults::SYNC_RESULT_SUCCESS,
+                            SyncResults::NO_ERROR);
+        QVERIFY(pm.saveSyncResults(name, results));
+    }
+    QVERIFY(pm.flush());
+}
+
+void ProfileManagerBenchmark::benchmarkRename_data()
+{
+    addSizes();
+}
+
+void ProfileManagerBenchmark::benchmarkRename()
+{
+    QFETCH(int, profiles);
+    const QString path = tree(profiles);
+    QVERIFY(!path.isEmpty());
+    ProfileManager pm(path, path);
+
+    QString name = ProfileTreeGenerator::syncProfileName(profiles / 3);
+    QString newName = name + "-renamed";
+    QBENCHMARK {
+        QVERIFY(pm.rename(name, newName));
+        qSwap(name, newName);
+    }
+
+    // Leave the tree as it was generated.
+    if (name != ProfileTreeGenerator::syncProfileName(profiles / 3))
+    {
+        QVERIFY(pm.rename(name, newName));
+    } // no else
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Machine-readable output unless the caller picked a format.
+    QStringList args = app.arguments();
+    bool formatGiven = false;
+    foreach (const QString &arg, args)
+    {
+        if (arg == "-o" || arg == "-xml" || arg == "-xunitxml" ||
+            arg == "-lightxml" || arg == "-csv" || arg == "-txt" ||
+            arg == "-teamcity" || arg == "-tap")
+        {
+            formatGiven = true;
+        } // no else
+    }
+    if (!formatGiven)
+    {
+        args.insert(1, "-csv");
+    } // no else
+
+    ProfileManagerBenchmark benchmark;
+    return QTest::qExec(&benchmark, args);
+}
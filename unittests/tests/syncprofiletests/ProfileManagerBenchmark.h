@@ -0,0 +1,89 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILEMANAGERBENCHMARK_H
+#define PROFILEMANAGERBENCHMARK_H
+
+#include <QtTest/QtTest>
+#include <QHash>
+#include <QList>
+
+namespace Buteo {
+
+/*! \brief Benchmarks of ProfileManager on large generated profile trees.
+ *
+ * Every benchmark runs at 100, 1k, 10k and 50k sync profiles. The sizes
+ * can be limited with a comma separated list in BUTEO_BENCHMARK_SIZES.
+ * Results are written as CSV unless another output format is given on
+ * the command line, so that runs can be compared by scripts.
+ */
+class ProfileManagerBenchmark: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void cleanupTestCase();
+
+    void benchmarkSyncProfile_data();
+    void benchmarkSyncProfile();
+
+    void benchmarkAllSyncProfiles_data();
+    void benchmarkAllSyncProfiles();
+
+    void benchmarkAllSyncProfilesCold_data();
+    void benchmarkAllSyncProfilesCold();
+
+    void benchmarkGetByStorage_data();
+    void benchmarkGetByStorage();
+
+    void benchmarkGetByAccount_data();
+    void benchmarkGetByAccount();
+
+    void benchmarkUpdateProfile_data();
+    void benchmarkUpdateProfile();
+
+    void benchmarkSaveSyncResults_data();
+    void benchmarkSaveSyncResults();
+
+    void benchmarkRename_data();
+    void benchmarkRename();
+
+private:
+
+    void addSizes();
+
+    QString tree(int aProfiles);
+
+    QList<int> iSizes;
+
+    // Profile count -> path of the generated tree.
+    QHash<int, QString> iTrees;
+
+    QString iRoot;
+};
+
+}
+
+#endif // PROFILEMANAGERBENCHMARK_H
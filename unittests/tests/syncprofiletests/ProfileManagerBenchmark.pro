@@ -0,0 +1,4 @@
+include(../testapplication.pri)
+
+HEADERS += ProfileTreeGenerator.h
+SOURCES += ProfileTreeGenerator.cpp
@@ -22,13 +22,22 @@
  */
 #include "ProfileManagerTest.h"
 #include "ProfileManager.h"
+#include "ProfileSnapshot.h"
+#include "ProfileQuery.h"
+#include "SqliteProfileStore.h"
 #include "Profile_p.h"
 #include "ProfileEngineDefs.h"
 #include "StorageProfile.h"
 #include "SyncResults.h"
+#include "SyncLog.h"
+#include "SyncLogJournal.h"
 
 #include <QScopedPointer>
 #include <QFile>
+#include <QDir>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QThread>
 
 using namespace Buteo;
 
@@ -39,6 +48,56 @@ static const QString SYNCML = "syncml";
 static const QString USERPROFILE_DIR = "syncprofiletests/testprofiles/user";
 static const QString SYSTEMPROFILE_DIR = "syncprofiletests/testprofiles/system";
 
+namespace {
+
+// Writes the pending profile updates of a manager in another thread.
+class FlushThread : public QThread
+{
+public:
+    explicit FlushThread(ProfileManager &aManager)
+    :   iManager(aManager),
+        iResult(false)
+    {
+    }
+
+    virtual void run()
+    {
+        iResult = iManager.flush();
+    }
+
+    ProfileManager &iManager;
+    bool iResult;
+};
+
+// Reads the document of a sync profile committed to a profile database.
+QString committedDocument(const QString &aDatabasePath, const QString &aName)
+{
+    const QString connectionName("committeddocument");
+    QString document;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(aDatabasePath);
+        if (db.open())
+        {
+            QSqlQuery query(db);
+            query.prepare("SELECT document FROM profiles "
+                          "WHERE type = :type AND name = :name");
+            query.bindValue(":type", Profile::TYPE_SYNC);
+            query.bindValue(":name", aName);
+            if (query.exec() && query.next())
+            {
+                document = query.value(0).toString();
+            } // no else
+        } // no else
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    return document;
+}
+
+}
+
 
 void ProfileManagerTest::initTestCase()
 {
@@ -123,6 +182,18 @@ void ProfileManagerTest::testGetSyncProfile()
     QVERIFY(!allProfiles.isEmpty());
     QCOMPARE(allProfiles.first()->name(), OVI_CALENDAR);
     QCOMPARE(allProfiles.first()->type(), Profile::TYPE_SYNC);
+
+    // Profiles loaded in parallel keep the order of the names and equal
+    // the profiles loaded one by one.
+    QStringList names = pm.profileNames(Profile::TYPE_SYNC);
+    QCOMPARE(allProfiles.size(), names.size());
+    for (int i = 0; i < names.size(); ++i)
+    {
+        QCOMPARE(allProfiles[i]->name(), names[i]);
+        QScopedPointer<SyncProfile> single(pm.syncProfile(names[i]));
+        QVERIFY(single != 0);
+        QCOMPARE(allProfiles[i]->toString(), single->toString());
+    }
     foreach (SyncProfile *p, allProfiles)
     {
         delete p;
@@ -497,6 +568,168 @@ void ProfileManagerTest::testGetByMultipleCriteria()
     profiles.clear();
 }
 
+void ProfileManagerTest::testQueryPlan()
+{
+    ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+
+    QList<ProfileManager::SearchCriteria> criteriaList;
+
+    ProfileManager::SearchCriteria notHidden;
+    notHidden.iType = ProfileManager::SearchCriteria::NOT_EQUAL;
+    notHidden.iKey = KEY_HIDDEN;
+    notHidden.iValue = BOOLEAN_TRUE;
+    criteriaList.append(notHidden);
+
+    ProfileManager::SearchCriteria hasStorage;
+    hasStorage.iType = ProfileManager::SearchCriteria::EXISTS;
+    hasStorage.iSubProfileName = "hcalendar";
+    hasStorage.iSubProfileType = Profile::TYPE_STORAGE;
+    criteriaList.append(hasStorage);
+
+    ProfileManager::SearchCriteria enabled;
+    enabled.iType = ProfileManager::SearchCriteria::EQUAL;
+    enabled.iKey = KEY_ENABLED;
+    enabled.iValue = BOOLEAN_TRUE;
+    criteriaList.append(enabled);
+
+    ProfileManager::SearchCriteria notebook;
+    notebook.iType = ProfileManager::SearchCriteria::EQUAL;
+    notebook.iSubProfileType = Profile::TYPE_STORAGE;
+    notebook.iKey = "Notebook Name";
+    notebook.iValue = "myNotebook";
+    criteriaList.append(notebook);
+
+    ProfileManager::SearchCriteria noBtAddress;
+    noBtAddress.iType = ProfileManager::SearchCriteria::NOT_EXISTS;
+    noBtAddress.iKey = KEY_BT_ADDRESS;
+    criteriaList.append(noBtAddress);
+
+    // Equality first, then existence checks, inequality last.
+    ProfileQuery query(criteriaList);
+    QList<ProfileManager::SearchCriteria> plan = query.plan();
+    QCOMPARE(plan.size(), criteriaList.size());
+    QCOMPARE(plan[0].iKey, enabled.iKey);
+    QCOMPARE(plan[1].iKey, notebook.iKey);
+    QCOMPARE(plan[2].iSubProfileName, hasStorage.iSubProfileName);
+    QCOMPARE(plan[3].iKey, noBtAddress.iKey);
+    QCOMPARE(plan[4].iKey, notHidden.iKey);
+
+    // Equality of an identifying key goes before any other check.
+    ProfileManager::SearchCriteria account;
+    account.iType = ProfileManager::SearchCriteria::EQUAL;
+    account.iKey = KEY_ACCOUNT_ID;
+    account.iValue = "1";
+    ProfileQuery accountQuery(QList<ProfileManager::SearchCriteria>()
+                              << enabled << account);
+    QCOMPARE(accountQuery.plan().first().iKey, account.iKey);
+
+    QScopedPointer<SyncProfile> profile(pm.syncProfile(OVI_CALENDAR));
+    QVERIFY(profile != 0);
+    QVERIFY(query.matches(*profile));
+    QVERIFY(!accountQuery.matches(*profile));
+    QVERIFY(ProfileQuery(QList<ProfileManager::SearchCriteria>()).matches(*profile));
+
+    // The order of the criteria does not change the result.
+    QList<ProfileManager::SearchCriteria> reversed;
+    foreach (const ProfileManager::SearchCriteria &criteria, criteriaList)
+    {
+        reversed.prepend(criteria);
+    }
+    QList<SyncProfile*> profiles = pm.getSyncProfilesByData(criteriaList);
+    QList<SyncProfile*> reversedProfiles = pm.getSyncProfilesByData(reversed);
+    QCOMPARE(profiles.size(), reversedProfiles.size());
+    QVERIFY(!profiles.isEmpty());
+    for (int i = 0; i < profiles.size(); ++i)
+    {
+        QCOMPARE(profiles[i]->name(), reversedProfiles[i]->name());
+    }
+    qDeleteAll(profiles);
+    qDeleteAll(reversedProfiles);
+
+    // A key no profile has is not found.
+    ProfileManager::SearchCriteria unknownKey;
+    unknownKey.iType = ProfileManager::SearchCriteria::EXISTS;
+    unknownKey.iKey = "no such key in any profile";
+    QVERIFY(!ProfileQuery(QList<ProfileManager::SearchCriteria>()
+                          << unknownKey).matches(*profile));
+}
+
+namespace {
+
+// Stops a query after the first row.
+class FirstRowHandler : public ProfileManager::RowHandler
+{
+public:
+    FirstRowHandler() : iCount(0) {}
+
+    virtual bool handleRow(const ProfileManager::ProfileRow &aRow)
+    {
+        iName = aRow.iName;
+        iCount++;
+        return false;
+    }
+
+    QString iName;
+    int iCount;
+};
+
+}
+
+void ProfileManagerTest::testQueryProfiles()
+{
+    ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+
+    // Without criteria every sync profile is returned.
+    QList<ProfileManager::SearchCriteria> criteriaList;
+    ProfileManager::Projection projection;
+    QList<ProfileManager::ProfileRow> rows =
+        pm.queryProfiles(criteriaList, projection);
+    QStringList names;
+    foreach (const ProfileManager::ProfileRow &row, rows)
+    {
+        names.append(row.iName);
+        QVERIFY(row.iKeys.isEmpty());
+        QVERIFY(row.iLastResults.isNull());
+    }
+    QCOMPARE(names, pm.profileNames(Profile::TYPE_SYNC));
+
+    // Only the requested parts of the matching profile are returned.
+    ProfileManager::SearchCriteria criteria;
+    criteria.iType = ProfileManager::SearchCriteria::EXISTS;
+    criteria.iSubProfileName = HCALENDAR;
+    criteria.iSubProfileType = Profile::TYPE_STORAGE;
+    criteriaList.append(criteria);
+    projection.iKeys << KEY_ENABLED << "unknown";
+    projection.iSubProfileType = Profile::TYPE_STORAGE;
+    projection.iSubProfileKeys << "Notebook Name";
+    projection.iSchedule = true;
+    rows = pm.queryProfiles(criteriaList, projection);
+    QCOMPARE(rows.size(), 1);
+    QCOMPARE(rows[0].iName, OVI_CALENDAR);
+    QCOMPARE(rows[0].iKeys.size(), 1);
+    QCOMPARE(rows[0].iKeys.value(KEY_ENABLED), BOOLEAN_TRUE);
+    QCOMPARE(rows[0].iSubProfileKeys.size(), 1);
+    QCOMPARE(rows[0].iSubProfileKeys.value(HCALENDAR).value("Notebook Name"),
+             QString("myNotebook"));
+    QVERIFY(rows[0].iLastResults.isNull());
+
+    // The rows agree with the full profile, cached or not.
+    QScopedPointer<SyncProfile> profile(pm.syncProfile(OVI_CALENDAR));
+    QVERIFY(profile != 0);
+    QCOMPARE(rows[0].iSyncType, profile->syncType());
+    QVERIFY(rows[0].iSchedule == profile->syncSchedule());
+    rows = pm.queryProfiles(criteriaList, projection);
+    QCOMPARE(rows.size(), 1);
+    QCOMPARE(rows[0].iKeys.value(KEY_ENABLED), profile->key(KEY_ENABLED));
+
+    // A handler can stop the query.
+    FirstRowHandler handler;
+    pm.queryProfiles(QList<ProfileManager::SearchCriteria>(),
+                     ProfileManager::Projection(), handler);
+    QCOMPARE(handler.iCount, 1);
+    QCOMPARE(handler.iName, pm.profileNames(Profile::TYPE_SYNC).first());
+}
+
 void ProfileManagerTest::testGetByStorage()
 {
     ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
@@ -636,8 +869,10 @@ void ProfileManagerTest::testRemovingProfiles()
     const QString TEMP_NAME = "TempProfile";
     QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
     QVERIFY(p != 0);
+    QVERIFY(!pm.profileNames(Profile::TYPE_SYNC).contains(TEMP_NAME));
     p->setName(TEMP_NAME);
     pm.updateProfile(*p);
+    QVERIFY(pm.profileNames(Profile::TYPE_SYNC).contains(TEMP_NAME));
 
     // Try removing protected profile.
     p->setBoolKey(KEY_PROTECTED, true);
@@ -648,6 +883,7 @@ void ProfileManagerTest::testRemovingProfiles()
     p->removeKey(KEY_PROTECTED);
     pm.updateProfile(*p);
     QCOMPARE(pm.removeProfile(TEMP_NAME), true);
+    QVERIFY(!pm.profileNames(Profile::TYPE_SYNC).contains(TEMP_NAME));
 }
 
 void ProfileManagerTest::testOverrideKey()
@@ -673,22 +909,615 @@ void ProfileManagerTest::testOverrideKey()
 
 void ProfileManagerTest::testBackup()
 {
-    ProfileManager pm(USERPROFILE_DIR + '/', SYSTEMPROFILE_DIR + '/'); 
-
-    // Copy to backup.
     QString fileName = USERPROFILE_DIR + '/' + Profile::TYPE_SYNC +
         '/' + OVI_CALENDAR + ".xml";
     QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray original = file.readAll();
+    file.close();
+
+    // Backup left behind by an interrupted save, which truncated the profile.
     QVERIFY(file.copy(fileName + ".bak"));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(original.left(original.size() / 2));
+    file.close();
 
-    // Get a sync profile. Profile is restored from a backup.
-    QScopedPointer<SyncProfile> sp(pm.syncProfile(OVI_CALENDAR));
-    QVERIFY(sp != 0);
-    QCOMPARE(sp->name(), OVI_CALENDAR);
-    QCOMPARE(sp->type(), Profile::TYPE_SYNC);
+    {
+        // Leftover backups are resolved when the profiles are first used.
+        ProfileManager pm(USERPROFILE_DIR + '/', SYSTEMPROFILE_DIR + '/');
+        QVERIFY(!QFile::exists(fileName + ".bak"));
+
+        // Profile is restored from the backup.
+        QScopedPointer<SyncProfile> sp(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(sp != 0);
+        QCOMPARE(sp->name(), OVI_CALENDAR);
+        QCOMPARE(sp->type(), Profile::TYPE_SYNC);
+    }
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), original);
+    file.close();
+
+    // An intact profile is kept and the stale backup removed.
+    QVERIFY(file.copy(fileName + ".bak"));
+    {
+        ProfileManager pm(USERPROFILE_DIR + '/', SYSTEMPROFILE_DIR + '/');
+        QVERIFY(!QFile::exists(fileName + ".bak"));
+
+        // Saving leaves neither a backup nor a temporary file behind.
+        QScopedPointer<SyncProfile> sp(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(sp != 0);
+        sp->setKey("atomicSaveTest", "saved");
+        QVERIFY(pm.updateProfile(*sp).size() > 0);
+        QVERIFY(pm.flush());
+        QVERIFY(!QFile::exists(fileName + ".bak"));
+        QVERIFY(!QFile::exists(fileName + ".tmp"));
+    }
+
+    // The change was written to the profile file.
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(file.readAll().contains("atomicSaveTest"));
+    file.close();
+
+    // Restore the original test data.
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(original);
+    file.close();
+}
+
+void ProfileManagerTest::testCache()
+{
+    ProfileManager pm(USERPROFILE_DIR + "/primary", USERPROFILE_DIR);
+    ProfileManager pm2(USERPROFILE_DIR + "/primary", USERPROFILE_DIR);
+
+    // Changes to a returned profile do not leak into the cache.
+    {
+        QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        QVERIFY(p->log() != 0);
+        p->setKey(KEY_DISPLAY_NAME, "changed");
+        QScopedPointer<SyncProfile> p2(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p2 != 0);
+        QVERIFY(p2->key(KEY_DISPLAY_NAME) != "changed");
+        QVERIFY(p2->log() != 0);
+    }
+
+    // Saving through one manager is seen by another using the same paths.
+    {
+        QScopedPointer<SyncProfile> p(pm2.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        QCOMPARE(p->isEnabled(), true);
+        p->setEnabled(false);
+        pm.updateProfile(*p);
+
+        QScopedPointer<SyncProfile> p2(pm2.syncProfile(OVI_CALENDAR));
+        QVERIFY(p2 != 0);
+        QCOMPARE(p2->isEnabled(), false);
+
+        p->setEnabled(true);
+        pm.updateProfile(*p);
+        p2.reset(pm2.syncProfile(OVI_CALENDAR));
+        QCOMPARE(p2->isEnabled(), true);
+    }
+}
+
+void ProfileManagerTest::testIndexUpdate()
+{
+    ProfileManager pm(USERPROFILE_DIR + "/primary", USERPROFILE_DIR);
+    const QString INDEX_KEY = "indexkey";
+
+    QList<ProfileManager::SearchCriteria> criteriaList;
+    ProfileManager::SearchCriteria criteria;
+    criteria.iType = ProfileManager::SearchCriteria::EQUAL;
+    criteria.iKey = INDEX_KEY;
+    criteria.iValue = "first";
+    criteriaList.append(criteria);
+
+    QList<SyncProfile*> profiles = pm.getSyncProfilesByData(criteriaList);
+    QVERIFY(profiles.isEmpty());
+
+    // Index follows profile updates.
+    QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+    QVERIFY(p != 0);
+    p->setKey(INDEX_KEY, "first");
+    pm.updateProfile(*p);
+
+    profiles = pm.getSyncProfilesByData(criteriaList);
+    QCOMPARE(profiles.size(), 1);
+    QCOMPARE(profiles[0]->name(), OVI_CALENDAR);
+    qDeleteAll(profiles);
+
+    profiles = pm.getSyncProfilesByData("", "", INDEX_KEY, "first");
+    QCOMPARE(profiles.size(), 1);
+    qDeleteAll(profiles);
+
+    p->setKey(INDEX_KEY, "second");
+    pm.updateProfile(*p);
+    profiles = pm.getSyncProfilesByData(criteriaList);
+    QVERIFY(profiles.isEmpty());
+
+    p->removeKey(INDEX_KEY);
+    pm.updateProfile(*p);
+    profiles = pm.getSyncProfilesByData("", "", INDEX_KEY);
+    QVERIFY(profiles.isEmpty());
+}
+
+void ProfileManagerTest::testSnapshot()
+{
+    ProfileSnapshot snapshot(USERPROFILE_DIR, USERPROFILE_DIR);
+    QFile::remove(snapshot.filePath());
+    QVERIFY(!snapshot.open());
+
+    QList<SyncProfile*> profiles;
+    {
+        // Loading all profiles writes a snapshot in the background. The
+        // write is finished when the last manager using the paths is gone.
+        ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+        profiles = pm.allSyncProfiles();
+        QVERIFY(!profiles.isEmpty());
+    }
+
+    QVERIFY(snapshot.open());
+    QCOMPARE(snapshot.profileNames().size(), profiles.size());
+    foreach (const SyncProfile *p, profiles)
+    {
+        QScopedPointer<SyncProfile> decoded(snapshot.syncProfile(p->name()));
+        QVERIFY(decoded != 0);
+        QVERIFY(decoded->isLoaded());
+        QCOMPARE(decoded->toString(), p->toString());
+        QCOMPARE(decoded->log() != 0, p->log() != 0);
+        if (p->log() != 0)
+        {
+            QCOMPARE(decoded->log()->allResults().size(),
+                     p->log()->allResults().size());
+        }
+    }
+    qDeleteAll(profiles);
+    snapshot.close();
+
+    // A changed profile is loaded from its files, while the rest of the
+    // snapshot stays in use. The next full load writes a new snapshot.
+    {
+        ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+        SyncResults results(QDateTime::currentDateTime(),
+                            SyncResults::SYNC_RESULT_SUCCESS, 42);
+        QVERIFY(pm.saveSyncResults(OVI_CALENDAR, results));
+
+        QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        QVERIFY(p->log() != 0);
+        QCOMPARE(p->log()->lastResults()->minorCode(), 42);
+
+        qDeleteAll(pm.allSyncProfiles());
+    }
+
+    QVERIFY(snapshot.open());
+    {
+        QScopedPointer<SyncProfile> decoded(snapshot.syncProfile(OVI_CALENDAR));
+        QVERIFY(decoded != 0);
+        QVERIFY(decoded->log() != 0);
+        QCOMPARE(decoded->log()->lastResults()->minorCode(), 42);
+    }
+    snapshot.close();
+
+    // Any change to the source files invalidates the snapshot.
+    {
+        ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+        SyncResults results(QDateTime::currentDateTime(),
+                            SyncResults::SYNC_RESULT_SUCCESS, SyncResults::NO_ERROR);
+        QVERIFY(pm.saveSyncResults(OVI_CALENDAR, results));
+    }
+    QVERIFY(!snapshot.open());
+
+    QFile::remove(snapshot.filePath());
+    QFile::remove(USERPROFILE_DIR + "/sync/logs/" + OVI_CALENDAR + ".log.xml");
+    QFile::remove(USERPROFILE_DIR + "/sync/logs/" + OVI_CALENDAR + ".log.journal");
+}
+
+void ProfileManagerTest::testResultsJournal()
+{
+    const QString logPath = USERPROFILE_DIR + "/sync/logs/" + OVI_CALENDAR + ".log.xml";
+    const QString journalPath = USERPROFILE_DIR + "/sync/logs/" + OVI_CALENDAR + ".log.journal";
+    QFile::remove(logPath);
+    QFile::remove(journalPath);
+
+    QDateTime syncTime = QDateTime::currentDateTime();
+    {
+        ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+        for (int i = 0; i < 7; i++)
+        {
+            SyncResults results(syncTime.addSecs(i),
+                                SyncResults::SYNC_RESULT_SUCCESS, i);
+            QVERIFY(pm.saveSyncResults(OVI_CALENDAR, results));
+        }
+
+        // Results are only journaled, the log file is not written.
+        QVERIFY(QFile::exists(journalPath));
+        QVERIFY(!QFile::exists(logPath));
+
+        // Unknown profiles have no log.
+        SyncResults results(syncTime, SyncResults::SYNC_RESULT_SUCCESS,
+                            SyncResults::NO_ERROR);
+        QVERIFY(!pm.saveSyncResults("no-such-profile", results));
+    }
+
+    // A new manager replays the journal, keeping the newest entries.
+    {
+        ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+        QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        QVERIFY(p->log() != 0);
+        QList<const SyncResults*> all = p->log()->allResults();
+        QCOMPARE(all.size(), 5);
+        QCOMPARE(all.first()->minorCode(), 2);
+        QCOMPARE(all.last()->minorCode(), 6);
+
+        // Saving the full log merges the journal into the log file.
+        QVERIFY(pm.saveLog(*p->log()));
+        QVERIFY(QFile::exists(logPath));
+        QVERIFY(!QFile::exists(journalPath));
+    }
+
+    {
+        ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+        QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        QCOMPARE(p->log()->allResults().size(), 5);
+        QCOMPARE(p->lastResults()->minorCode(), 6);
+    }
+
+    QFile::remove(logPath);
+    QFile::remove(journalPath);
+}
+
+void ProfileManagerTest::testJournalRecovery()
+{
+    const QString logDirectory = USERPROFILE_DIR + "/journal";
+    QDir(logDirectory).removeRecursively();
+    SyncLogJournal journal(logDirectory);
+    QFile file(journal.filePath(OVI_CALENDAR));
+
+    const QDateTime syncTime = QDateTime::currentDateTime();
+    qint64 firstSize = 0;
+    qint64 secondSize = 0;
+    QVERIFY(journal.append(OVI_CALENDAR,
+                           SyncResults(syncTime, SyncResults::SYNC_RESULT_SUCCESS, 1),
+                           firstSize));
+    QVERIFY(journal.append(OVI_CALENDAR,
+                           SyncResults(syncTime.addSecs(1), SyncResults::SYNC_RESULT_SUCCESS, 2),
+                           secondSize));
+    QVERIFY(secondSize > firstSize);
+
+    // A record cut short by an interrupted write is dropped before the next
+    // record is appended.
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Append));
+    QCOMPARE(file.write(QByteArray("\x42\x53\x4c", 3)), qint64(3));
+    file.close();
+    qint64 size = 0;
+    QVERIFY(journal.append(OVI_CALENDAR,
+                           SyncResults(syncTime.addSecs(2), SyncResults::SYNC_RESULT_SUCCESS, 3),
+                           size));
+    QCOMPARE(size, secondSize + (secondSize - firstSize));
+    {
+        SyncLog log(OVI_CALENDAR);
+        QCOMPARE(journal.replay(OVI_CALENDAR, log), 3);
+        QCOMPARE(log.allResults().last()->minorCode(), 3);
+    }
+
+    // A corrupted record does not match its checksum. Replay stops there,
+    // and the next append replaces it.
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.seek(firstSize + (secondSize - firstSize) / 2));
+    QCOMPARE(file.write(QByteArray("#")), qint64(1));
+    file.close();
+    {
+        SyncLog log(OVI_CALENDAR);
+        QCOMPARE(journal.replay(OVI_CALENDAR, log), 1);
+    }
+    QVERIFY(journal.append(OVI_CALENDAR,
+                           SyncResults(syncTime.addSecs(3), SyncResults::SYNC_RESULT_SUCCESS, 4),
+                           size));
+    {
+        SyncLog log(OVI_CALENDAR);
+        QCOMPARE(journal.replay(OVI_CALENDAR, log), 2);
+        QCOMPARE(log.allResults().first()->minorCode(), 1);
+        QCOMPARE(log.allResults().last()->minorCode(), 4);
+    }
+
+    QDir(logDirectory).removeRecursively();
+}
+
+void ProfileManagerTest::testWriteBehind()
+{
+    const QString KEY = "writebehindkey";
+    const QString fileName = USERPROFILE_DIR + '/' + Profile::TYPE_SYNC +
+        '/' + OVI_CALENDAR + ".xml";
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray original = file.readAll();
+    file.close();
+
+    {
+        ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+        ProfileManager pm2(USERPROFILE_DIR, USERPROFILE_DIR);
+        QSignalSpy spy(&pm, SIGNAL(signalProfileChanged(QString, int, QString)));
+
+        // Updating an unmodified profile writes nothing.
+        QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        QVERIFY(!p->isModified());
+        p->setKey(KEY, QString());
+        QVERIFY(!p->isModified());
+        QCOMPARE(pm.updateProfile(*p), OVI_CALENDAR);
+        QCOMPARE(spy.count(), 0);
+
+        // Changes are seen by all managers before they are on disk.
+        p->setKey(KEY, "first");
+        QVERIFY(p->isModified());
+        pm.updateProfile(*p);
+        p->setKey(KEY, "second");
+        pm.updateProfile(*p);
+        QCOMPARE(spy.count(), 2);
+
+        QScopedPointer<SyncProfile> p2(pm2.syncProfile(OVI_CALENDAR));
+        QVERIFY(p2 != 0);
+        QCOMPARE(p2->key(KEY), QString("second"));
+        QVERIFY(!p2->isModified());
+
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), original);
+        file.close();
+
+        // Only the last update is written.
+        QVERIFY(pm.flush());
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        const QByteArray written = file.readAll();
+        file.close();
+        QVERIFY(written.contains("second"));
+        QVERIFY(!written.contains("first"));
+        QVERIFY(!QFile::exists(fileName + ".tmp"));
+
+        // Sub-profile changes modify the main profile.
+        p2.reset(pm2.syncProfile(OVI_CALENDAR));
+        Profile *storage = p2->subProfile(HCALENDAR, Profile::TYPE_STORAGE);
+        QVERIFY(storage != 0);
+        QVERIFY(!p2->isModified());
+        storage->setKey(KEY, "third");
+        QVERIFY(p2->isModified());
+    }
+
+    // Restore the original test data.
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(original);
+    file.close();
+}
+
+void ProfileManagerTest::testParallelLoad()
+{
+    const QString KEY = "parallelkey";
+    const QString fileName = USERPROFILE_DIR + '/' + Profile::TYPE_SYNC +
+        '/' + OVI_CALENDAR + ".xml";
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray original = file.readAll();
+    file.close();
+
+    {
+        ProfileManager pm(USERPROFILE_DIR, USERPROFILE_DIR);
+        QVERIFY(pm.profileNames(Profile::TYPE_SYNC).size() > 1);
+
+        for (int round = 0; round < 20; ++round)
+        {
+            const QString value = QString::number(round);
+            QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+            QVERIFY(p != 0);
+            p->setKey(KEY, value);
+            pm.updateProfile(*p);
+
+            // Profiles are loaded on worker threads while the pending update
+            // is written.
+            FlushThread flusher(pm);
+            flusher.start();
+            QList<SyncProfile*> profiles = pm.allSyncProfiles();
+            QVERIFY(flusher.wait());
+            QVERIFY(flusher.iResult);
+
+            QString loadedValue;
+            foreach (const SyncProfile *loaded, profiles)
+            {
+                if (loaded->name() == OVI_CALENDAR)
+                {
+                    loadedValue = loaded->key(KEY);
+                } // no else
+            }
+            qDeleteAll(profiles);
+            QCOMPARE(loadedValue, value);
+
+            // Nothing outdated was cached while the file was replaced.
+            QCoreApplication::processEvents();
+            p.reset(pm.syncProfile(OVI_CALENDAR));
+            QVERIFY(p != 0);
+            QCOMPARE(p->key(KEY), value);
+        }
+    }
+
+    // Restore the original test data.
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(original);
+    file.close();
+}
+
+void ProfileManagerTest::testDatabaseStore()
+{
+    const QString primaryPath = USERPROFILE_DIR + "/database";
+    const QString databasePath = primaryPath + '/' + SqliteProfileStore::DATABASE_FILE;
+    QDir(primaryPath).removeRecursively();
+
+    // Import the profile files into a new database.
+    {
+        SqliteProfileStore store(databasePath, SYSTEMPROFILE_DIR);
+        QVERIFY(store.init());
+        QVERIFY(store.importXml(USERPROFILE_DIR) > 0);
+    }
+
+    ProfileManager xmlPm(USERPROFILE_DIR, SYSTEMPROFILE_DIR);
+    {
+        // The database is used once it exists.
+        ProfileManager pm(primaryPath, SYSTEMPROFILE_DIR);
+        QVERIFY(!QDir(primaryPath + '/' + Profile::TYPE_SYNC).exists());
+
+        foreach (const QString &type, QStringList() << Profile::TYPE_SYNC
+                 << Profile::TYPE_STORAGE << Profile::TYPE_CLIENT)
+        {
+            QStringList names = pm.profileNames(type);
+            QStringList xmlNames = xmlPm.profileNames(type);
+            names.sort();
+            xmlNames.sort();
+            QCOMPARE(names, xmlNames);
+        }
+
+        QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+        QScopedPointer<SyncProfile> xmlP(xmlPm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        QVERIFY(xmlP != 0);
+        QCOMPARE(p->toString(), xmlP->toString());
+
+        // Criteria on the keys of the sync profiles are resolved by the
+        // database, the results are the same.
+        ProfileManager::SearchCriteria enabled;
+        enabled.iKey = KEY_ENABLED;
+        enabled.iValue = BOOLEAN_TRUE;
+        ProfileManager::SearchCriteria storage;
+        storage.iSubProfileType = Profile::TYPE_STORAGE;
+        storage.iType = ProfileManager::SearchCriteria::EXISTS;
+        QList<ProfileManager::SearchCriteria> criteria;
+        criteria << enabled << storage;
+        QList<SyncProfile*> found = pm.getSyncProfilesByData(criteria);
+        QList<SyncProfile*> xmlFound = xmlPm.getSyncProfilesByData(criteria);
+        QVERIFY(!found.isEmpty());
+        QCOMPARE(found.size(), xmlFound.size());
+        for (int i = 0; i < found.size(); ++i)
+        {
+            QCOMPARE(found[i]->name(), xmlFound[i]->name());
+        }
+        qDeleteAll(found);
+        qDeleteAll(xmlFound);
+
+        // Updates and results are stored.
+        const QString KEY = "databasekey";
+        p->setKey(KEY, "value");
+        QVERIFY(!pm.updateProfile(*p).isEmpty());
+        QDateTime syncTime = QDateTime::currentDateTime();
+        for (int i = 0; i < 7; i++)
+        {
+            SyncResults results(syncTime.addSecs(i),
+                                SyncResults::SYNC_RESULT_SUCCESS, i);
+            QVERIFY(pm.saveSyncResults(OVI_CALENDAR, results));
+        }
+
+        SqliteProfileStore store(databasePath, SYSTEMPROFILE_DIR);
+        QVERIFY(store.init());
+        QScopedPointer<Profile> stored(store.load(OVI_CALENDAR, Profile::TYPE_SYNC));
+        QVERIFY(stored != 0);
+        QCOMPARE(stored->key(KEY), QString("value"));
+        QScopedPointer<SyncLog> log(store.loadLog(OVI_CALENDAR));
+        QVERIFY(log != 0);
+        QCOMPARE(log->allResults().size(), 5);
+        QCOMPARE(log->allResults().last()->minorCode(), 6);
+
+        ProfileManager::SearchCriteria updated;
+        updated.iKey = KEY;
+        updated.iType = ProfileManager::SearchCriteria::EXISTS;
+        QSet<QString> candidates;
+        QVERIFY(store.candidates(QList<ProfileManager::SearchCriteria>() << updated,
+                                 candidates));
+        QVERIFY(candidates.contains(OVI_CALENDAR));
+
+        // Export back to the file layout.
+        QVERIFY(store.exportXml(primaryPath + "/export") > 0);
+        QVERIFY(QFile::exists(primaryPath + "/export/sync/" + OVI_CALENDAR + ".xml"));
+        QVERIFY(QFile::exists(primaryPath + "/export/sync/logs/" + OVI_CALENDAR +
+                              ".log.xml"));
+
+        // Rename and removal.
+        const QString NEW_NAME = "renamed";
+        QVERIFY(pm.rename(OVI_CALENDAR, NEW_NAME));
+        QVERIFY(pm.profileNames(Profile::TYPE_SYNC).contains(NEW_NAME));
+        QVERIFY(!pm.profileNames(Profile::TYPE_SYNC).contains(OVI_CALENDAR));
+        QScopedPointer<SyncProfile> renamed(pm.syncProfile(NEW_NAME));
+        QVERIFY(renamed != 0);
+        QCOMPARE(renamed->name(), NEW_NAME);
+        QCOMPARE(renamed->log()->allResults().size(), 5);
+
+        QVERIFY(pm.removeProfile(NEW_NAME));
+        QVERIFY(!pm.profileNames(Profile::TYPE_SYNC).contains(NEW_NAME));
+        QVERIFY(store.loadLog(NEW_NAME) == 0);
+    }
+
+    QDir(primaryPath).removeRecursively();
+}
+
+void ProfileManagerTest::testDatabaseMigration()
+{
+    const QString KEY = "migrationkey";
+    const QString primaryPath = USERPROFILE_DIR + "/migration";
+    const QString databasePath = primaryPath + '/' + SqliteProfileStore::DATABASE_FILE;
+    const QString fileName = primaryPath + '/' + Profile::TYPE_SYNC + '/' +
+        OVI_CALENDAR + ".xml";
+    QDir(primaryPath).removeRecursively();
+
+    {
+        // Start with a profile file.
+        ProfileManager xmlPm(USERPROFILE_DIR, SYSTEMPROFILE_DIR);
+        QScopedPointer<Profile> source(xmlPm.profile(OVI_CALENDAR, Profile::TYPE_SYNC));
+        QVERIFY(source != 0);
+        ProfileManager pm(primaryPath, SYSTEMPROFILE_DIR);
+        QVERIFY(!pm.updateProfile(*source).isEmpty());
+        QVERIFY(QFile::exists(fileName));
+        QVERIFY(!QFile::exists(databasePath));
+
+        // The files are imported and the manager switches to the database.
+        QVERIFY(pm.useDatabase());
+        QVERIFY(QFile::exists(databasePath));
+        QVERIFY(!QFile::exists(databasePath + ".tmp"));
+        QVERIFY(pm.profileNames(Profile::TYPE_SYNC).contains(OVI_CALENDAR));
+        QVERIFY(!committedDocument(databasePath, OVI_CALENDAR).isEmpty());
+        QVERIFY(pm.useDatabase());
+
+        // Updates are deferred until flushed, but are visible right away.
+        QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        p->setKey(KEY, "deferred");
+        QVERIFY(!pm.updateProfile(*p).isEmpty());
+        QVERIFY(!committedDocument(databasePath, OVI_CALENDAR).contains(KEY));
+        p.reset(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        QCOMPARE(p->key(KEY), QString("deferred"));
+
+        ProfileManager::SearchCriteria updated;
+        updated.iKey = KEY;
+        updated.iValue = "deferred";
+        QList<SyncProfile*> found = pm.getSyncProfilesByData(
+                QList<ProfileManager::SearchCriteria>() << updated);
+        QCOMPARE(found.size(), 1);
+        qDeleteAll(found);
+
+        QVERIFY(pm.flush());
+        QVERIFY(committedDocument(databasePath, OVI_CALENDAR).contains(KEY));
+    }
+
+    {
+        // New managers use the database, the files are not written any more.
+        ProfileManager pm(primaryPath, SYSTEMPROFILE_DIR);
+        QScopedPointer<SyncProfile> p(pm.syncProfile(OVI_CALENDAR));
+        QVERIFY(p != 0);
+        QCOMPARE(p->key(KEY), QString("deferred"));
+
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QVERIFY(!file.readAll().contains(KEY.toLatin1()));
+    }
 
-    // Backup is removed after successful load.
-    QVERIFY(!QFile::exists(fileName + ".bak"));
+    QDir(primaryPath).removeRecursively();
 }
 
 QTEST_MAIN(Buteo::ProfileManagerTest)
@@ -46,6 +46,10 @@ private slots:
 
     void testGetByMultipleCriteria();
 
+    void testQueryPlan();
+
+    void testQueryProfiles();
+
     void testGetByStorage();
 
     void testLog();
@@ -60,6 +64,24 @@ private slots:
 
     void testBackup();
 
+    void testCache();
+
+    void testIndexUpdate();
+
+    void testSnapshot();
+
+    void testResultsJournal();
+
+    void testJournalRecovery();
+
+    void testWriteBehind();
+
+    void testParallelLoad();
+
+    void testDatabaseStore();
+
+    void testDatabaseMigration();
+
 };
 
 }
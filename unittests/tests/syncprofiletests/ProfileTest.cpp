@@ -190,6 +190,17 @@ void ProfileTest::testKeys()
     key2Values = p.keyValues(KEY2);
     QCOMPARE(key2Values.size(), 0);
 
+    // Well-known keys have their fixed identifiers, lookups do not intern.
+    QCOMPARE(ProfileKeys::find(KEY_ENABLED), qint32(ProfileKeys::ENABLED));
+    QCOMPARE(ProfileKeys::name(ProfileKeys::PROFILE_ID), KEY_PROFILE_ID);
+    QCOMPARE(ProfileKeys::find(KEY1), qint32(ProfileKeys::intern(KEY1)));
+    const QString UNKNOWN = "never-set-key";
+    QVERIFY(p.key(UNKNOWN).isNull());
+    p.removeKey(UNKNOWN);
+    QCOMPARE(ProfileKeys::find(UNKNOWN), -1);
+    p.setEnabled(false);
+    QCOMPARE(p.isEnabled(), false);
+    QCOMPARE(p.key(KEY_ENABLED), QString("false"));
 }
 
 void ProfileTest::testFields()
@@ -0,0 +1,213 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "ProfileTreeGenerator.h"
+
+#include <QDir>
+#include <QFile>
+#include <QXmlStreamWriter>
+
+#include "Profile.h"
+#include "ProfileEngineDefs.h"
+#include "SyncLog.h"
+#include "SyncResults.h"
+#include "TargetResults.h"
+
+using namespace Buteo;
+
+static const QString CLIENT_PREFIX("bench-client-");
+static const QString STORAGE_PREFIX("bench-storage-");
+static const QString SYNC_PREFIX("bench-sync-");
+
+static void writeKey(QXmlStreamWriter &aWriter, const QString &aName,
+                     const QString &aValue)
+{
+    aWriter.writeStartElement(TAG_KEY);
+    aWriter.writeAttribute(ATTR_NAME, aName);
+    aWriter.writeAttribute(ATTR_VALUE, aValue);
+    aWriter.writeEndElement();
+}
+
+ProfileTreeGenerator::ProfileTreeGenerator(const QString &aPath)
+:   iPath(aPath),
+    iSharedProfiles(10),
+    iLogSize(5)
+{
+}
+
+void ProfileTreeGenerator::setSharedProfiles(int aCount)
+{
+    iSharedProfiles = qMax(aCount, 1);
+}
+
+void ProfileTreeGenerator::setLogSize(int aCount)
+{
+    iLogSize = aCount;
+}
+
+QString ProfileTreeGenerator::syncProfileName(int aIndex)
+{
+    return SYNC_PREFIX + QString::number(aIndex);
+}
+
+QString ProfileTreeGenerator::storageProfileName(int aIndex)
+{
+    return STORAGE_PREFIX + QString::number(aIndex);
+}
+
+bool ProfileTreeGenerator::generate(int aSyncProfiles)
+{
+    QDir(iPath).removeRecursively();
+    QDir dir;
+    if (!dir.mkpath(iPath + "/" + Profile::TYPE_CLIENT) ||
+        !dir.mkpath(iPath + "/" + Profile::TYPE_STORAGE) ||
+        !dir.mkpath(iPath + "/" + Profile::TYPE_SYNC + "/logs"))
+    {
+        return false;
+    } // no else
+
+    for (int i = 0; i < iSharedProfiles; ++i)
+    {
+        if (!writeSharedProfile(Profile::TYPE_CLIENT,
+                                CLIENT_PREFIX + QString::number(i),
+                                "Sync Transport", "HTTP") ||
+            !writeSharedProfile(Profile::TYPE_STORAGE, storageProfileName(i),
+                                KEY_LOCAL_URI, "./storage/" + QString::number(i)))
+        {
+            return false;
+        } // no else
+    }
+
+    for (int i = 0; i < aSyncProfiles; ++i)
+    {
+        if (!writeSyncProfile(i) || (iLogSize > 0 && !writeLog(i)))
+        {
+            return false;
+        } // no else
+    }
+
+    return true;
+}
+
+bool ProfileTreeGenerator::writeSharedProfile(const QString &aType,
+        const QString &aName, const QString &aKey, const QString &aValue)
+{
+    QFile file(iPath + "/" + aType + "/" + aName + ".xml");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    } // no else
+
+    QXmlStreamWriter writer(&file);
+    writer.setAutoFormatting(true);
+    writer.writeStartDocument();
+    writer.writeStartElement(TAG_PROFILE);
+    writer.writeAttribute(ATTR_NAME, aName);
+    writer.writeAttribute(ATTR_TYPE, aType);
+    writeKey(writer, aKey, aValue);
+    writer.writeEndElement();
+    writer.writeEndDocument();
+
+    return !writer.hasError();
+}
+
+bool ProfileTreeGenerator::writeSyncProfile(int aIndex)
+{
+    const QString name = syncProfileName(aIndex);
+    QFile file(iPath + "/" + Profile::TYPE_SYNC + "/" + name + ".xml");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    } // no else
+
+    QXmlStreamWriter writer(&file);
+    writer.setAutoFormatting(true);
+    writer.writeStartDocument();
+    writer.writeStartElement(TAG_PROFILE);
+    writer.writeAttribute(ATTR_NAME, name);
+    writer.writeAttribute(ATTR_TYPE, Profile::TYPE_SYNC);
+    writeKey(writer, KEY_ENABLED, (aIndex % 4 == 3) ? BOOLEAN_FALSE : BOOLEAN_TRUE);
+    writeKey(writer, KEY_HIDDEN, (aIndex % 10 == 9) ? BOOLEAN_TRUE : BOOLEAN_FALSE);
+    writeKey(writer, KEY_ACCOUNT_ID, QString::number(aIndex));
+    writeKey(writer, KEY_DESTINATION_TYPE, VALUE_ONLINE);
+    writeKey(writer, KEY_DISPLAY_NAME, "Benchmark " + QString::number(aIndex));
+
+    writer.writeStartElement(TAG_PROFILE);
+    writer.writeAttribute(ATTR_NAME, CLIENT_PREFIX +
+                          QString::number(aIndex % iSharedProfiles));
+    writer.writeAttribute(ATTR_TYPE, Profile::TYPE_CLIENT);
+    writer.writeEndElement();
+
+    // Two storages, the first one enabled.
+    for (int s = 0; s < 2; ++s)
+    {
+        writer.writeStartElement(TAG_PROFILE);
+        writer.writeAttribute(ATTR_NAME,
+                storageProfileName((aIndex + s) % iSharedProfiles));
+        writer.writeAttribute(ATTR_TYPE, Profile::TYPE_STORAGE);
+        writeKey(writer, KEY_ENABLED, (s == 0) ? BOOLEAN_TRUE : BOOLEAN_FALSE);
+        writer.writeEndElement();
+    }
+
+    writer.writeStartElement(TAG_SCHEDULE);
+    writer.writeAttribute(ATTR_INTERVAL, QString::number(15 + aIndex % 60));
+    writer.writeAttribute(ATTR_DAYS, "1,2,3,4,5");
+    writer.writeAttribute(ATTR_TIME, "");
+    writer.writeEndElement();
+
+    writer.writeEndElement();
+    writer.writeEndDocument();
+
+    return !writer.hasError();
+}
+
+bool ProfileTreeGenerator::writeLog(int aIndex)
+{
+    const QString name = syncProfileName(aIndex);
+    QFile file(iPath + "/" + Profile::TYPE_SYNC + "/logs/" + name + ".log.xml");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    } // no else
+
+    SyncLog log(name);
+    const QDateTime now = QDateTime::currentDateTime();
+    for (int i = 0; i < iLogSize; ++i)
+    {
+        const bool failed = ((aIndex + i) % 7 == 0);
+        SyncResults results(now.addSecs(-3600 * (iLogSize - i)),
+                failed ? SyncResults::SYNC_RESULT_FAILED : SyncResults::SYNC_RESULT_SUCCESS,
+                failed ? SyncResults::CONNECTION_ERROR : SyncResults::NO_ERROR);
+        results.addTargetResults(TargetResults(storageProfileName(aIndex % iSharedProfiles),
+                ItemCounts(i, 0, 1), ItemCounts(0, i, 1)));
+        log.addResults(results);
+    }
+
+    QXmlStreamWriter writer(&file);
+    writer.setAutoFormatting(true);
+    writer.writeStartDocument();
+    log.toXml(writer);
+    writer.writeEndDocument();
+
+    return !writer.hasError();
+}
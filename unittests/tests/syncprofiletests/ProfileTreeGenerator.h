@@ -0,0 +1,97 @@
+/*
+ * This file is part of buteo-syncfw package
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Sateesh Kavuri <sateesh.kavuri@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef PROFILETREEGENERATOR_H
+#define PROFILETREEGENERATOR_H
+
+#include <QString>
+
+namespace Buteo {
+
+/*! \brief Writes synthetic profile trees for benchmarks.
+ *
+ * The tree has the layout ProfileManager uses in its primary path: N sync
+ * profiles in sync/, each referring to one of M shared client profiles in
+ * client/ and to two of M shared storage profiles in storage/, with a
+ * schedule and a sync log in sync/logs/. Profile i has account id i, every
+ * tenth profile is hidden and every fourth is disabled.
+ */
+class ProfileTreeGenerator
+{
+public:
+    /*! \brief Constructor.
+     *
+     * \param aPath Directory to write the tree to.
+     */
+    explicit ProfileTreeGenerator(const QString &aPath);
+
+    /*! \brief Sets the number of shared client and storage profiles.
+     *
+     * \param aCount Number of profiles of each type, 10 by default.
+     */
+    void setSharedProfiles(int aCount);
+
+    /*! \brief Sets the number of results in the log of each sync profile.
+     *
+     * \param aCount Number of results, 5 by default.
+     */
+    void setLogSize(int aCount);
+
+    /*! \brief Writes the tree, replacing an existing one.
+     *
+     * \param aSyncProfiles Number of sync profiles.
+     * \return True on success.
+     */
+    bool generate(int aSyncProfiles);
+
+    /*! \brief Gets the name of a generated sync profile.
+     *
+     * \param aIndex Index of the profile.
+     */
+    static QString syncProfileName(int aIndex);
+
+    /*! \brief Gets the name of a generated storage profile.
+     *
+     * \param aIndex Index of the profile.
+     */
+    static QString storageProfileName(int aIndex);
+
+private:
+
+    bool writeSyncProfile(int aIndex);
+
+    bool writeLog(int aIndex);
+
+    bool writeSharedProfile(const QString &aType, const QString &aName,
+                            const QString &aKey, const QString &aValue);
+
+    QString iPath;
+
+    int iSharedProfiles;
+
+    int iLogSize;
+};
+
+}
+
+#endif // PROFILETREEGENERATOR_H
@@ -23,6 +23,7 @@
 #include "SyncLogTest.h"
 
 #include <QDomDocument>
+#include <QXmlStreamReader>
 
 #include "SyncLog.h"
 
@@ -73,6 +74,16 @@ void SyncLogTest::testLog()
     QVERIFY(doc2.toString().size() >= LOG_XML.size());
     QCOMPARE(doc2.toString(), doc3.toString());
 
+    // Create from an XML stream.
+    QXmlStreamReader reader(LOG_XML);
+    QVERIFY(reader.readNextStartElement());
+    SyncLog log4(reader);
+    QVERIFY(!reader.hasError());
+    QVERIFY(reader.isEndElement());
+    QDomDocument doc4;
+    doc4.appendChild(log4.toXml(doc4));
+    QCOMPARE(doc4.toString(), doc2.toString());
+
     // Add new results.
     SyncResults newResults;
     newResults.setMajorCode(Buteo::SyncResults::SYNC_RESULT_CANCELLED);
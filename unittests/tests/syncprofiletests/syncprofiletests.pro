@@ -3,6 +3,7 @@ TEMPLATE = subdirs
 SUBDIRS = \
         ProfileFactoryTest.pro \
         ProfileFieldTest.pro \
+        ProfileManagerBenchmark.pro \
         ProfileManagerTest.pro \
         ProfileTest.pro \
         StorageProfileTest.pro \